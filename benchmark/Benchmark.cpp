@@ -0,0 +1,292 @@
+#include "Log.hpp"
+#include "graphics/Engine.hpp"
+#include "graphics/CameraPath.hpp"
+#include "SceneLoader.hpp"
+
+//libs
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Deterministic benchmark: loads a named scene, replays a camera path on a fixed timestep
+// and reports per-frame CPU record, submit and GPU times with their percentiles as JSON.
+//
+// usage: m1Benchmark [--scene cubes|helmet] [--grid N] [--path camera_path.txt] [--frames N] [--warmup N]
+//                    [--dt seconds] [--window] [--gpu-driven] [--packed-vertices] [--output results.json]
+
+namespace
+{
+	struct BenchmarkOptions
+	{
+		std::string scene = "cubes";
+		uint32_t gridSize = 10;
+		std::string cameraPath; // empty: orbit around the scene
+		uint32_t frames = 1000;
+		uint32_t warmupFrames = 60;
+		float dt = 1.0f / 60.0f;
+		bool windowed = false;
+		bool gpuDriven = false;
+		bool packedVertices = false;
+		std::string outputPath = "benchmark.json";
+	};
+
+	struct FrameSample
+	{
+		float cpuRecordMs = 0.0f;
+		float submitMs = 0.0f;
+		float gpuMs = -1.0f; // -1 if not available
+		float frameMs = 0.0f;
+	};
+
+	struct Stats
+	{
+		float mean = 0.0f;
+		float p50 = 0.0f;
+		float p95 = 0.0f;
+		float p99 = 0.0f;
+		float max = 0.0f;
+		size_t count = 0;
+	};
+
+	BenchmarkOptions parseOptions(int argc, char* argv[])
+	{
+		BenchmarkOptions options;
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--scene" && hasValue)
+				options.scene = argv[++i];
+			else if (arg == "--grid" && hasValue)
+				options.gridSize = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else if (arg == "--path" && hasValue)
+				options.cameraPath = argv[++i];
+			else if (arg == "--frames" && hasValue)
+				options.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else if (arg == "--warmup" && hasValue)
+				options.warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else if (arg == "--dt" && hasValue)
+				options.dt = std::stof(argv[++i]);
+			else if (arg == "--window")
+				options.windowed = true;
+			else if (arg == "--gpu-driven")
+				options.gpuDriven = true;
+			else if (arg == "--packed-vertices")
+				options.packedVertices = true;
+			else if (arg == "--output" && hasValue)
+				options.outputPath = argv[++i];
+			else
+				m1::Log::Get().Warning("Unknown benchmark argument: " + arg);
+		}
+		return options;
+	}
+
+	void loadScene(m1::Engine& engine, const BenchmarkOptions& options)
+	{
+		if (options.scene == "cubes")
+			m1::loadCubes(engine, options.gridSize);
+		else if (options.scene == "helmet")
+			m1::loadGltf(engine, std::string(PROJECT_SOURCE_DIR) + "/resources/DamagedHelmet.glb");
+		else
+			throw std::runtime_error("Unknown benchmark scene " + options.scene);
+	}
+
+	// nearest-rank percentiles
+	Stats computeStats(std::vector<float> values)
+	{
+		Stats stats;
+		stats.count = values.size();
+		if (values.empty())
+			return stats;
+
+		std::sort(values.begin(), values.end());
+		auto percentile = [&values](float p)
+		{
+			size_t rank = static_cast<size_t>(std::ceil(p / 100.0f * static_cast<float>(values.size())));
+			return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+		};
+
+		double sum = 0.0;
+		for (float v : values)
+			sum += v;
+
+		stats.mean = static_cast<float>(sum / static_cast<double>(values.size()));
+		stats.p50 = percentile(50.0f);
+		stats.p95 = percentile(95.0f);
+		stats.p99 = percentile(99.0f);
+		stats.max = values.back();
+		return stats;
+	}
+
+	std::string statsToJson(const Stats& stats)
+	{
+		return std::format(R"({{ "count": {}, "mean": {:.4f}, "p50": {:.4f}, "p95": {:.4f}, "p99": {:.4f}, "max": {:.4f} }})",
+			stats.count, stats.mean, stats.p50, stats.p95, stats.p99, stats.max);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	m1::Log::Get().SetLevel(m1::LogLevel::Warning);
+
+	BenchmarkOptions options = parseOptions(argc, argv);
+
+	// fixed configuration: no UI and no particles (their simulation depends on the wall clock)
+	m1::EngineConfig engineConfig
+	{
+		.msaaEnabled = true,
+		.shadowsEnabled = true,
+		.particlesEnabled = false,
+		.uiEnabled = false,
+		.lightingType = m1::LightingType::Pbr,
+		.gpuDrivenEnabled = options.gpuDriven,
+		.vertexFormat = options.packedVertices ? m1::VertexFormat::Packed : m1::VertexFormat::Standard,
+		.headless = !options.windowed,
+	};
+
+	try
+	{
+		m1::Engine engine{engineConfig};
+		loadScene(engine, options);
+		engine.compile();
+
+		m1::Camera& camera = engine.getCamera();
+
+		m1::CameraPath path;
+		if (!options.cameraPath.empty())
+			path = m1::CameraPath::load(options.cameraPath);
+
+		if (path.empty())
+		{
+			// default path: one orbit around the scene for the whole benchmark
+			const m1::BBox& bbox = engine.getSceneBBox();
+			float radius = glm::length(bbox.getExtent());
+			float duration = static_cast<float>(options.frames) * options.dt;
+			path = m1::CameraPath::orbit(bbox.getCenter(), camera.getUp(), radius, radius * 0.5f, duration);
+		}
+
+		// GPU times are read back when a frame slot is reused, so they arrive as many frames later as there are frames in flight:
+		// render some additional frames at the end to collect all of them
+		const uint32_t totalFrames = options.warmupFrames + options.frames + engine.getFramesInFlight();
+		std::vector<FrameSample> samples(options.frames);
+		uint64_t firstMeasuredFrame = 0;
+
+		auto benchmarkStart = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < totalFrames; i++)
+		{
+			if (options.windowed)
+				glfwPollEvents();
+
+			// fixed timestep: the camera position only depends on the frame number
+			uint32_t measuredIndex = i >= options.warmupFrames ? i - options.warmupFrames : 0;
+			m1::CameraKeyframe keyframe = path.sample(static_cast<float>(measuredIndex) * options.dt);
+			camera.setViewTarget(keyframe.position, keyframe.target, camera.getUp());
+
+			auto frameStart = std::chrono::high_resolution_clock::now();
+			engine.renderFrame();
+			float frameMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - frameStart).count();
+
+			const m1::FrameTimings& timings = engine.getLastFrameTimings();
+			if (i == options.warmupFrames)
+				firstMeasuredFrame = timings.frameIndex;
+
+			if (i >= options.warmupFrames && measuredIndex < options.frames)
+			{
+				samples[measuredIndex].cpuRecordMs = timings.cpuRecordMs;
+				samples[measuredIndex].submitMs = timings.submitMs;
+				samples[measuredIndex].frameMs = frameMs;
+			}
+
+			// the GPU time refers to an older frame
+			if (i >= options.warmupFrames && timings.gpuFrameIndex >= static_cast<int64_t>(firstMeasuredFrame))
+			{
+				uint64_t gpuIndex = static_cast<uint64_t>(timings.gpuFrameIndex) - firstMeasuredFrame;
+				if (gpuIndex < options.frames)
+					samples[gpuIndex].gpuMs = timings.gpuMs;
+			}
+		}
+
+		float totalSeconds = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - benchmarkStart).count();
+
+		// statistics
+		std::vector<float> cpuRecord, submit, gpu, frame;
+		for (const auto& sample : samples)
+		{
+			cpuRecord.push_back(sample.cpuRecordMs);
+			submit.push_back(sample.submitMs);
+			frame.push_back(sample.frameMs);
+			if (sample.gpuMs >= 0.0f)
+				gpu.push_back(sample.gpuMs);
+		}
+
+		Stats cpuRecordStats = computeStats(cpuRecord);
+		Stats submitStats = computeStats(submit);
+		Stats gpuStats = computeStats(gpu);
+		Stats frameStats = computeStats(frame);
+
+		// JSON report
+		std::ofstream file(options.outputPath);
+		if (!file.is_open())
+			throw std::runtime_error("Failed to write benchmark results " + options.outputPath);
+
+		file << "{\n";
+		file << std::format("  \"scene\": \"{}\",\n", options.scene);
+		if (options.scene == "cubes")
+			file << std::format("  \"grid\": {},\n", options.gridSize);
+		file << std::format("  \"device\": \"{}\",\n", engine.getDevice().getProperties().deviceName);
+		file << std::format("  \"headless\": {},\n", !options.windowed);
+		file << std::format("  \"gpuDriven\": {},\n", engine.getGpuDrivenEnabled());
+		file << std::format("  \"packedVertices\": {},\n", options.packedVertices);
+		file << std::format("  \"frames\": {},\n", options.frames);
+		file << std::format("  \"warmupFrames\": {},\n", options.warmupFrames);
+		file << std::format("  \"dt\": {},\n", options.dt);
+		file << std::format("  \"totalSeconds\": {:.3f},\n", totalSeconds);
+		file << "  \"stats\": {\n";
+		file << "    \"cpuRecordMs\": " << statsToJson(cpuRecordStats) << ",\n";
+		file << "    \"submitMs\": " << statsToJson(submitStats) << ",\n";
+		file << "    \"gpuMs\": " << statsToJson(gpuStats) << ",\n";
+		file << "    \"frameMs\": " << statsToJson(frameStats) << "\n";
+		file << "  },\n";
+
+		// per-pass GPU times, averaged over the last frames
+		const m1::GpuProfiler& profiler = engine.getGpuProfiler();
+		file << "  \"gpuPassAvgMs\": {";
+		for (uint32_t i = 0; i < m1::GpuProfiler::SCOPES_COUNT; i++)
+		{
+			auto scope = static_cast<m1::GpuScope>(i);
+			file << std::format("{} \"{}\": {:.4f}", i == 0 ? "" : ",", m1::GpuProfiler::getScopeName(scope), profiler.getAverageMs(scope));
+		}
+		file << " },\n";
+
+		file << "  \"perFrame\": [\n";
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			const auto& s = samples[i];
+			file << std::format(R"(    {{ "cpuRecordMs": {:.4f}, "submitMs": {:.4f}, "gpuMs": {:.4f}, "frameMs": {:.4f} }})",
+				s.cpuRecordMs, s.submitMs, s.gpuMs, s.frameMs);
+			file << (i + 1 < samples.size() ? ",\n" : "\n");
+		}
+		file << "  ]\n";
+		file << "}\n";
+
+		std::cout << std::format("Benchmark '{}': {} frames, cpu record p50 {:.3f} ms p99 {:.3f} ms, gpu p50 {:.3f} ms p99 {:.3f} ms -> {}",
+			options.scene, options.frames, cpuRecordStats.p50, cpuRecordStats.p99, gpuStats.p50, gpuStats.p99, options.outputPath) << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		m1::Log::Get().Error(e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -11,22 +11,50 @@ layout (location = 0) out vec3 fragColor;
 layout(set = 0, binding = 1) uniform FrameUbo {
     mat4 view;
     mat4 proj;
-    mat4 lightViewProjMatrix;
+    mat4 cascadeViewProj[4]; // light view projection of each shadow cascade
+    vec4 cascadeSplits;      // view depth where each cascade ends
     vec4 camPos;
+    float iblIntensity;
     int shadowsEnabled;
+    int cascadeCount;
 } frameUbo;
 
-// Push Constants
-layout(push_constant) uniform Push {
+// per object data, written once per frame
+struct ObjectData {
     mat4 model;
-    mat3 normalMatrix;
-} push;
+    mat4 normalMatrix;
+    vec4 boundsCenter;
+    vec4 boundsExtent;
+    uint batchIndex;
+    uint firstCommand;
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint shadowIndexCount;
+    uint shadowFirstIndex;
+    uint firstMeshlet;
+    uint meshletCount;
+    uint padding[3];
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer ObjectsSsbo {
+    ObjectData objects[];
+};
+
+// object index of each instance: the draws of a group of objects sharing mesh and material are instanced,
+// firstInstance is their first entry (written with the draw lists, or by the GPU culling)
+layout(std430, set = 0, binding = 8) readonly buffer InstancesSsbo {
+    uint instances[];
+};
 
 void main() {
+    uint objectIndex = instances[gl_InstanceIndex];
+    mat4 model = objects[objectIndex].model;
+
     // gl_Position is a built-in output variable that stores the final vertex position in the vertex shader
     // Sets the final vertex position in clip space (range [-w, +w] for x, y, z. GPU uses them for clipping against the view frustum before perspective division to NDC.)
     // The x,y,z values will be converted in Normalized Device Coordinates (NDC) (range [-1, 1]) by dividing them by w
-    gl_Position = frameUbo.proj * frameUbo.view * push.model * vec4(position, 1.0);
+    gl_Position = frameUbo.proj * frameUbo.view * model * vec4(position, 1.0);
 
     fragColor = color; // Pass the color to the fragment shader
 }
\ No newline at end of file
@@ -10,9 +10,12 @@ layout (location = 0) out vec3 fragColor;
 layout(set = 0, binding = 1) uniform FrameUbo {
     mat4 view;
     mat4 proj;
-    mat4 lightViewProjMatrix;
+    mat4 cascadeViewProj[4]; // light view projection of each shadow cascade
+    vec4 cascadeSplits;      // view depth where each cascade ends
     vec4 camPos;
+    float iblIntensity;
     int shadowsEnabled;
+    int cascadeCount;
 } frameUbo;
 
 void main() {
@@ -12,7 +12,6 @@ const float PI = 3.14159265359;
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec2 fragTextCoord;
 layout (location = 2) in vec3 fragPosWorld;
-layout (location = 3) in vec4 fragPosLightSpace;
 layout (location = 4) in mat3 TBN;// Tangent-Bitangent-Normal matrix for normal mapping
 
 // Output. Specify the out location (index of the framebuffer attachment) and out variable
@@ -22,10 +21,12 @@ layout (location = 0) out vec4 outColor;
 layout(set = 0, binding = 1) uniform FrameUbo {
     mat4 view;
     mat4 proj;
-    mat4 lightViewProjMatrix;
+    mat4 cascadeViewProj[4]; // light view projection of each shadow cascade
+    vec4 cascadeSplits;      // view depth where each cascade ends
     vec4 camPos;
     float iblIntensity;
     int shadowsEnabled;
+    int cascadeCount;
 } frameUbo;
 
 layout(set = 0, binding = 2) uniform LightsUbo {
@@ -34,7 +35,7 @@ layout(set = 0, binding = 2) uniform LightsUbo {
     int numLights;
 } lightsUbo;
 
-layout (set = 0, binding = 3) uniform sampler2D shadowMap;
+layout (set = 0, binding = 3) uniform sampler2DArray shadowMap; // one layer for each cascade
 layout (set = 0, binding = 4) uniform samplerCube irradianceMap;
 layout (set = 0, binding = 5) uniform samplerCube prefilteredMap;
 layout (set = 0, binding = 6) uniform sampler2D brdfLUT;
@@ -54,12 +55,6 @@ layout (set = 1, binding = 3) uniform sampler2D metallicRoughnessMap;
 layout (set = 1, binding = 4) uniform sampler2D aoMap;// ambient occlusion
 layout (set = 1, binding = 5) uniform sampler2D emissiveMap;// Lets materials glow independent of lighting (e.g., LEDs, screens)
 
-// Push constant
-layout(push_constant) uniform Push {
-    mat4 model;
-    mat3 normalMatrix;
-} push;
-
 // Normal Distribution Function (D) - GGX/Trowbridge-Reitz Distribution
 // Approximates the amount the surface's microfacets are aligned to the halfway vector
 float DistributionGGX(float NdotH, float roughness) {
@@ -97,13 +92,16 @@ vec3 FresnelSchlick(float cosTheta, vec3 F0, float roughness)
 }
 
 vec3 calculateLight(Light light, vec3 N, vec3 baseColor, vec3 V, vec3 F0, float metallic, float roughness, vec2 texelSize);
-float calculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir, vec2 texelSize);
+float calculateShadow(vec3 normal, vec3 lightDir, vec2 texelSize);
 
 void main(){
 
     // TODO optimizaion?: don't transform the normal but light variable in tangent space in the vertex shader (see learnOpengl)
     // Sample normal map and convert from [0,1] to [-1,1] range
-    vec3 N = texture(normalMap, fragTextCoord).xyz * 2.0 - 1.0;
+    // z is reconstructed from xy: the BC5 normal maps only store two channels
+    vec3 N;
+    N.xy = texture(normalMap, fragTextCoord).xy * 2.0 - 1.0;
+    N.z = sqrt(max(1.0 - dot(N.xy, N.xy), 0.0));
     // Transform normal from tangent space to world space
     N = normalize(TBN * N);
 
@@ -136,7 +134,7 @@ void main(){
     vec3 F0 = mix(vec3(0.04), baseColor.rgb, metallic);
 
     // get the size of one texel in texture space (used for PCF in shadow calculation)
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0).xy;
 
     // Initialize outgoing radiance accumulator
     vec3 Lo = vec3(0.0);
@@ -195,7 +193,7 @@ vec3 calculateLight(Light light, vec3 N, vec3 baseColor, vec3 V, vec3 F0, float
     }
     else if (frameUbo.shadowsEnabled == 1) {
         // compute shadow for directional light
-        shadow = calculateShadow(fragPosLightSpace, N, L, texelSize);
+        shadow = calculateShadow(N, L, texelSize);
     }
 
     // === BRDF EVALUATION ===
@@ -228,8 +226,20 @@ vec3 calculateLight(Light light, vec3 N, vec3 baseColor, vec3 V, vec3 F0, float
     return (kD * baseColor / PI + specular) * radiance * NdotL;
 }
 
-float calculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir, vec2 texelSize)
+float calculateShadow(vec3 normal, vec3 lightDir, vec2 texelSize)
 {
+    // cascade of the fragment: the first one ending after its view depth
+    float viewDepth = -(frameUbo.view * vec4(fragPosWorld, 1.0)).z;
+    int cascade = 0;
+    while (cascade < frameUbo.cascadeCount && viewDepth > frameUbo.cascadeSplits[cascade])
+        cascade++;
+
+    // fragments beyond the shadow distance are not in shadow
+    if (cascade == frameUbo.cascadeCount)
+        return 1.0;
+
+    vec4 fragPosLightSpace = frameUbo.cascadeViewProj[cascade] * vec4(fragPosWorld, 1.0);
+
     // convert in Normalized Device Coordinates
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
 
@@ -252,7 +262,7 @@ float calculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir, vec2 t
     {
         for (int y = -1; y <= 1; ++y)
         {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
+            float pcfDepth = texture(shadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r;
             shadow += currentDepth - bias < pcfDepth ? 1.0 : 0.0;
         }
     }
@@ -1,7 +1,7 @@
 #version 450 // Specifies the GLSL version
 
 // Input
-layout (location = 0) in vec3 position;
+layout (location = 0) in vec4 position; // w = tangent handedness (packed format only)
 layout (location = 1) in vec3 color;
 layout (location = 2) in vec3 normal;
 layout (location = 3) in vec2 texCoord;
@@ -11,41 +11,77 @@ layout (location = 4) in vec4 tangent;
 layout (location = 0) out vec3 fragColor;
 layout (location = 1) out vec2 fragTexCoord;
 layout (location = 2) out vec3 fragPosWorld;
-layout (location = 3) out vec4 fragPosLightSpace;
 layout (location = 4) out mat3 TBN;// Tangent-Bitangent-Normal matrix for normal mapping
 
-layout(set = 0, binding = 0) uniform ObjectUbo {
-    mat4 model;
-    mat3 normalMatrix;
-} objectUbo;
-
 layout(set = 0, binding = 1) uniform FrameUbo {
     mat4 view;
     mat4 proj;
-    mat4 lightViewProjMatrix;
+    mat4 cascadeViewProj[4]; // light view projection of each shadow cascade
+    vec4 cascadeSplits;      // view depth where each cascade ends
     vec4 camPos;
+    float iblIntensity;
     int shadowsEnabled;
+    int cascadeCount;
 } frameUbo;
 
-layout(push_constant) uniform Push {
+// packed vertex format (PackedVertex): normal and tangent are octahedral encoded, the position w is the tangent handedness.
+// The positions are dequantized by the model matrix
+layout (constant_id = 1) const bool PACKED_VERTICES = false;
+
+vec3 octDecode(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+    return normalize(v);
+}
+
+// per object data, written once per frame
+struct ObjectData {
     mat4 model;
-    mat3 normalMatrix;
-} push;
+    mat4 normalMatrix;
+    vec4 boundsCenter;
+    vec4 boundsExtent;
+    uint batchIndex;
+    uint firstCommand;
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint shadowIndexCount;
+    uint shadowFirstIndex;
+    uint firstMeshlet;
+    uint meshletCount;
+    uint padding[3];
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer ObjectsSsbo {
+    ObjectData objects[];
+};
+
+// object index of each instance: the draws of a group of objects sharing mesh and material are instanced,
+// firstInstance is their first entry (written with the draw lists, or by the GPU culling)
+layout(std430, set = 0, binding = 8) readonly buffer InstancesSsbo {
+    uint instances[];
+};
 
 void main() {
+    uint objectIndex = instances[gl_InstanceIndex];
+    mat4 model = objects[objectIndex].model;
+    mat3 normalMatrix = mat3(objects[objectIndex].normalMatrix);
+
     // gl_Position is a built-in output variable that stores the final vertex position in the vertex shader
     // Sets the final vertex position in clip space (range [-w, +w] for x, y, z. GPU uses them for clipping against the view frustum before perspective division to NDC.)
     // The x,y,z values will be converted in Normalized Device Coordinates (NDC) (range [-1, 1]) by dividing them by w
-    gl_Position = frameUbo.proj * frameUbo.view * push.model * vec4(position, 1.0);
+    gl_Position = frameUbo.proj * frameUbo.view * model * vec4(position.xyz, 1.0);
 
     fragColor = color;// Pass the color to the fragment shader
     fragTexCoord = texCoord;
-    fragPosWorld = vec3(push.model * vec4(position, 1.0));
-    fragPosLightSpace = frameUbo.lightViewProjMatrix * vec4(fragPosWorld, 1.0);
+    fragPosWorld = vec3(model * vec4(position.xyz, 1.0));
 
     // compute TBN matrix for normal mapping
-    vec3 T = normalize(vec3(push.normalMatrix * tangent.xyz));
-    vec3 N = normalize(push.normalMatrix * normal);;
-    vec3 B = normalize(cross(N, T)) * tangent.w; // Bitangent (w = handedness)
+    vec3 objectNormal = PACKED_VERTICES ? octDecode(normal.xy) : normal;
+    vec4 objectTangent = PACKED_VERTICES ? vec4(octDecode(tangent.xy), position.w) : tangent;
+    vec3 T = normalize(vec3(normalMatrix * objectTangent.xyz));
+    vec3 N = normalize(normalMatrix * objectNormal);
+    vec3 B = normalize(cross(N, T)) * objectTangent.w; // Bitangent (w = handedness)
     TBN = mat3(T, B, N);
 }
\ No newline at end of file
@@ -11,7 +11,6 @@ layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec2 fragTextCoord;
 layout (location = 2) in vec3 fragPosWorld;
 layout (location = 3) in vec3 fragNormalWorld;
-layout (location = 4) in vec4 fragPosLightSpace;
 
 // Output. Specify the out location (index of the framebuffer attachment) and out variable
 layout (location = 0) out vec4 outColor;
@@ -27,13 +26,16 @@ layout(set = 0, binding = 2) uniform LightsUbo {
 layout(set = 0, binding = 1) uniform FrameUbo {
     mat4 view;
     mat4 proj;
-    mat4 lightViewProjMatrix;
+    mat4 cascadeViewProj[4]; // light view projection of each shadow cascade
+    vec4 cascadeSplits;      // view depth where each cascade ends
     vec4 camPos;
+    float iblIntensity;
     int shadowsEnabled;
+    int cascadeCount;
 } frameUbo;
 
 // shadow map sampler
-layout(set = 0, binding = 3) uniform sampler2D shadowMap;
+layout(set = 0, binding = 3) uniform sampler2DArray shadowMap; // one layer for each cascade
 
 // Material ubo
 layout (set = 1, binding = 0) uniform MaterialUbo {
@@ -49,20 +51,13 @@ layout (set = 1, binding = 1) uniform sampler2D diffuseMap;
 // specular map sampler
 layout (set = 1, binding = 2) uniform sampler2D specularMap;
 
-// Push constant
-layout(push_constant) uniform Push {
-    mat4 model;
-    mat3 normalMatrix;
-} push;
-
 // Functions
 vec3 calculateLight(Light light, vec3 fragNormal, vec3 diffuseColor, vec3 specularColor, vec2 texelSize);
-float calculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir, vec2 texelSize);
+float calculateShadow(vec3 normal, vec3 lightDir, vec2 texelSize);
 
 void main(){
     //outColor = vec4(fragColor, 1.0); // rgba color, range [0, 1]
     //outColor = vec4(fragTexCoord, 0.0, 1.0);
-    //outColor = vec4(push.color, 1.0);
     
     //outColor = texture(texSampler, fragTexCoord);
     //return;
@@ -77,7 +72,7 @@ void main(){
     vec3 fragNormal = normalize(fragNormalWorld);
 
     // get the size of one texel in texture space (used for PCF in shadow calculation)
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0).xy;
 
     // loops on the lights to get diffuse and specular components
     vec3 diffuseAndSpecularComponent = vec3(0.0);
@@ -111,7 +106,7 @@ vec3 calculateLight(Light light, vec3 fragNormal, vec3 diffuseColor, vec3 specul
     }
     else if (frameUbo.shadowsEnabled == 1) {
         // compute shadow for directional light
-        shadow = calculateShadow(fragPosLightSpace, fragNormal, lightDir, texelSize);
+        shadow = calculateShadow(fragNormal, lightDir, texelSize);
     }
 
     // diffuse strength of the light by taking dot product between frag normal and light direction
@@ -143,8 +138,20 @@ vec3 calculateLight(Light light, vec3 fragNormal, vec3 diffuseColor, vec3 specul
     return (diffuseComponent + specularComponent) * shadow;
 }
 
-float calculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir, vec2 texelSize)
+float calculateShadow(vec3 normal, vec3 lightDir, vec2 texelSize)
 {
+    // cascade of the fragment: the first one ending after its view depth
+    float viewDepth = -(frameUbo.view * vec4(fragPosWorld, 1.0)).z;
+    int cascade = 0;
+    while (cascade < frameUbo.cascadeCount && viewDepth > frameUbo.cascadeSplits[cascade])
+        cascade++;
+
+    // fragments beyond the shadow distance are not in shadow
+    if (cascade == frameUbo.cascadeCount)
+        return 1.0;
+
+    vec4 fragPosLightSpace = frameUbo.cascadeViewProj[cascade] * vec4(fragPosWorld, 1.0);
+
     // convert in Normalized Device Coordinates
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
 
@@ -167,7 +174,7 @@ float calculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir, vec2 t
     {
         for(int y = -1; y <= 1; ++y)
         {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
+            float pcfDepth = texture(shadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r;
             shadow += currentDepth - bias < pcfDepth ? 1.0 : 0.0;
         }
     }
@@ -5,17 +5,51 @@ layout (location = 0) in vec3 position;
 layout(set = 0, binding = 1) uniform FrameUbo {
     mat4 view;
     mat4 proj;
-    mat4 lightViewProjMatrix;
+    mat4 cascadeViewProj[4]; // light view projection of each shadow cascade
+    vec4 cascadeSplits;      // view depth where each cascade ends
     vec4 camPos;
+    float iblIntensity;
     int shadowsEnabled;
+    int cascadeCount;
 } frameUbo;
 
-layout(push_constant) uniform Push {
+// per object data, written once per frame
+struct ObjectData {
     mat4 model;
-    mat3 normalMatrix;
+    mat4 normalMatrix;
+    vec4 boundsCenter;
+    vec4 boundsExtent;
+    uint batchIndex;
+    uint firstCommand;
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint shadowIndexCount;
+    uint shadowFirstIndex;
+    uint firstMeshlet;
+    uint meshletCount;
+    uint padding[3];
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer ObjectsSsbo {
+    ObjectData objects[];
+};
+
+// object index of each instance: the draws of a group of objects sharing mesh and material are instanced,
+// firstInstance is their first entry (written with the draw lists, or by the GPU culling)
+layout(std430, set = 0, binding = 8) readonly buffer InstancesSsbo {
+    uint instances[];
+};
+
+// layer of the shadow map being rendered
+layout(push_constant) uniform Push {
+    uint cascadeIndex;
 } push;
 
 void main()
 {
-    gl_Position = frameUbo.lightViewProjMatrix * push.model * vec4(position, 1.0);
+    uint objectIndex = instances[gl_InstanceIndex];
+    mat4 model = objects[objectIndex].model;
+
+    gl_Position = frameUbo.cascadeViewProj[push.cascadeIndex] * model * vec4(position, 1.0);
 }
@@ -5,6 +5,8 @@
 #include <stb_image.h>
 
 #include "Utils.hpp"
+#include "ThreadPool.hpp"
+#include "Log.hpp"
 #include "graphics/Engine.hpp"
 #include "graphics/Sampler.hpp"
 #include "graphics/SceneObject.hpp"
@@ -44,8 +46,7 @@ namespace m1
 					fastgltf::Options::DontRequireValidAssetMember |
 					fastgltf::Options::AllowDouble |
 					fastgltf::Options::LoadExternalBuffers |
-					fastgltf::Options::LoadExternalImages |
-					fastgltf::Options::GenerateMeshIndices;
+					fastgltf::Options::GenerateMeshIndices; // the external images are loaded by the worker threads
 
 			auto gltfFile = fastgltf::MappedGltfFile::FromPath(path);
 			if (!static_cast<bool>(gltfFile))
@@ -62,31 +63,83 @@ namespace m1
 			}
 
 			_asset = std::move(asset.get());
+			_directory = path.parent_path();
+			_compressedTexturesSupported = engine.getDevice().getFeatures().textureCompressionBC;
+			_textureStreamingEnabled = engine.getTextureStreamer() != nullptr;
+
+			auto startTime = std::chrono::steady_clock::now();
+
+			// decode the images and load the meshes on the worker threads
+			ThreadPool threadPool;
+			submitJobs(threadPool);
 
 			// load samplers
 			loadSamplers(engine);
 
-			// load materials and textures
+			// load materials and textures (waits for the decoded images)
 			images.resize(_asset.images.size());
 			textures.resize(_asset.textures.size());
 			for (auto &material: _asset.materials)
 				loadMaterial(material, engine);
 
-			// load meshes
-			for (auto &mesh: _asset.meshes)
-				meshes.push_back(loadMesh(mesh));
+			// collect the meshes
+			for (auto &loadedMesh: _loadedMeshes)
+				meshes.push_back(loadedMesh.get());
 
-			// load nodes
-			for (auto& node : _asset.nodes)
-				loadNode(node, engine);
+			// load the node hierarchies from their roots: the nodes of the default scene, or the nodes without parent
+			std::vector<size_t> rootNodes;
+			if (!_asset.scenes.empty())
+			{
+				const auto& scene = _asset.scenes[_asset.defaultScene.value_or(0)];
+				rootNodes.assign(scene.nodeIndices.begin(), scene.nodeIndices.end());
+			}
+			else
+			{
+				std::vector<bool> isChild(_asset.nodes.size(), false);
+				for (const auto& node : _asset.nodes)
+					for (auto childIndex : node.children)
+						isChild[childIndex] = true;
+				for (size_t i = 0; i < _asset.nodes.size(); i++)
+					if (!isChild[i])
+						rootNodes.push_back(i);
+			}
+			for (auto nodeIndex : rootNodes)
+				loadNode(_asset.nodes[nodeIndex], engine, INVALID_SCENE_NODE);
 
 			for (auto& mat: materials)
 				engine.addMaterial(std::move(mat));
+
+			auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+			Log::Get().Info(std::format("glTF loaded in {:.1f} ms ({} threads)", elapsed.count(), threadPool.getThreadCount()));
 		}
 
 		return true;
 	}
 
+	void GltfReader::DecodedImage::PixelsDeleter::operator()(unsigned char* pixels) const
+	{
+		stbi_image_free(pixels);
+	}
+
+	void GltfReader::submitJobs(ThreadPool& threadPool)
+	{
+		// images used by the textures
+		_decodedImages.resize(_asset.images.size());
+		for (const auto& texture : _asset.textures)
+		{
+			if (!texture.imageIndex.has_value())
+				continue;
+
+			auto imageIndex = texture.imageIndex.value();
+			if (!_decodedImages[imageIndex].valid())
+				_decodedImages[imageIndex] = threadPool.submit([this, imageIndex] { return decodeImage(_asset.images[imageIndex], true); });
+		}
+
+		// meshes: accessors and tangents
+		for (const auto& mesh : _asset.meshes)
+			_loadedMeshes.push_back(threadPool.submit([this, &mesh] { return loadMesh(mesh); }));
+	}
+
 	void GltfReader::loadSamplers(Engine& engine)
 	{
 		auto extract_filter = [&](fastgltf::Filter filter)
@@ -138,25 +191,26 @@ namespace m1
 		}
 	}
 
-	void GltfReader::loadNode(const fastgltf::Node& gltfNode, Engine& engine)
+	void GltfReader::loadNode(const fastgltf::Node& gltfNode, Engine& engine, SceneNode parent)
 	{
-		// get transformation
+		// get transformation (relative to the parent node)
 		auto matrix = fastgltf::getTransformMatrix(gltfNode);
 		auto transform = glm::mat4(1.0f);
 		for (int column = 0; column < 4; ++column)
 			for (int row = 0; row < 4; ++row)
 				transform[column][row] = matrix[column][row];
 
-		// assign mesh
+		SceneNode node = engine.getSceneGraph().createNode(parent, transform);
+
+		// assign mesh (the primitives share the node)
 		if (gltfNode.meshIndex.has_value())
 		{
 			auto nodeMeshes = meshes[gltfNode.meshIndex.value()];
 
 			for (auto& m: nodeMeshes)
 			{
-				auto sceneObj = SceneObject::createSceneObject();
+				auto sceneObj = SceneObject::createSceneObject(engine.getSceneGraph(), node);
 				sceneObj->setMesh(m);
-				sceneObj->setTransform(transform);
 				engine.addSceneObject(std::move(sceneObj));
 			}
 		}
@@ -166,12 +220,12 @@ namespace m1
 		{
 			for (const auto& childIndex: gltfNode.children)
 			{
-				loadNode(_asset.nodes[childIndex], engine);
+				loadNode(_asset.nodes[childIndex], engine, node);
 			}
 		}
 	}
 
-	std::vector<std::shared_ptr<Mesh>> GltfReader::loadMesh(const fastgltf::Mesh& gltfMesh)
+	std::vector<std::shared_ptr<Mesh>> GltfReader::loadMesh(const fastgltf::Mesh& gltfMesh) const
 	{
 		std::vector<std::shared_ptr<Mesh>> primitives;
 
@@ -188,7 +242,7 @@ namespace m1
 			// A mesh primitive is required to hold the POSITION attribute.
 			assert(gltfPrimitive.indicesAccessor.has_value()); // we should always have indices
 
-			auto& positionAccessor = _asset.accessors[position->accessorIndex];
+			const auto& positionAccessor = _asset.accessors[position->accessorIndex];
 			if (!positionAccessor.bufferViewIndex.has_value())
 				continue;
 			std::vector<Vertex> vertices(positionAccessor.count);
@@ -205,13 +259,13 @@ namespace m1
 			if (gltfPrimitive.materialIndex.has_value())
 			{
 				auto matIndex = gltfPrimitive.materialIndex.value();
-				mesh->setMaterialName(materials[matIndex]->name);
-				auto& gltfMaterial = _asset.materials[matIndex];
+				const auto& gltfMaterial = _asset.materials[matIndex];
+				mesh->setMaterialName(gltfMaterial.name.c_str()); // same name of the Material created by loadMaterial
 
-				auto& baseColorTexture = gltfMaterial.pbrData.baseColorTexture;
+				const auto& baseColorTexture = gltfMaterial.pbrData.baseColorTexture;
 				if (baseColorTexture.has_value())
 				{
-					auto& texture = _asset.textures[baseColorTexture->textureIndex];
+					const auto& texture = _asset.textures[baseColorTexture->textureIndex];
 					if (!texture.imageIndex.has_value())
 						continue;
 
@@ -227,7 +281,7 @@ namespace m1
 			auto texCoord = gltfPrimitive.findAttribute(texcoordAttribute);
 			if (texCoord != gltfPrimitive.attributes.end())
 			{
-				auto& texCoordAccessor = _asset.accessors[texCoord->accessorIndex];
+				const auto& texCoordAccessor = _asset.accessors[texCoord->accessorIndex];
 
 				fastgltf::iterateAccessorWithIndex<fastgltf::math::fvec2>(_asset, texCoordAccessor,
 					[&](fastgltf::math::fvec2 uv, std::size_t idx)
@@ -275,7 +329,7 @@ namespace m1
 			}
 
 			// Indices
-			auto& indexAccessor = _asset.accessors[gltfPrimitive.indicesAccessor.value()];
+			const auto& indexAccessor = _asset.accessors[gltfPrimitive.indicesAccessor.value()];
 			if (!indexAccessor.bufferViewIndex.has_value())
 				continue;
 
@@ -289,84 +343,113 @@ namespace m1
 			mesh->Vertices = std::move(vertices);
 			mesh->Indices = std::move(indices);
 
+			// computed here to run on the worker thread (Mesh::compile skips the meshes already processed)
+			mesh->computeTangents();
+			mesh->optimize();
+			mesh->generateLods();
+			mesh->buildMeshlets();
+
 			primitives.push_back(std::move(mesh));
 		}
 
 		return primitives;
 	}
 
-	std::shared_ptr<Image> GltfReader::loadImage(fastgltf::Image& image, Engine& engine, VkFormat format)
+	GltfReader::DecodedImage GltfReader::decodeImage(const fastgltf::Image& image, bool allowCompressed) const
 	{
-		std::shared_ptr<Image> myImage;
+		DecodedImage decoded;
+		int nrChannels;
 
-		auto createImage = [&](unsigned char* data, int width, int height)
+		auto decodeFromMemory = [&](const std::byte* bytes, size_t size)
 		{
-			uint32_t w = static_cast<uint32_t>(width);
-			uint32_t h = static_cast<uint32_t>(height);
-			ImageParams params
-			{
-				.extent = {w, h},
-				.format = format,
-				.usage = getTextureImageUsageFlags(),
-				.mipLevels = computeMipLevels(w, h)
-			};
-			myImage = std::move(engine.createImage(params, data));
+			decoded.pixels.reset(stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(bytes), static_cast<int>(size),
+				&decoded.width, &decoded.height, &nrChannels, 4));
 		};
 
-		// TODO use KTX2 library? it should also contains mipLevels and image format
-
 		std::visit(fastgltf::visitor{
-			           [](auto &arg) {},
-			           [&](fastgltf::sources::URI &filePath)
+			           [](const auto &arg) {},
+			           [&](const fastgltf::sources::URI &filePath)
 			           {
 				           assert(filePath.fileByteOffset == 0); // We don't support offsets with stbi.
 				           assert(filePath.uri.isLocalPath()); // We're only capable of loading local files.
-				           int width, height, nrChannels;
 
-				           const std::string path(filePath.uri.path().begin(), filePath.uri.path().end());
-				           // Thanks C++.
-				           unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrChannels, 4);
+				           const std::string path = (_directory / filePath.uri.fspath()).string();
+
+				           // texture baked by the texture baker, with its mip chain (the larger levels are streamed later)
+				           if (allowCompressed && _compressedTexturesSupported)
+				           {
+					           decoded.compressedPath = getKtx2Path(path);
+					           decoded.compressed = readKtx2(decoded.compressedPath,
+						           _textureStreamingEnabled ? TextureStreamer::MIP_TAIL_EXTENT : UINT32_MAX);
+					           if (decoded.compressed)
+						           return;
+				           }
 
-				           createImage(data, width, height);
-				           stbi_image_free(data);
+				           decoded.pixels.reset(stbi_load(path.c_str(), &decoded.width, &decoded.height, &nrChannels, 4));
 			           },
-			           [&](fastgltf::sources::Array &vector)
+			           [&](const fastgltf::sources::Array &vector)
 			           {
-				           int width, height, nrChannels;
-				           unsigned char *data = stbi_load_from_memory(
-					           reinterpret_cast<const stbi_uc *>(vector.bytes.data()),
-					           static_cast<int>(vector.bytes.size()), &width, &height, &nrChannels, 4);
-
-				           createImage(data, width, height);
-				           stbi_image_free(data);
+				           decodeFromMemory(vector.bytes.data(), vector.bytes.size());
 			           },
-			           [&](fastgltf::sources::BufferView &view)
+			           [&](const fastgltf::sources::BufferView &view)
 			           {
-				           auto &bufferView = _asset.bufferViews[view.bufferViewIndex];
-				           auto &buffer = _asset.buffers[bufferView.bufferIndex];
-				           // Yes, we've already loaded every buffer into some GL buffer. However, with GL it's simpler
-				           // to just copy the buffer data again for the texture. Besides, this is just an example.
+				           const auto &bufferView = _asset.bufferViews[view.bufferViewIndex];
+				           const auto &buffer = _asset.buffers[bufferView.bufferIndex];
 				           std::visit(fastgltf::visitor{
 					                      // We only care about VectorWithMime here, because we specify LoadExternalBuffers, meaning
 					                      // all buffers are already loaded into a vector.
-					                      [](auto &arg) {},
-					                      [&](fastgltf::sources::Array &vector)
+					                      [](const auto &arg) {},
+					                      [&](const fastgltf::sources::Array &vector)
 					                      {
-						                      int width, height, nrChannels;
-						                      unsigned char *data = stbi_load_from_memory(
-							                      reinterpret_cast<const stbi_uc *>(
-								                      vector.bytes.data() + bufferView.byteOffset),
-							                      static_cast<int>(bufferView.byteLength), &width, &height, &nrChannels,
-							                      4);
-
-						                      createImage(data, width, height);
-						                      stbi_image_free(data);
+						                      decodeFromMemory(vector.bytes.data() + bufferView.byteOffset, bufferView.byteLength);
 					                      }
 				                      }, buffer.data);
 			           },
 		           }, image.data);
 
-		return myImage;
+		return decoded;
+	}
+
+	std::shared_ptr<Image> GltfReader::loadImage(size_t imageIndex, Engine& engine, VkFormat format)
+	{
+		// the future is consumed by the first call: an image is only loaded again when it failed the first time
+		if (!_decodedImages[imageIndex].valid())
+			return nullptr;
+
+		// wait for the worker thread
+		DecodedImage decoded = _decodedImages[imageIndex].get();
+		if (decoded.compressed)
+		{
+			if (decoded.compressed->faces == 1 && isCompressedFormatCompatible(decoded.compressed->format, format))
+			{
+				if (auto* textureStreamer = engine.getTextureStreamer())
+					return textureStreamer->addImage(decoded.compressedPath, *decoded.compressed);
+				return engine.createImage(*decoded.compressed);
+			}
+
+			// e.g. baked as a normal map but used as a color map: decoded here from the source image
+			Log::Get().Warning("Baked glTF image " + std::to_string(imageIndex) + " not matching the texture format, loading the source image");
+			decoded = decodeImage(_asset.images[imageIndex], false);
+		}
+
+		if (!decoded.pixels)
+		{
+			Log::Get().Warning("Failed to decode the glTF image " + std::to_string(imageIndex));
+			return nullptr;
+		}
+
+		auto width = static_cast<uint32_t>(decoded.width);
+		auto height = static_cast<uint32_t>(decoded.height);
+		ImageParams params
+		{
+			.extent = {width, height},
+			.format = format,
+			.usage = getTextureImageUsageFlags(),
+			.mipLevels = computeMipLevels(width, height)
+		};
+
+		// the pixels are copied into the upload staging memory, they can be freed right after
+		return engine.createImage(params, decoded.pixels.get());
 	}
 
 	std::shared_ptr<Texture> GltfReader::loadTexture(Engine& engine, const fastgltf::TextureInfo& textureInfo, VkFormat format)
@@ -382,10 +465,16 @@ namespace m1
 
 		// load the image if missing
 		if (images[imgIndex] == nullptr)
-			images[imgIndex] = loadImage(_asset.images[imgIndex], engine, format);
+			images[imgIndex] = loadImage(imgIndex, engine, format);
+
+		// failed to decode: no texture, the material uses the default map
+		if (images[imgIndex] == nullptr)
+			return nullptr;
 
 		// create the texture
 		textures[textureInfo.textureIndex] = std::make_shared<Texture>(engine.getDevice(), images[imgIndex], samplers[samplerIndex]);
+		if (auto* textureStreamer = engine.getTextureStreamer())
+			textureStreamer->addTexture(textures[textureInfo.textureIndex]);
 		return textures[textureInfo.textureIndex];
 	}
 
@@ -6,6 +6,12 @@
 
 #include "Mesh.hpp"
 #include "graphics/Material.hpp"
+#include "graphics/Ktx2.hpp"
+#include "graphics/SceneGraph.hpp"
+
+// std
+#include <future>
+#include <optional>
 
 namespace  m1
 {
@@ -13,24 +19,50 @@ namespace  m1
 	class Engine;
 	class Sampler;
 	class Image;
+	class ThreadPool;
 
+	/*
+		Images decoding and meshes loading (accessors, tangents) run in parallel on a thread pool,
+		the calling thread only creates the resources (samplers, images, textures, materials, scene objects)
+	*/
 	class GltfReader
 	{
 	public:
 		bool loadGltf(Engine& engine, const std::filesystem::path &path);
 
 	private:
+		// RGBA pixels decoded by stb_image, or the texture baked offline (KTX2 file next to the image file)
+		struct DecodedImage
+		{
+			struct PixelsDeleter { void operator()(unsigned char* pixels) const; };
+
+			int width = 0;
+			int height = 0;
+			std::unique_ptr<unsigned char, PixelsDeleter> pixels;
+			std::optional<Ktx2Image> compressed; // only the mip tail when the textures are streamed
+			std::string compressedPath;
+		};
+
 		fastgltf::Asset _asset;
+		std::filesystem::path _directory; // the image URIs are relative to the glTF file
+		bool _compressedTexturesSupported = false;
+		bool _textureStreamingEnabled = false;
+		std::vector<std::future<DecodedImage>> _decodedImages; // only for the images used by the textures
+		std::vector<std::future<std::vector<std::shared_ptr<Mesh>>>> _loadedMeshes;
 		std::vector<std::vector<std::shared_ptr<Mesh>>> meshes;
 		std::vector<std::unique_ptr<Material>> materials;
 		std::vector<std::shared_ptr<Image>> images;
 		std::vector<std::shared_ptr<Texture>> textures;
 		std::vector<std::shared_ptr<Sampler>> samplers;
 
+		void submitJobs(ThreadPool& threadPool);
 		void loadSamplers(Engine& engine);
-		void loadNode(const fastgltf::Node& gltfNode, Engine& engine);
-		std::vector<std::shared_ptr<Mesh>> loadMesh(const fastgltf::Mesh& gltfMesh);
-		std::shared_ptr<Image> loadImage(fastgltf::Image& image, Engine& engine, VkFormat format);
+		// the node and its subtree, depth first (the subtrees are contiguous in the scene graph)
+		void loadNode(const fastgltf::Node& gltfNode, Engine& engine, SceneNode parent);
+		// thread safe: only reads the asset
+		std::vector<std::shared_ptr<Mesh>> loadMesh(const fastgltf::Mesh& gltfMesh) const;
+		DecodedImage decodeImage(const fastgltf::Image& image, bool allowCompressed) const;
+		std::shared_ptr<Image> loadImage(size_t imageIndex, Engine& engine, VkFormat format);
 		std::shared_ptr<Texture> loadTexture(Engine& engine, const fastgltf::TextureInfo& textureIndex, VkFormat format);
 		bool loadMaterial(fastgltf::Material& gltfMaterial, Engine& engine);
 	};
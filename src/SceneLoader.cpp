@@ -0,0 +1,215 @@
+#include "SceneLoader.hpp"
+#include "Log.hpp"
+#include "graphics/Engine.hpp"
+#include "graphics/SceneObject.hpp"
+#include "Vertex.hpp"
+#include "Mesh.hpp"
+#include "graphics/Material.hpp"
+#include "GltfReader.hpp"
+
+// libs
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+// std
+#include <unordered_map>
+#include <stdexcept>
+
+namespace m1
+{
+	void loadObj(Engine& engine, const std::string& path)
+	{
+	    tinyobj::attrib_t attrib;
+	    std::vector<tinyobj::shape_t> shapes;
+	    std::vector<tinyobj::material_t> materials;
+	    std::string warn, err;
+
+	    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+	    {
+	        throw std::runtime_error(warn + err);
+	    }
+
+	    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+		auto mesh = std::make_shared<Mesh>();
+
+	    for (const auto& shape : shapes)
+	    {
+	        for (const auto& index : shape.mesh.indices)
+	        {
+	            Vertex vertex{};
+
+	            if (index.vertex_index >= 0)
+	            {
+	                vertex.pos = {
+	                    attrib.vertices[3 * index.vertex_index + 0],
+	                    attrib.vertices[3 * index.vertex_index + 1],
+	                    attrib.vertices[3 * index.vertex_index + 2],
+	                };
+
+	                vertex.color = {
+	                    attrib.colors[3 * index.vertex_index + 0],
+	                    attrib.colors[3 * index.vertex_index + 1],
+	                    attrib.colors[3 * index.vertex_index + 2],
+	                };
+	            }
+
+	            if (index.normal_index >= 0)
+	            {
+	                vertex.normal = {
+	                    attrib.normals[3 * index.normal_index + 0],
+	                    attrib.normals[3 * index.normal_index + 1],
+	                    attrib.normals[3 * index.normal_index + 2],
+	                };
+	            }
+
+	            if (index.texcoord_index >= 0)
+	            {
+	                vertex.texCoord = {
+	                    attrib.texcoords[2 * index.texcoord_index + 0],
+	                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+	                };
+	            }
+
+	            if (!uniqueVertices.contains(vertex))
+	            {
+	                uniqueVertices[vertex] = static_cast<uint32_t>(mesh->Vertices.size());
+	                mesh->Vertices.push_back(vertex);
+	            }
+
+	            mesh->Indices.push_back(uniqueVertices[vertex]);
+	        }
+	    }
+
+		auto sceneObj = SceneObject::createSceneObject(engine.getSceneGraph());
+		sceneObj->setMesh(std::move(mesh));
+	    engine.addSceneObject(std::move(sceneObj));
+	}
+
+	void loadGltf(Engine& engine, const std::string& path)
+	{
+		GltfReader reader;
+		reader.loadGltf(engine, path);
+	}
+
+	void loadCubes(Engine& engine, const uint32_t numCubes)
+	{
+		bool isYup = engine.getCamera().isYup();
+
+		// Initialize materials array with different material types
+
+		// Shiny material (high specular, moderate diffuse)
+		engine.addMaterial(std::make_unique<Material>(
+			"shiny", 32.0f,
+			glm::vec4(0.7f, 0.0f, 0.0f, 1.0f),
+			glm::vec3(0.5f, 0.5f, 0.5f),
+			glm::vec3(0.7f, 0.0f, 0.0f)
+		));
+
+		// Matte material (low specular, high diffuse)
+		engine.addMaterial(std::make_unique<Material>(
+			"matte", 1.0f,
+			glm::vec4(0.8f, 0.8f, 0.8f, 1.0f),
+			glm::vec3(0.1f, 0.1f, 0.1f),
+			glm::vec3(0.1f, 0.1f, 0.1f)
+		));
+
+		// Emissive material (very high specular and diffuse for glow effect)
+		engine.addMaterial(std::make_unique<Material>(
+			"emissive", 64.0f,
+			glm::vec4(5.0f, 5.0f, 5.0f, 1.0f),
+			glm::vec3(5.0f, 5.0f, 5.0f),
+			glm::vec3(1.0f, 1.0f, 1.0f)
+		));
+
+		// container texture
+		glm::vec4 white(1.0f);
+		auto material = std::make_unique<Material>("container", 64.0f, white,white,white);
+		material->diffuseTexturePath = std::string(PROJECT_SOURCE_DIR) + "/resources/container.png";
+		material->specularTexturePath = std::string(PROJECT_SOURCE_DIR) + "/resources/container_specular.png";
+		engine.addMaterial(std::move(material));
+
+		// floor
+		auto sceneObj = SceneObject::createSceneObject(engine.getSceneGraph());
+		auto mesh = Mesh::createQuad({0.5f, 0.5f, 0.5f});
+		sceneObj->setMesh(std::move(mesh));
+		if (isYup)
+		{
+			auto transform = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
+			sceneObj->setTransform(transform);
+		}
+		engine.addSceneObject(std::move(sceneObj));
+
+		// cube that represents the light source
+	    sceneObj = SceneObject::createSceneObject(engine.getSceneGraph());
+		sceneObj->IsAuxiliary = true;
+		mesh = Mesh::createCube();
+	    sceneObj->setMesh(std::move(mesh));
+	    auto transform = glm::translate(glm::mat4(1.0f), glm::vec3(5.2f, 6.2f, -5.2f));
+	    transform = glm::scale(transform, glm::vec3(.1f));
+	    sceneObj->setTransform(transform);
+		sceneObj->PipelineKey = PipelineType::NoLight;
+	    engine.addSceneObject(std::move(sceneObj));
+
+		float dx = 3, dy = 2, dz = 0.5;
+
+		bool random = false;
+		if (random)
+		{
+			glm::vec3 cubePositions[] = {
+				glm::vec3( 0.0f,  0.0f,  0.0f),
+				glm::vec3( 2.0f,  5.0f, -15.0f),
+				glm::vec3(-1.5f, -2.2f, -2.5f),
+				glm::vec3(-3.8f, -2.0f, -12.3f),
+				glm::vec3( 2.4f, -0.4f, -3.5f),
+				glm::vec3(-1.7f,  3.0f, -7.5f),
+				glm::vec3( 1.3f, -2.0f, -2.5f),
+				glm::vec3( 1.5f,  2.0f, -2.5f),
+				glm::vec3( 1.5f,  0.2f, -1.5f),
+				glm::vec3(-1.3f,  1.0f, -1.5f)
+			};
+
+			for(unsigned int i = 0; i < 10; i++)
+			{
+				sceneObj = SceneObject::createSceneObject(engine.getSceneGraph());
+				mesh = Mesh::createCube();
+				mesh->setMaterialName("container");
+				sceneObj->setMesh(std::move(mesh));
+
+				transform = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+				float angle = 20.0f * i;
+				transform = glm::rotate(transform, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+				sceneObj->setTransform(transform);
+				engine.addSceneObject(std::move(sceneObj));
+			}
+		}
+		else
+		{
+			// cube grid: the cubes are children of the grid node
+			transform = glm::mat4(1.0f);
+			if (isYup)
+				transform = glm::rotate(transform, glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
+			SceneNode gridNode = engine.getSceneGraph().createNode(INVALID_SCENE_NODE, transform);
+
+			// one mesh for all the cubes: drawn as the instances of one draw
+			std::shared_ptr<Mesh> cubeMesh = Mesh::createCube(dx, dy, dz);
+			cubeMesh->setMaterialName("container");
+
+			for (uint32_t i = 0; i < numCubes; i++)
+			{
+				for (uint32_t j = 0; j < numCubes; j++)
+				{
+					for (uint32_t k = 0; k < numCubes; k++)
+					{
+						sceneObj = SceneObject::createSceneObject(engine.getSceneGraph(), engine.getSceneGraph().createNode(gridNode));
+						sceneObj->setMesh(cubeMesh);
+						transform = glm::translate(glm::mat4(1.0f), glm::vec3(i* (dx + 1), j * (dy + 1), k * (dz + 1)));
+
+						sceneObj->setTransform(transform);
+						engine.addSceneObject(std::move(sceneObj));
+					}
+				}
+			}
+		}
+	}
+}
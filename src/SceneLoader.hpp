@@ -0,0 +1,16 @@
+#pragma once
+
+// std
+#include <string>
+#include <cstdint>
+
+namespace m1
+{
+	class Engine;
+
+	// Scene loading helpers shared by the application and the benchmark
+	void loadObj(Engine& engine, const std::string& path);
+	void loadGltf(Engine& engine, const std::string& path);
+	// a floor, a light cube and a numCubes^3 grid of textured cubes
+	void loadCubes(Engine& engine, uint32_t numCubes);
+}
@@ -0,0 +1,49 @@
+#include "ThreadPool.hpp"
+
+// std
+#include <algorithm>
+
+namespace m1
+{
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+		for (uint32_t i = 0; i < threadCount; i++)
+			_threads.emplace_back(&ThreadPool::workerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock(_mutex);
+			_stop = true;
+		}
+		_condition.notify_all();
+
+		for (auto& thread : _threads)
+			thread.join();
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock lock(_mutex);
+				_condition.wait(lock, [this] { return _stop || !_jobs.empty(); });
+
+				// stop only when all the queued jobs are completed
+				if (_jobs.empty())
+					return;
+
+				job = std::move(_jobs.front());
+				_jobs.pop();
+			}
+
+			job();
+		}
+	}
+}
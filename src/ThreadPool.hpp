@@ -0,0 +1,61 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace m1
+{
+	// Fixed number of worker threads executing the submitted jobs in FIFO order.
+	// The result (or the exception) of a job is returned through its future
+	class ThreadPool
+	{
+	public:
+		// 0 => one thread for each hardware thread
+		explicit ThreadPool(uint32_t threadCount = 0);
+		// completes the queued jobs before joining the threads
+		~ThreadPool();
+
+		// Non-copyable, non-movable
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) = delete;
+		ThreadPool& operator=(ThreadPool&&) = delete;
+
+		template <typename Job>
+		auto submit(Job&& job) -> std::future<std::invoke_result_t<std::decay_t<Job>>>
+		{
+			using Result = std::invoke_result_t<std::decay_t<Job>>;
+
+			// std::function requires copyable callables: the task is shared
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Job>(job));
+			auto future = task->get_future();
+			{
+				std::lock_guard lock(_mutex);
+				_jobs.emplace([task] { (*task)(); });
+			}
+			_condition.notify_one();
+
+			return future;
+		}
+
+		[[nodiscard]] uint32_t getThreadCount() const { return static_cast<uint32_t>(_threads.size()); }
+
+	private:
+		std::vector<std::thread> _threads;
+		std::queue<std::function<void()>> _jobs;
+		std::mutex _mutex;
+		std::condition_variable _condition;
+		bool _stop = false;
+
+		void workerLoop();
+	};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// std
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace m1
+{
+	// Lock-free hand-off of the latest value from one producer thread to one consumer thread.
+	// Each side owns a buffer, the third one is exchanged atomically: the producer never waits for the consumer, the
+	// consumer always gets the latest published value (the older ones are overwritten)
+	template <typename T>
+	class TripleBuffer
+	{
+	public:
+		// producer: the buffer to fill, then published
+		T& getWriteBuffer() { return _buffers[_writeIndex]; }
+
+		void publish()
+		{
+			uint32_t previous = _shared.exchange(_writeIndex | NEW_BIT, std::memory_order_acq_rel);
+			_writeIndex = previous & INDEX_MASK;
+		}
+
+		// consumer: the latest published value, nullptr if nothing has been published since the last read
+		const T* read()
+		{
+			if ((_shared.load(std::memory_order_relaxed) & NEW_BIT) == 0)
+				return nullptr;
+
+			uint32_t previous = _shared.exchange(_readIndex, std::memory_order_acq_rel);
+			_readIndex = previous & INDEX_MASK;
+			return &_buffers[_readIndex];
+		}
+
+	private:
+		static constexpr uint32_t INDEX_MASK = 0x3;
+		static constexpr uint32_t NEW_BIT = 0x4; // the shared buffer has been published and not read yet
+
+		std::array<T, 3> _buffers{};
+		uint32_t _writeIndex = 0; // producer only
+		std::atomic<uint32_t> _shared{ 1 };
+		uint32_t _readIndex = 2; // consumer only
+	};
+}
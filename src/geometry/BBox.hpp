@@ -22,6 +22,7 @@ namespace m1
             max = glm::max(max, other.max);
         }
 
+        bool isValid() const { return min.x <= max.x; }
         glm::vec3 getCenter() const { return (min + max) * 0.5f; }
         glm::vec3 getExtent() const { return max - min; }
     	std::array<glm::vec3, 8> getCorners() const
@@ -37,5 +38,23 @@ namespace m1
 				glm::vec3(max.x, max.y, max.z)
          	};
         }
+
+        // bounds of the box transformed by the matrix (Arvo's method, no need to transform the 8 corners)
+        BBox transform(const glm::mat4& matrix) const
+        {
+        	if (!isValid())
+        		return {};
+
+        	glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+        	glm::vec3 halfExtent = getExtent() * 0.5f;
+        	glm::vec3 newHalfExtent = glm::abs(glm::vec3(matrix[0])) * halfExtent.x +
+        							  glm::abs(glm::vec3(matrix[1])) * halfExtent.y +
+        							  glm::abs(glm::vec3(matrix[2])) * halfExtent.z;
+
+        	BBox result;
+        	result.min = center - newHalfExtent;
+        	result.max = center + newHalfExtent;
+        	return result;
+        }
     };
 }
\ No newline at end of file
@@ -1,10 +1,11 @@
 #include "Vertex.hpp"
 #include "Mesh.hpp"
-#include "Buffer.hpp"
-#include "Utils.hpp"
+#include "MeshSimplifier.hpp"
 #include "Log.hpp"
 
 // std
+#include <atomic>
+#include <format>
 #include <memory>
 
 
@@ -12,55 +13,64 @@ namespace m1
 {
 	Mesh::Mesh()
 	{
+		static std::atomic<uint32_t> currentId = 0; // meshes can be created by the loader threads
+		_id = currentId++;
+
 		Log::Get().Info("Creating mesh");
 	}
 
 	Mesh::~Mesh()
 	{
+		if (_geometryPool)
+			_geometryPool->free(_geometry);
+
 		Log::Get().Info("Destroying mesh");
 	}
 
-    void Mesh::compile(const Device& device)
+    void Mesh::compile(GeometryPool& geometryPool)
     {
-		computeTangents();
-        createVertexBuffer(device);
-        createIndexBuffer(device);
-    }
+		if (_geometryPool)
+			return; // already compiled
 
-    void Mesh::draw(VkCommandBuffer commandBuffer) const
-    {
-        // bind the vertex buffer
-        VkBuffer vertexBuffers[] = { _vertexBuffer->getVkBuffer() };
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+		computeTangents();
+		optimize();
+		generateLods();
+		buildMeshlets();
 
-        // bind the index buffer
-        vkCmdBindIndexBuffer(commandBuffer, _indexBuffer->getVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		_localBBox = {};
+		for (const auto& vertex : Vertices)
+			_localBBox.merge(vertex.pos);
 
-        // draw command
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(Indices.size()), 1, 0, 0, 0);
+		if (_lodIndices.empty() && _meshletIndices.empty())
+			_geometry = geometryPool.allocate(Vertices, Indices);
+		else
+		{
+			std::vector<uint32_t> indices;
+			indices.reserve(Indices.size() + _lodIndices.size() + _meshletIndices.size());
+			indices.insert(indices.end(), Indices.begin(), Indices.end());
+			indices.insert(indices.end(), _lodIndices.begin(), _lodIndices.end());
+			indices.insert(indices.end(), _meshletIndices.begin(), _meshletIndices.end());
+			_geometry = geometryPool.allocate(Vertices, indices);
+		}
+		_geometryPool = &geometryPool;
     }
 
-    void Mesh::createVertexBuffer(const Device& device)
+    void Mesh::bind(VkCommandBuffer commandBuffer) const
     {
-        VkDeviceSize size = sizeof(Vertices[0]) * Vertices.size();
-
-        // Create the actual vertex buffer with device local memory for better performance
-        _vertexBuffer = std::make_unique<Buffer>(device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-
-        // upload vertex data to buffer
-        uploadToDeviceBuffer(device, *_vertexBuffer, size, Vertices.data());
+        _geometryPool->bind(commandBuffer, _geometry.block);
     }
 
-    void Mesh::createIndexBuffer(const Device& device)
+    void Mesh::drawIndexed(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod) const
     {
-        VkDeviceSize size = sizeof(Indices[0]) * Indices.size();
-
-        // Create the actual index buffer with device local memory for better performance
-        _indexBuffer = std::make_unique<Buffer>(device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        const MeshLod& range = _lods[lod];
+        vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount, _geometry.firstIndex + range.firstIndex,
+            _geometry.vertexOffset, firstInstance);
+    }
 
-        // upload indices data to buffer
-        uploadToDeviceBuffer(device, *_indexBuffer, size, Indices.data());
+    void Mesh::draw(VkCommandBuffer commandBuffer) const
+    {
+        bind(commandBuffer);
+        drawIndexed(commandBuffer);
     }
 
 	void Mesh::computeTangents()
@@ -121,6 +131,58 @@ namespace m1
 		}
 	}
 
+	void Mesh::optimize()
+	{
+		if (_optimized)
+			return;
+		_optimized = true;
+
+		_sourceCacheStatistics = analyzeVertexCache(Indices, Vertices.size());
+		optimizeVertexCache(Indices, Vertices.size());
+		optimizeOverdraw(Indices, Vertices);
+		optimizeVertexFetch(Vertices, Indices);
+		_cacheStatistics = analyzeVertexCache(Indices, Vertices.size());
+
+		Log::Get().Debug(std::format("Mesh optimized: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+			_sourceCacheStatistics.acmr, _cacheStatistics.acmr, _sourceCacheStatistics.atvr, _cacheStatistics.atvr));
+	}
+
+	void Mesh::generateLods()
+	{
+		if (!_lods.empty())
+			return; // already generated
+
+		// the vertex fetch optimization renumbers the vertices: done before the levels index them
+		optimize();
+
+		_lods.push_back({ .firstIndex = 0, .indexCount = getIndexCount(), .error = 0.0f });
+
+		for (auto& level : simplifyLodChain(Vertices, Indices))
+		{
+			optimizeVertexCache(level.indices, Vertices.size());
+
+			_lods.push_back({
+				.firstIndex = getIndexCount() + static_cast<uint32_t>(_lodIndices.size()),
+				.indexCount = static_cast<uint32_t>(level.indices.size()),
+				.error = level.error,
+			});
+			_lodIndices.insert(_lodIndices.end(), level.indices.begin(), level.indices.end());
+		}
+	}
+
+	void Mesh::buildMeshlets()
+	{
+		if (!_meshlets.empty() || getIndexCount() / 3 < MIN_MESHLET_TRIANGLES)
+			return; // already built, or small mesh
+
+		generateLods();
+
+		_meshlets = m1::buildMeshlets(Indices, Vertices, _meshletIndices);
+		auto firstIndex = getIndexCount() + static_cast<uint32_t>(_lodIndices.size());
+		for (auto& meshlet : _meshlets)
+			meshlet.firstIndex += firstIndex;
+	}
+
 	std::unique_ptr<Mesh> Mesh::createCube(float dx, float dy, float dz, const glm::vec3& color)
 	{
 		auto mesh = std::make_unique<Mesh>();
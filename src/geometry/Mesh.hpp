@@ -1,6 +1,10 @@
 #pragma once
 
 #include "Vertex.hpp"
+#include "BBox.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshletBuilder.hpp"
+#include "graphics/GeometryPool.hpp"
 
 //libs
 #include "graphics/glm_config.hpp"
@@ -12,12 +16,19 @@
 
 namespace m1 
 {
-	class Buffer;
-	class Device;
+	// range of a level of detail in the indices of the mesh (all the levels share the vertices)
+	struct MeshLod
+	{
+		uint32_t firstIndex = 0; // relative to the first index of the mesh
+		uint32_t indexCount = 0;
+		float error = 0.0f;      // object space distance to the full detail surface
+	};
 
 	class Mesh 
 	{
 	public:
+		static constexpr uint32_t MIN_MESHLET_TRIANGLES = 1024; // smaller meshes are culled as a whole
+
 		Mesh();
 		~Mesh();
 
@@ -26,19 +37,58 @@ namespace m1
 
 		void setMaterialName(const std::string& materialName) { _materialName = materialName; }
 		[[nodiscard]] const std::string& getMaterialName() const { return _materialName; }
-		void compile(const Device& device);
+		// material id resolved from the material name when the scene is compiled (0 => default material)
+		void setMaterialId(uint32_t materialId) { _materialId = materialId; }
+		[[nodiscard]] uint32_t getMaterialId() const { return _materialId; }
+		[[nodiscard]] uint32_t getId() const { return _id; }
+		[[nodiscard]] uint32_t getIndexCount() const { return static_cast<uint32_t>(Indices.size()); }
+		// level 0 is the full detail (Indices), then about half the triangles at each level
+		[[nodiscard]] uint32_t getLodCount() const { return static_cast<uint32_t>(_lods.size()); }
+		[[nodiscard]] const MeshLod& getLod(uint32_t lod) const { return _lods[lod]; }
+		// clusters of the full detail level, their firstIndex is relative to the first index of the mesh (empty for the
+		// small meshes)
+		[[nodiscard]] const std::vector<Meshlet>& getMeshlets() const { return _meshlets; }
+		// range of the mesh in the geometry pool (valid after compile)
+		[[nodiscard]] const GeometryAllocation& getGeometry() const { return _geometry; }
+		// vertex cache efficiency of the full detail indices, before and after optimize
+		[[nodiscard]] const VertexCacheStatistics& getSourceCacheStatistics() const { return _sourceCacheStatistics; }
+		[[nodiscard]] const VertexCacheStatistics& getCacheStatistics() const { return _cacheStatistics; }
+		// bounds of the vertices in object space (computed by compile)
+		[[nodiscard]] const BBox& getLocalBBox() const { return _localBBox; }
+		// upload the mesh into the geometry pool (only the first time, meshes can be shared by several objects)
+		void compile(GeometryPool& geometryPool);
+		// bind the buffers of the geometry pool block containing the mesh
+		void bind(VkCommandBuffer commandBuffer) const;
+		// draw with the buffers already bound, the instances are the entries [firstInstance, firstInstance + instanceCount)
+		// of the instances SSBO (object indices)
+		void drawIndexed(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0) const;
+		// bind and draw
 		void draw(VkCommandBuffer commandBuffer) const;
+		// called by compile when missing, loaders can call them ahead (e.g. on worker threads)
+		void computeTangents();
+		// reorders the triangles for the vertex cache and the overdraw, then the vertices in the order of the indices
+		void optimize();
+		// optimizes the mesh first, the levels share its vertices
+		void generateLods();
+		// generates the LODs first, the meshlet indices are stored after them
+		void buildMeshlets();
 
 		std::vector<Vertex> Vertices;
 		std::vector<uint32_t> Indices;
 	private:
-		void createVertexBuffer(const Device& device);
-		void createIndexBuffer(const Device& device);
-		void computeTangents();
-
-		std::unique_ptr<Buffer> _vertexBuffer;
-		std::unique_ptr<Buffer> _indexBuffer;
+		GeometryPool* _geometryPool = nullptr; // null until compiled
+		GeometryAllocation _geometry;
+		std::vector<MeshLod> _lods; // empty until generated
+		std::vector<uint32_t> _lodIndices; // indices of the levels after the full detail, uploaded after Indices
+		std::vector<Meshlet> _meshlets;
+		std::vector<uint32_t> _meshletIndices; // uploaded after the LOD indices
+		bool _optimized = false;
+		VertexCacheStatistics _sourceCacheStatistics;
+		VertexCacheStatistics _cacheStatistics;
 
+		uint32_t _id;
+		BBox _localBBox;
 		std::string _materialName;
+		uint32_t _materialId = 0;
 	};
 }
@@ -0,0 +1,319 @@
+#include "MeshOptimizer.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace m1
+{
+	namespace
+	{
+		// a vertex is in the cache while less than size vertices were transformed after it
+		class FifoCache
+		{
+		public:
+			FifoCache(size_t vertexCount, uint32_t size) : _timestamps(vertexCount, 0), _time(size + 1), _size(size) {}
+
+			// true if the vertex is transformed
+			bool access(uint32_t vertex)
+			{
+				if (_time - _timestamps[vertex] <= _size)
+					return false;
+				_timestamps[vertex] = _time++;
+				return true;
+			}
+
+			void flush() { _time += _size + 1; }
+
+		private:
+			std::vector<uint32_t> _timestamps;
+			uint32_t _time;
+			uint32_t _size;
+		};
+
+		uint32_t accessTriangle(FifoCache& cache, std::span<const uint32_t> indices, size_t triangle)
+		{
+			return cache.access(indices[triangle * 3]) + cache.access(indices[triangle * 3 + 1]) + cache.access(indices[triangle * 3 + 2]);
+		}
+
+		// Forsyth's scoring, with the constants of the article
+		constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+		constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+		constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+		constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+		constexpr uint32_t NO_TRIANGLE = UINT32_MAX;
+
+		float getVertexScore(int cachePosition, uint32_t remainingTriangles)
+		{
+			if (remainingTriangles == 0)
+				return -1.0f;
+
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				// the vertices of the last triangle get a fixed score, to not favor one of its edges
+				if (cachePosition < 3)
+					score = FORSYTH_LAST_TRIANGLE_SCORE;
+				else
+				{
+					float scaler = 1.0f / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+					score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+				}
+			}
+
+			// the vertices with few triangles left are finished first, not to leave lone triangles behind
+			score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+			return score;
+		}
+	}
+
+	VertexCacheStatistics analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+	{
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return {};
+
+		FifoCache cache(vertexCount, cacheSize);
+		std::vector<uint8_t> referenced(vertexCount, 0);
+		size_t misses = 0;
+		size_t referencedCount = 0;
+		for (size_t i = 0; i < triangleCount; i++)
+			misses += accessTriangle(cache, indices, i);
+		for (uint32_t index : indices)
+		{
+			referencedCount += !referenced[index];
+			referenced[index] = 1;
+		}
+
+		return {
+			.acmr = static_cast<float>(misses) / static_cast<float>(triangleCount),
+			.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount),
+		};
+	}
+
+	void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount)
+	{
+		auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		if (triangleCount < 2)
+			return;
+
+		// live triangles of each vertex: [offset, offset + remaining), the emitted ones are swapped out of the range
+		std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+		for (uint32_t index : indices)
+			remainingTriangles[index]++;
+		std::vector<uint32_t> triangleOffsets(vertexCount, 0);
+		std::exclusive_scan(remainingTriangles.begin(), remainingTriangles.end(), triangleOffsets.begin(), 0u);
+		std::vector<uint32_t> vertexTriangles(indices.size());
+		{
+			std::vector<uint32_t> fill(triangleOffsets);
+			for (uint32_t i = 0; i < indices.size(); i++)
+				vertexTriangles[fill[indices[i]]++] = i / 3;
+		}
+
+		std::vector<int> cachePositions(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			vertexScores[v] = getVertexScore(-1, remainingTriangles[v]);
+
+		std::vector<float> triangleScores(triangleCount);
+		for (uint32_t t = 0; t < triangleCount; t++)
+			triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+
+		// the 3 vertices of the emitted triangle are pushed in front, the entries beyond the cache size are kept during
+		// the update to lower their scores
+		std::vector<uint32_t> cache;
+		std::vector<uint32_t> newCache;
+		cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+		uint32_t bestTriangle = static_cast<uint32_t>(std::ranges::max_element(triangleScores) - triangleScores.begin());
+		uint32_t inputCursor = 0;
+		for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+		{
+			if (bestTriangle == NO_TRIANGLE)
+			{
+				// no live triangle in the cache: the next one in the input order (instead of a scan of all the scores)
+				while (emitted[inputCursor])
+					inputCursor++;
+				bestTriangle = inputCursor;
+			}
+
+			const uint32_t* triangle = &indices[bestTriangle * 3];
+			result.insert(result.end(), triangle, triangle + 3);
+			emitted[bestTriangle] = 1;
+
+			newCache.assign(triangle, triangle + 3);
+			for (uint32_t vertex : cache)
+			{
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+					newCache.push_back(vertex);
+			}
+
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				uint32_t vertex = triangle[k];
+				uint32_t* first = &vertexTriangles[triangleOffsets[vertex]];
+				uint32_t* last = first + remainingTriangles[vertex] - 1;
+				std::swap(*std::find(first, last + 1, bestTriangle), *last);
+				remainingTriangles[vertex]--;
+			}
+
+			// new scores of the vertices of the cache (and of the ones just pushed out of it)
+			for (size_t i = 0; i < newCache.size(); i++)
+			{
+				uint32_t vertex = newCache[i];
+				int position = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+				cachePositions[vertex] = position;
+
+				float score = getVertexScore(position, remainingTriangles[vertex]);
+				float delta = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+				for (uint32_t j = 0; j < remainingTriangles[vertex]; j++)
+					triangleScores[vertexTriangles[triangleOffsets[vertex] + j]] += delta;
+			}
+
+			newCache.resize(std::min<size_t>(newCache.size(), FORSYTH_CACHE_SIZE));
+			std::swap(cache, newCache);
+
+			// the next triangle is the best live one of the cached vertices
+			bestTriangle = NO_TRIANGLE;
+			float bestScore = -1.0f;
+			for (uint32_t vertex : cache)
+			{
+				for (uint32_t j = 0; j < remainingTriangles[vertex]; j++)
+				{
+					uint32_t candidate = vertexTriangles[triangleOffsets[vertex] + j];
+					if (triangleScores[candidate] > bestScore)
+					{
+						bestScore = triangleScores[candidate];
+						bestTriangle = candidate;
+					}
+				}
+			}
+		}
+
+		std::ranges::copy(result, indices.begin());
+	}
+
+	void optimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold)
+	{
+		constexpr uint32_t CACHE_SIZE = 16;
+
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount < 2)
+			return;
+
+		// hard boundaries: the triangles with 3 transformed vertices, where the cache optimization started over
+		FifoCache cache(vertices.size(), CACHE_SIZE);
+		std::vector<size_t> hardBoundaries;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (accessTriangle(cache, indices, t) == 3 || t == 0)
+				hardBoundaries.push_back(t);
+		}
+		hardBoundaries.push_back(triangleCount);
+
+		// soft boundaries: a cluster is split as soon as its miss ratio is low enough, the flush of the cache at the split
+		// costs a few misses bounded by the threshold
+		std::vector<size_t> clusters;
+		for (size_t c = 0; c + 1 < hardBoundaries.size(); c++)
+		{
+			size_t start = hardBoundaries[c];
+			size_t end = hardBoundaries[c + 1];
+
+			cache.flush();
+			uint32_t clusterMisses = 0;
+			for (size_t t = start; t < end; t++)
+				clusterMisses += accessTriangle(cache, indices, t);
+			float maxMissRatio = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+			cache.flush();
+			clusters.push_back(start);
+			size_t first = start;
+			uint32_t misses = 0;
+			for (size_t t = start; t + 1 < end; t++)
+			{
+				misses += accessTriangle(cache, indices, t);
+				if (static_cast<float>(misses) / static_cast<float>(t + 1 - first) <= maxMissRatio)
+				{
+					cache.flush();
+					clusters.push_back(t + 1);
+					first = t + 1;
+					misses = 0;
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+
+		// area weighted centroids and normals of the clusters and of the mesh
+		size_t clusterCount = clusters.size() - 1;
+		std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+		std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+		for (size_t c = 0; c < clusterCount; c++)
+		{
+			float clusterArea = 0.0f;
+			for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+			{
+				const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+				const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+				const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				float area = glm::length(normal);
+
+				clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+				clusterNormals[c] += normal;
+				clusterArea += area;
+			}
+
+			meshCentroid += clusterCentroids[c];
+			meshArea += clusterArea;
+			if (clusterArea > 0.0f)
+				clusterCentroids[c] /= clusterArea;
+		}
+		if (meshArea > 0.0f)
+			meshCentroid /= meshArea;
+
+		std::vector<float> sortKeys(clusterCount, 0.0f);
+		for (size_t c = 0; c < clusterCount; c++)
+		{
+			float normalLength = glm::length(clusterNormals[c]);
+			if (normalLength > 0.0f)
+				sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength);
+		}
+
+		std::vector<size_t> order(clusterCount);
+		std::iota(order.begin(), order.end(), size_t(0));
+		std::ranges::stable_sort(order, [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (size_t c : order)
+			result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+		std::ranges::copy(result, indices.begin());
+	}
+
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices)
+	{
+		std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+		std::vector<Vertex> reordered;
+		reordered.reserve(vertices.size());
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == UINT32_MAX)
+			{
+				remap[index] = static_cast<uint32_t>(reordered.size());
+				reordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		vertices = std::move(reordered);
+	}
+}
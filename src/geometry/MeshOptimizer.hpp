@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+// std
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace m1
+{
+	// post-transform vertex cache efficiency of an index list, simulated with a FIFO cache
+	struct VertexCacheStatistics
+	{
+		float acmr = 0.0f; // average cache miss ratio: transformed vertices per triangle (0.5 to 3, lower is better)
+		float atvr = 0.0f; // average transformed vertex ratio: transformed vertices per referenced vertex (1 is optimal)
+	};
+
+	VertexCacheStatistics analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+	/*
+		Reorders the triangles for the post-transform vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation"):
+		the next triangle is the best scored one of the vertices in a simulated LRU cache, a vertex scoring higher when
+		it was used recently and when it has few triangles left
+	*/
+	void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+
+	/*
+		Reorders clusters of triangles to draw the outer ones first (Sander et al., "Fast Triangle Reordering for Vertex
+		Locality and Reduced Overdraw"), to be called after optimizeVertexCache. The clusters are split where the
+		triangle order restarts in the vertex cache, and inside of them while the cache miss ratio stays below
+		threshold * the one of the whole cluster. They are sorted by the distance of their centroid to the mesh centroid
+		along their normal: the front facing outer clusters are drawn first and occlude the inner ones.
+	*/
+	void optimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold = 1.05f);
+
+	// reorders the vertices in the order of their first use by the indices (the unreferenced ones are removed)
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices);
+}
@@ -0,0 +1,339 @@
+#include "MeshSimplifier.hpp"
+#include "BBox.hpp"
+
+// std
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+
+namespace m1
+{
+	namespace
+	{
+		// triangles of each vertex: triangles[offsets[v]] to triangles[offsets[v + 1]]
+		void getVertexTriangles(const std::vector<uint32_t>& indices, std::vector<uint32_t>& offsets,
+			std::vector<uint32_t>& triangles)
+		{
+			std::ranges::fill(offsets, 0);
+			for (uint32_t index : indices)
+				offsets[index + 1]++;
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+			triangles.resize(indices.size());
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (uint32_t i = 0; i < indices.size(); i++)
+				triangles[fill[indices[i]]++] = i / 3;
+		}
+	}
+
+	glm::vec3 getClosestPoint(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+		float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return a;
+
+		glm::vec3 bp = p - b;
+		float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return a + ab * (d1 / (d1 - d3));
+
+		glm::vec3 cp = p - c;
+		float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return a + ac * (d2 / (d2 - d6));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		float denominator = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	void MeshSimplifier::Quadric::addPlane(const glm::dvec3& normal, double d, double planeWeight)
+	{
+		double w = planeWeight;
+		a2 += w * normal.x * normal.x; ab += w * normal.x * normal.y; ac += w * normal.x * normal.z; ad += w * normal.x * d;
+		b2 += w * normal.y * normal.y; bc += w * normal.y * normal.z; bd += w * normal.y * d;
+		c2 += w * normal.z * normal.z; cd += w * normal.z * d;
+		d2 += w * d * d;
+		weight += w;
+	}
+
+	void MeshSimplifier::Quadric::add(const Quadric& other)
+	{
+		a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+		b2 += other.b2; bc += other.bc; bd += other.bd;
+		c2 += other.c2; cd += other.cd;
+		d2 += other.d2;
+		weight += other.weight;
+	}
+
+	double MeshSimplifier::Quadric::evaluate(const glm::dvec3& p) const
+	{
+		if (weight == 0.0)
+			return 0.0;
+
+		// p^T A p + 2 b.p + c, with the plane weights summed in the matrix, normalized by the total weight so the
+		// result is a squared distance whatever the area of the triangles
+		double result = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x +
+			b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y +
+			c2 * p.z * p.z + 2 * cd * p.z +
+			d2;
+		return std::max(result / weight, 0.0);
+	}
+
+	MeshSimplifier::MeshSimplifier(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) :
+		_vertices(vertices), _indices(indices), _quadrics(vertices.size()), _locked(vertices.size(), 0),
+		_collapsedInto(vertices.size())
+	{
+		std::iota(_collapsedInto.begin(), _collapsedInto.end(), 0u);
+
+		// vertices sharing a position: UV or normal seams
+		std::unordered_map<glm::vec3, uint32_t> positions;
+		std::vector<uint32_t> welded(vertices.size());
+		for (uint32_t i = 0; i < vertices.size(); i++)
+		{
+			auto [it, inserted] = positions.try_emplace(vertices[i].pos, i);
+			welded[i] = it->second;
+			if (!inserted)
+				_locked[i] = _locked[it->second] = 1;
+		}
+
+		// edges of the welded vertices used by one triangle (open borders) or more than two (non-manifold)
+		std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (uint32_t e = 0; e < 3; e++)
+			{
+				uint32_t a = welded[indices[i + e]], b = welded[indices[i + (e + 1) % 3]];
+				edgeTriangles[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)]++;
+			}
+		}
+		for (auto [edge, count] : edgeTriangles)
+		{
+			if (count != 2)
+				_locked[static_cast<uint32_t>(edge >> 32)] = _locked[static_cast<uint32_t>(edge)] = 1;
+		}
+		for (uint32_t i = 0; i < vertices.size(); i++)
+			_locked[i] |= _locked[welded[i]];
+
+		// plane of each triangle, weighted by its area
+		BBox bbox;
+		for (const auto& vertex : vertices)
+			bbox.merge(vertex.pos);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			glm::dvec3 p0(vertices[indices[i]].pos), p1(vertices[indices[i + 1]].pos), p2(vertices[indices[i + 2]].pos);
+			glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+			double area = glm::length(normal);
+			if (area == 0.0)
+				continue;
+
+			normal /= area;
+			for (uint32_t k = 0; k < 3; k++)
+				_quadrics[indices[i + k]].addPlane(normal, -glm::dot(normal, p0), area * 0.5);
+		}
+
+		double size = bbox.isValid() ? glm::length(glm::dvec3(bbox.getExtent())) : 0.0;
+		_normalPenalty = (NORMAL_WEIGHT * size) * (NORMAL_WEIGHT * size);
+	}
+
+	float MeshSimplifier::getError() const
+	{
+		return _error;
+	}
+
+	float MeshSimplifier::measureError() const
+	{
+		std::vector<uint32_t> triangleOffsets(_vertices.size() + 1);
+		std::vector<uint32_t> vertexTriangles;
+		getVertexTriangles(_indices, triangleOffsets, vertexTriangles);
+
+		auto getDistance = [&](const glm::vec3& pos, uint32_t triangle)
+		{
+			return glm::distance(pos, getClosestPoint(pos, _vertices[_indices[triangle * 3]].pos,
+				_vertices[_indices[triangle * 3 + 1]].pos, _vertices[_indices[triangle * 3 + 2]].pos));
+		};
+
+		// the quadrics average the distances to the planes: the error reported for the LOD selection is measured.
+		// The distance to any triangle bounds the distance to the surface: starting from the triangles of the vertex
+		// it was collapsed into, each original vertex walks to the triangles around the closest one while they get closer
+		float maxDistance = 0.0f;
+		for (uint32_t i = 0; i < _vertices.size(); i++)
+		{
+			uint32_t vertex = _collapsedInto[i];
+			if (vertex == i || triangleOffsets[vertex] == triangleOffsets[vertex + 1])
+				continue; // still in the triangles, or not used by them
+
+			const glm::vec3& pos = _vertices[i].pos;
+			uint32_t closestTriangle = vertexTriangles[triangleOffsets[vertex]];
+			float distance = getDistance(pos, closestTriangle);
+			for (bool closer = true; closer;)
+			{
+				closer = false;
+				uint32_t triangle = closestTriangle;
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					uint32_t corner = _indices[triangle * 3 + k];
+					for (uint32_t t = triangleOffsets[corner]; t < triangleOffsets[corner + 1]; t++)
+					{
+						float triangleDistance = getDistance(pos, vertexTriangles[t]);
+						if (triangleDistance < distance)
+						{
+							distance = triangleDistance;
+							closestTriangle = vertexTriangles[t];
+							closer = true;
+						}
+					}
+				}
+			}
+			maxDistance = std::max(maxDistance, distance);
+		}
+		return maxDistance;
+	}
+
+	MeshSimplifier::Collapse MeshSimplifier::getCollapse(uint32_t from, uint32_t to) const
+	{
+		double cost = _quadrics[from].evaluate(glm::dvec3(_vertices[to].pos));
+
+		// the triangles of the vertex take the normal of the target
+		const glm::vec3& fromNormal = _vertices[from].normal;
+		const glm::vec3& toNormal = _vertices[to].normal;
+		if (glm::dot(fromNormal, fromNormal) > 0.0f && glm::dot(toNormal, toNormal) > 0.0f)
+			cost += (1.0 - glm::dot(glm::normalize(fromNormal), glm::normalize(toNormal))) * _normalPenalty;
+
+		return { from, to, cost };
+	}
+
+	bool MeshSimplifier::isCollapseValid(uint32_t from, uint32_t to, std::span<const uint32_t> triangles,
+		const std::vector<uint32_t>& remap) const
+	{
+		for (uint32_t triangle : triangles)
+		{
+			uint32_t v[3] = { remap[_indices[triangle * 3]], remap[_indices[triangle * 3 + 1]], remap[_indices[triangle * 3 + 2]] };
+			if (v[0] == to || v[1] == to || v[2] == to)
+				continue; // removed by the collapse
+
+			glm::dvec3 before[3], after[3];
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				before[k] = glm::dvec3(_vertices[v[k]].pos);
+				after[k] = v[k] == from ? glm::dvec3(_vertices[to].pos) : before[k];
+			}
+
+			glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			if (glm::dot(normalBefore, normalAfter) <= MIN_NORMAL_COS * glm::length(normalBefore) * glm::length(normalAfter))
+				return false;
+		}
+		return true;
+	}
+
+	std::vector<uint32_t> MeshSimplifier::simplify(size_t targetIndexCount)
+	{
+		std::vector<uint32_t> remap(_vertices.size());
+		std::vector<uint8_t> touched(_vertices.size());
+		std::vector<uint32_t> triangleOffsets(_vertices.size() + 1);
+		std::vector<uint32_t> vertexTriangles;
+		std::vector<Collapse> collapses;
+
+		// one pass collapses the cheapest independent edges (no vertex collapsed twice), then the indices are rebuilt
+		while (_indices.size() > targetIndexCount)
+		{
+			getVertexTriangles(_indices, triangleOffsets, vertexTriangles);
+
+			// candidate collapses of the unlocked vertices along the edges of their triangles
+			collapses.clear();
+			for (size_t i = 0; i < _indices.size(); i += 3)
+			{
+				for (uint32_t e = 0; e < 3; e++)
+				{
+					uint32_t a = _indices[i + e], b = _indices[i + (e + 1) % 3];
+					if (!_locked[a])
+						collapses.push_back(getCollapse(a, b));
+					if (!_locked[b])
+						collapses.push_back(getCollapse(b, a));
+				}
+			}
+			std::ranges::sort(collapses, {}, &Collapse::cost);
+
+			// a collapse removes about two triangles
+			size_t triangleCount = _indices.size() / 3;
+			size_t targetTriangleCount = targetIndexCount / 3;
+			std::iota(remap.begin(), remap.end(), 0u);
+			std::ranges::fill(touched, 0);
+			size_t collapsedCount = 0;
+			for (const auto& collapse : collapses)
+			{
+				if (triangleCount <= targetTriangleCount)
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				auto triangles = std::span(vertexTriangles).subspan(triangleOffsets[collapse.from],
+					triangleOffsets[collapse.from + 1] - triangleOffsets[collapse.from]);
+				if (!isCollapseValid(collapse.from, collapse.to, triangles, remap))
+					continue;
+
+				remap[collapse.from] = collapse.to;
+				touched[collapse.from] = touched[collapse.to] = 1;
+				_quadrics[collapse.to].add(_quadrics[collapse.from]);
+				triangleCount -= std::min<size_t>(triangleCount, 2);
+				collapsedCount++;
+			}
+
+			if (collapsedCount == 0)
+				break; // only locked vertices or flipping collapses left
+
+			for (uint32_t& vertex : _collapsedInto)
+				vertex = remap[vertex];
+
+			// the collapsed triangles become degenerate
+			size_t write = 0;
+			for (size_t i = 0; i < _indices.size(); i += 3)
+			{
+				uint32_t a = remap[_indices[i]], b = remap[_indices[i + 1]], c = remap[_indices[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+				_indices[write++] = a;
+				_indices[write++] = b;
+				_indices[write++] = c;
+			}
+			_indices.resize(write);
+		}
+
+		_error = std::max(_error, measureError());
+		return _indices;
+	}
+
+	std::vector<SimplifiedLod> simplifyLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		std::vector<SimplifiedLod> lods;
+
+		// each level halves the triangles of the previous one, until the simplification stalls (locked seams and borders)
+		MeshSimplifier simplifier(vertices, indices);
+		size_t previousCount = indices.size();
+		while (lods.size() + 1 < MAX_LODS && previousCount / 3 >= 2 * MIN_LOD_TRIANGLES)
+		{
+			auto levelIndices = simplifier.simplify(previousCount / 2);
+			if (levelIndices.size() > previousCount * 3 / 4)
+				break;
+
+			previousCount = levelIndices.size();
+			lods.push_back({ .indices = std::move(levelIndices), .error = simplifier.getError() });
+		}
+
+		return lods;
+	}
+}
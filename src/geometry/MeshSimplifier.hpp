@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+// std
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace m1
+{
+	/*
+		Quadric error metric simplification (Garland-Heckbert) by half-edge collapses: a vertex is merged into one of its
+		neighbors, so each result is a new index list over the same vertices (the LODs share the vertex buffer).
+		- the cost of a collapse is the mean squared distance of the target to the planes of the triangles accumulated
+		  by the vertex (weighted by their area), plus a penalty for the difference of their normals
+		- the vertices of the UV and normal seams (several vertices at the same position) and of the open borders are
+		  locked, so the seams and the silhouette of open surfaces are kept
+		- the collapses flipping a triangle are rejected
+		The simplification is progressive: each call continues from the previous result.
+	*/
+	class MeshSimplifier
+	{
+	public:
+		MeshSimplifier(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+		// collapses edges until the indices are not more than targetIndexCount, or no collapse is possible
+		std::vector<uint32_t> simplify(size_t targetIndexCount);
+		// largest distance of the original vertices to the results so far, in object space: measured to the
+		// triangles of the vertex each one was collapsed into, an upper bound of the distance to the whole surface
+		[[nodiscard]] float getError() const;
+
+	private:
+		// symmetric 4x4 matrix of the plane equations (a, b, c, d)
+		struct Quadric
+		{
+			double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+			double weight = 0; // sum of the weights of the planes
+
+			void addPlane(const glm::dvec3& normal, double d, double planeWeight);
+			void add(const Quadric& other);
+			// weighted mean of the squared distances of the point to the planes
+			[[nodiscard]] double evaluate(const glm::dvec3& point) const;
+		};
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			double cost; // squared distance to the planes + normal penalty
+		};
+
+		// collapses a normal deviation of 90 degrees costs as much as moving by this fraction of the mesh size
+		static constexpr double NORMAL_WEIGHT = 0.05;
+		// the collapses making the angle between the old and new normals of a triangle larger than ~80 degrees are rejected
+		static constexpr double MIN_NORMAL_COS = 0.2;
+
+		const std::vector<Vertex>& _vertices;
+		std::vector<uint32_t> _indices;
+		std::vector<Quadric> _quadrics;
+		std::vector<uint8_t> _locked;
+		std::vector<uint32_t> _collapsedInto; // vertex of the current indices representing each original vertex
+		double _normalPenalty = 0;
+		float _error = 0;
+
+		[[nodiscard]] Collapse getCollapse(uint32_t from, uint32_t to) const;
+		// the triangles of the vertex keep their orientation when it's moved to the target
+		[[nodiscard]] bool isCollapseValid(uint32_t from, uint32_t to, std::span<const uint32_t> triangles,
+			const std::vector<uint32_t>& remap) const;
+		// largest distance of the original vertices to the triangles of the vertices they were collapsed into
+		[[nodiscard]] float measureError() const;
+	};
+
+	// levels of detail of a mesh, full detail included
+	constexpr uint32_t MAX_LODS = 5;
+	// smaller meshes (and levels) are not simplified
+	constexpr uint32_t MIN_LOD_TRIANGLES = 256;
+
+	// simplified level of detail, indexing the vertices of the full detail mesh
+	struct SimplifiedLod
+	{
+		std::vector<uint32_t> indices;
+		float error = 0.0f; // object space distance to the full detail surface
+	};
+
+	// levels after the full detail one, each halving the triangles of the previous level (see Mesh::generateLods)
+	std::vector<SimplifiedLod> simplifyLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+	// closest point of the triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+	glm::vec3 getClosestPoint(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+}
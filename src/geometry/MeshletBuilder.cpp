@@ -0,0 +1,175 @@
+#include "MeshletBuilder.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace m1
+{
+	namespace
+	{
+		// the meshlets with a wider normal cone are never back facing
+		constexpr float MIN_CONE_DOT = 0.1f;
+
+		// bounding sphere around the center of the bounds, normal cone of the unit triangle normals
+		void computeMeshletBounds(Meshlet& meshlet, std::span<const uint32_t> triangles, std::span<const uint32_t> vertexIndices,
+			std::span<const Vertex> vertices)
+		{
+			glm::vec3 min(vertices[vertexIndices[0]].pos), max(min);
+			for (uint32_t vertex : vertexIndices)
+			{
+				min = glm::min(min, vertices[vertex].pos);
+				max = glm::max(max, vertices[vertex].pos);
+			}
+			meshlet.center = (min + max) * 0.5f;
+			meshlet.radius = 0.0f;
+			for (uint32_t vertex : vertexIndices)
+				meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, vertices[vertex].pos));
+
+			std::vector<glm::vec3> normals;
+			normals.reserve(triangles.size() / 3);
+			glm::vec3 normalSum(0.0f);
+			for (size_t i = 0; i < triangles.size(); i += 3)
+			{
+				const glm::vec3& p0 = vertices[triangles[i]].pos;
+				glm::vec3 normal = glm::cross(vertices[triangles[i + 1]].pos - p0, vertices[triangles[i + 2]].pos - p0);
+				float length = glm::length(normal);
+				if (length == 0.0f)
+					continue; // degenerate
+				normals.push_back(normal / length);
+				normalSum += normals.back();
+			}
+
+			float sumLength = glm::length(normalSum);
+			if (normals.empty() || sumLength == 0.0f)
+				return;
+
+			glm::vec3 axis = normalSum / sumLength;
+			float minDot = 1.0f;
+			for (const auto& normal : normals)
+				minDot = std::min(minDot, glm::dot(normal, axis));
+			if (minDot < MIN_CONE_DOT)
+				return;
+
+			meshlet.coneAxis = axis;
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	std::vector<Meshlet> buildMeshlets(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+		std::vector<uint32_t>& meshletIndices)
+	{
+		std::vector<Meshlet> meshlets;
+		meshletIndices.clear();
+		meshletIndices.reserve(indices.size());
+
+		auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		if (triangleCount == 0)
+			return meshlets;
+
+		// triangles of each vertex
+		std::vector<uint32_t> triangleOffsets(vertices.size() + 1, 0);
+		for (uint32_t index : indices)
+			triangleOffsets[index + 1]++;
+		std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+		std::vector<uint32_t> vertexTriangles(indices.size());
+		{
+			std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (uint32_t i = 0; i < indices.size(); i++)
+				vertexTriangles[fill[indices[i]]++] = i / 3;
+		}
+
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		std::vector<uint32_t> vertexMeshlet(vertices.size(), UINT32_MAX); // last meshlet using the vertex
+		std::vector<uint32_t> meshletVertices;
+		meshletVertices.reserve(MAX_MESHLET_VERTICES);
+
+		// the index repeated by a degenerate triangle adds its vertex once
+		auto getNewVertexCount = [&](uint32_t triangle)
+		{
+			auto meshletIndex = static_cast<uint32_t>(meshlets.size());
+			uint32_t a = indices[triangle * 3], b = indices[triangle * 3 + 1], c = indices[triangle * 3 + 2];
+			return static_cast<uint32_t>(vertexMeshlet[a] != meshletIndex) +
+				static_cast<uint32_t>(b != a && vertexMeshlet[b] != meshletIndex) +
+				static_cast<uint32_t>(c != a && c != b && vertexMeshlet[c] != meshletIndex);
+		};
+
+		uint32_t meshletFirstIndex = 0;
+		uint32_t inputCursor = 0;
+		for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+		{
+			// neighbor adding the fewest vertices
+			uint32_t bestTriangle = UINT32_MAX;
+			uint32_t bestNewVertices = 4;
+			for (uint32_t vertex : meshletVertices)
+			{
+				for (uint32_t j = triangleOffsets[vertex]; j < triangleOffsets[vertex + 1] && bestNewVertices > 0; j++)
+				{
+					uint32_t triangle = vertexTriangles[j];
+					if (emitted[triangle])
+						continue;
+					uint32_t newVertices = getNewVertexCount(triangle);
+					if (newVertices < bestNewVertices)
+					{
+						bestNewVertices = newVertices;
+						bestTriangle = triangle;
+					}
+				}
+				if (bestNewVertices == 0)
+					break;
+			}
+
+			if (bestTriangle == UINT32_MAX)
+			{
+				while (emitted[inputCursor])
+					inputCursor++;
+				bestTriangle = inputCursor;
+				bestNewVertices = getNewVertexCount(bestTriangle);
+			}
+
+			// the triangle starts the next meshlet when it doesn't fit
+			auto meshletTriangleCount = static_cast<uint32_t>(meshletIndices.size() - meshletFirstIndex) / 3;
+			if (meshletVertices.size() + bestNewVertices > MAX_MESHLET_VERTICES || meshletTriangleCount == MAX_MESHLET_TRIANGLES)
+			{
+				Meshlet& meshlet = meshlets.emplace_back();
+				meshlet.firstIndex = meshletFirstIndex;
+				meshlet.triangleCount = meshletTriangleCount;
+				meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+				meshletFirstIndex = static_cast<uint32_t>(meshletIndices.size());
+				meshletVertices.clear();
+			}
+
+			auto meshletIndex = static_cast<uint32_t>(meshlets.size());
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				uint32_t vertex = indices[bestTriangle * 3 + k];
+				if (vertexMeshlet[vertex] != meshletIndex)
+				{
+					vertexMeshlet[vertex] = meshletIndex;
+					meshletVertices.push_back(vertex);
+				}
+				meshletIndices.push_back(vertex);
+			}
+			emitted[bestTriangle] = 1;
+		}
+
+		Meshlet& last = meshlets.emplace_back();
+		last.firstIndex = meshletFirstIndex;
+		last.triangleCount = static_cast<uint32_t>(meshletIndices.size() - meshletFirstIndex) / 3;
+		last.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+
+		// bounds of the finished meshlets
+		std::vector<uint32_t> vertexIndices;
+		for (auto& meshlet : meshlets)
+		{
+			auto triangles = std::span<const uint32_t>(meshletIndices).subspan(meshlet.firstIndex, meshlet.triangleCount * 3);
+			vertexIndices.assign(triangles.begin(), triangles.end());
+			std::ranges::sort(vertexIndices);
+			vertexIndices.erase(std::ranges::unique(vertexIndices).begin(), vertexIndices.end());
+			computeMeshletBounds(meshlet, triangles, vertexIndices, vertices);
+		}
+
+		return meshlets;
+	}
+}
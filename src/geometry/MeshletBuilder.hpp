@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+// std
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace m1
+{
+	// cluster of triangles culled as a whole, drawn as a range of the mesh indices
+	struct Meshlet
+	{
+		glm::vec3 center{};           // bounding sphere, object space
+		float radius = 0.0f;
+		glm::vec3 coneAxis{};         // average normal of the triangles
+		float coneCutoff = 1.0f;      // sine of the normal cone half angle, 1 => never back facing
+		uint32_t firstIndex = 0;      // range in the indices of buildMeshlets
+		uint32_t triangleCount = 0;
+		uint32_t vertexCount = 0;
+	};
+
+	// limits of the mesh shader friendly meshlets (one work group of 64 threads per meshlet)
+	static constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+	static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+	/*
+		Splits the triangles into meshlets grown greedily from a seed triangle: the next triangle is the one adding the
+		fewest vertices to the meshlet among the ones sharing its vertices, until a limit is reached. The input order (e.g.
+		optimized for the vertex cache) is followed when the meshlet has no neighbor left.
+		meshletIndices receives the triangles in the order of the meshlets.
+		The meshlet is back facing for all the camera positions p with
+		dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius.
+	*/
+	std::vector<Meshlet> buildMeshlets(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+		std::vector<uint32_t>& meshletIndices);
+}
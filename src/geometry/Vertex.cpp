@@ -1,5 +1,8 @@
 #include "Vertex.hpp"
 
+// std
+#include <cmath>
+
 namespace m1
 {
     VkVertexInputBindingDescription Vertex::getBindingDescription()
@@ -52,4 +55,74 @@ namespace m1
 
 	    return attributeDescriptions;
     }
-}
\ No newline at end of file
+
+	// octahedral encoding of a unit vector: projection on the octahedron, lower hemisphere folded over the upper one
+	static glm::vec2 octEncode(const glm::vec3& v)
+	{
+		float l1Norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+		if (l1Norm == 0.0f)
+			return glm::vec2(0.0f);
+
+		glm::vec2 p = glm::vec2(v.x, v.y) / l1Norm;
+		if (v.z < 0.0f)
+		{
+			glm::vec2 signs(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+			p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signs;
+		}
+
+		return p;
+	}
+
+	PackedVertex PackedVertex::pack(const Vertex& vertex, const glm::vec3& boundsCenter, const glm::vec3& boundsHalfExtent)
+	{
+		glm::vec3 position = glm::clamp((vertex.pos - boundsCenter) / boundsHalfExtent, -1.0f, 1.0f);
+		float handedness = vertex.tangent.w < 0.0f ? -1.0f : 1.0f;
+
+		return PackedVertex
+		{
+			.position = { glm::packSnorm2x16(glm::vec2(position.x, position.y)), glm::packSnorm2x16(glm::vec2(position.z, handedness)) },
+			.normal = glm::packSnorm2x16(octEncode(vertex.normal)),
+			.tangent = glm::packSnorm2x16(octEncode(glm::vec3(vertex.tangent))),
+			.texCoord = glm::packHalf2x16(vertex.texCoord),
+		};
+	}
+
+	uint32_t PackedVertex::packColor(const glm::vec3& color)
+	{
+		return glm::packUnorm4x8(glm::vec4(color, 1.0f));
+	}
+
+	VertexLayout VertexLayout::get(VertexFormat format, bool positionOnly)
+	{
+		VertexLayout layout{};
+
+		if (format == VertexFormat::Standard)
+		{
+			layout.bindings.push_back(Vertex::getBindingDescription());
+			layout.attributes = Vertex::getAttributeDescriptions();
+		}
+		else
+		{
+			layout.bindings.push_back({ .binding = 0, .stride = sizeof(PackedVertex), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX });
+			layout.attributes =
+			{
+				{ .location = 0, .binding = 0, .format = VK_FORMAT_R16G16B16A16_SNORM, .offset = offsetof(PackedVertex, position) },
+				{ .location = 2, .binding = 0, .format = VK_FORMAT_R16G16_SNORM, .offset = offsetof(PackedVertex, normal) },
+				{ .location = 3, .binding = 0, .format = VK_FORMAT_R16G16_SFLOAT, .offset = offsetof(PackedVertex, texCoord) },
+				{ .location = 4, .binding = 0, .format = VK_FORMAT_R16G16_SNORM, .offset = offsetof(PackedVertex, tangent) },
+			};
+
+			if (!positionOnly)
+			{
+				// color stream
+				layout.bindings.push_back({ .binding = 1, .stride = sizeof(uint32_t), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX });
+				layout.attributes.push_back({ .location = 1, .binding = 1, .format = VK_FORMAT_R8G8B8A8_UNORM, .offset = 0 });
+			}
+		}
+
+		if (positionOnly)
+			std::erase_if(layout.attributes, [](const VkVertexInputAttributeDescription& attribute) { return attribute.location != 0; });
+
+		return layout;
+	}
+}
@@ -10,6 +10,12 @@
 
 namespace m1
 {
+	enum class VertexFormat
+	{
+		Standard, // Vertex: full float attributes (60 bytes)
+		Packed,   // PackedVertex (20 bytes) + color stream (4 bytes)
+	};
+
 	struct Vertex
 	{
 		glm::vec3 pos{};
@@ -27,6 +33,35 @@ namespace m1
 			       tangent == other.tangent;
 		}
 	};
+
+	/*
+		Quantized vertex, binding 0 of the packed format:
+		- position: snorm16 xyz in the bounds of the mesh (dequantized by the model matrix), w = tangent handedness
+		- normal, tangent: octahedral encoding in snorm16x2
+		- texCoord: half float
+		The color is stored in a separate stream (binding 1, unorm8x4), not fetched by the position only pipelines.
+	*/
+	struct PackedVertex
+	{
+		uint32_t position[2];
+		uint32_t normal;
+		uint32_t tangent;
+		uint32_t texCoord;
+
+		// boundsCenter/boundsHalfExtent: bounds of the positions of the mesh (half extent components must be > 0)
+		static PackedVertex pack(const Vertex& vertex, const glm::vec3& boundsCenter, const glm::vec3& boundsHalfExtent);
+		static uint32_t packColor(const glm::vec3& color);
+	};
+
+	// vertex input state (bindings and attributes) of a vertex format
+	struct VertexLayout
+	{
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+
+		// positionOnly: only the location 0 (e.g. shadow mapping)
+		static VertexLayout get(VertexFormat format, bool positionOnly = false);
+	};
 }
 
 namespace std
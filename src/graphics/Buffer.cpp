@@ -7,11 +7,12 @@
 
 namespace m1
 {
-	Buffer::Buffer(const Device& device, VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags memoryProps) : _device(device)
+	Buffer::Buffer(const Device& device, VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags memoryProps,
+		QueueSharing sharing) : _device(device)
 	{
 		Log::Get().Info("Creating buffer of size " + std::to_string(size));
 		_size = size;
-		createBuffer(size, usage, memoryProps);
+		createBuffer(size, usage, memoryProps, sharing);
 	}
 
 	Buffer::~Buffer()
@@ -26,6 +27,12 @@ namespace m1
 		vmaCopyMemoryToAllocation(_device.getMemoryAllocator(), data, _allocation, 0, _size);
 	}
 
+	void Buffer::copyDataFromBuffer(void* data) const
+	{
+		// the buffer must be host visible (e.g. created with VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT for readbacks)
+		vmaCopyAllocationToMemory(_device.getMemoryAllocator(), _allocation, 0, data, _size);
+	}
+
 	VkDescriptorBufferInfo Buffer::getVkDescriptorBufferInfo() const
 	{
 		return {
@@ -35,7 +42,7 @@ namespace m1
 		};
 	}
 
-	void Buffer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags memoryProps)
+	void Buffer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags memoryProps, QueueSharing sharing)
 	{
 		// Buffer Info
 		VkBufferCreateInfo bufferInfo{};
@@ -44,12 +51,23 @@ namespace m1
 		bufferInfo.usage = usage; // purpose of the data in the buffer
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // sharing mode between multiple queue families
 
+		// e.g. written by the dedicated transfer queue and read by the graphics queue: concurrent sharing avoids the ownership transfers
+		auto queueFamilies = _device.getResourceQueueFamilies(sharing);
+		if (queueFamilies.size() > 1)
+		{
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+			bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+		}
+
 		// allocation info
 		VmaAllocationCreateInfo allocInfo = {};
 		allocInfo.usage = VMA_MEMORY_USAGE_AUTO; // best memory type selected automatically based on usage
 		allocInfo.flags = memoryProps;
 
 		// create the buffer
-		VK_CHECK(vmaCreateBuffer(_device.getMemoryAllocator(), &bufferInfo, &allocInfo, &_vkBuffer, &_allocation, nullptr));
+		VmaAllocationInfo allocationInfo;
+		VK_CHECK(vmaCreateBuffer(_device.getMemoryAllocator(), &bufferInfo, &allocInfo, &_vkBuffer, &_allocation, &allocationInfo));
+		_mappedData = allocationInfo.pMappedData;
 	}
 }
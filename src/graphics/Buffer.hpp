@@ -1,6 +1,7 @@
 #pragma once
 
 #include <graphics/Material.hpp>
+#include <graphics/QueueSharing.hpp>
 
 // libs
 #include "vk_mem_alloc.h"
@@ -10,6 +11,7 @@ namespace m1
 	class Device; // Forward declaration
 
 	#define MAX_LIGHTS 10
+	#define MAX_SHADOW_CASCADES 4
 
 	struct Light
 	{
@@ -29,16 +31,42 @@ namespace m1
 	{
 		glm::mat4 view;
 		glm::mat4 proj;
-		glm::mat4 lightViewProjMatrix;
+		glm::mat4 cascadeViewProj[MAX_SHADOW_CASCADES]; // light view projection of each shadow cascade (layer of the shadow map)
+		glm::vec4 cascadeSplits; // view depth where each cascade ends
 		glm::vec4 camPos; // 3 meaningful value, vec4 for padding
 		float iblIntensity;
 		int shadowsEnabled;
+		int cascadeCount;
 	};
 
-	struct ObjectUbo
+	// One entry per scene object in the objects SSBO (std430), written once per frame.
+	// Read by the vertex shaders (object index = instances[gl_InstanceIndex]) and by the GPU-driven culling compute shader
+	struct ObjectData
 	{
 		glm::mat4 model;
-		glm::mat3 normalMatrix;
+		glm::mat4 normalMatrix; // mat3 stored as mat4 to match the std430 column alignment
+		glm::vec4 boundsCenter; // world space
+		glm::vec4 boundsExtent; // world space half extent, negative => never visible
+		uint32_t batchIndex;    // draw batch (counter of the visible instances)
+		uint32_t firstCommand;  // first indirect command of the batch
+		uint32_t indexCount;
+		uint32_t firstIndex;    // range of the LOD of the main pass in the geometry pool block
+		int32_t vertexOffset;
+		uint32_t shadowIndexCount;
+		uint32_t shadowFirstIndex; // range of the LOD of the shadow pass
+		uint32_t firstMeshlet;     // in the meshlets SSBO
+		uint32_t meshletCount;     // 0 => culled and drawn as a whole
+		uint32_t padding[3];
+	};
+
+	// meshlet read by the meshlet culling (see Meshlet)
+	struct MeshletData
+	{
+		glm::vec4 boundingSphere; // center in the space of the positions of the geometry pool (before the model matrix), object space radius
+		glm::vec4 cone;           // object space axis, cutoff
+		uint32_t firstIndex;      // in the geometry pool block
+		uint32_t indexCount;
+		uint32_t padding[2];
 	};
 
 	struct MaterialPhongUbo
@@ -68,7 +96,8 @@ namespace m1
 	class Buffer
 	{
 	public:
-		Buffer(const Device& device, VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags memoryProps = 0);
+		Buffer(const Device& device, VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags memoryProps = 0,
+			QueueSharing sharing = QueueSharing::Exclusive);
 		~Buffer();
 
 		// Non-copyable
@@ -77,14 +106,18 @@ namespace m1
 
 		[[nodiscard]] VkBuffer getVkBuffer() const { return _vkBuffer; }
 		void copyDataToBuffer(const void* data) const;
+		void copyDataFromBuffer(void* data) const;
 		[[nodiscard]] VkDeviceSize getSize() const { return _size; }
+		// pointer to the persistently mapped memory (VMA_ALLOCATION_CREATE_MAPPED_BIT), null otherwise
+		[[nodiscard]] void* getMappedData() const { return _mappedData; }
 		[[nodiscard]] VkDescriptorBufferInfo getVkDescriptorBufferInfo() const;
 
 	private:
 		VkBuffer _vkBuffer;
 		VmaAllocation _allocation;
 		VkDeviceSize _size;
+		void* _mappedData = nullptr;
 		const Device& _device;
-		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags memoryProps);
+		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags memoryProps, QueueSharing sharing);
 	};
 }
\ No newline at end of file
@@ -22,6 +22,8 @@ namespace m1
 		void setViewDirection(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& up = glm::vec3(0.0f, -1.0f, 0.0f));
 		void setViewTarget(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up = glm::vec3(0.0f, -1.0f, 0.0f));
 		[[nodiscard]] const glm::vec3& getPosition () const { return _position; }
+		[[nodiscard]] const glm::vec3& getTarget () const { return _target; }
+		[[nodiscard]] const glm::vec3& getUp () const { return _up; }
 		void setPosition(const glm::vec3& pos) { _position = pos; updateViewMatrix(); }
 		void setTarget(const glm::vec3& target) { _target = target; updateViewMatrix(); }
 		void setUp(const glm::vec3& up) { _up = up; updateViewMatrix(); }
@@ -29,6 +31,8 @@ namespace m1
 		[[nodiscard]] const glm::mat4& getViewMatrix() const { return _viewMatrix; }
 		[[nodiscard]] const glm::mat4& getProjectionMatrix() const { return _projectionMatrix; }
 		[[nodiscard]] ProjectionType getProjectionType() const { return _projectionType; }
+		[[nodiscard]] float getNearPlane() const { return _nearPlane; }
+		[[nodiscard]] float getFarPlane() const { return _farPlane; }
 		void setProjectionType(ProjectionType projectionType) { _projectionType = projectionType; updateProjectionMatrix(); }
 		[[nodiscard]] bool isYup() const { return glm::dot(glm::normalize(_up), glm::vec3(0.0f, 1.0f, 0.0f)) > 0.999f;}
 
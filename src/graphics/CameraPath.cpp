@@ -0,0 +1,132 @@
+#include "CameraPath.hpp"
+#include "Log.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <format>
+
+namespace m1
+{
+	CameraPath CameraPath::load(const std::string& filePath)
+	{
+		std::ifstream file(filePath);
+		if (!file.is_open())
+		{
+			Log::Get().Error("Failed to open camera path " + filePath);
+			throw std::runtime_error("Failed to open camera path " + filePath);
+		}
+
+		CameraPath path;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (line.empty() || line[0] == '#')
+				continue;
+
+			std::istringstream stream(line);
+			CameraKeyframe keyframe;
+			stream >> keyframe.time
+			       >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+			       >> keyframe.target.x >> keyframe.target.y >> keyframe.target.z;
+
+			if (stream.fail())
+			{
+				Log::Get().Warning("Skipping malformed camera path line: " + line);
+				continue;
+			}
+
+			path.addKeyframe(keyframe);
+		}
+
+		return path;
+	}
+
+	CameraPath CameraPath::orbit(const glm::vec3& center, const glm::vec3& up, float radius, float height, float duration, uint32_t keyframesCount)
+	{
+		// build an orthonormal basis around the up axis
+		glm::vec3 upAxis = glm::normalize(up);
+		glm::vec3 helper = std::abs(upAxis.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+		glm::vec3 axisU = glm::normalize(glm::cross(upAxis, helper));
+		glm::vec3 axisV = glm::cross(upAxis, axisU);
+
+		CameraPath path;
+		keyframesCount = std::max(keyframesCount, 2u);
+		for (uint32_t i = 0; i < keyframesCount; i++)
+		{
+			float t = static_cast<float>(i) / static_cast<float>(keyframesCount - 1);
+			float angle = t * 2.0f * 3.14159265358979323846f;
+
+			CameraKeyframe keyframe
+			{
+				.time = t * duration,
+				.position = center + radius * (std::cos(angle) * axisU + std::sin(angle) * axisV) + height * upAxis,
+				.target = center,
+			};
+			path.addKeyframe(keyframe);
+		}
+
+		return path;
+	}
+
+	void CameraPath::save(const std::string& filePath) const
+	{
+		std::ofstream file(filePath);
+		if (!file.is_open())
+		{
+			Log::Get().Error("Failed to write camera path " + filePath);
+			throw std::runtime_error("Failed to write camera path " + filePath);
+		}
+
+		file << "# time px py pz tx ty tz\n";
+		for (const auto& k : _keyframes)
+		{
+			file << std::format("{} {} {} {} {} {} {}\n", k.time,
+				k.position.x, k.position.y, k.position.z, k.target.x, k.target.y, k.target.z);
+		}
+	}
+
+	void CameraPath::addKeyframe(const CameraKeyframe& keyframe)
+	{
+		// keep the keyframes sorted by time
+		auto it = std::upper_bound(_keyframes.begin(), _keyframes.end(), keyframe.time,
+			[](float time, const CameraKeyframe& k) { return time < k.time; });
+		_keyframes.insert(it, keyframe);
+	}
+
+	CameraKeyframe CameraPath::sample(float time) const
+	{
+		if (_keyframes.empty())
+			return {};
+
+		if (_keyframes.size() == 1 || getDuration() <= 0.0f)
+			return _keyframes.front();
+
+		// loop
+		float duration = getDuration();
+		time = std::fmod(std::max(time, 0.0f), duration);
+
+		// first keyframe after time
+		auto next = std::upper_bound(_keyframes.begin(), _keyframes.end(), time,
+			[](float t, const CameraKeyframe& k) { return t < k.time; });
+
+		if (next == _keyframes.begin())
+			return _keyframes.front();
+		if (next == _keyframes.end())
+			return _keyframes.back();
+
+		const CameraKeyframe& k0 = *(next - 1);
+		const CameraKeyframe& k1 = *next;
+		float span = k1.time - k0.time;
+		float f = span > 0.0f ? (time - k0.time) / span : 0.0f;
+
+		return {
+			.time = time,
+			.position = glm::mix(k0.position, k1.position, f),
+			.target = glm::mix(k0.target, k1.target, f),
+		};
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// libs
+#include "glm_config.hpp"
+
+// std
+#include <string>
+#include <vector>
+
+namespace m1
+{
+	struct CameraKeyframe
+	{
+		float time = 0.0f; // seconds from the start of the path
+		glm::vec3 position{0.0f};
+		glm::vec3 target{0.0f};
+	};
+
+	// A camera path is a list of keyframes sampled with linear interpolation.
+	// Used to record a camera fly-through and replay it deterministically (e.g. benchmarks).
+	// Text format: one keyframe per line "time px py pz tx ty tz", lines starting with '#' are comments.
+	class CameraPath
+	{
+	public:
+		static CameraPath load(const std::string& filePath);
+		// a circular path around center, in the plane orthogonal to up
+		static CameraPath orbit(const glm::vec3& center, const glm::vec3& up, float radius, float height, float duration, uint32_t keyframesCount = 64);
+
+		void save(const std::string& filePath) const;
+		void addKeyframe(const CameraKeyframe& keyframe);
+		// the path loops when time exceeds its duration
+		[[nodiscard]] CameraKeyframe sample(float time) const;
+		[[nodiscard]] float getDuration() const { return _keyframes.empty() ? 0.0f : _keyframes.back().time; }
+		[[nodiscard]] bool empty() const { return _keyframes.empty(); }
+		[[nodiscard]] size_t size() const { return _keyframes.size(); }
+
+	private:
+		std::vector<CameraKeyframe> _keyframes;
+	};
+}
@@ -34,14 +34,14 @@ namespace m1
         VK_CHECK(vkCreateCommandPool(_device.getVkDevice(), &poolInfo, nullptr, &_commandPool));
     }
 
-    std::vector<VkCommandBuffer> CommandPool::allocateCommandBuffers(int count) const
+    std::vector<VkCommandBuffer> CommandPool::allocateCommandBuffers(int count, VkCommandBufferLevel level) const
     {
         std::vector<VkCommandBuffer> commandBuffers(count);
 
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool = _commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.level = level;
         allocInfo.commandBufferCount = count;
 
         VK_CHECK(vkAllocateCommandBuffers(_device.getVkDevice(), &allocInfo, commandBuffers.data()));
@@ -27,6 +27,7 @@ namespace m1
 	    createMaterialPbrDescriptorSetLayout();
 		createOneSamplerDescriptorSetLayout();
 		createParticleDescriptorSetLayout();
+		createCullingDescriptorSetLayout();
 	    createDescriptorPool();
     }
 
@@ -45,23 +46,13 @@ namespace m1
     {
 	    // Most frequently updated resources of each set must be first in binding order for performance optimization
 
-	    // Object Uniform buffer layout binding
-	    VkDescriptorSetLayoutBinding objectUboLayoutBinding
-		{
-		    .binding = 0, // binding number. Correspond number used in the shaders
-		    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-		    .descriptorCount = 1, // number of descriptors in the binding, for arrays
-		    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT, // which shader stages will access this binding
-		    .pImmutableSamplers = nullptr
-	    };
-
 	    // Frame Uniform buffer layout binding
 	    VkDescriptorSetLayoutBinding frameUboLayoutBinding
 		{
-		    .binding = 1,
+		    .binding = 1, // binding number. Correspond number used in the shaders
 		    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-		    .descriptorCount = 1,
-		    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		    .descriptorCount = 1, // number of descriptors in the binding, for arrays
+		    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, // which shader stages will access this binding
 		    .pImmutableSamplers = nullptr
 	    };
 
@@ -115,16 +106,37 @@ namespace m1
 			.pImmutableSamplers = nullptr
 		};
 
+		// Objects SSBO (per object data indexed by gl_InstanceIndex)
+		VkDescriptorSetLayoutBinding objectsSsboBinding
+		{
+			.binding = 7,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
+		// Instances SSBO (object index of each instance of the draws)
+		VkDescriptorSetLayoutBinding instancesSsboBinding
+		{
+			.binding = 8,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
 	    // DescriptorSet Info
 	    std::array bindings =
 	    {
-		    objectUboLayoutBinding,
 		    frameUboLayoutBinding,
 	    	lightsUboLayoutBinding,
 			shadowMapSamplerBinding,
 	    	irradianceSamplerBinding,
 	    	prefilteredSamplerBinding,
-	    	brdfLUTSamplerBinding
+	    	brdfLUTSamplerBinding,
+	    	objectsSsboBinding,
+	    	instancesSsboBinding
 	    };
 
 	    VkDescriptorSetLayoutCreateInfo layoutInfo
@@ -335,25 +347,131 @@ namespace m1
 		_descriptorSetLayouts.emplace(DescriptorSetLayoutType::ComputeParticles, descriptorSetLayout);
 	}
 
+	void DescriptorSetManager::createCullingDescriptorSetLayout()
+	{
+		// Frame UBO (view-projection matrices of the camera and of the light)
+		VkDescriptorSetLayoutBinding frameUboLayoutBinding
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
+		// Objects SSBO (read)
+		VkDescriptorSetLayoutBinding objectsSsboLayoutBinding
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
+		// Indirect draw commands (write)
+		VkDescriptorSetLayoutBinding drawCommandsLayoutBinding
+		{
+			.binding = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
+		// Draw counts, one for each batch (write)
+		VkDescriptorSetLayoutBinding drawCountsLayoutBinding
+		{
+			.binding = 3,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
+		// Object index of each instance, indexed by the commands (write)
+		VkDescriptorSetLayoutBinding instancesLayoutBinding
+		{
+			.binding = 4,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
+		// Meshlets of all the meshes (read by the meshlet culling)
+		VkDescriptorSetLayoutBinding meshletsLayoutBinding
+		{
+			.binding = 5,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
+		// Meshlet tasks, appended by the object culling and read by the meshlet culling
+		VkDescriptorSetLayoutBinding meshletTasksLayoutBinding
+		{
+			.binding = 6,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
+		// Indirect dispatch of the meshlet culling (write)
+		VkDescriptorSetLayoutBinding meshletDispatchLayoutBinding
+		{
+			.binding = 7,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = nullptr
+		};
+
+		std::array bindings =
+		{
+			frameUboLayoutBinding,
+			objectsSsboLayoutBinding,
+			drawCommandsLayoutBinding,
+			drawCountsLayoutBinding,
+			instancesLayoutBinding,
+			meshletsLayoutBinding,
+			meshletTasksLayoutBinding,
+			meshletDispatchLayoutBinding,
+		};
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = static_cast<uint32_t>(bindings.size()),
+			.pBindings = bindings.data()
+		};
+
+		VkDescriptorSetLayout descriptorSetLayout;
+		VK_CHECK(vkCreateDescriptorSetLayout(_device.getVkDevice(), &layoutInfo, nullptr, &descriptorSetLayout));
+		_descriptorSetLayouts.emplace(DescriptorSetLayoutType::ComputeCulling, descriptorSetLayout);
+	}
+
 	void DescriptorSetManager::createDescriptorPool()
 	{
 		// Pool sizes
 		std::array<VkDescriptorPoolSize, 4> poolSizes{};
 		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSizes[0].descriptorCount = static_cast<uint32_t>(Engine::FRAMES_IN_FLIGHT * 3); // *3 => frame, object and lights UBO
+		poolSizes[0].descriptorCount = Engine::MAX_FRAMES_IN_FLIGHT * 3; // *3 => frame and lights UBO + frame UBO of the culling
 		poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-		poolSizes[1].descriptorCount = static_cast<uint32_t>(Engine::FRAMES_IN_FLIGHT); // materials dyn ubo (each buffer contains all materials data)
+		poolSizes[1].descriptorCount = Engine::MAX_FRAMES_IN_FLIGHT * 500; // materials dyn ubo, one for each material (phong and pbr) and frame in flight
         poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[2].descriptorCount = static_cast<uint32_t>(1000); // sampler, one for each material + shadow map sampler
+        poolSizes[2].descriptorCount = Engine::MAX_FRAMES_IN_FLIGHT * 2000; // samplers, 8 for each material and frame in flight + shadow map and IBL samplers
 		poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		poolSizes[3].descriptorCount = static_cast<uint32_t>(Engine::FRAMES_IN_FLIGHT) * 2; // *2 => prev and current frame SSBO
+		poolSizes[3].descriptorCount = Engine::MAX_FRAMES_IN_FLIGHT * 11; // *11 => prev and current frame particles SSBO, objects and instances SSBO + culling objects, commands, counts, instances, meshlets, meshlet tasks and dispatch
 
         // DescriptorPool Info
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
         poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(1000);
+        poolInfo.maxSets = Engine::MAX_FRAMES_IN_FLIGHT * 600;
 
 		// Create the descriptor pool
         VK_CHECK(vkCreateDescriptorPool(_device.getVkDevice(), &poolInfo, nullptr, &_descriptorPool));
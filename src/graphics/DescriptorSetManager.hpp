@@ -16,6 +16,7 @@ namespace m1
 		MaterialPhong,
 		MaterialPbr,
 		ComputeParticles,
+		ComputeCulling,
 		OneSampler,
 	};
 
@@ -44,6 +45,7 @@ namespace m1
 		void createMaterialPbrDescriptorSetLayout();
 		void createOneSamplerDescriptorSetLayout();
 		void createParticleDescriptorSetLayout();
+		void createCullingDescriptorSetLayout();
 		void createDescriptorPool();
 	};
 }
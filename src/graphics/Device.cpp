@@ -9,23 +9,40 @@
 #define VMA_IMPLEMENTATION
 #include "vk_mem_alloc.h"
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <set>
 #include <iostream>
 
 namespace m1
 {
-	Device::Device(const Window& window)
+	Device::Device(const Window* window) : _headless(window == nullptr), _instance(window == nullptr)
     {
-        Log::Get().Info("Creating device");
+        Log::Get().Info(_headless ? "Creating headless device" : "Creating device");
 		_deviceProperties = {};
-        createSurface(window);
+
+		if (!_headless)
+		{
+			_requiredExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME); // Not all graphics cards are capable of presenting images
+			createSurface(*window);
+		}
+
         pickPhysicalDevice();
         createLogicalDevice();
 		createMemoryAllocator();
         _graphicsQueue = std::make_unique<Queue>(*this, _queueFamilies.graphicsFamily.value(), 0);
-        _presentQueue = std::make_unique<Queue>(*this, _queueFamilies.presentFamily.value(), 0);
-        _computeQueue = std::make_unique<Queue>(*this, _queueFamilies.graphicsFamily.value(), 0);
+		if (!_headless)
+			_presentQueue = std::make_unique<Queue>(*this, _queueFamilies.presentFamily.value(), 0);
+        _computeQueue = std::make_unique<Queue>(*this, _queueFamilies.computeFamily.value_or(_queueFamilies.graphicsFamily.value()), 0);
+        _transferQueue = std::make_unique<Queue>(*this, _queueFamilies.transferFamily.value_or(_queueFamilies.graphicsFamily.value()), 0);
+
+        if (hasDedicatedTransferQueue())
+            Log::Get().Info("Using the dedicated transfer queue family " + std::to_string(_queueFamilies.transferFamily.value()));
+        if (hasDedicatedComputeQueue())
+            Log::Get().Info("Using the dedicated compute queue family " + std::to_string(_queueFamilies.computeFamily.value()));
+        else
+            Log::Get().Warning("No compute queue family without graphics: the particles are computed on the graphics queue (no overlap)");
     }
 
     Device::~Device()
@@ -37,11 +54,13 @@ namespace m1
         _graphicsQueue = nullptr;
         _presentQueue = nullptr;
         _computeQueue = nullptr;
+        _transferQueue = nullptr;
 
 		// physical device is implicitly destroyed when the VkInstance is destroyed
         // Device queues are implicitly destroyed when the device is destroyed
         vkDestroyDevice(_vkDevice, nullptr);
-        vkDestroySurfaceKHR(_instance.getVkInstance(), _surface, nullptr);
+        if (_surface != VK_NULL_HANDLE)
+            vkDestroySurfaceKHR(_instance.getVkInstance(), _surface, nullptr);
         Log::Get().Info("Device destroyed");
     }
 
@@ -121,7 +140,13 @@ namespace m1
         Log::Get().Info("Creating logical device");
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         // Gets unique queue indices (duplicates are automatically discarded)
-        std::set<uint32_t> uniqueQueueFamilies = { _queueFamilies.graphicsFamily.value(), _queueFamilies.presentFamily.value() };
+        std::set<uint32_t> uniqueQueueFamilies = { _queueFamilies.graphicsFamily.value() };
+        if (_queueFamilies.presentFamily.has_value())
+            uniqueQueueFamilies.insert(_queueFamilies.presentFamily.value());
+        if (_queueFamilies.transferFamily.has_value())
+            uniqueQueueFamilies.insert(_queueFamilies.transferFamily.value());
+        if (_queueFamilies.computeFamily.has_value())
+            uniqueQueueFamilies.insert(_queueFamilies.computeFamily.value());
 
         // Queue info
         float queuePriority = 1.0f;
@@ -140,11 +165,24 @@ namespace m1
         VkPhysicalDeviceFeatures deviceFeatures{};
 		deviceFeatures.samplerAnisotropy = VK_TRUE; // enable anisotropic filtering
 		deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading (for better quality when using MSAA)
+		deviceFeatures.multiDrawIndirect = _deviceFeatures.multiDrawIndirect;
+		deviceFeatures.drawIndirectFirstInstance = _deviceFeatures.drawIndirectFirstInstance;
+		deviceFeatures.textureCompressionBC = _deviceFeatures.textureCompressionBC;
+
+        // enable Vulkan 1.2 features
+        VkPhysicalDeviceVulkan12Features features12 =
+        {
+	        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        	.drawIndirectCount = _deviceFeatures.drawIndirectCount,
+        	.hostQueryReset = _deviceFeatures.hostQueryReset,
+        	.timelineSemaphore = true, // frame synchronization (core in Vulkan 1.2)
+        };
 
         // enable Vulkan 1.3 features
         VkPhysicalDeviceVulkan13Features features =
         {
 	        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        	.pNext = &features12,
         	.synchronization2 = true,
 	        .dynamicRendering = true,
         };
@@ -156,8 +194,12 @@ namespace m1
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(_requiredExtensions.size());
-        createInfo.ppEnabledExtensionNames = _requiredExtensions.data();
+        // required and supported optional extensions
+        std::vector<const char*> extensions = _requiredExtensions;
+        if (_deviceFeatures.memoryBudget)
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
 
         // Create logical device
         VK_CHECK(vkCreateDevice(_physicalDevice, &createInfo, nullptr, &_vkDevice));
@@ -175,17 +217,20 @@ namespace m1
 
         // check queue families
         _queueFamilies = findQueueFamilies(device);
-        if (!_queueFamilies.isComplete())
+        if (!_queueFamilies.isComplete(_headless))
             return false;
 
         // check extensions support
         if (!checkDeviceExtensionSupport(device))
             return false;
 
-        // check swapChain support
-        auto swapChainProperties = getSwapChainProperties(device);
-        if (swapChainProperties.formats.empty() || swapChainProperties.presentModes.empty())
-            return false;
+        // check swapChain support (nothing to present in headless mode)
+        if (!_headless)
+        {
+            auto swapChainProperties = getSwapChainProperties(device);
+            if (swapChainProperties.formats.empty() || swapChainProperties.presentModes.empty())
+                return false;
+        }
 
 		// get device properties
         VkSampleCountFlags counts = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
@@ -198,7 +243,32 @@ namespace m1
 											VK_SAMPLE_COUNT_1_BIT;
 
 		_deviceProperties.minUniformBufferOffsetAlignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+		_deviceProperties.maxComputeWorkGroupCountX = deviceProperties.limits.maxComputeWorkGroupCount[0];
 		_deviceProperties.apiVersion = deviceProperties.apiVersion;
+		_deviceProperties.deviceName = deviceProperties.deviceName;
+		_deviceProperties.vendorId = deviceProperties.vendorID;
+		_deviceProperties.deviceId = deviceProperties.deviceID;
+		_deviceProperties.driverVersion = deviceProperties.driverVersion;
+		std::copy_n(deviceProperties.pipelineCacheUUID, VK_UUID_SIZE, _deviceProperties.pipelineCacheUuid.begin());
+
+		// timestamp queries support (used for GPU timings)
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+		_deviceProperties.timestampPeriod = deviceProperties.limits.timestampPeriod;
+		_deviceProperties.timestampValidBits = queueFamilies[_queueFamilies.graphicsFamily.value()].timestampValidBits;
+
+		// optional features
+		VkPhysicalDeviceVulkan12Features supportedFeatures12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+		VkPhysicalDeviceFeatures2 supportedFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &supportedFeatures12 };
+		vkGetPhysicalDeviceFeatures2(device, &supportedFeatures);
+		_deviceFeatures.hostQueryReset = supportedFeatures12.hostQueryReset;
+		_deviceFeatures.drawIndirectCount = supportedFeatures12.drawIndirectCount;
+		_deviceFeatures.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+		_deviceFeatures.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+		_deviceFeatures.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+		_deviceFeatures.memoryBudget = isExtensionSupported(device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
 		Log::Get().Info("Device " + std::string(deviceProperties.deviceName) + " is suitable");
         Log::Get().Info("Device maxPushConstantsSize: " + std::to_string(deviceProperties.limits.maxPushConstantsSize) + "bytes");
@@ -224,6 +294,20 @@ namespace m1
         return requiredExtensions.empty();
     }
 
+    bool Device::isExtensionSupported(VkPhysicalDevice device, const char* extensionName)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        return std::ranges::any_of(availableExtensions, [extensionName](const VkExtensionProperties& extension)
+        {
+            return std::strcmp(extension.extensionName, extensionName) == 0;
+        });
+    }
+
     QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) const
     {
         QueueFamilyIndices indices;
@@ -241,20 +325,22 @@ namespace m1
             if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT
             	&& queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)
             {
-            	// family that support both graphics and compute operations.
-            	// For async compute I should use a dedicated compute queue family.
+            	// family that support both graphics and compute operations
                 indices.graphicsFamily = i;
             }
 
             // presentFamily
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
-            if (presentSupport)
+            if (!_headless)
             {
-                indices.presentFamily = i; // very likely the same of graphicsFamily. Better for performance if they are the same
+                VkBool32 presentSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
+                if (presentSupport)
+                {
+                    indices.presentFamily = i; // very likely the same of graphicsFamily. Better for performance if they are the same
+                }
             }
 
-            if (indices.isComplete())
+            if (indices.isComplete(_headless))
             {
                 break;
             }
@@ -262,6 +348,29 @@ namespace m1
             i++;
         }
 
+        // dedicated transfer family (usually a DMA engine): copies run in parallel with the graphics work
+        for (uint32_t j = 0; j < queueFamilyCount; j++)
+        {
+            auto flags = queueFamilies[j].queueFlags;
+            if (flags & VK_QUEUE_TRANSFER_BIT && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+            {
+                indices.transferFamily = j;
+                break;
+            }
+        }
+
+        // dedicated (async) compute family: the particles computation overlaps with the graphics work.
+        // Timestamps are required to keep the computation measured by the GPU profiler
+        for (uint32_t j = 0; j < queueFamilyCount; j++)
+        {
+            auto flags = queueFamilies[j].queueFlags;
+            if (flags & VK_QUEUE_COMPUTE_BIT && !(flags & VK_QUEUE_GRAPHICS_BIT) && queueFamilies[j].timestampValidBits > 0)
+            {
+                indices.computeFamily = j;
+                break;
+            }
+        }
+
         return indices;
     }
 
@@ -292,6 +401,17 @@ namespace m1
         return details;
     }
 
+	std::vector<uint32_t> Device::getResourceQueueFamilies(QueueSharing sharing) const
+	{
+		std::vector<uint32_t> families = { _queueFamilies.graphicsFamily.value() };
+		if (sharing != QueueSharing::Exclusive && _queueFamilies.transferFamily.has_value())
+			families.push_back(_queueFamilies.transferFamily.value());
+		if (sharing == QueueSharing::UploadAndCompute && _queueFamilies.computeFamily.has_value())
+			families.push_back(_queueFamilies.computeFamily.value());
+
+		return families;
+	}
+
 	VkDeviceSize Device::getUniformBufferAlignment(VkDeviceSize uboInstanceSize) const
 	{
 		// Vulkan requires each element in a dynamic uniform buffer to be aligned to VkPhysicalDeviceLimits::minUniformBufferOffsetAlignment.
@@ -319,6 +439,10 @@ namespace m1
 
 		//allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
 
+		// actual usage and budget of the heaps (otherwise estimated from the allocations and the heap sizes)
+		if (_deviceFeatures.memoryBudget)
+			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
 		vmaCreateAllocator(&allocatorInfo, &_memAllocator);
 	}
 } // namespace m1
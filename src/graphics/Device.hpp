@@ -2,6 +2,7 @@
 
 #include "Window.hpp"
 #include "Instance.hpp"
+#include "QueueSharing.hpp"
 
 // libs
 #include "vk_mem_alloc.h"
@@ -11,6 +12,7 @@
 #include <optional>
 #include <vector>
 #include <memory>
+#include <string>
 
 namespace m1
 {
@@ -20,8 +22,11 @@ namespace m1
     {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily; // dedicated transfer family (no graphics and compute), if any
+        std::optional<uint32_t> computeFamily; // dedicated compute family (no graphics), if any
 
-        bool isComplete() const { return graphicsFamily.has_value() && presentFamily.has_value(); }
+        // the present family is not needed in headless mode
+        bool isComplete(bool headless = false) const { return graphicsFamily.has_value() && (headless || presentFamily.has_value()); }
     };
 
     struct SwapChainProperties
@@ -36,12 +41,35 @@ namespace m1
 		uint32_t apiVersion;
 		VkSampleCountFlagBits maxMsaaSamples = VK_SAMPLE_COUNT_1_BIT;
 		VkDeviceSize minUniformBufferOffsetAlignment = 0;
+		float timestampPeriod = 0.0f; // nanoseconds per timestamp tick
+		uint32_t timestampValidBits = 0; // of the graphics queue family, 0 => timestamps not supported
+		uint32_t maxComputeWorkGroupCountX = 65535; // minimum guaranteed by the spec
+		std::string deviceName;
+		// identify the device and driver a pipeline cache was created with
+		uint32_t vendorId = 0;
+		uint32_t deviceId = 0;
+		uint32_t driverVersion = 0;
+		std::array<uint8_t, VK_UUID_SIZE> pipelineCacheUuid{};
+	};
+
+	// optional features, enabled when supported
+	struct DeviceFeatures
+	{
+		bool hostQueryReset = false; // reset query pools from the host (Vulkan 1.2)
+		// GPU-driven rendering: draw count read from a buffer (Vulkan 1.2), multiple draws per indirect call
+		// and firstInstance != 0 in the indirect commands (used as object index)
+		bool drawIndirectCount = false;
+		bool multiDrawIndirect = false;
+		bool drawIndirectFirstInstance = false;
+		bool textureCompressionBC = false; // BC1-BC7 sampled images (desktop GPUs)
+		bool memoryBudget = false; // VK_EXT_memory_budget: VMA reports the actual heap usage and budget of the process
 	};
 
     class Device
     {
     public:
-	    explicit Device(const Window& window);
+    	// a null window creates a headless device: no surface, no present queue and no swapchain extension
+	    explicit Device(const Window* window);
         ~Device();
 
         // Non-copyable, non-movable
@@ -56,9 +84,19 @@ namespace m1
         QueueFamilyIndices getQueueFamilyIndices() const { return _queueFamilies; }
         const Queue& getGraphicsQueue() const { return *_graphicsQueue; }
         const Queue& getPresentQueue() const { return *_presentQueue; }
+        bool isHeadless() const { return _headless; }
+        // the dedicated compute queue when the hardware has one, otherwise the graphics queue
         const Queue& getComputeQueue() const { return *_computeQueue; }
+        bool hasDedicatedComputeQueue() const { return _queueFamilies.computeFamily.has_value(); }
+        // the dedicated transfer queue when the hardware has one, otherwise the graphics queue
+        const Queue& getTransferQueue() const { return *_transferQueue; }
+        bool hasDedicatedTransferQueue() const { return _queueFamilies.transferFamily.has_value(); }
+        // queue families sharing a buffer or an image (concurrent sharing mode if more than one)
+        std::vector<uint32_t> getResourceQueueFamilies(QueueSharing sharing) const;
         VkSurfaceKHR getSurface() const { return _surface; }
 		VkSampleCountFlagBits getMaxMsaaSamples() const { return _deviceProperties.maxMsaaSamples; }
+		const DeviceProperties& getProperties() const { return _deviceProperties; }
+		const DeviceFeatures& getFeatures() const { return _deviceFeatures; }
         SwapChainProperties getSwapChainProperties() const { return getSwapChainProperties(_physicalDevice); }
     	VmaAllocator getMemoryAllocator() const { return _memAllocator; }
         VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) const;
@@ -73,9 +111,11 @@ namespace m1
 
         bool isDeviceSuitable(VkPhysicalDevice device);
         bool checkDeviceExtensionSupport(VkPhysicalDevice device) const;
+        static bool isExtensionSupported(VkPhysicalDevice device, const char* extensionName);
         QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) const;
         SwapChainProperties getSwapChainProperties(VkPhysicalDevice device) const;
 
+        const bool _headless;
         Instance _instance;
         VkSurfaceKHR _surface = VK_NULL_HANDLE;
         VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
@@ -83,13 +123,13 @@ namespace m1
         std::unique_ptr<Queue> _graphicsQueue;
         std::unique_ptr<Queue> _presentQueue;
         std::unique_ptr<Queue> _computeQueue;
+        std::unique_ptr<Queue> _transferQueue;
         QueueFamilyIndices _queueFamilies;
     	DeviceProperties _deviceProperties;
+    	DeviceFeatures _deviceFeatures;
 
     	VmaAllocator _memAllocator;
 
-        const std::array<const char*, 1> _requiredExtensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME // Not all graphics cards are capable of presenting images
-        }; 
+        std::vector<const char*> _requiredExtensions;
     };
 }
@@ -0,0 +1,84 @@
+#include "DrawList.hpp"
+#include "Log.hpp"
+
+// libs
+#include "glm_config.hpp"
+
+// std
+#include <array>
+#include <format>
+#include <stdexcept>
+
+namespace m1
+{
+	namespace
+	{
+		// the fields are not masked: two ids sharing their low bits would merge their instancing groups
+		void checkKeyField(uint32_t value, uint32_t bits, const char* field)
+		{
+			if (value < (1u << bits))
+				return;
+
+			std::string message = std::format("Draw key {} {} does not fit in {} bits", field, value, bits);
+			Log::Get().Error(message);
+			throw std::runtime_error(message);
+		}
+	}
+
+	uint64_t DrawList::makeKey(PipelineType pipeline, uint32_t materialId, uint32_t meshId, uint32_t lod, float depth01)
+	{
+		checkKeyField(static_cast<uint32_t>(pipeline), PIPELINE_BITS, "pipeline");
+		checkKeyField(materialId, MATERIAL_BITS, "material id");
+		checkKeyField(meshId, MESH_BITS, "mesh id");
+		checkKeyField(lod, LOD_BITS, "LOD");
+
+		constexpr uint32_t maxDepth = (1u << DEPTH_BITS) - 1;
+		auto depth = static_cast<uint32_t>(glm::clamp(depth01, 0.0f, 1.0f) * static_cast<float>(maxDepth));
+
+		uint64_t key = static_cast<uint64_t>(pipeline);
+		key = (key << MATERIAL_BITS) | materialId;
+		key = (key << MESH_BITS) | meshId;
+		key = (key << LOD_BITS) | lod;
+		key = (key << DEPTH_BITS) | depth;
+		return key;
+	}
+
+	uint64_t DrawList::makeShadowKey(uint32_t geometryBlock, uint32_t meshId, uint32_t lod)
+	{
+		return makeKey(PipelineType::ShadowMapping, geometryBlock, meshId, lod, 0.0f);
+	}
+
+	void DrawList::sort()
+	{
+		if (_items.size() < 2)
+			return;
+
+		_scratch.resize(_items.size());
+
+		// 8 passes of 8 bits, from the least significant byte
+		for (uint32_t shift = 0; shift < 64; shift += 8)
+		{
+			std::array<size_t, 256> offsets{};
+			for (const auto& item : _items)
+				offsets[(item.key >> shift) & 0xFF]++;
+
+			// all the keys have the same byte: nothing to do in this pass
+			if (offsets[(_items[0].key >> shift) & 0xFF] == _items.size())
+				continue;
+
+			// prefix sum
+			size_t sum = 0;
+			for (auto& offset : offsets)
+			{
+				size_t count = offset;
+				offset = sum;
+				sum += count;
+			}
+
+			for (const auto& item : _items)
+				_scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+
+			_items.swap(_scratch);
+		}
+	}
+}
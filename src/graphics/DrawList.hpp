@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Pipeline.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace m1
+{
+	struct DrawItem
+	{
+		uint64_t key;
+		uint32_t objectIndex; // index in the engine scene objects
+	};
+
+	// List of draws sorted by a packed 64-bit key to minimize the state changes while recording:
+	// | pipeline (4 bits) | material id (20 bits) | mesh id (21 bits) | lod (3 bits) | depth bucket (16 bits) |
+	// draws sharing the pipeline are contiguous, then the material, then the mesh and its LOD. Depth sorts front to back.
+	// The shadow draws have no material: their keys hold the geometry pool block in its place (see makeShadowKey).
+	class DrawList
+	{
+	public:
+		static constexpr uint32_t PIPELINE_BITS = 4;
+		static constexpr uint32_t MATERIAL_BITS = 20;
+		static constexpr uint32_t MESH_BITS = 21;
+		static constexpr uint32_t LOD_BITS = 3;
+		static constexpr uint32_t DEPTH_BITS = 16;
+
+		// depth01: normalized view depth in [0, 1]. Throws if an id does not fit in its bits
+		static uint64_t makeKey(PipelineType pipeline, uint32_t materialId, uint32_t meshId, uint32_t lod, float depth01);
+		// shadow mapping pipeline, the casters sharing the geometry pool buffers contiguous (no depth order)
+		static uint64_t makeShadowKey(uint32_t geometryBlock, uint32_t meshId, uint32_t lod);
+		static PipelineType getPipeline(uint64_t key) { return static_cast<PipelineType>(key >> (MATERIAL_BITS + MESH_BITS + LOD_BITS + DEPTH_BITS)); }
+		static uint32_t getMaterialId(uint64_t key) { return static_cast<uint32_t>(key >> (MESH_BITS + LOD_BITS + DEPTH_BITS)) & ((1u << MATERIAL_BITS) - 1); }
+		static uint32_t getMeshId(uint64_t key) { return static_cast<uint32_t>(key >> (LOD_BITS + DEPTH_BITS)) & ((1u << MESH_BITS) - 1); }
+		static uint32_t getLod(uint64_t key) { return static_cast<uint32_t>(key >> DEPTH_BITS) & ((1u << LOD_BITS) - 1); }
+		// draws with the same pipeline, material, mesh and LOD: contiguous once sorted, drawn as the instances of one draw
+		static uint64_t getInstancingGroup(uint64_t key) { return key >> DEPTH_BITS; }
+
+		void clear() { _items.clear(); }
+		void add(uint64_t key, uint32_t objectIndex) { _items.push_back({ key, objectIndex }); }
+		// LSD radix sort on the keys (stable)
+		void sort();
+		[[nodiscard]] const std::vector<DrawItem>& getItems() const { return _items; }
+
+	private:
+		std::vector<DrawItem> _items;
+		std::vector<DrawItem> _scratch; // radix sort ping-pong buffer, kept to avoid allocations at each frame
+	};
+}
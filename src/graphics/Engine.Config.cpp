@@ -31,10 +31,43 @@ namespace m1
 
 	LightingType Engine::getLightingType() const { return _config.lightingType;}
 
+	// falls back to the CPU culling and draw loop if indirect count draws are not supported
+	void Engine::setGpuDrivenEnabled(bool enabled) { _config.gpuDrivenEnabled = enabled && isGpuDrivenSupported(); }
+
+	bool Engine::getGpuDrivenEnabled() const { return _config.gpuDrivenEnabled; }
+
 	void Engine::setSkyboxEnabled(bool enabled) { _config.skyboxEnabled = enabled; }
 
 	bool Engine::getSkyboxEnabled() const { return _config.skyboxEnabled; }
 
+	void Engine::setParallelRecordingEnabled(bool enabled) { _config.parallelRecordingEnabled = enabled; }
+
+	bool Engine::getParallelRecordingEnabled() const { return _config.parallelRecordingEnabled; }
+
+	void Engine::setLodEnabled(bool enabled) { _config.lodEnabled = enabled; }
+
+	bool Engine::getLodEnabled() const { return _config.lodEnabled; }
+
+	void Engine::setMeshletCullingEnabled(bool enabled)
+	{
+		_config.meshletCullingEnabled = enabled;
+		std::ranges::fill(_objectLods, UINT8_MAX); // the meshlet counts of the object data are written with the LODs
+	}
+
+	bool Engine::getMeshletCullingEnabled() const { return _config.meshletCullingEnabled; }
+
+	void Engine::setShadowCascadeCount(uint32_t count) { _config.shadowCascadeCount = count; }
+
+	uint32_t Engine::getShadowCascadeCount() const { return std::clamp(_config.shadowCascadeCount, 1u, static_cast<uint32_t>(MAX_SHADOW_CASCADES)); }
+
+	void Engine::setShadowCascadeSplitLambda(float lambda) { _config.shadowCascadeSplitLambda = lambda; }
+
+	float Engine::getShadowCascadeSplitLambda() const { return _config.shadowCascadeSplitLambda; }
+
+	void Engine::setShadowCascadeCachingEnabled(bool enabled) { _config.shadowCascadeCachingEnabled = enabled; }
+
+	bool Engine::getShadowCascadeCachingEnabled() const { return _config.shadowCascadeCachingEnabled; }
+
 	void Engine::setSkyBoxMap(SkyBoxMap map)
 	{
 		if (_config.skyBoxMap == map) return;
@@ -117,7 +150,8 @@ namespace m1
 		return std::clamp(_lightsUbo.numLights, 0, MAX_LIGHTS);
 	}
 
-	void Engine::setUiEnabled(bool enabled) { _config.uiEnabled = enabled; }
+	// the ui module doesn't exist in headless mode
+	void Engine::setUiEnabled(bool enabled) { _config.uiEnabled = enabled && _gui != nullptr; }
 
 	bool Engine::getUiEnabled() const { return _config.uiEnabled; }
 }
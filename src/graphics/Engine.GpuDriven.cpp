@@ -0,0 +1,363 @@
+#include "Engine.hpp"
+#include "SceneObject.hpp"
+#include "Mesh.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+
+// libs
+#include "glm_config.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+namespace m1
+{
+	/*
+		GPU-driven rendering:
+		- the per object data (transform, world bounds, batch) is written into the objects SSBO once per frame (the
+		  SSBO is also read by the vertex shaders of the CPU path)
+		- a compute shader culls the objects against the camera frustum and the light frustums of the shadow cascades
+		  rendered this frame, and appends one indirect command for each visible object to its batch (objects sharing
+		  pipeline, material and geometry pool block) of the pass, and the object index to the instances (firstInstance
+		  of the command)
+		- the visible objects drawn at full detail with meshlets append tasks (groups of meshlets) instead: a second
+		  compute pass, dispatched indirectly, culls each meshlet against the camera frustum and its normal cone and
+		  appends one command for each visible meshlet to the batch of the object
+		- the main pass and each shadow cascade issue one vkCmdDrawIndexedIndirectCount for each batch.
+		  The vertex shaders read the model matrix from the objects SSBO (object index = instances[gl_InstanceIndex])
+	*/
+
+	static constexpr uint32_t CULLING_GROUP_SIZE = 64; // local_size_x of the culling shader
+	static constexpr uint32_t MESHLET_CULLING_GROUP_SIZE = 64; // local_size_x of the meshlet culling shader, meshlets of a task
+
+	namespace
+	{
+		// meshlet dispatch buffer, written by the culling shader. The work groups are clamped to the device limit and
+		// loop over the tasks
+		struct MeshletDispatch
+		{
+			VkDispatchIndirectCommand command; // x = min(taskCount, maxComputeWorkGroupCount[0])
+			uint32_t taskCount;
+		};
+	}
+
+	bool Engine::isGpuDrivenSupported() const
+	{
+		const auto& features = _device.getFeatures();
+		return features.drawIndirectCount && features.multiDrawIndirect && features.drawIndirectFirstInstance;
+	}
+
+	void Engine::createGpuDrivenResources()
+	{
+		// the objects SSBO is read by the vertex shaders of both paths, so it's created even if GPU-driven rendering is disabled
+		auto objectsCount = static_cast<VkDeviceSize>(std::max<size_t>(_sceneObjects.size(), 1));
+		_objectsData.assign(_sceneObjects.size(), {});
+		_objectsDataVersions.assign(_sceneObjects.size(), UINT64_MAX);
+		_objectLods.assign(_sceneObjects.size(), UINT8_MAX);
+		_drawBatches.clear();
+		_drawBatchesLightingType.reset();
+
+		// meshlets of the meshes of the scene, stored once for each mesh. The bounding spheres are moved into the space of
+		// the geometry pool positions, transformed by the model matrix of the object data
+		std::vector<MeshletData> meshlets;
+		std::unordered_map<const Mesh*, uint32_t> firstMeshlets;
+		_drawCommandsPerPass = 0;
+		_maxMeshletTasks = 0;
+		for (size_t i = 0; i < _sceneObjects.size(); i++)
+		{
+			const Mesh& mesh = *_sceneObjects[i]->Mesh;
+			const auto& meshMeshlets = mesh.getMeshlets();
+			auto [it, inserted] = firstMeshlets.try_emplace(&mesh, static_cast<uint32_t>(meshlets.size()));
+			if (inserted)
+			{
+				const GeometryAllocation& geometry = mesh.getGeometry();
+				glm::mat4 toPoolPositions = glm::inverse(geometry.positionTransform);
+				for (const auto& meshlet : meshMeshlets)
+				{
+					meshlets.push_back({
+						.boundingSphere = glm::vec4(glm::vec3(toPoolPositions * glm::vec4(meshlet.center, 1.0f)), meshlet.radius),
+						.cone = glm::vec4(meshlet.coneAxis, meshlet.coneCutoff),
+						.firstIndex = geometry.firstIndex + meshlet.firstIndex,
+						.indexCount = meshlet.triangleCount * 3,
+					});
+				}
+			}
+
+			auto meshletCount = static_cast<uint32_t>(meshMeshlets.size());
+			_objectsData[i].firstMeshlet = it->second;
+			_drawCommandsPerPass += std::max(meshletCount, 1u);
+			_maxMeshletTasks += (meshletCount + MESHLET_CULLING_GROUP_SIZE - 1) / MESHLET_CULLING_GROUP_SIZE;
+		}
+		auto commandsCount = static_cast<VkDeviceSize>(std::max(_drawCommandsPerPass, 1u));
+		constexpr VkDeviceSize passCount = 1 + MAX_SHADOW_CASCADES; // main pass, then the shadow cascades
+
+		_meshletsBuffer = std::make_unique<Buffer>(_device, std::max<size_t>(meshlets.size(), 1) * sizeof(MeshletData),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 0, QueueSharing::Upload);
+		if (!meshlets.empty())
+			_uploadBatcher->uploadBuffer(*_meshletsBuffer, meshlets.data(), meshlets.size() * sizeof(MeshletData));
+
+		for (size_t i = 0; i < _framesInFlight; i++)
+		{
+			auto& frameData = *_framesData[i];
+
+			frameData.objectsSsboBuffer = std::make_unique<Buffer>(_device, objectsCount * sizeof(ObjectData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT); // persistent mapping
+
+			// main pass and shadow cascades, written by the draw lists of the CPU path or by the culling
+			frameData.instancesBuffer = std::make_unique<Buffer>(_device, passCount * commandsCount * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+			// each object (or meshlet) can be drawn in all the passes. There can't be more batches than objects
+			frameData.drawCommandsBuffer = std::make_unique<Buffer>(_device, passCount * commandsCount * sizeof(VkDrawIndexedIndirectCommand),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+			frameData.drawCountsBuffer = std::make_unique<Buffer>(_device, passCount * objectsCount * sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+			// (object index, first meshlet) of each task
+			frameData.meshletTasksBuffer = std::make_unique<Buffer>(_device, std::max(_maxMeshletTasks, 1u) * 2 * sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+			frameData.meshletDispatchBuffer = std::make_unique<Buffer>(_device, sizeof(MeshletDispatch),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+			// frame descriptor set
+			auto objectsSsboInfo = frameData.objectsSsboBuffer->getVkDescriptorBufferInfo();
+			auto objectsSsboWrite = initVkWriteDescriptorSet(frameData.frameDescriptorSet, 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &objectsSsboInfo);
+			auto instancesInfo = frameData.instancesBuffer->getVkDescriptorBufferInfo();
+			auto instancesWrite = initVkWriteDescriptorSet(frameData.frameDescriptorSet, 8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &instancesInfo);
+
+			// culling descriptor set
+			auto frameUboInfo = frameData.frameUboBuffer->getVkDescriptorBufferInfo();
+			auto drawCommandsInfo = frameData.drawCommandsBuffer->getVkDescriptorBufferInfo();
+			auto drawCountsInfo = frameData.drawCountsBuffer->getVkDescriptorBufferInfo();
+			auto meshletsInfo = _meshletsBuffer->getVkDescriptorBufferInfo();
+			auto meshletTasksInfo = frameData.meshletTasksBuffer->getVkDescriptorBufferInfo();
+			auto meshletDispatchInfo = frameData.meshletDispatchBuffer->getVkDescriptorBufferInfo();
+			auto cullingSet = frameData.cullingDescriptorSet;
+
+			std::array descriptorWrites =
+			{
+				objectsSsboWrite,
+				instancesWrite,
+				initVkWriteDescriptorSet(cullingSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &frameUboInfo),
+				initVkWriteDescriptorSet(cullingSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &objectsSsboInfo),
+				initVkWriteDescriptorSet(cullingSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &drawCommandsInfo),
+				initVkWriteDescriptorSet(cullingSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &drawCountsInfo),
+				initVkWriteDescriptorSet(cullingSet, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &instancesInfo),
+				initVkWriteDescriptorSet(cullingSet, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &meshletsInfo),
+				initVkWriteDescriptorSet(cullingSet, 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &meshletTasksInfo),
+				initVkWriteDescriptorSet(cullingSet, 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &meshletDispatchInfo),
+			};
+
+			vkUpdateDescriptorSets(_device.getVkDevice(), descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+		}
+	}
+
+	void Engine::buildDrawBatches()
+	{
+		/*
+			Objects are sorted by pipeline, material and geometry block (the block takes the place of the mesh in the DrawList key),
+			then each run of equal keys becomes a batch with a contiguous range of indirect commands (one for each object,
+			or for each meshlet of the objects with meshlets).
+			The meshes of a batch share the buffers: each command selects its mesh with firstIndex and vertexOffset
+		*/
+		auto defaultPipeline = _config.lightingType == LightingType::BlinnPhong ? PipelineType::PhongLighting : PipelineType::PbrLighting;
+
+		DrawList drawList;
+		for (uint32_t i = 0; i < _sceneObjects.size(); i++)
+		{
+			const auto& obj = _sceneObjects[i];
+			auto pipelineType = obj->PipelineKey.value_or(defaultPipeline);
+
+			// objects without lighting don't use materials
+			uint32_t materialId = pipelineType != PipelineType::NoLight ? obj->Mesh->getMaterialId() : 0;
+
+			drawList.add(DrawList::makeKey(pipelineType, materialId, obj->Mesh->getGeometry().block, 0, 0.0f), i);
+		}
+		drawList.sort();
+
+		_drawBatches.clear();
+		const auto& items = drawList.getItems();
+		uint32_t commandCount = 0;
+		for (uint32_t i = 0; i < items.size(); i++)
+		{
+			const auto& item = items[i];
+			const Mesh& mesh = *_sceneObjects[item.objectIndex]->Mesh;
+			const GeometryAllocation& geometry = mesh.getGeometry();
+
+			if (i == 0 || item.key != items[i - 1].key)
+				_drawBatches.push_back({
+					.pipelineType = DrawList::getPipeline(item.key),
+					.materialId = DrawList::getMaterialId(item.key),
+					.geometryBlock = geometry.block,
+					.firstCommand = commandCount,
+					.maxDrawCount = 0,
+				});
+
+			auto& batch = _drawBatches.back();
+			uint32_t objectCommands = std::max(static_cast<uint32_t>(mesh.getMeshlets().size()), 1u);
+			batch.maxDrawCount += objectCommands;
+			commandCount += objectCommands;
+
+			auto& objectData = _objectsData[item.objectIndex];
+			objectData.batchIndex = static_cast<uint32_t>(_drawBatches.size() - 1);
+			objectData.firstCommand = batch.firstCommand;
+			objectData.vertexOffset = geometry.vertexOffset; // the index ranges are the LODs, written by selectLods
+		}
+
+		_drawBatchesLightingType = _config.lightingType;
+	}
+
+	void Engine::updateObjectsSsbo()
+	{
+		// the matrices and the world bounds are computed again only when the world transform changed, the whole array is
+		// still copied: each frame in flight has its own SSBO
+		for (size_t i = 0; i < _sceneObjects.size(); i++)
+		{
+			auto& obj = _sceneObjects[i];
+			uint64_t worldVersion = _sceneGraph.getWorldVersion(obj->getNode());
+			if (_objectsDataVersions[i] == worldVersion)
+				continue;
+			_objectsDataVersions[i] = worldVersion;
+
+			auto& objectData = _objectsData[i];
+
+			objectData.model = obj->getTransform() * obj->Mesh->getGeometry().positionTransform;
+			objectData.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(obj->getTransform()))));
+
+			const BBox& bbox = obj->getWorldBBox();
+			if (bbox.isValid())
+			{
+				objectData.boundsCenter = glm::vec4(bbox.getCenter(), 1.0f);
+				objectData.boundsExtent = glm::vec4(bbox.getExtent() * 0.5f, 0.0f);
+			}
+			else
+			{
+				// negative extent: always outside the frustums
+				objectData.boundsCenter = glm::vec4(0.0f);
+				objectData.boundsExtent = glm::vec4(-1e30f);
+			}
+		}
+
+		if (!_objectsData.empty())
+			_framesData[_currentFrame]->objectsSsboBuffer->copyDataToBuffer(_objectsData.data());
+	}
+
+	void Engine::recordCullingPass(VkCommandBuffer commandBuffer) const
+	{
+		const FrameData& frameData = *_framesData[_currentFrame];
+
+		// reset the draw counts and the meshlet tasks
+		vkCmdFillBuffer(commandBuffer, frameData.drawCountsBuffer->getVkBuffer(), 0, VK_WHOLE_SIZE, 0);
+		bool meshletCulling = _config.meshletCullingEnabled && _maxMeshletTasks > 0;
+		if (meshletCulling)
+		{
+			MeshletDispatch dispatch{ .command = { .x = 0, .y = 1, .z = 1 }, .taskCount = 0 };
+			vkCmdUpdateBuffer(commandBuffer, frameData.meshletDispatchBuffer->getVkBuffer(), 0, sizeof(dispatch), &dispatch);
+		}
+		memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+		if (!_objectsData.empty())
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullingPipeline->getVkPipeline());
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullingPipeline->getLayout(), 0, 1,
+				&frameData.cullingDescriptorSet, 0, nullptr);
+
+			bool perspective = _camera.getProjectionMatrix()[3][3] == 0.0f;
+			CullingPushConstantData push
+			{
+				.objectCount = static_cast<uint32_t>(_objectsData.size()),
+				.batchCount = static_cast<uint32_t>(_drawBatches.size()),
+				.cascadeMask = _shadowCascadeMask,
+				.commandsPerPass = _drawCommandsPerPass,
+				.cameraPosition = glm::vec4(_camera.getPosition(), perspective ? 1.0f : 0.0f),
+				.maxMeshletGroups = _device.getProperties().maxComputeWorkGroupCountX,
+			};
+			vkCmdPushConstants(commandBuffer, _cullingPipeline->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullingPushConstantData), &push);
+
+			vkCmdDispatch(commandBuffer, (push.objectCount + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE, 1, 1);
+
+			// meshlets of the visible objects, one work group for each task appended by the object culling
+			if (meshletCulling)
+			{
+				memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+					VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _meshletCullingPipeline->getVkPipeline());
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _meshletCullingPipeline->getLayout(), 0, 1,
+					&frameData.cullingDescriptorSet, 0, nullptr);
+				vkCmdPushConstants(commandBuffer, _meshletCullingPipeline->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+					sizeof(CullingPushConstantData), &push);
+
+				vkCmdDispatchIndirect(commandBuffer, frameData.meshletDispatchBuffer->getVkBuffer(), 0);
+			}
+		}
+
+		// the barrier to the indirect draws is recorded by the render graph
+	}
+
+	void Engine::drawObjectsIndirect(VkCommandBuffer commandBuffer, uint32_t pass) const
+	{
+		const FrameData& frameData = *_framesData[_currentFrame];
+		VkBuffer drawCommandsBuffer = frameData.drawCommandsBuffer->getVkBuffer();
+		VkBuffer drawCountsBuffer = frameData.drawCountsBuffer->getVkBuffer();
+
+		// the commands and counts of the shadow cascades are stored after the ones of the main pass
+		bool shadowPass = pass > 0;
+		constexpr VkDeviceSize commandStride = sizeof(VkDrawIndexedIndirectCommand);
+		VkDeviceSize commandsOffset = static_cast<VkDeviceSize>(pass) * _drawCommandsPerPass * commandStride;
+		VkDeviceSize countsOffset = pass * _drawBatches.size() * sizeof(uint32_t);
+
+		const Pipeline* currentPipeline = nullptr;
+		std::optional<PipelineType> currentPipelineType;
+		std::optional<uint32_t> currentMaterialId;
+		std::optional<uint32_t> currentGeometryBlock;
+
+		for (uint32_t i = 0; i < _drawBatches.size(); i++)
+		{
+			const auto& batch = _drawBatches[i];
+			auto pipelineType = shadowPass ? PipelineType::ShadowMapping : batch.pipelineType;
+
+			// bind pipeline and frame descriptor set
+			if (pipelineType != currentPipelineType)
+			{
+				currentPipelineType = pipelineType;
+				currentMaterialId.reset();
+
+				currentPipeline = _graphicsPipelines.at(pipelineType).get();
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getVkPipeline());
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getLayout(),
+				                        0, 1, &frameData.frameDescriptorSet, 0, nullptr);
+
+				// layer of the shadow map
+				if (shadowPass)
+				{
+					ShadowPushConstantData push{ .cascadeIndex = pass - 1 };
+					vkCmdPushConstants(commandBuffer, currentPipeline->getLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0,
+						sizeof(ShadowPushConstantData), &push);
+				}
+			}
+
+			// bind the material descriptor set
+			if (!shadowPass && pipelineType != PipelineType::NoLight && batch.materialId != currentMaterialId)
+			{
+				currentMaterialId = batch.materialId;
+				bindMaterialDescriptorSet(commandBuffer, *currentPipeline, pipelineType, batch.materialId);
+			}
+
+			if (batch.geometryBlock != currentGeometryBlock)
+			{
+				currentGeometryBlock = batch.geometryBlock;
+				_geometryPool->bind(commandBuffer, batch.geometryBlock);
+			}
+
+			vkCmdDrawIndexedIndirectCount(commandBuffer,
+				drawCommandsBuffer, commandsOffset + batch.firstCommand * commandStride,
+				drawCountsBuffer, countsOffset + i * sizeof(uint32_t),
+				batch.maxDrawCount, commandStride);
+		}
+	}
+}
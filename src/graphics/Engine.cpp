@@ -8,6 +8,8 @@
 #include "Sampler.hpp"
 #include "UiModule.hpp"
 #include "Renderer.hpp"
+#include "IblCache.hpp"
+#include "Ktx2.hpp"
 
 //libs
 #include "glm_config.hpp"
@@ -15,6 +17,9 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
 // std
 #include <array>
 #include <stdexcept>
@@ -22,15 +27,42 @@
 #include <chrono>
 #include <random>
 #include <ranges>
+#include <span>
+#include <optional>
 #include <limits>
+#include <format>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 
 namespace m1
 {
-	Engine::Engine(const EngineConfig& config) : _config(config)
+	Engine::Engine(const EngineConfig& config) : _config(config),
+		_framesInFlight(std::clamp(config.framesInFlight, MIN_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT)),
+		_window(config.headless ? nullptr : std::make_unique<Window>(WINDOW_WIDTH, WINDOW_HEIGHT, "Vulkan App")),
+		_device(_window.get())
 	{
 		Log::Get().Info("Engine constructor");
 
+		// without a window there is nothing to draw the ui on
+		if (_config.headless)
+			_config.uiEnabled = false;
+
+		if (_config.gpuDrivenEnabled && !isGpuDrivenSupported())
+		{
+			Log::Get().Warning("Indirect count draws not supported, GPU-driven rendering disabled");
+			_config.gpuDrivenEnabled = false;
+		}
+
+		_pipelineCache = std::make_unique<PipelineCache>(_device, _config.pipelineCachePath);
+		_renderGraph = std::make_unique<RenderGraph>(_device);
 		recreateSwapChain();
+		_uploadBatcher = std::make_unique<UploadBatcher>(_device);
+		if (_config.textureStreamingEnabled && _device.getFeatures().textureCompressionBC)
+			_textureStreamer = std::make_unique<TextureStreamer>(_device, *_uploadBatcher, _framesInFlight,
+				VkDeviceSize{_config.textureStreamingBudgetMb} << 20);
+		_commandRecorder = std::make_unique<ParallelCommandRecorder>(_device, _framesInFlight, _config.recordingThreadCount);
+		_geometryPool = std::make_unique<GeometryPool>(_device, *_uploadBatcher, _config.vertexFormat);
 		_descriptorSetManager = std::make_unique<DescriptorSetManager>(_device);
 		createShadowMapTexture();
 		createEnvironmentTextures();
@@ -40,6 +72,7 @@ namespace m1
 		_materialPhongUboAlignment = _device.getUniformBufferAlignment(sizeof(MaterialPhongUbo));
 		_materialPbrUboAlignment = _device.getUniformBufferAlignment(sizeof(MaterialPbrUbo));
 		createFramesResources();
+		_gpuProfiler = std::make_unique<GpuProfiler>(_device, _framesInFlight);
 		createDefaultTextures();
 		initLights();
 		initParticles();
@@ -47,14 +80,18 @@ namespace m1
 
 		createSyncObjects();
 
-		_gui = std::make_unique<UiModule>(*this, _window, *_swapChain);
+		if (!_config.headless)
+			_gui = std::make_unique<UiModule>(*this, *_window, *_swapChain);
 
 		loadIblTextures();
 	}
 
 	Engine::~Engine()
 	{
+		stopUpdateThread();
+
 		// wait for the GPU to finish all operations before destroying the resources
+		_uploadBatcher->waitIdle();
 		vkDeviceWaitIdle(_device.getVkDevice());
 
 		_gui.reset(); // destroy first
@@ -71,19 +108,103 @@ namespace m1
 		}
 		vkDestroySemaphore(_device.getVkDevice(), _acquireSemaphore, nullptr);
 
-		for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++)
-		{
-			vkDestroyFence(_device.getVkDevice(), _framesData[i]->drawCmdExecutedFence, nullptr);
-			vkDestroyFence(_device.getVkDevice(), _framesData[i]->computeCmdExecutedFence, nullptr);
-			vkDestroySemaphore(_device.getVkDevice(), _framesData[i]->computeCmdExecutedSem, nullptr);
-		}
+		vkDestroySemaphore(_device.getVkDevice(), _graphicsTimeline, nullptr);
+		vkDestroySemaphore(_device.getVkDevice(), _computeTimeline, nullptr);
 
 		Log::Get().Info("Engine destroyed");
 	}
 
 	void Engine::run()
 	{
-		mainLoop();
+		if (_config.headless)
+			headlessLoop();
+		else
+			mainLoop();
+	}
+
+	void Engine::renderFrame()
+	{
+		drawFrame();
+		_totalFrames++;
+	}
+
+	std::vector<uint8_t> Engine::readbackFrame()
+	{
+		// make sure there is something to read
+		if (_totalFrames == 0)
+			renderFrame();
+
+		// wait for the last frame to be written into the color image
+		vkDeviceWaitIdle(_device.getVkDevice());
+
+		Image& colorImage = _swapChain->getColorImage();
+		auto extent = colorImage.getExtent();
+		VkDeviceSize imageSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+		// host visible buffer the image is copied into
+		Buffer readbackBuffer{ _device, imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT };
+
+		VkCommandBuffer commandBuffer = _device.getGraphicsQueue().beginOneTimeCommand();
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = 0;
+		region.bufferRowLength = 0; // tightly packed
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = {0, 0, 0};
+		region.imageExtent = {extent.width, extent.height, 1};
+
+		// the color image is left in TRANSFER_SRC_OPTIMAL layout at the end of each frame
+		vkCmdCopyImageToBuffer(commandBuffer, colorImage.getVkImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			readbackBuffer.getVkBuffer(), 1, &region);
+
+		// make the transfer write visible to the host
+		VkMemoryBarrier2 hostBarrier
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+			.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+		};
+		VkDependencyInfo dependencyInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &hostBarrier,
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+		_device.getGraphicsQueue().endOneTimeCommand(commandBuffer);
+
+		std::vector<uint8_t> pixels(imageSize);
+		readbackBuffer.copyDataFromBuffer(pixels.data());
+
+		// swap channels if the image is BGRA (windowed mode, swap chain format)
+		auto format = colorImage.getFormat();
+		if (format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_B8G8R8A8_UNORM)
+		{
+			for (size_t i = 0; i < pixels.size(); i += 4)
+				std::swap(pixels[i], pixels[i + 2]);
+		}
+
+		return pixels;
+	}
+
+	void Engine::saveFrameToPng(const std::string& filePath)
+	{
+		auto pixels = readbackFrame();
+		auto extent = _swapChain->getColorImage().getExtent();
+
+		int stride = static_cast<int>(extent.width) * 4;
+		if (!stbi_write_png(filePath.c_str(), static_cast<int>(extent.width), static_cast<int>(extent.height), 4, pixels.data(), stride))
+		{
+			Log::Get().Error("Failed to write frame to " + filePath);
+			throw std::runtime_error("Failed to write frame to " + filePath);
+		}
 	}
 
 	void Engine::addSceneObject(std::unique_ptr<SceneObject> obj)
@@ -93,20 +214,64 @@ namespace m1
 
 	void Engine::addMaterial(std::unique_ptr<Material> material)
 	{
-		_materials.try_emplace(material->name, std::move(material));
+		// materials with the same name are added only once
+		auto materialId = static_cast<uint32_t>(_materials.size()) + 1; // 0 is the default material
+		if (_materialIds.try_emplace(material->name, materialId).second)
+			_materials.push_back(std::move(material));
 	}
 
 	void Engine::compile()
 	{
 		compileMaterials();
+		deduplicateMeshes();
 		compileSceneObjects();
+		_sceneGraph.update(&_commandRecorder->getThreadPool()); // world transforms of the loaded scene
+		createGpuDrivenResources();
 		_bbox = computeSceneBBox();
+
+		// textures and meshes data are uploaded all together
+		_uploadBatcher->waitIdle();
 	}
 
 	void Engine::loadIblTextures() const
 	{
-		//auto equirectTexture = loadEquirectangularHDRMap(*this, std::string(PROJECT_SOURCE_DIR) + "/resources/newport_loft.hdr");
-		auto equirectTexture = loadEquirectangularHDRMap(*this, std::string(PROJECT_SOURCE_DIR) + "/resources/HDR_111_Parking_Lot_2_Ref.hdr");
+		//auto hdrPath = std::string(PROJECT_SOURCE_DIR) + "/resources/newport_loft.hdr";
+		auto hdrPath = std::string(PROJECT_SOURCE_DIR) + "/resources/HDR_111_Parking_Lot_2_Ref.hdr";
+
+		// the baked textures are reloaded while the HDR file, the resolutions and the formats don't change.
+		// The BRDF LUT doesn't depend on the environment
+		IblCache iblCache(_device, *_uploadBatcher, _config.iblCacheDirectory);
+		uint64_t environmentKey = IblCache::hashFile(hdrPath);
+
+		bool environmentCached = iblCache.load("environment", environmentKey, _environmentCubemap->getImage()) &&
+			iblCache.load("irradiance", environmentKey, _irradianceCubemap->getImage()) &&
+			iblCache.load("prefiltered_env", environmentKey, _prefilteredEnvCubemap->getImage());
+		bool brdfLutCached = iblCache.load("brdf_lut", 0, _brdfLUT->getImage());
+
+		// the cached textures (and the resources created by the constructor) must be resident before rendering
+		_uploadBatcher->waitIdle();
+
+		if (!environmentCached)
+		{
+			bakeEnvironmentMaps(hdrPath);
+			iblCache.store("environment", environmentKey, _environmentCubemap->getImage());
+			iblCache.store("irradiance", environmentKey, _irradianceCubemap->getImage());
+			iblCache.store("prefiltered_env", environmentKey, _prefilteredEnvCubemap->getImage());
+		}
+
+		if (!brdfLutCached)
+		{
+			bakeBrdfLut();
+			iblCache.store("brdf_lut", 0, _brdfLUT->getImage());
+		}
+	}
+
+	void Engine::bakeEnvironmentMaps(const std::string& hdrPath) const
+	{
+		auto equirectTexture = loadEquirectangularHDRMap(*this, hdrPath);
+
+		// the equirectangular map must be resident before rendering
+		_uploadBatcher->waitIdle();
 
 		auto equirectToCubemapDescriptorSet = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::OneSampler, 1)[0];
 
@@ -368,13 +533,15 @@ namespace m1
 		VK_CHECK(vkQueueSubmit(_device.getGraphicsQueue().getVkQueue(), 1, &submitInfo, nullptr));
 
 		vkDeviceWaitIdle(_device.getVkDevice()); // TODO use fence and semaphores
+	}
 
-
-		// -------------- BRDF LUT ----------------------
+	void Engine::bakeBrdfLut() const
+	{
+		auto commandBuffer = _device.getGraphicsQueue().getPersistentCommandPool().allocateCommandBuffers(1)[0];
 
 		// reset the command buffer and begin a new recording
 		vkResetCommandBuffer(commandBuffer, 0);
-		beginInfo = {};
+		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		beginInfo.flags = 0;                  // Optional
 		beginInfo.pInheritanceInfo = nullptr; // Optional
@@ -424,7 +591,7 @@ namespace m1
 		// VK_CHECK(vkCreateSemaphore(_device.getVkDevice(), &semaphoreInfo, nullptr, &semaphore));
 
 		// submit info
-		submitInfo =
+		VkSubmitInfo submitInfo
 		{
 			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 			//wait semaphores
@@ -447,18 +614,47 @@ namespace m1
 	int _frameCount = 0;
 	float _framesTime = 0.0f;
 
+	// milliseconds elapsed since start
+	static float elapsedMs(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
 	void Engine::mainLoop()
 	{
 		auto prevTime = std::chrono::high_resolution_clock::now();
 
-		while (!_window.shouldClose())
+		// camera recording
+		CameraPath recordedPath;
+		float recordTime = 0.0f;
+		float lastRecordTime = -1.0f;
+		constexpr float recordInterval = 1.0f / 30.0f;
+
+		if (_config.pipelinedUpdateEnabled)
+			startUpdateThread();
+
+		while (!_window->shouldClose())
 		{
 			glfwPollEvents();
 
+			if (_config.pipelinedUpdateEnabled)
+			{
+				// the scene simulated while the previous frame was recorded, then the next one is requested right away
+				if (const SceneSnapshot* snapshot = _snapshots.read())
+				{
+					_camera = snapshot->camera;
+					_camera.setAspectRatio(_swapChain->getAspectRatio()); // the swap chain can be recreated by the render thread
+				}
+				bool keyboardCaptured = _config.uiEnabled && UiModule::wantCaptureKeyboard();
+				_updateInputKey.store(keyboardCaptured ? GLFW_KEY_UNKNOWN : _window->getPressedKey(), std::memory_order_relaxed);
+				_snapshotRequests.fetch_add(1, std::memory_order_release);
+				_snapshotRequests.notify_one();
+			}
+
 			if (_config.uiEnabled)
 				_gui->build(); // must be called at each frame
 
-			drawFrame();
+			renderFrame();
 
 			// update frame time
 			_frameCount++;
@@ -469,6 +665,16 @@ namespace m1
 			// process input
 			processInput(frameTime);
 
+			if (!_config.cameraRecordPath.empty())
+			{
+				recordTime += frameTime;
+				if (lastRecordTime < 0.0f || recordTime - lastRecordTime >= recordInterval)
+				{
+					recordedPath.addKeyframe({ .time = recordTime, .position = _camera.getPosition(), .target = _camera.getTarget() });
+					lastRecordTime = recordTime;
+				}
+			}
+
 			// update fps
 			// NOTE: VK_PRESENT_MODE_FIFO_KHR enables vertical sync and caps FPS to the monitor refresh rate.
 			_framesTime += frameTime;
@@ -476,12 +682,39 @@ namespace m1
 			{
 				double fps = 1.0f / (_framesTime / _frameCount);
 				double avgFrameMs = (_framesTime / _frameCount) * 1000.0;
-				_window.setTitle(std::format("Vulkan App | FPS: {:.1f} | Frame: {:.2f} ms", fps, avgFrameMs).c_str());
+				_window->setTitle(std::format("Vulkan App | FPS: {:.1f} | Frame: {:.2f} ms", fps, avgFrameMs).c_str());
 
 				_framesTime = 0.0f;
 				_frameCount = 0;
 			}
 		}
+
+		stopUpdateThread();
+
+		if (!_config.cameraRecordPath.empty() && !recordedPath.empty())
+		{
+			recordedPath.save(_config.cameraRecordPath);
+			std::cout << std::format("Camera path saved to {} ({} keyframes)", _config.cameraRecordPath, recordedPath.size()) << std::endl;
+		}
+	}
+
+	void Engine::headlessLoop()
+	{
+		// render a fixed number of frames as fast as possible (no presentation, no input)
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < _config.headlessFrameCount; i++)
+			renderFrame();
+
+		vkDeviceWaitIdle(_device.getVkDevice());
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		double totalTime = std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
+		double avgFrameMs = totalTime * 1000.0 / std::max(1u, _config.headlessFrameCount);
+
+		// the result of the run, printed whatever the log level
+		std::cout << std::format("Headless: {} frames in {:.3f} s | FPS: {:.1f} | Frame: {:.2f} ms",
+			_config.headlessFrameCount, totalTime, 1000.0 / avgFrameMs, avgFrameMs) << std::endl;
 	}
 
 	void Engine::drawFrame()
@@ -489,47 +722,43 @@ namespace m1
 		/*
 		    At a high level, rendering a frame in Vulkan consists of a common set of steps:
 
-		    - Wait for the previous frame to finish
+		    - Wait for the previous use of the frame slot to finish
 		    - Acquire an image from the swap chain
 		    - Record a command buffer which draws the scene onto a color image and copy it to the swap chain image
 			- Submit the recorded command buffer (waiting on the image to be available - signal when the command buffer finishes)
 			- Present the swap chain image (waiting on the command buffer to finish)
+
+			The particles of the next frame are computed on the compute queue while the current frame is drawn.
 		*/
 
 		FrameData& frameData = *_framesData[_currentFrame];
 
-		// record and submit compute commands
-		if (_config.particlesEnabled)
-		{
-			// wait for the previous computation to finish
-			vkWaitForFences(_device.getVkDevice(), 1, &frameData.computeCmdExecutedFence, VK_TRUE, UINT64_MAX);
-			vkResetFences(_device.getVkDevice(), 1, &frameData.computeCmdExecutedFence);
+		// propagate the transforms changed since the last frame (doesn't depend on the GPU)
+		bool sceneChanged = _sceneGraph.update(&_commandRecorder->getThreadPool());
 
-			// record compute commands
-			vkResetCommandBuffer(frameData.computeCmdBuffer, 0);
-			recordComputeCommands(frameData.computeCmdBuffer);
+		// wait for the previous use of the frame slot to finish (the only CPU wait of the frame)
+		waitForFrameSlot(_currentFrame);
 
-			VkSubmitInfo computeSubmitInfo
-			{
-				.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-				// command buffers
-				.commandBufferCount = 1,
-				.pCommandBuffers = &frameData.computeCmdBuffer,
-				// signal semaphore
-				.signalSemaphoreCount = 1,
-				.pSignalSemaphores = &frameData.computeCmdExecutedSem,
-			};
+		// the previous use of this frame slot is completed, its GPU timings can be collected
+		_gpuProfiler->beginFrame(_currentFrame, _totalFrames);
+		_frameTimings.frameIndex = _totalFrames;
+		_frameTimings.gpuFrameIndex = _gpuProfiler->getLastFrameNumber();
+		_frameTimings.gpuMs = _gpuProfiler->getLastMs(GpuScope::Frame);
 
-	    	VK_CHECK(vkQueueSubmit(_device.getComputeQueue().getVkQueue(), 1, &computeSubmitInfo, frameData.computeCmdExecutedFence));
-		}
+		if (_textureStreamer)
+			updateTextureStreaming();
 
-		// Update the frame uniform buffer
+		// Update the frame uniform buffer (with the shadow cascades)
+		updateShadowCascades(sceneChanged);
 		updateFrameUbo();
 
-		// wait for the previous frame to finish (with Fence wait on the CPU)
-		vkWaitForFences(_device.getVkDevice(), 1, &frameData.drawCmdExecutedFence, VK_TRUE, UINT64_MAX);
-		// reset the fence to unsignaled state
-		vkResetFences(_device.getVkDevice(), 1, &frameData.drawCmdExecutedFence);
+		// headless: no swap chain image to acquire nor present
+		if (_swapChain->isHeadless())
+		{
+			drawOffscreenFrame(frameData);
+			_currentFrame = (_currentFrame + 1) % _framesInFlight;
+			return;
+		}
 
 		// acquire an image from the swap chain (signal the semaphore when the image is ready)
 		uint32_t swapChainImageIndex;
@@ -555,48 +784,20 @@ namespace m1
 		}
 
 		// record the drawing commands
+		auto recordStart = std::chrono::high_resolution_clock::now();
 		recordDrawSceneCommands(frameData.drawSceneCmdBuffer, swapChainImageIndex);
+		_frameTimings.cpuRecordMs = elapsedMs(recordStart);
 
-		// specify the semaphores and stages to wait on
-		// Each entry in the waitStages array corresponds to the semaphore with the same index in waitSemaphores
-		std::vector<VkSemaphore> waitSemaphores;
-		std::vector<VkPipelineStageFlags> waitStages;
-		waitSemaphores.push_back(_imageAvailableSems[swapChainImageIndex]);
-		waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-		if (_config.particlesEnabled)
-		{
-			waitSemaphores.push_back(frameData.computeCmdExecutedSem);
-			waitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
-		}
-
-		// specify which semaphores to signal once the command buffer has finished executing
-		VkSemaphore cmdExecutedSignalSemaphores[] = {_drawCmdExecutedSems[swapChainImageIndex]};
-
-		// submit info
-		VkSubmitInfo submitInfo
-		{
-			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-			//wait semaphores
-			.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size()),
-			.pWaitSemaphores = waitSemaphores.data(),
-			.pWaitDstStageMask = waitStages.data(),
-			// command buffers
-			.commandBufferCount = 1,
-			.pCommandBuffers = &frameData.drawSceneCmdBuffer,
-			// signal semaphore
-			.signalSemaphoreCount = 1,
-			.pSignalSemaphores = cmdExecutedSignalSemaphores,
-		};
-
-		// submit the command buffer (the fence will be signaled when the command buffer finishes executing)
-        VK_CHECK(vkQueueSubmit(_device.getGraphicsQueue().getVkQueue(), 1, &submitInfo, frameData.drawCmdExecutedFence));
+		// submit the command buffer (waiting on the image to be available, signaling the semaphore waited by the presentation)
+		VkSemaphore cmdExecutedSemaphore = _drawCmdExecutedSems[swapChainImageIndex];
+		auto submitStart = std::chrono::high_resolution_clock::now();
+		submitDrawCommands(frameData, _imageAvailableSems[swapChainImageIndex], cmdExecutedSemaphore);
 
 		// present info
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = cmdExecutedSignalSemaphores; // wait for the command buffer to finish
+		presentInfo.pWaitSemaphores = &cmdExecutedSemaphore; // wait for the command buffer to finish
 
 		VkSwapchainKHR swapChains[] = {_swapChain->getVkSwapChain()};
 		presentInfo.swapchainCount = 1;
@@ -605,9 +806,10 @@ namespace m1
 
 		// present the swap chain image
 		result = vkQueuePresentKHR(_device.getPresentQueue().getVkQueue(), &presentInfo);
+		_frameTimings.submitMs = elapsedMs(submitStart);
 
 		// recreate the swap chain if needed
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _window.FramebufferResized)
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _window->FramebufferResized)
 		{
 			Log::Get().Trace("Swap chain suboptimal, out of date, or window resized. Recreating.");
 			recreateSwapChain();
@@ -619,7 +821,153 @@ namespace m1
 		}
 
 		// advance to the next frame
-		_currentFrame = (_currentFrame + 1) % FRAMES_IN_FLIGHT;
+		_currentFrame = (_currentFrame + 1) % _framesInFlight;
+	}
+
+	void Engine::drawOffscreenFrame(FrameData& frameData)
+	{
+		// record the drawing commands (the frame ends in the color image)
+		auto recordStart = std::chrono::high_resolution_clock::now();
+		recordDrawSceneCommands(frameData.drawSceneCmdBuffer, 0);
+		_frameTimings.cpuRecordMs = elapsedMs(recordStart);
+
+		// only the particles computation has to be waited for
+		auto submitStart = std::chrono::high_resolution_clock::now();
+		submitDrawCommands(frameData, VK_NULL_HANDLE, VK_NULL_HANDLE);
+		_frameTimings.submitMs = elapsedMs(submitStart);
+	}
+
+	void Engine::waitForFrameSlot(uint32_t frameSlot) const
+	{
+		// - the draw of the previous use of the slot: its command buffer, uniform buffers and queries are reused
+		// - the particles computation submitted by the previous use of the slot: it writes the particles of the next slot,
+		//   computed again by this frame (same command buffer), and its queries are in the slot query pool
+		std::array semaphores{ _graphicsTimeline, _computeTimeline };
+		std::array values
+		{
+			_framesData[frameSlot]->graphicsTimelineValue,
+			_framesData[(frameSlot + 1) % _framesInFlight]->computeTimelineValue,
+		};
+
+		VkSemaphoreWaitInfo waitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+			.semaphoreCount = static_cast<uint32_t>(semaphores.size()),
+			.pSemaphores = semaphores.data(),
+			.pValues = values.data(),
+		};
+		VK_CHECK(vkWaitSemaphores(_device.getVkDevice(), &waitInfo, UINT64_MAX));
+	}
+
+	void Engine::submitDrawCommands(FrameData& frameData, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore)
+	{
+		std::vector<VkSemaphoreSubmitInfo> waitInfos;
+		if (waitSemaphore != VK_NULL_HANDLE)
+		{
+			waitInfos.push_back(
+			{
+				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+				.semaphore = waitSemaphore,
+				.stageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT, // the swap chain image is first written by the blit
+			});
+		}
+		// the particles of the frame, computed while the previous frame was drawn (already completed if the particles
+		// were disabled in the meantime)
+		waitInfos.push_back(
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = _computeTimeline,
+			.value = frameData.computeTimelineValue,
+			.stageMask = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT,
+		});
+
+		frameData.graphicsTimelineValue = ++_graphicsTimelineValue;
+		std::vector<VkSemaphoreSubmitInfo> signalInfos
+		{
+			{
+				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+				.semaphore = _graphicsTimeline,
+				.value = frameData.graphicsTimelineValue,
+				.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			},
+		};
+		if (signalSemaphore != VK_NULL_HANDLE)
+		{
+			signalInfos.push_back(
+			{
+				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+				.semaphore = signalSemaphore,
+				.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			});
+		}
+
+		VkCommandBufferSubmitInfo commandBufferInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+			.commandBuffer = frameData.drawSceneCmdBuffer,
+		};
+
+		VkSubmitInfo2 submitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+			.waitSemaphoreInfoCount = static_cast<uint32_t>(waitInfos.size()),
+			.pWaitSemaphoreInfos = waitInfos.data(),
+			.commandBufferInfoCount = 1,
+			.pCommandBufferInfos = &commandBufferInfo,
+			.signalSemaphoreInfoCount = static_cast<uint32_t>(signalInfos.size()),
+			.pSignalSemaphoreInfos = signalInfos.data(),
+		};
+		VK_CHECK(vkQueueSubmit2(_device.getGraphicsQueue().getVkQueue(), 1, &submitInfo, VK_NULL_HANDLE));
+
+		// the particles of the next frame are computed on the compute queue while this frame is drawn (overlapping only
+		// when the compute queue belongs to a dedicated family, see Device)
+		if (_config.particlesEnabled)
+			submitParticlesCompute((_currentFrame + 1) % _framesInFlight);
+	}
+
+	void Engine::submitParticlesCompute(uint32_t frameSlot)
+	{
+		FrameData& frameData = *_framesData[frameSlot];
+
+		// the previous computation using the command buffer has been waited for by waitForFrameSlot
+		vkResetCommandBuffer(frameData.computeCmdBuffer, 0);
+		recordComputeCommands(frameData.computeCmdBuffer, frameSlot);
+
+		// the particles written are read (as vertex buffer) by the last draw of the slot, which may still be executing
+		VkSemaphoreSubmitInfo waitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = _graphicsTimeline,
+			.value = frameData.graphicsTimelineValue,
+			.stageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		};
+
+		frameData.computeTimelineValue = ++_computeTimelineValue;
+		VkSemaphoreSubmitInfo signalInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = _computeTimeline,
+			.value = frameData.computeTimelineValue,
+			.stageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		};
+
+		VkCommandBufferSubmitInfo commandBufferInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+			.commandBuffer = frameData.computeCmdBuffer,
+		};
+
+		VkSubmitInfo2 submitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+			.waitSemaphoreInfoCount = 1,
+			.pWaitSemaphoreInfos = &waitInfo,
+			.commandBufferInfoCount = 1,
+			.pCommandBufferInfos = &commandBufferInfo,
+			.signalSemaphoreInfoCount = 1,
+			.pSignalSemaphoreInfos = &signalInfo,
+		};
+		VK_CHECK(vkQueueSubmit2(_device.getComputeQueue().getVkQueue(), 1, &submitInfo, VK_NULL_HANDLE));
 	}
 
 	void Engine::updateFrameUbo() const
@@ -628,27 +976,40 @@ namespace m1
 		{
 			.view                = _camera.getViewMatrix(),
 			.proj                = _camera.getProjectionMatrix(),
-			.lightViewProjMatrix = computeLightViewProjMatrix(),
 			.camPos              = glm::vec4(_camera.getPosition(), 1.0f),
 			.iblIntensity        = _config.iblIntensity,
 			.shadowsEnabled      = _config.shadowsEnabled ? 1 : 0,
+			.cascadeCount        = static_cast<int>(getShadowCascadeCount()),
 		};
+		for (uint32_t i = 0; i < MAX_SHADOW_CASCADES; i++)
+		{
+			frameUbo.cascadeViewProj[i] = _shadowCascades[i].viewProj;
+			frameUbo.cascadeSplits[static_cast<int>(i)] = _shadowCascades[i].splitDepth;
+		}
 		_framesData[_currentFrame]->frameUboBuffer->copyDataToBuffer(&frameUbo);
 	}
 
-	void Engine::updateObjectUbo(const SceneObject &sceneObject) const
+	void Engine::createSyncObjects()
 	{
-		ObjectUbo objectUbo
+		// timeline semaphores of the frames: their values only increase, each submission signals the next one
+		VkSemaphoreTypeCreateInfo timelineInfo
 		{
-			.model        = sceneObject.Transform,
-			.normalMatrix = glm::transpose(glm::inverse(sceneObject.Transform)),
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+			.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+			.initialValue = 0,
 		};
+		VkSemaphoreCreateInfo timelineSemaphoreInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = &timelineInfo,
+		};
+		VK_CHECK(vkCreateSemaphore(_device.getVkDevice(), &timelineSemaphoreInfo, nullptr, &_graphicsTimeline));
+		VK_CHECK(vkCreateSemaphore(_device.getVkDevice(), &timelineSemaphoreInfo, nullptr, &_computeTimeline));
 
-		_framesData[_currentFrame]->objectUboBuffer->copyDataToBuffer(&objectUbo);
-	}
+		// nothing to acquire or present in headless mode
+		if (_swapChain->isHeadless())
+			return;
 
-	void Engine::createSyncObjects()
-	{
 		// use separate semaphore per swap chain image (even if the frame count is different)
 		// to synchronize between acquiring and presenting images
 		size_t imageCount = _swapChain->getImageCount();
@@ -667,78 +1028,341 @@ namespace m1
 		VK_CHECK(vkCreateSemaphore(_device.getVkDevice(), &semaphoreInfo, nullptr, &_acquireSemaphore));
 	}
 
-	void Engine::drawObjectsLoop(VkCommandBuffer commandBuffer)
+	void Engine::cullSceneObjects()
 	{
-		auto defaultPipeline = _config.lightingType == LightingType::BlinnPhong ? PipelineType::PhongLighting : PipelineType::PbrLighting;
-
-		auto currentPipelineType = defaultPipeline;
+		_frustumCuller.update(_sceneObjects);
 
-		// bind default pipeline
-		Pipeline* currentPipeline = _graphicsPipelines.at(currentPipelineType).get();
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getVkPipeline());
+		_frustumCuller.cull(_camera.getProjectionMatrix() * _camera.getViewMatrix(), _visibleObjects);
 
-		// bind frame descriptor set
-		VkDescriptorSet descriptorSet0 = _framesData[_currentFrame]->frameDescriptorSet;
-    	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getLayout(), 0, 1, &descriptorSet0, 0, nullptr);
+		// casters of the cascades rendered this frame
+		for (uint32_t i = 0; i < MAX_SHADOW_CASCADES; i++)
+		{
+			if (_shadowCascadeMask & (1u << i))
+				_frustumCuller.cull(_shadowCascades[i].viewProj, _visibleShadowCasters[i]);
+		}
+	}
 
-		// bind default material descriptor set
-		VkDescriptorSet descriptorSetMat = _defaultMaterial->getDescriptorSet(currentPipelineType);
-		uint32_t dynOff = 0;
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getLayout(), 1, 1, &descriptorSetMat, 1, &dynOff);
-		_currentMaterialName = DEFAULT_MATERIAL_NAME;
+	void Engine::updateShadowCascades(bool sceneChanged)
+	{
+		/*
+			The view depths [near, shadow distance] are split with the practical split scheme (Zhang et al., "Parallel-Split
+			Shadow Maps"): split i = lambda * n * (f / n)^(i / N) + (1 - lambda) * (n + (f - n) * i / N).
+			Each cascade is fitted to the bounding sphere of its slice of the view frustum, whose size doesn't change when
+			the camera rotates, and its center is snapped to the texels of the layer: the shadow edges don't shimmer when the
+			camera moves, and the projection of a still camera stays the same (the layer can be cached)
+		*/
+		uint32_t cascadeCount = getShadowCascadeCount();
+		float nearDepth = _camera.getNearPlane();
+		float farDepth = _camera.getFarPlane();
+		float shadowDistance = _config.shadowDistance > 0.0f ? std::min(_config.shadowDistance, farDepth) : farDepth;
+		float lambda = std::clamp(_config.shadowCascadeSplitLambda, 0.0f, 1.0f);
+
+		// corners of the near and far planes of the view frustum in world space (depth [0, 1])
+		glm::mat4 invViewProj = glm::inverse(_camera.getProjectionMatrix() * _camera.getViewMatrix());
+		std::array<glm::vec3, 4> nearCorners, farCorners;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			glm::vec2 ndc(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f);
+			glm::vec4 nearCorner = invViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+			glm::vec4 farCorner = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+			nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+			farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+		}
 
-		for (auto &obj: _sceneObjects)
+		_shadowCascadeMask = 0;
+		float sliceNear = nearDepth;
+		for (uint32_t i = 0; i < MAX_SHADOW_CASCADES; i++)
 		{
-			//updateObjectUbo(*obj); // TODO: how to update the object ubo instead of using push constants?
+			auto& cascade = _shadowCascades[i];
+			if (i >= cascadeCount || !_config.shadowsEnabled)
+			{
+				cascade.cached = false; // not rendered, the layer content is lost
+				continue;
+			}
 
-			auto objPipeLineType = obj->PipelineKey.value_or(defaultPipeline);
+			float ratio = static_cast<float>(i + 1) / static_cast<float>(cascadeCount);
+			float logSplit = nearDepth * std::pow(shadowDistance / nearDepth, ratio);
+			float uniformSplit = nearDepth + (shadowDistance - nearDepth) * ratio;
+			cascade.splitDepth = i + 1 == cascadeCount ? shadowDistance : lambda * logSplit + (1.0f - lambda) * uniformSplit;
 
-			// determine which pipeline to use for this object
-			if (objPipeLineType != currentPipelineType)
+			// the view depth is linear along the edges of the frustum
+			std::array<glm::vec3, 8> sliceCorners;
+			float tNear = (sliceNear - nearDepth) / (farDepth - nearDepth);
+			float tFar = (cascade.splitDepth - nearDepth) / (farDepth - nearDepth);
+			for (uint32_t j = 0; j < 4; j++)
 			{
-				currentPipelineType = objPipeLineType;
-				_currentMaterialName = "";
+				sliceCorners[j] = glm::mix(nearCorners[j], farCorners[j], tNear);
+				sliceCorners[4 + j] = glm::mix(nearCorners[j], farCorners[j], tFar);
+			}
+			sliceNear = cascade.splitDepth;
 
-				// bind pipeline
-				currentPipeline = _graphicsPipelines.at(currentPipelineType).get();
-				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getVkPipeline());
+			cascade.viewProj = computeCascadeViewProjMatrix(sliceCorners);
 
-				// bind descriptor set
-				descriptorSet0 = _framesData[_currentFrame]->frameDescriptorSet;
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getLayout(),
-				                        0, 1, &descriptorSet0, 0, nullptr);
+			// the layer is rendered again when its content is stale (cached again by the shadow pass)
+			bool valid = _config.shadowCascadeCachingEnabled && cascade.cached && !sceneChanged && cascade.cachedViewProj == cascade.viewProj;
+			if (!valid)
+				_shadowCascadeMask |= 1u << i;
+		}
+	}
 
-				_currentMaterialName = "";
+	void Engine::updateTextureStreaming()
+	{
+		// the requested resolutions change slowly, the visible objects are culled again only every few frames
+		if (_totalFrames % TEXTURE_STREAMING_INTERVAL == 0)
+		{
+			_frustumCuller.update(_sceneObjects);
+			_frustumCuller.cull(_camera.getProjectionMatrix() * _camera.getViewMatrix(), _streamingVisibleObjects);
+
+			// on-screen size (pixels) of the bounding sphere of the largest visible object of each material
+			const glm::mat4& projection = _camera.getProjectionMatrix();
+			bool perspective = projection[3][3] == 0.0f;
+			float pixelsPerUnit = std::abs(projection[1][1]) * static_cast<float>(_swapChain->getExtent().height);
+			std::vector<float> materialPixels(_materials.size() + 1, 0.0f);
+			for (uint32_t i : _streamingVisibleObjects)
+			{
+				auto& obj = _sceneObjects[i];
+				if (obj->PipelineKey == PipelineType::NoLight)
+					continue;
+
+				const BBox& bbox = obj->getWorldBBox();
+				float radius = 0.5f * glm::length(bbox.getExtent());
+				float distance = perspective ? std::max(glm::distance(bbox.getCenter(), _camera.getPosition()), 0.001f) : 1.0f;
+				auto& pixels = materialPixels[obj->Mesh->getMaterialId()];
+				pixels = std::max(pixels, radius * pixelsPerUnit / distance);
 			}
 
-			if (currentPipelineType != PipelineType::NoLight)
+			_textureStreamer->beginRequests();
+			for (uint32_t materialId = 0; materialId < materialPixels.size(); materialId++)
 			{
-				// gets the object material and bind the descriptor set if different from the current material
-				auto matName = obj->Mesh->getMaterialName();
-				const Material& material = matName.empty() ? *_defaultMaterial : *_materials.at(matName);
+				if (materialPixels[materialId] == 0.0f)
+					continue;
 
-				if (material.name != _currentMaterialName)
+				const Material& material = getMaterial(materialId);
+				for (const auto* map : { &material.baseColorMap, &material.specularMap, &material.normalMap,
+					&material.metallicRoughnessMap, &material.occlusionMap, &material.emissiveMap })
 				{
-					_currentMaterialName = matName;
-					uint32_t dynamicOffset = material.uboIndex * (currentPipelineType == PipelineType::PbrLighting
-						                                              ? _materialPbrUboAlignment
-						                                              : _materialPhongUboAlignment);
+					if (*map)
+						_textureStreamer->requestResolution(**map, materialPixels[materialId]);
+				}
+			}
+		}
 
-					VkDescriptorSet descriptorSet = material.getDescriptorSet(currentPipelineType);
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getLayout(), 1, 1, &descriptorSet, 1, &dynamicOffset);
+		// the frames in flight keep the descriptor sets of their replaced textures until their slot is reused
+		auto changedTextures = _textureStreamer->update(_totalFrames);
+		for (uint32_t materialId = 0; materialId <= _materials.size(); materialId++)
+		{
+			auto& material = materialId == 0 ? *_defaultMaterial : *_materials[materialId - 1];
+			if (!changedTextures.empty())
+			{
+				for (const auto* map : { &material.baseColorMap, &material.specularMap, &material.normalMap,
+					&material.metallicRoughnessMap, &material.occlusionMap, &material.emissiveMap })
+				{
+					if (std::ranges::contains(changedTextures, map->get()))
+						material.staleDescriptorSets = (1u << _framesInFlight) - 1;
 				}
 			}
 
-			// push constants
-			PushConstantData push
+			if (material.staleDescriptorSets & (1u << _currentFrame))
 			{
-				.model = obj->Transform,
-				.normalMatrix = glm::transpose(glm::inverse(obj->Transform))
-			};
-			vkCmdPushConstants(commandBuffer, currentPipeline->getLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &push);
+				updateMaterialDescriptorSet(material, _currentFrame);
+				material.staleDescriptorSets &= ~(1u << _currentFrame);
+			}
+		}
+	}
+
+	void Engine::selectLods()
+	{
+		/*
+			The LOD of an object is the coarsest one whose simplification error, projected at the distance of the bounding
+			sphere, is below lodErrorPixels. The LOD changes only when needed: finer as soon as the error of the current
+			one is too large, coarser only when the error of the next one is below LOD_HYSTERESIS * lodErrorPixels
+		*/
+		const glm::mat4& projection = _camera.getProjectionMatrix();
+		bool perspective = projection[3][3] == 0.0f;
+		float pixelsPerUnit = std::abs(projection[1][1]) * 0.5f * static_cast<float>(_swapChain->getExtent().height);
 
-			obj->Mesh->draw(commandBuffer);
+		bool shadowLodsChanged = false;
+		for (uint32_t i = 0; i < _sceneObjects.size(); i++)
+		{
+			auto& obj = _sceneObjects[i];
+			const Mesh& mesh = *obj->Mesh;
+			uint32_t lodCount = _config.lodEnabled ? mesh.getLodCount() : 1;
+			uint32_t lod = std::min<uint32_t>(_objectLods[i], lodCount - 1); // from the coarsest one the first time
+
+			if (lodCount > 1)
+			{
+				// object space errors: scaled by the largest scale of the world transform
+				const glm::mat4& transform = obj->getTransform();
+				glm::vec3 axes[3] = { glm::vec3(transform[0]), glm::vec3(transform[1]), glm::vec3(transform[2]) };
+				float scale = std::sqrt(std::max({ glm::dot(axes[0], axes[0]), glm::dot(axes[1], axes[1]), glm::dot(axes[2], axes[2]) }));
+
+				const BBox& bbox = obj->getWorldBBox();
+				float radius = 0.5f * glm::length(bbox.getExtent());
+				float distance = perspective ? std::max(glm::distance(bbox.getCenter(), _camera.getPosition()) - radius, 0.001f) : 1.0f;
+				float pixelsPerError = scale * pixelsPerUnit / distance;
+
+				while (lod > 0 && mesh.getLod(lod).error * pixelsPerError > _config.lodErrorPixels)
+					lod--;
+				while (lod + 1 < lodCount && mesh.getLod(lod + 1).error * pixelsPerError <= _config.lodErrorPixels * LOD_HYSTERESIS)
+					lod++;
+			}
+
+			if (lod == _objectLods[i])
+				continue;
+			uint32_t previousShadowLod = getShadowLod(i);
+			_objectLods[i] = static_cast<uint8_t>(lod);
+			shadowLodsChanged |= getShadowLod(i) != previousShadowLod;
+
+			// index ranges of the indirect commands written by the GPU culling
+			const GeometryAllocation& geometry = mesh.getGeometry();
+			const MeshLod& mainLod = mesh.getLod(lod);
+			const MeshLod& shadowLod = mesh.getLod(getShadowLod(i));
+			auto& objectData = _objectsData[i];
+			objectData.indexCount = mainLod.indexCount;
+			objectData.firstIndex = geometry.firstIndex + mainLod.firstIndex;
+			objectData.shadowIndexCount = shadowLod.indexCount;
+			objectData.shadowFirstIndex = geometry.firstIndex + shadowLod.firstIndex;
+			// the meshlets are clusters of the full detail level
+			objectData.meshletCount = lod == 0 && _config.meshletCullingEnabled ? static_cast<uint32_t>(mesh.getMeshlets().size()) : 0;
 		}
+
+		// the cached shadow cascades were rendered with the previous LODs
+		if (shadowLodsChanged && _config.shadowsEnabled)
+			_shadowCascadeMask = (1u << getShadowCascadeCount()) - 1;
+	}
+
+	uint32_t Engine::getShadowLod(uint32_t objectIndex) const
+	{
+		uint32_t lodCount = _config.lodEnabled ? _sceneObjects[objectIndex]->Mesh->getLodCount() : 1;
+		return std::min(_objectLods[objectIndex] + _config.shadowLodBias, lodCount - 1);
+	}
+
+	void Engine::buildDrawList()
+	{
+		auto defaultPipeline = _config.lightingType == LightingType::BlinnPhong ? PipelineType::PhongLighting : PipelineType::PbrLighting;
+		const glm::mat4& view = _camera.getViewMatrix();
+		float farPlane = _camera.getFarPlane();
+
+		_drawList.clear();
+		for (uint32_t i : _visibleObjects)
+		{
+			const auto& obj = _sceneObjects[i];
+			auto pipelineType = obj->PipelineKey.value_or(defaultPipeline);
+
+			// objects without lighting don't use materials
+			uint32_t materialId = pipelineType != PipelineType::NoLight ? obj->Mesh->getMaterialId() : 0;
+
+			// view depth of the object origin (the camera looks towards -z)
+			float depth = -(view * obj->getTransform()[3]).z;
+
+			_drawList.add(DrawList::makeKey(pipelineType, materialId, obj->Mesh->getId(), _objectLods[i], depth / farPlane), i);
+		}
+
+		_drawList.sort();
+
+		// shadow casters of the cascades rendered this frame, grouped by geometry pool block
+		for (uint32_t cascade = 0; cascade < MAX_SHADOW_CASCADES; cascade++)
+		{
+			auto& shadowDrawList = _shadowDrawLists[cascade];
+			shadowDrawList.clear();
+			if (!(_shadowCascadeMask & (1u << cascade)))
+				continue;
+
+			for (uint32_t i : _visibleShadowCasters[cascade])
+			{
+				const auto& mesh = *_sceneObjects[i]->Mesh;
+				shadowDrawList.add(DrawList::makeShadowKey(mesh.getGeometry().block, mesh.getId(), getShadowLod(i)), i);
+			}
+			shadowDrawList.sort();
+		}
+
+		// the instances are the objects in the order of the lists: the firstInstance of a draw is the index of its first item
+		auto* instances = static_cast<uint32_t*>(_framesData[_currentFrame]->instancesBuffer->getMappedData());
+		const auto& items = _drawList.getItems();
+		for (size_t i = 0; i < items.size(); i++)
+			instances[i] = items[i].objectIndex;
+		for (uint32_t cascade = 0; cascade < MAX_SHADOW_CASCADES; cascade++)
+		{
+			const auto& shadowItems = _shadowDrawLists[cascade].getItems();
+			for (size_t i = 0; i < shadowItems.size(); i++)
+				instances[getShadowInstancesOffset(cascade) + i] = shadowItems[i].objectIndex;
+		}
+	}
+
+	// number of items following the first one in the same instancing group, drawn as its instances
+	static uint32_t countInstances(std::span<const DrawItem> items, size_t first)
+	{
+		uint64_t group = DrawList::getInstancingGroup(items[first].key);
+		uint32_t count = 1;
+		while (first + count < items.size() && DrawList::getInstancingGroup(items[first + count].key) == group)
+			count++;
+		return count;
+	}
+
+	void Engine::drawObjectsLoop(VkCommandBuffer commandBuffer, uint32_t firstItem, uint32_t itemCount) const
+	{
+		/*
+			Draws are sorted by pipeline, material and mesh (see DrawList) so each state is bound only when it changes,
+			and the objects sharing the three are drawn by one instanced draw.
+			The states are bound again at the beginning of each range (one range per secondary command buffer), a group
+			spanning two ranges is drawn once in each
+		*/
+		VkDescriptorSet frameDescriptorSet = _framesData[_currentFrame]->frameDescriptorSet;
+		const Pipeline* currentPipeline = nullptr;
+		std::optional<PipelineType> currentPipelineType;
+		std::optional<uint32_t> currentMaterialId;
+		std::optional<uint32_t> currentGeometryBlock;
+
+		auto items = std::span(_drawList.getItems()).subspan(firstItem, itemCount);
+		for (size_t i = 0; i < items.size();)
+		{
+			const auto& item = items[i];
+			const auto& obj = _sceneObjects[item.objectIndex];
+			auto pipelineType = DrawList::getPipeline(item.key);
+
+			// bind pipeline and frame descriptor set
+			if (pipelineType != currentPipelineType)
+			{
+				currentPipelineType = pipelineType;
+				currentMaterialId.reset();
+
+				currentPipeline = _graphicsPipelines.at(pipelineType).get();
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getVkPipeline());
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentPipeline->getLayout(),
+				                        0, 1, &frameDescriptorSet, 0, nullptr);
+			}
+
+			// bind the material descriptor set
+			uint32_t materialId = DrawList::getMaterialId(item.key);
+			if (pipelineType != PipelineType::NoLight && materialId != currentMaterialId)
+			{
+				currentMaterialId = materialId;
+				bindMaterialDescriptorSet(commandBuffer, *currentPipeline, pipelineType, materialId);
+			}
+
+			// bind the geometry pool buffers only when the block changes: meshes in the same block share them
+			uint32_t geometryBlock = obj->Mesh->getGeometry().block;
+			if (geometryBlock != currentGeometryBlock)
+			{
+				currentGeometryBlock = geometryBlock;
+				_geometryPool->bind(commandBuffer, geometryBlock);
+			}
+			// the vertex shaders read the object index of each instance from the instances SSBO
+			uint32_t instanceCount = countInstances(items, i);
+			obj->Mesh->drawIndexed(commandBuffer, instanceCount, firstItem + static_cast<uint32_t>(i), DrawList::getLod(item.key));
+			i += instanceCount;
+		}
+	}
+
+	void Engine::bindMaterialDescriptorSet(VkCommandBuffer commandBuffer, const Pipeline& pipeline, PipelineType pipelineType, uint32_t materialId) const
+	{
+		const Material& material = getMaterial(materialId);
+		uint32_t dynamicOffset = material.uboIndex * (pipelineType == PipelineType::PbrLighting
+			                                              ? _materialPbrUboAlignment
+			                                              : _materialPhongUboAlignment);
+
+		VkDescriptorSet descriptorSet = material.getDescriptorSet(pipelineType, _currentFrame);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.getLayout(), 1, 1, &descriptorSet, 1, &dynamicOffset);
 	}
 
 	void Engine::drawSkyBox(VkCommandBuffer commandBuffer) const
@@ -762,35 +1386,93 @@ namespace m1
 		vkCmdDraw(commandBuffer, 36, 1, 0, 0);
 	}
 
-	void Engine::drawParticles(VkCommandBuffer commandBuffer) const
+	void Engine::drawParticles(VkCommandBuffer commandBuffer) const
+	{
+		Pipeline *particlePipeline = _graphicsPipelines.at(PipelineType::Particles).get();
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, particlePipeline->getVkPipeline());
+
+		VkDescriptorSet descriptorSet = _framesData[_currentFrame]->frameDescriptorSet;
+	    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, particlePipeline->getLayout(), 0, 1, &descriptorSet, 0, nullptr);
+
+		VkBuffer vertexBuffers[] = {_framesData[_currentFrame]->particleSSboBuffer->getVkBuffer()};
+		VkDeviceSize offsets[] = {0};
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+		vkCmdDraw(commandBuffer, PARTICLES_COUNT, 1, 0, 0);
+	}
+
+	void Engine::drawParticlesAndSkyBox(VkCommandBuffer commandBuffer) const
+	{
+		// draw particles
+		if (_config.particlesEnabled)
+			drawParticles(commandBuffer);
+
+		// draw sky box
+		if (_config.skyboxEnabled)
+		{
+			_gpuProfiler->beginScope(commandBuffer, GpuScope::Skybox);
+			drawSkyBox(commandBuffer);
+			_gpuProfiler->endScope(commandBuffer, GpuScope::Skybox);
+		}
+	}
+
+	void Engine::recordSecondaryCommands()
 	{
-		Pipeline *particlePipeline = _graphicsPipelines.at(PipelineType::Particles).get();
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, particlePipeline->getVkPipeline());
+		_commandRecorder->beginFrame(_currentFrame);
 
-		VkDescriptorSet descriptorSet = _framesData[_currentFrame]->frameDescriptorSet;
-	    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, particlePipeline->getLayout(), 0, 1, &descriptorSet, 0, nullptr);
+		// the shadow cascades and the main pass are recorded concurrently, while the render graph is compiled
+		const Image& shadowMapImage = _shadowMap->getImage();
+		RenderingFormats shadowFormats{ .depthFormat = shadowMapImage.getFormat() };
+		for (uint32_t cascade = 0; cascade < MAX_SHADOW_CASCADES; cascade++)
+		{
+			if (!(_shadowCascadeMask & (1u << cascade)))
+				continue;
 
-		VkBuffer vertexBuffers[] = {_framesData[_currentFrame]->particleSSboBuffer->getVkBuffer()};
-		VkDeviceSize offsets[] = {0};
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-		vkCmdDraw(commandBuffer, PARTICLES_COUNT, 1, 0, 0);
+			_commandRecorder->record(shadowFormats, static_cast<uint32_t>(_shadowDrawLists[cascade].getItems().size()),
+				[this, cascade, extent = shadowMapImage.getExtent()](VkCommandBuffer cmd, uint32_t first, uint32_t count)
+				{
+					setDynamicStates(cmd, extent);
+					drawShadowCasters(cmd, cascade, first, count);
+				}, _shadowPassCommands[cascade]);
+		}
+
+		RenderingFormats mainFormats
+		{
+			.colorFormats = { _swapChain->getColorImage().getFormat() },
+			.depthFormat = _swapChain->getDepthFormat(),
+			.samples = _swapChain->getSamples(),
+		};
+		auto itemCount = static_cast<uint32_t>(_drawList.getItems().size());
+		_commandRecorder->record(mainFormats, itemCount,
+			[this, itemCount, extent = _swapChain->getExtent()](VkCommandBuffer cmd, uint32_t first, uint32_t count)
+			{
+				setDynamicStates(cmd, extent);
+				// the scope starts in the first command buffer and ends in the last one
+				if (first == 0)
+					_gpuProfiler->beginScope(cmd, GpuScope::MainLit);
+				drawObjectsLoop(cmd, first, count);
+				if (first + count == itemCount)
+					_gpuProfiler->endScope(cmd, GpuScope::MainLit);
+			}, _mainPassCommands);
+
+		if (_config.particlesEnabled || _config.skyboxEnabled)
+		{
+			_commandRecorder->record(mainFormats, 1, [this, extent = _swapChain->getExtent()](VkCommandBuffer cmd, uint32_t, uint32_t)
+			{
+				setDynamicStates(cmd, extent);
+				drawParticlesAndSkyBox(cmd);
+			}, _mainPassCommands);
+		}
 	}
 
 	void Engine::recordDrawSceneCommands(VkCommandBuffer commandBuffer, uint32_t swapChainImageIndex)
 	{
-		// it can be executed on a separate thread
-
 		/*
 			Rendering is done on a color image, then copied to the swap chain image.
+			In the CPU path, the draws of the shadow and main passes are recorded by worker threads into secondary command buffers.
 			If multi-sample antialiasing is enabled, rendering is done on msaa image, then resolved to the color image.
 
-			At a high level:
-			- transition the attachments images to right layouts
-			- begin rendering
-			- draw objects command
-			- end rendering
-			- copy color image to swap chain image
-			- transition swap chain image to present layout
+			The passes (culling, shadow, main, blit, ui) are declared to the render graph, which culls the unused ones,
+			allocates the transient attachments (depth, msaa) and records the barriers and layout transitions.
 		*/
 
 		// reset the command buffer and begin a new recording
@@ -801,40 +1483,143 @@ namespace m1
 		beginInfo.pInheritanceInfo = nullptr; // Optional
 		VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
-		if (_config.shadowsEnabled)
-			// create the shadow map
-			recordShadowMappingPass(commandBuffer);
+		_gpuProfiler->beginScope(commandBuffer, GpuScope::Frame);
+
+		// CPU side of the culling (the draw lists, or the batches of the GPU culling). The per object data is read from
+		// the objects SSBO by both paths
+		selectLods();
+		if (_config.gpuDrivenEnabled)
+		{
+			// the default pipeline (and so the batches) depends on the lighting type
+			if (_drawBatchesLightingType != _config.lightingType)
+				buildDrawBatches();
+		}
 		else
-			// transition layout SHADER_READ_ONLY_OPTIMAL - still attached to the descriptor even if not used in the shader when shadows are disabled
-			transitionImageLayout(commandBuffer, _shadowMap->getImage().getVkImage(), 1,
-				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
+		{
+			cullSceneObjects();
+			buildDrawList();
+		}
+		updateObjectsSsbo();
+
+		// a few indirect draws in the GPU-driven path: only the CPU path is worth recording in parallel
+		if (!_config.gpuDrivenEnabled && _config.parallelRecordingEnabled)
+			recordSecondaryCommands();
 
-		// gets the images attachments
+		// declare the passes of the frame, the render graph records the barriers between them
+		_renderGraph->reset();
+
+		// the color image stays in transfer layout (copied to the swap chain image, or read back in headless mode)
 		Image& colorImage = _swapChain->getColorImage();
-		Image& msaaImage = _swapChain->getMsaaColorImage();
-		Image& depthImage = _swapChain->getDepthImage();
-		VkImage swapChainImage = _swapChain->getSwapChainImage(swapChainImageIndex);
-		VkImageView swapChainImageView = _swapChain->getSwapChainImageView(swapChainImageIndex);
+		auto color = _renderGraph->importImage("color", colorImage.getVkImage(), VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		auto shadowMap = _renderGraph->importImage("shadow map", _shadowMap->getImage().getVkImage(), VK_IMAGE_ASPECT_DEPTH_BIT);
+
+		auto extent = _swapChain->getExtent();
+		auto depth = _renderGraph->createImage("depth",
+		{
+			.extent = extent,
+			.format = _swapChain->getDepthFormat(),
+			.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+			.samples = _swapChain->getSamples(),
+		});
+
+		// if multi-sample antialiasing is enabled, rendering is done on the msaa image, then resolved to the color image
+		std::optional<RenderGraphResource> msaa;
+		if (_config.msaaEnabled)
+		{
+			msaa = _renderGraph->createImage("msaa color",
+			{
+				.extent = extent,
+				.format = colorImage.getFormat(),
+				.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+				.samples = _swapChain->getSamples(),
+			});
+		}
+
+		// cull on the GPU: writes the indirect commands and the instances of the main and shadow passes
+		std::optional<RenderGraphResource> drawCommands, drawCounts, instances;
+		if (_config.gpuDrivenEnabled)
+		{
+			const FrameData& frameData = *_framesData[_currentFrame];
+			drawCommands = _renderGraph->importBuffer("draw commands", frameData.drawCommandsBuffer->getVkBuffer());
+			drawCounts = _renderGraph->importBuffer("draw counts", frameData.drawCountsBuffer->getVkBuffer());
+			instances = _renderGraph->importBuffer("instances", frameData.instancesBuffer->getVkBuffer());
+
+			_renderGraph->addPass("culling", [this](VkCommandBuffer cmd)
+			{
+				_gpuProfiler->beginScope(cmd, GpuScope::Culling);
+				recordCullingPass(cmd);
+				_gpuProfiler->endScope(cmd, GpuScope::Culling);
+			})
+			.write(*drawCommands, BufferUsage::ComputeWrite)
+			.write(*drawCounts, BufferUsage::ComputeWrite)
+			.write(*instances, BufferUsage::ComputeWrite);
+		}
+
+		// render the stale cascades of the shadow map, the cached layers are preserved (when shadows are disabled, the
+		// shadow map is still attached to the descriptor)
+		if (_shadowCascadeMask != 0)
+		{
+			auto shadowPass = _renderGraph->addPass("shadow", [this](VkCommandBuffer cmd)
+			{
+				_gpuProfiler->beginScope(cmd, GpuScope::Shadow);
+				recordShadowMappingPass(cmd);
+				_gpuProfiler->endScope(cmd, GpuScope::Shadow);
+			});
+			uint32_t cascadesMask = (1u << getShadowCascadeCount()) - 1;
+			if (_shadowCascadeMask == cascadesMask)
+				shadowPass.write(shadowMap, ImageUsage::DepthAttachment);
+			else
+				shadowPass.readWrite(shadowMap, ImageUsage::DepthAttachment);
+			if (_config.gpuDrivenEnabled)
+			{
+				shadowPass.read(*drawCommands, BufferUsage::IndirectRead).read(*drawCounts, BufferUsage::IndirectRead)
+					.read(*instances, BufferUsage::VertexShaderRead);
+			}
+		}
+
+		auto mainPass = _renderGraph->addPass("main", [this, depth, msaa](VkCommandBuffer cmd)
+		{
+			recordMainPass(cmd, _swapChain->getColorImage(), _renderGraph->getImage(depth),
+				msaa ? &_renderGraph->getImage(*msaa) : nullptr);
+		});
+		mainPass.write(depth, ImageUsage::DepthAttachment).read(shadowMap, ImageUsage::Sampled);
+		if (msaa)
+			mainPass.write(*msaa, ImageUsage::ColorAttachment).write(color, ImageUsage::ResolveAttachment);
+		else
+			mainPass.write(color, ImageUsage::ColorAttachment);
+		if (_config.gpuDrivenEnabled)
+		{
+			mainPass.read(*drawCommands, BufferUsage::IndirectRead).read(*drawCounts, BufferUsage::IndirectRead)
+				.read(*instances, BufferUsage::VertexShaderRead);
+		}
+
+		// copy the frame into the swap chain image (in headless mode the frame stays in the color image)
+		if (_swapChain->isHeadless())
+			_renderGraph->markOutput(color);
+		else
+			addPresentPasses(color, swapChainImageIndex);
 
-		// TODO: should I use the real current layout instead of undefined?
-		// TODO: should I set the layout at each frame even if is not changing (e.g. depthImage). Transition is not only for changing the layout but also to set the memory barriers
+		_renderGraph->compile();
+		_renderGraph->execute(commandBuffer);
 
-		// transition the msaa and color image to COLOR_ATTACHMENT_OPTIMAL
-		transitionImageLayout(commandBuffer, colorImage.getVkImage(), 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-		if (_config.msaaEnabled) transitionImageLayout(commandBuffer, msaaImage.getVkImage(), msaaImage.getMipLevels(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+		_gpuProfiler->endScope(commandBuffer, GpuScope::Frame);
 
-		// transition the depth image to DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-		transitionImageLayout(commandBuffer, depthImage.getVkImage(), depthImage.getMipLevels(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
+		// end command buffer recording
+		VK_CHECK(vkEndCommandBuffer(commandBuffer));
+	}
 
+	void Engine::recordMainPass(VkCommandBuffer commandBuffer, const Image& colorImage, const Image& depthImage, const Image* msaaImage)
+	{
 		// choose the render target image
-		Image& renderTarget = _config.msaaEnabled ? msaaImage : colorImage;
+		const Image& renderTarget = msaaImage ? *msaaImage : colorImage;
 		auto extent = renderTarget.getExtent();
 
 		// set the color attachment
 		VkRenderingAttachmentInfo colorAttachment = createColorAttachment(renderTarget.getVkImageView());
 
 		// set resolve image if msaa is enable
-		if (_config.msaaEnabled)
+		if (msaaImage)
 		{
 			colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
 			colorAttachment.resolveImageView = colorImage.getVkImageView();
@@ -845,6 +1630,15 @@ namespace m1
 		// set depth attachment
 		VkRenderingAttachmentInfo depthAttachment = createDepthAttachment(depthImage.getVkImageView());
 
+		// draws recorded by the worker threads: the rendering only executes the secondary command buffers
+		if (!_mainPassCommands.empty())
+		{
+			beginRendering(commandBuffer, {{0, 0}, extent}, 1, &colorAttachment, &depthAttachment, VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT);
+			ParallelCommandRecorder::execute(commandBuffer, _mainPassCommands);
+			endRendering(commandBuffer);
+			return;
+		}
+
 		// begin rendering
 		beginRendering(commandBuffer, {{0, 0}, extent}, 1, &colorAttachment, &depthAttachment);
 
@@ -852,61 +1646,86 @@ namespace m1
 		setDynamicStates(commandBuffer, extent);
 
 		// draw objects
-		drawObjectsLoop(commandBuffer);
-
-		// draw particles
-		if (_config.particlesEnabled)
-			drawParticles(commandBuffer);
+		_gpuProfiler->beginScope(commandBuffer, GpuScope::MainLit);
+		if (_config.gpuDrivenEnabled)
+			drawObjectsIndirect(commandBuffer, 0);
+		else
+			drawObjectsLoop(commandBuffer, 0, static_cast<uint32_t>(_drawList.getItems().size()));
+		_gpuProfiler->endScope(commandBuffer, GpuScope::MainLit);
 
-		// draw sky box
-		if (_config.skyboxEnabled)
-			drawSkyBox(commandBuffer);
+		// draw particles and sky box
+		drawParticlesAndSkyBox(commandBuffer);
 
 		// end rendering
 		endRendering(commandBuffer);
+	}
 
-		// transition the color image and the swapchain image into their correct transfer layouts
-		transitionImageLayout(commandBuffer, colorImage.getVkImage(), 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-		transitionImageLayout(commandBuffer, swapChainImage, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+	void Engine::addPresentPasses(RenderGraphResource color, uint32_t swapChainImageIndex)
+	{
+		// the blit is the first use of the acquired image (see the wait stage of the image available semaphore)
+		VkImage swapChainImage = _swapChain->getSwapChainImage(swapChainImageIndex);
+		auto swapChain = _renderGraph->importImage("swap chain", swapChainImage, VK_IMAGE_ASPECT_COLOR_BIT,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+		_renderGraph->markOutput(swapChain);
 
 		// copy the color image into the swapchain image
-		copyImageToImage(commandBuffer, colorImage.getVkImage(), swapChainImage, colorImage.getExtent(), _swapChain->getExtent());
-
-		if (_config.uiEnabled)
+		_renderGraph->addPass("blit", [this, swapChainImage](VkCommandBuffer cmd)
 		{
-			// set the spawChain image layout to color attachment optimal to render ui on it
-			transitionImageLayout(commandBuffer, swapChainImage, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-
-			// draw the ui
-			_gui->draw(commandBuffer, swapChainImageView, {0, 0, _swapChain->getExtent()});
-
-			// set the swapChain image layout to Present to show it on the screen
-			transitionImageLayout(commandBuffer, swapChainImage, 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_ASPECT_COLOR_BIT);
-		}
-		else
+			Image& colorImage = _swapChain->getColorImage();
+			_gpuProfiler->beginScope(cmd, GpuScope::Blit);
+			copyImageToImage(cmd, colorImage.getVkImage(), swapChainImage, colorImage.getExtent(), _swapChain->getExtent());
+			_gpuProfiler->endScope(cmd, GpuScope::Blit);
+		})
+		.read(color, ImageUsage::TransferSrc)
+		.write(swapChain, ImageUsage::TransferDst);
+
+		// draw the ui on top of the frame
+		if (_config.uiEnabled)
 		{
-			// set the swapchain image layout to Present to show it on the screen
-			transitionImageLayout(commandBuffer, swapChainImage, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_ASPECT_COLOR_BIT);
+			VkImageView swapChainImageView = _swapChain->getSwapChainImageView(swapChainImageIndex);
+			_renderGraph->addPass("ui", [this, swapChainImageView](VkCommandBuffer cmd)
+			{
+				_gpuProfiler->beginScope(cmd, GpuScope::Ui);
+				_gui->draw(cmd, swapChainImageView, {0, 0, _swapChain->getExtent()});
+				_gpuProfiler->endScope(cmd, GpuScope::Ui);
+			})
+			.readWrite(swapChain, ImageUsage::ColorAttachment);
 		}
-
-		// end command buffer recording
-		VK_CHECK(vkEndCommandBuffer(commandBuffer));
 	}
 
-	void Engine::recordComputeCommands(VkCommandBuffer commandBuffer) const
+	void Engine::recordComputeCommands(VkCommandBuffer commandBuffer, uint32_t frameSlot) const
 	{
 		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
 		VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
+		// the particles read were written by the previous computation, submitted before on the same queue
+		VkMemoryBarrier2 particlesBarrier
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+		};
+		VkDependencyInfo dependencyInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &particlesBarrier,
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipeline->getVkPipeline());
-		VkDescriptorSet descriptorSet = _framesData[_currentFrame]->computeParticleDescriptorSet;
+		VkDescriptorSet descriptorSet = _framesData[frameSlot]->computeParticleDescriptorSet;
     	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipeline->getLayout(), 0, 1,
     		&descriptorSet, 0, nullptr);
 
 		// groupsCount = PARTICLE_COUNT / 256 because we defined in the particle shader 256 invocations for each group
+		_gpuProfiler->beginScope(commandBuffer, GpuScope::ParticlesCompute);
 		vkCmdDispatch(commandBuffer, PARTICLES_COUNT / 256, 1, 1);
+		_gpuProfiler->endScope(commandBuffer, GpuScope::ParticlesCompute);
 
 		VK_CHECK(vkEndCommandBuffer(commandBuffer));
 	}
@@ -916,7 +1735,7 @@ namespace m1
 		// TODO: I should recreate the pipeline if image format or render pass (including subpass layout, attachments, sample count, etc.) changed
 
 		Log::Get().Info("Recreating swap chain");
-		while (_window.IsMinimized)
+		while (_window && _window->IsMinimized)
 			glfwWaitEvents();
 
 		vkDeviceWaitIdle(_device.getVkDevice());
@@ -924,6 +1743,7 @@ namespace m1
 		SwapChainConfig config
 		{
 			.samples = _config.msaaEnabled ? _device.getMaxMsaaSamples() : VK_SAMPLE_COUNT_1_BIT,
+			.headlessExtent = _config.headlessExtent,
 		};
 
 		if (_swapChain != nullptr)
@@ -935,10 +1755,13 @@ namespace m1
 			    throw std::runtime_error("Swap chain image(or depth) format has changed!");
 			}*/
 
-			_window.FramebufferResized = false;
+			if (_window)
+				_window->FramebufferResized = false;
 		}
 
-		_swapChain = std::make_unique<SwapChain>(_device, _window, config);
+		_swapChain = std::make_unique<SwapChain>(_device, _window.get(), config);
+		// the swap chain and color images are new (their handles can be reused)
+		_renderGraph->clearImportedStates();
 
 		// update camera aspect ratio
 		_camera.setAspectRatio(_swapChain->getAspectRatio());
@@ -955,151 +1778,58 @@ namespace m1
 
 			for (const auto& vertex : obj->Mesh->Vertices)
 			{
-				auto worldPos = glm::vec3(obj->Transform * glm::vec4(vertex.pos, 1.0f));
+				auto worldPos = glm::vec3(obj->getTransform() * glm::vec4(vertex.pos, 1.0f));
 				bbox.merge(worldPos);
 			}
 		}
 		return bbox;
 	}
 
-	glm::mat4 Engine::computeLightViewProjMatrix() const
+	glm::mat4 Engine::computeCascadeViewProjMatrix(const std::array<glm::vec3, 8>& sliceCorners) const
 	{
 		const Light& directionalLight = _lightsUbo.lights[1];
 		glm::vec3 lightDir = glm::normalize(glm::vec3(directionalLight.posDir));
 
-		// fit on scene bounding box
-		auto center = _bbox.getCenter();
-
-		// Create the light view matrix
-		glm::vec3 lightPos = center - lightDir;
+		// the light view only depends on the light direction: the cascades follow the camera by translating their projection
 		glm::vec3 up = glm::abs(glm::dot(lightDir, glm::vec3(0.0f, 0.0f, 1.0f))) > 0.99f
 			? glm::vec3(1.0f, 0.0f, 0.0f) // use x-axis if the light direction is parallel to z-axis
 			: glm::vec3(0.0f, 0.0f, 1.0f);
-		const auto lightView = glm::lookAt(lightPos, center, up);
-
-		float left = -1, right = 1, bottom = -1, top = 1, near = 0, far = 1;
-
-		if (_bbox.min.x <= _bbox.max.x) // Check if the bbox is valid
-		{
-			// transform bbox corners in light view space and find max and min coordinates (AABB)
-			auto corners = _bbox.getCorners();
-
-			float minX = std::numeric_limits<float>::max();
-			float maxX = std::numeric_limits<float>::lowest();
-			float minY = std::numeric_limits<float>::max();
-			float maxY = std::numeric_limits<float>::lowest();
-			float minZ = std::numeric_limits<float>::max();
-			float maxZ = std::numeric_limits<float>::lowest();
-
-			for (const auto& corner : corners)
-			{
-				const auto trf = lightView * glm::vec4(corner, 1.0f);
-				minX = std::min(minX, trf.x);
-				maxX = std::max(maxX, trf.x);
-				minY = std::min(minY, trf.y);
-				maxY = std::max(maxY, trf.y);
-				minZ = std::min(minZ, trf.z);
-				maxZ = std::max(maxZ, trf.z);
-			}
-
-			// make the AABB square around the center
-			float width  = maxX - minX;
-			float height = maxY - minY;
-
-			float extend = std::max(width, height);
-			glm::vec3 centerLightSpace = lightView * glm::vec4(center, 1.0f);
-
-			left = centerLightSpace.x - extend * 0.5f;
-			right = centerLightSpace.x + extend * 0.5f;
-
-			bottom = centerLightSpace.y - extend * 0.5f;
-			top = centerLightSpace.y + extend * 0.5f;
-
-			near = minZ;
-			far = maxZ;
-		}
-
-		// Build ortho projection that encloses the frustum in light space
-		glm::mat4 lightProj = orthoProjection(left, right, bottom, top, near, far);
-
-		return lightProj * lightView;
-
-		/*
-			// Compute light view-projection matrix that tightly fits the camera view frustum (https://learnopengl.com/Guest-Articles/2021/CSM)
-			// Steps:
-			// 1. Extract camera frustum corners and center in world space
-			// 2. Transform those corners into light space
-			// 3. Compute an orthographic projection that encloses those points
-
-
-		// Camera matrices
-		auto camView = _camera.getViewMatrix();
-		auto camProj = _camera.getProjectionMatrix();
-
-		// We need the inverse of view*proj to transform NDC cube corners in world space
-		glm::mat4 invViewProj = glm::inverse(camProj * camView);
-
-		// compute frustum corners in world space
-		std::vector<glm::vec4> frustumCornersWorld;
-		for (unsigned int x = 0; x < 2; ++x)
+		const auto lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+
+		// bounding sphere of the slice, rounded up: the precision errors don't change the size of the texels
+		glm::vec3 center(0.0f);
+		for (const auto& corner : sliceCorners)
+			center += corner;
+		center /= static_cast<float>(sliceCorners.size());
+		float radius = 0.0f;
+		for (const auto& corner : sliceCorners)
+			radius = std::max(radius, glm::distance(center, corner));
+		radius = std::max(std::ceil(radius * 16.0f) / 16.0f, 1.0f / 16.0f);
+
+		// snap the center to the texels of the layer: the casters are rasterized the same way while the camera moves
+		glm::vec3 centerLightSpace = lightView * glm::vec4(center, 1.0f);
+		float texelSize = 2.0f * radius / static_cast<float>(SHADOW_MAP_RESOLUTION.width);
+		centerLightSpace.x = std::floor(centerLightSpace.x / texelSize) * texelSize;
+		centerLightSpace.y = std::floor(centerLightSpace.y / texelSize) * texelSize;
+
+		// depth range of the slice and of the scene: the casters between the light and the slice are not clipped
+		float minZ = centerLightSpace.z - radius;
+		float maxZ = centerLightSpace.z + radius;
+		if (_bbox.isValid())
 		{
-			for (unsigned int y = 0; y < 2; ++y)
+			for (const auto& corner : _bbox.getCorners())
 			{
-				for (unsigned int z = 0; z < 2; ++z)
-				{
-					const glm::vec4 pt =
-						invViewProj * glm::vec4(
-							2.0f * x - 1.0f,
-							2.0f * y - 1.0f,
-							static_cast<float>(z), // depth [0, 1]
-							1.0f);
-					frustumCornersWorld.push_back(pt / pt.w);
-				}
+				float z = (lightView * glm::vec4(corner, 1.0f)).z;
+				minZ = std::min(minZ, z);
+				maxZ = std::max(maxZ, z);
 			}
 		}
 
-		// Compute the center of the frustum
-		auto frustumCenterWorld = glm::vec3(0.0f);
-		for (const auto &c : frustumCornersWorld) frustumCenterWorld += glm::vec3(c);
-		frustumCenterWorld /= 8.0f;
-
-		// Create the light view matrix
-		glm::vec3 lightPos = frustumCenterWorld - lightDir;
-		glm::vec3 up = glm::abs(glm::dot(lightDir, glm::vec3(0.0f, 0.0f, 1.0f))) > 0.99f
-			? glm::vec3(1.0f, 0.0f, 0.0f) // use this if the light direction is parallel to z axis
-			: glm::vec3(0.0f, 0.0f, 1.0f);
-		const auto lightView = glm::lookAt(lightPos, frustumCenterWorld, up);
-
-		// gets min and max in light view space
-		float minX = std::numeric_limits<float>::max();
-		float maxX = std::numeric_limits<float>::lowest();
-		float minY = std::numeric_limits<float>::max();
-		float maxY = std::numeric_limits<float>::lowest();
-		float minZ = std::numeric_limits<float>::max();
-		float maxZ = std::numeric_limits<float>::lowest();
-
-		// 1. Consider camera frustum corners
-		for (const auto& v : frustumCornersWorld)
-		{
-			const auto trf = lightView * v;
-			minX = std::min(minX, trf.x);
-			maxX = std::max(maxX, trf.x);
-			minY = std::min(minY, trf.y);
-			maxY = std::max(maxY, trf.y);
-			minZ = std::min(minZ, trf.z);
-			maxZ = std::max(maxZ, trf.z);
-		}
-
-		// extend near/far (not only geometry which is in the frustum can cast shadows on a surface in the frustum!)
-		constexpr float zMult = 10.0f; // Tune this parameter according to the scene
-		if (minZ < 0) minZ *= zMult; else minZ /= zMult;
-		if (maxZ < 0) maxZ /= zMult; else maxZ *= zMult;
-
-		// Build ortho projection that encloses the frustum in light space
-		glm::mat4 lightProj = orthoProjection(minX, maxX, minY, maxY, minZ, maxZ);
+		// the light looks towards -z: near and far are the distances of the max and min z
+		glm::mat4 lightProj = orthoProjection(centerLightSpace.x - radius, centerLightSpace.x + radius,
+			centerLightSpace.y - radius, centerLightSpace.y + radius, -maxZ, -minZ);
 
 		return lightProj * lightView;
-		*/
 	}
 
 	void Engine::createEnvironmentTextures()
@@ -1119,6 +1849,7 @@ namespace m1
 			.usage = getTextureImageUsageFlags() | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 			.mipLevels = 1,// Texture::computeMipLevels(ENVIRONMENT_CUBEMAP_RESOLUTION.width, ENVIRONMENT_CUBEMAP_RESOLUTION.height),
 			.arrayLayers = 6,
+			.sharing = QueueSharing::Upload, // baked by the graphics queue or loaded from the IBL cache by the upload batcher
 		};
 		auto envCubemapImage = std::make_shared<Image>(_device, imageParams);
 
@@ -1133,6 +1864,7 @@ namespace m1
 			.usage = getTextureImageUsageFlags() | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 			.mipLevels = 1,
 			.arrayLayers = 6,
+			.sharing = QueueSharing::Upload,
 		};
 		auto irradianceCubemapImage = std::make_shared<Image>(_device, imageParams);
 		_irradianceCubemap = std::make_unique<Texture>(_device, std::move(irradianceCubemapImage), sampler);
@@ -1146,6 +1878,7 @@ namespace m1
 			.usage = getTextureImageUsageFlags() | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 			.mipLevels = PREFILTERED_ENV_CUBEMAP_MIP_LEVELS,
 			.arrayLayers = 6,
+			.sharing = QueueSharing::Upload,
 		};
 		auto prefilterEnvCubemapImage = std::make_shared<Image>(_device, imageParams);
 		_prefilteredEnvCubemap = std::make_unique<Texture>(_device, std::move(prefilterEnvCubemapImage), sampler);
@@ -1156,7 +1889,8 @@ namespace m1
 			.extent = BRDF_LUT_RESOLUTION,
 			.format = BRDF_LUT_FORMAT,
 			.usage = getTextureImageUsageFlags() | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-			.mipLevels = 1
+			.mipLevels = 1,
+			.sharing = QueueSharing::Upload,
 		};
 		auto brdfImage = std::make_shared<Image>(_device, imageParams);
 		_brdfLUT = std::make_unique<Texture>(_device, std::move(brdfImage), sampler);
@@ -1178,6 +1912,7 @@ namespace m1
 			.format = shadowImageFormat,
 			.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 			.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+			.arrayLayers = MAX_SHADOW_CASCADES, // one layer for each cascade
 			.memoryProps = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, // dedicated allocation for special, big resources, like fullscreen images used as attachments
 		};
 
@@ -1202,26 +1937,54 @@ namespace m1
 
 		// create the shadow map texture
 		_shadowMap = std::make_unique<Texture>(_device, std::move(shadowMapImage), std::move(shadowSampler));
+		_shadowCascades = {}; // nothing cached in the new layers
 	}
 
-	void Engine::recordShadowMappingPass(VkCommandBuffer commandBuffer) const
+	void Engine::recordShadowMappingPass(VkCommandBuffer commandBuffer)
 	{
 		Image& shadowMapImage = _shadowMap->getImage();
+		auto extent = shadowMapImage.getExtent();
 
-		// transition the layout to DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-		transitionImageLayout(commandBuffer, shadowMapImage.getVkImage(), 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
+		// one rendering for each stale cascade, into its layer
+		for (uint32_t cascade = 0; cascade < MAX_SHADOW_CASCADES; cascade++)
+		{
+			if (!(_shadowCascadeMask & (1u << cascade)))
+				continue;
 
-		auto extent = shadowMapImage.getExtent();
+			// the layer holds the casters seen through the projection of this frame
+			_shadowCascades[cascade].cachedViewProj = _shadowCascades[cascade].viewProj;
+			_shadowCascades[cascade].cached = true;
 
-		// set depth attachment
-		VkRenderingAttachmentInfo depthAttachment = createDepthAttachment(shadowMapImage.getVkImageView());
+			// set depth attachment
+			VkRenderingAttachmentInfo depthAttachment = createDepthAttachment(shadowMapImage.getSubresourceVkImageView(cascade, 0));
 
-		// begin rendering
-		beginRendering(commandBuffer, {{0, 0}, extent}, 0, nullptr, &depthAttachment);
+			// draws recorded by the worker threads
+			if (!_shadowPassCommands[cascade].empty())
+			{
+				beginRendering(commandBuffer, {{0, 0}, extent}, 0, nullptr, &depthAttachment, VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT);
+				ParallelCommandRecorder::execute(commandBuffer, _shadowPassCommands[cascade]);
+				endRendering(commandBuffer);
+				continue;
+			}
 
-		// set dynamic states
-		setDynamicStates(commandBuffer, extent);
+			// begin rendering
+			beginRendering(commandBuffer, {{0, 0}, extent}, 0, nullptr, &depthAttachment);
+
+			// set dynamic states
+			setDynamicStates(commandBuffer, extent);
 
+			if (_config.gpuDrivenEnabled)
+				drawObjectsIndirect(commandBuffer, 1 + cascade);
+			else
+				drawShadowCasters(commandBuffer, cascade, 0, static_cast<uint32_t>(_shadowDrawLists[cascade].getItems().size()));
+
+			// end rendering
+			endRendering(commandBuffer);
+		}
+	}
+
+	void Engine::drawShadowCasters(VkCommandBuffer commandBuffer, uint32_t cascade, uint32_t first, uint32_t count) const
+	{
 		// bind shadow mapping pipeline
 		Pipeline* pipeline = _graphicsPipelines.at(PipelineType::ShadowMapping).get();
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getVkPipeline());
@@ -1230,32 +1993,37 @@ namespace m1
 		VkDescriptorSet descriptorSet = _framesData[_currentFrame]->frameDescriptorSet;
 		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getLayout(), 0, 1, &descriptorSet, 0, nullptr);
 
-		// draw objects loop
-		for (auto &obj: _sceneObjects)
+		// layer of the shadow map
+		ShadowPushConstantData push{ .cascadeIndex = cascade };
+		vkCmdPushConstants(commandBuffer, pipeline->getLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowPushConstantData), &push);
+
+		// draw objects loop (only the objects inside the light frustum of the cascade), one instanced draw for each mesh
+		std::optional<uint32_t> currentGeometryBlock;
+		auto items = std::span(_shadowDrawLists[cascade].getItems()).subspan(first, count);
+		for (size_t i = 0; i < items.size();)
 		{
-			// push constants
-			PushConstantData push
-			{
-				.model = obj->Transform,
-				.normalMatrix = glm::transpose(glm::inverse(obj->Transform))
-			};
-			vkCmdPushConstants(commandBuffer, pipeline->getLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &push);
+			const auto& obj = _sceneObjects[items[i].objectIndex];
 
-			// draw the mesh
-			obj->Mesh->draw(commandBuffer);
+			// draw the mesh (the geometry pool buffers are bound only when the block changes)
+			uint32_t geometryBlock = obj->Mesh->getGeometry().block;
+			if (geometryBlock != currentGeometryBlock)
+			{
+				currentGeometryBlock = geometryBlock;
+				_geometryPool->bind(commandBuffer, geometryBlock);
+			}
+			uint32_t instanceCount = countInstances(items, i);
+			obj->Mesh->drawIndexed(commandBuffer, instanceCount, getShadowInstancesOffset(cascade) + first + static_cast<uint32_t>(i),
+				DrawList::getLod(items[i].key));
+			i += instanceCount;
 		}
-
-		// end rendering
-		endRendering(commandBuffer);
-
-		// transition layout SHADER_READ_ONLY_OPTIMAL
-		transitionImageLayout(commandBuffer, shadowMapImage.getVkImage(), 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
 	}
 
 	void Engine::createPipelines()
 	{
 		_graphicsPipelines.clear();
 		_computePipeline.reset();
+		_cullingPipeline.reset();
+		_meshletCullingPipeline.reset();
 
 		auto shadersPath = std::string(PROJECT_SOURCE_DIR) + "/shaders/compiled/";
 
@@ -1264,65 +2032,74 @@ namespace m1
 		builder.addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::Frame))
 		       .setDepthAttachmentFormat(_shadowMap->getImage().getFormat())
 		       .addShaderStage(shadersPath + "shadow.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
+		       .setVertexFormat(_config.vertexFormat, true)
+		       .addPushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowPushConstantData)) // cascade
 		       // front face culling to fix peter panning artifacts, but works only for 3D solid objects, not for planes/surfaces
 		       .setCullModeFlags(VK_CULL_MODE_FRONT_BIT);
-		_graphicsPipelines.emplace(PipelineType::ShadowMapping, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::ShadowMapping, builder.build(_device, _pipelineCache.get()));
 
 		// No lights
 		builder = {};
 		builder.addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::Frame))
 		       .addColorAttachment(_swapChain->getSwapChainImageFormat())
-		       .setDepthAttachmentFormat(_swapChain->getDepthImage().getFormat())
+		       .setDepthAttachmentFormat(_swapChain->getDepthFormat())
 		       .addShaderStage(shadersPath + "noLight.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
+		       .setVertexFormat(_config.vertexFormat)
 		       .addShaderStage(shadersPath + "noLight.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 		       .setSamples(_swapChain->getSamples());
-		_graphicsPipelines.emplace(PipelineType::NoLight, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::NoLight, builder.build(_device, _pipelineCache.get()));
 
 		// PhongLighting
 		builder = {};
 		builder.addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::Frame)) // set 0
 		       .addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::MaterialPhong)) // set 1
 			   .addColorAttachment(_swapChain->getSwapChainImageFormat())
-			   .setDepthAttachmentFormat(_swapChain->getDepthImage().getFormat())
+			   .setDepthAttachmentFormat(_swapChain->getDepthFormat())
 			   .addShaderStage(shadersPath + "phong.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
+			   .setVertexFormat(_config.vertexFormat)
+			   // packed normals and tangents are decoded in the vertex shader
+			   .setSpecializationConstant(VK_SHADER_STAGE_VERTEX_BIT, 1, _config.vertexFormat == VertexFormat::Packed)
 			   .addShaderStage(shadersPath + "phong.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 			   .setSamples(_swapChain->getSamples());
-		_graphicsPipelines.emplace(PipelineType::PhongLighting, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::PhongLighting, builder.build(_device, _pipelineCache.get()));
 
 		// PbrLighting
 		builder = {};
 		builder.addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::Frame)) // set 0
 			   .addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::MaterialPbr)) // set 1
 			   .addColorAttachment(_swapChain->getSwapChainImageFormat())
-			   .setDepthAttachmentFormat(_swapChain->getDepthImage().getFormat())
+			   .setDepthAttachmentFormat(_swapChain->getDepthFormat())
 			   .addShaderStage(shadersPath + "pbr.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
+			   .setVertexFormat(_config.vertexFormat)
+			   // packed normals and tangents are decoded in the vertex shader
+			   .setSpecializationConstant(VK_SHADER_STAGE_VERTEX_BIT, 1, _config.vertexFormat == VertexFormat::Packed)
 			   .addShaderStage(shadersPath + "pbr.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 			   .setSamples(_swapChain->getSamples());
-		_graphicsPipelines.emplace(PipelineType::PbrLighting, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::PbrLighting, builder.build(_device, _pipelineCache.get()));
 
 		// Particles
 		builder = {};
 		builder.addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::Frame)) // set 0
 			   .addColorAttachment(_swapChain->getSwapChainImageFormat())
-			   .setDepthAttachmentFormat(_swapChain->getDepthImage().getFormat())
+			   .setDepthAttachmentFormat(_swapChain->getDepthFormat())
 			   .addShaderStage(shadersPath + "particle.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
 			   .addShaderStage(shadersPath + "particle.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 			   .setPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_POINT_LIST)
 			   .setSamples(_swapChain->getSamples());
-		_graphicsPipelines.emplace(PipelineType::Particles, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::Particles, builder.build(_device, _pipelineCache.get()));
 
 		// SkyBox
 		builder = {};
 		builder.addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::OneSampler)) // set 0
 			   .addColorAttachment(_swapChain->getSwapChainImageFormat())
-			   .setDepthAttachmentFormat(_swapChain->getDepthImage().getFormat())
+			   .setDepthAttachmentFormat(_swapChain->getDepthFormat())
 			   .clearVertexInput()
 			   .addShaderStage(shadersPath + "skyBox.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
 			   .addShaderStage(shadersPath + "skyBox.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 			   .setDepthCompareOp(VK_COMPARE_OP_LESS_OR_EQUAL)
 			   .clearPushConstantRanges().addPushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(IblPushConstantData))
 			   .setSamples(_swapChain->getSamples());
-		_graphicsPipelines.emplace(PipelineType::SkyBox, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::SkyBox, builder.build(_device, _pipelineCache.get()));
 
 		// Equirect to cube map
 		builder = {};
@@ -1332,7 +2109,7 @@ namespace m1
 			   .addShaderStage(shadersPath + "cubeNDC.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
 			   .addShaderStage(shadersPath + "equirectToCube.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 			   .clearPushConstantRanges().addPushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(IblPushConstantData));
-		_graphicsPipelines.emplace(PipelineType::EquirectToCube, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::EquirectToCube, builder.build(_device, _pipelineCache.get()));
 
 		// Irradiance convolution
 		builder = {};
@@ -1342,7 +2119,7 @@ namespace m1
 			   .addShaderStage(shadersPath + "cubeNDC.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
 			   .addShaderStage(shadersPath + "irradianceConvolution.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 			   .clearPushConstantRanges().addPushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(IblPushConstantData));
-		_graphicsPipelines.emplace(PipelineType::IrradianceConvolution, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::IrradianceConvolution, builder.build(_device, _pipelineCache.get()));
 
 		// Prefilter env
 		builder = {};
@@ -1352,7 +2129,7 @@ namespace m1
 			   .addShaderStage(shadersPath + "cubeNDC.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
 			   .addShaderStage(shadersPath + "prefilterEnv.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 			   .clearPushConstantRanges().addPushConstantRange(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(IblPushConstantData));
-		_graphicsPipelines.emplace(PipelineType::PrefilterEnv, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::PrefilterEnv, builder.build(_device, _pipelineCache.get()));
 
 		// BRDF LUT
 		builder = {};
@@ -1362,41 +2139,42 @@ namespace m1
 			   .addShaderStage(shadersPath + "quadNDC.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
 			   .addShaderStage(shadersPath + "brdfLUT.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 			   .clearPushConstantRanges();
-		_graphicsPipelines.emplace(PipelineType::BrdfLUT, builder.build(_device));
+		_graphicsPipelines.emplace(PipelineType::BrdfLUT, builder.build(_device, _pipelineCache.get()));
 
 		// Compute
 		ComputePipelineBuilder computeBuilder{};
 		computeBuilder.addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::ComputeParticles))
 		              .setShader(shadersPath + "particle.comp.spv");
-		_computePipeline = computeBuilder.build(_device);
+		_computePipeline = computeBuilder.build(_device, _pipelineCache.get());
+
+		// GPU-driven culling
+		computeBuilder = {};
+		computeBuilder.addSetLayout(_descriptorSetManager->getDescriptorSetLayout(DescriptorSetLayoutType::ComputeCulling))
+		              .addPushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullingPushConstantData))
+		              .setShader(shadersPath + "cull.comp.spv");
+		_cullingPipeline = computeBuilder.build(_device, _pipelineCache.get());
+
+		computeBuilder.setShader(shadersPath + "meshletCull.comp.spv");
+		_meshletCullingPipeline = computeBuilder.build(_device, _pipelineCache.get());
 	}
 
 	void Engine::createFramesResources()
 	{
 		Log::Get().Info("Creating frame resources");
 
-		// one FrameData for each FRAMES_IN_FLIGHT to don't share resources between frames
-		_framesData.resize(FRAMES_IN_FLIGHT);
+		// one FrameData for each frame in flight to don't share resources between frames
+		_framesData.resize(_framesInFlight);
 		VkDeviceSize frameUboSize = sizeof(FrameUbo);
-		VkDeviceSize objectUboSize = sizeof(ObjectUbo);
-
-		// Fence create info
-		VkFenceCreateInfo fenceInfo{};
-		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // start in signaled state, to don't block the first frame
-
-		// Semaphore create info
-		VkSemaphoreCreateInfo semaphoreInfo{};
-		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
 		// allocate descriptor sets and command buffers
-		auto descriptorSets = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::Frame, FRAMES_IN_FLIGHT);
-		auto skyBoxDescriptorSets = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::OneSampler, FRAMES_IN_FLIGHT);
-		auto computeParticlesDescSet = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::ComputeParticles, FRAMES_IN_FLIGHT);
-		auto drawSceneCmdBuffers = _device.getGraphicsQueue().getPersistentCommandPool().allocateCommandBuffers(FRAMES_IN_FLIGHT);
-		auto computeCmdBuffers = _device.getComputeQueue().getPersistentCommandPool().allocateCommandBuffers(FRAMES_IN_FLIGHT);
-
-		for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+		auto descriptorSets = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::Frame, _framesInFlight);
+		auto skyBoxDescriptorSets = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::OneSampler, _framesInFlight);
+		auto computeParticlesDescSet = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::ComputeParticles, _framesInFlight);
+		auto cullingDescSets = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::ComputeCulling, _framesInFlight);
+		auto drawSceneCmdBuffers = _device.getGraphicsQueue().getPersistentCommandPool().allocateCommandBuffers(_framesInFlight);
+		auto computeCmdBuffers = _device.getComputeQueue().getPersistentCommandPool().allocateCommandBuffers(_framesInFlight);
+
+		for (size_t i = 0; i < _framesInFlight; i++)
 		{
 			// VK_MEMORY_PROPERTY_HOST_COHERENT_BIT: ensures that writes to the mapped memory by the host are automatically visible to the driver (no need for an explicit flush)
 			// persistent mapping because we need to update it every frame
@@ -1405,26 +2183,13 @@ namespace m1
 			auto frameUboBuffer = std::make_unique<Buffer>(_device, frameUboSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 				VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT); // persistent mapping
 
-			// create object ubo
-			auto objectUboBuffer = std::make_unique<Buffer>(_device, objectUboSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT); // persistent mapping
-
-			// create synchronization objects
-			VkFence drawFence, computeFence;
-			VkSemaphore computeSem;
-            VK_CHECK(vkCreateFence(_device.getVkDevice(), &fenceInfo, nullptr, &drawFence));
-            VK_CHECK(vkCreateFence(_device.getVkDevice(), &fenceInfo, nullptr, &computeFence));
-            VK_CHECK(vkCreateSemaphore(_device.getVkDevice(), &semaphoreInfo, nullptr, &computeSem));
-
 			// create the frame data
-			_framesData[i] = std::make_unique<FrameData> (std::move(frameUboBuffer), std::move(objectUboBuffer), descriptorSets[i],
-				drawFence, drawSceneCmdBuffers[i]);
+			_framesData[i] = std::make_unique<FrameData> (std::move(frameUboBuffer), descriptorSets[i], drawSceneCmdBuffers[i]);
 
 			_framesData[i]->skyBoxDescriptorSet = skyBoxDescriptorSets[i];
 			_framesData[i]->computeParticleDescriptorSet = computeParticlesDescSet[i];
+			_framesData[i]->cullingDescriptorSet = cullingDescSets[i];
 
-			_framesData[i]->computeCmdExecutedFence = computeFence;
-			_framesData[i]->computeCmdExecutedSem = computeSem;
 			_framesData[i]->computeCmdBuffer = computeCmdBuffers[i];
 		}
 	}
@@ -1452,21 +2217,18 @@ namespace m1
 
 		VkDeviceSize bufferSize = sizeof(Particle) * PARTICLES_COUNT;
 
-		// Create a staging buffer accessible to CPU to upload the data
-		Buffer stagingBuffer{ _device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT };
-
-		// Copy data to the staging buffer
-		stagingBuffer.copyDataToBuffer(particles.data());
-
-		for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+		for (size_t i = 0; i < _framesInFlight; i++)
 		{
 			// create the SSBO buffer
 			// VK_BUFFER_USAGE_STORAGE_BUFFER_BIT: to be read and write in the compute shader
 			// VK_BUFFER_USAGE_VERTEX_BUFFER_BIT: to be used in the vertex shader
-			_framesData[i]->particleSSboBuffer = std::make_unique<Buffer>(_device, bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+			// written by the compute queue and read by the graphics queue (synchronized by the timeline semaphores):
+			// concurrent sharing avoids the ownership transfers
+			_framesData[i]->particleSSboBuffer = std::make_unique<Buffer>(_device, bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				0, QueueSharing::UploadAndCompute);
 
-			// Copy staging buffer to SSBO buffer
-			copyBuffer(_device, stagingBuffer, *_framesData[i]->particleSSboBuffer, bufferSize);
+			// upload the particles to the SSBO buffer
+			_uploadBatcher->uploadBuffer(*_framesData[i]->particleSSboBuffer, particles.data(), bufferSize);
 		}
 	}
 
@@ -1488,10 +2250,11 @@ namespace m1
 
 		// Create the lights ubo with device local memory for better performance
 		VkDeviceSize lightsUboSize = sizeof(LightsUbo);
-        _lightsUboBuffer = std::make_unique<Buffer>(_device, lightsUboSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+        _lightsUboBuffer = std::make_unique<Buffer>(_device, lightsUboSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        	0, QueueSharing::Upload);
 
 		// upload lights data to buffer
-		uploadToDeviceBuffer(_device, *_lightsUboBuffer, lightsUboSize, &_lightsUbo);
+		_uploadBatcher->uploadBuffer(*_lightsUboBuffer, &_lightsUbo, lightsUboSize);
 	}
 
 	void Engine::updateDescriptorSets() const
@@ -1505,16 +2268,13 @@ namespace m1
 		VkDescriptorImageInfo brdfLUTImageInfo = _brdfLUT->getVkDescriptorImageInfo();
 
 	    // update each DescriptorSet
-	    for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+	    for (size_t i = 0; i < _framesInFlight; i++)
 	    {
 	    	auto& frameResources = _framesData[i];
 
 			//---------- FRAME DESCRIPTOR SET ---------------//
 	    	auto frameDescriptorSet = frameResources->frameDescriptorSet;
 
-		    auto objectUboInfo = frameResources->objectUboBuffer->getVkDescriptorBufferInfo();
-			auto objectUboWrite = initVkWriteDescriptorSet(frameDescriptorSet, 0,  VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &objectUboInfo);
-
 	    	auto frameUboInfo = frameResources->frameUboBuffer->getVkDescriptorBufferInfo();
 	    	auto frameUboWrite = initVkWriteDescriptorSet(frameDescriptorSet, 1,  VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &frameUboInfo);
 
@@ -1526,7 +2286,7 @@ namespace m1
 
 		    std::array descriptorWrites =
 		    {
-			    objectUboWrite, frameUboWrite, lightsUboWrite, shadowMapWrite, irradianceMapWrite, prefilteredMapWrite, brdfLUTMapWrite
+			    frameUboWrite, lightsUboWrite, shadowMapWrite, irradianceMapWrite, prefilteredMapWrite, brdfLUTMapWrite
 		    };
 
 		    vkUpdateDescriptorSets(_device.getVkDevice(), descriptorWrites.size(),
@@ -1536,7 +2296,7 @@ namespace m1
 	    	auto particleDescriptorSet = frameResources->computeParticleDescriptorSet;
 	    	// Particles Ssbo previous frame
 	    	VkDescriptorBufferInfo particlesSsboInfoPrevFrame{};
-	    	particlesSsboInfoPrevFrame.buffer = _framesData[(i - 1) % FRAMES_IN_FLIGHT]->particleSSboBuffer->getVkBuffer();
+	    	particlesSsboInfoPrevFrame.buffer = _framesData[(i + _framesInFlight - 1) % _framesInFlight]->particleSSboBuffer->getVkBuffer();
 	    	particlesSsboInfoPrevFrame.offset = 0;
 	    	particlesSsboInfoPrevFrame.range = sizeof(Particle) * PARTICLES_COUNT;
 
@@ -1575,6 +2335,12 @@ namespace m1
     }
 
 	void Engine::updateMaterialDescriptorSets(const Material& material) const
+	{
+		for (uint32_t i = 0; i < _framesInFlight; i++)
+			updateMaterialDescriptorSet(material, i);
+	}
+
+	void Engine::updateMaterialDescriptorSet(const Material& material, uint32_t frameIndex) const
 	{
 		VkDescriptorImageInfo baseColorImageInfo = material.baseColorMap->getVkDescriptorImageInfo();
 		VkDescriptorImageInfo specularImageInfo = material.specularMap->getVkDescriptorImageInfo();
@@ -1583,69 +2349,118 @@ namespace m1
 		VkDescriptorImageInfo occlusionImageInfo = material.occlusionMap->getVkDescriptorImageInfo();
 		VkDescriptorImageInfo emissiveImageInfo = material.emissiveMap->getVkDescriptorImageInfo();
 
-		for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++)
-		{
-			auto& frameResources = _framesData[i];
+		auto& frameResources = _framesData[frameIndex];
 
-			//---------- PHONG DESCRIPTOR SET ---------------//
-			VkDescriptorBufferInfo materialDynUboInfo = frameResources->materialPhongDynUboBuffer->getVkDescriptorBufferInfo();
-			materialDynUboInfo.range = _materialPhongUboAlignment;
+		//---------- PHONG DESCRIPTOR SET ---------------//
+		VkDescriptorBufferInfo materialDynUboInfo = frameResources->materialPhongDynUboBuffer->getVkDescriptorBufferInfo();
+		materialDynUboInfo.range = _materialPhongUboAlignment;
 
-			auto materialDynUboWrite = initVkWriteDescriptorSet(material.descriptorSetPhong, 0,
-				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &materialDynUboInfo);
+		auto materialDynUboWrite = initVkWriteDescriptorSet(material.descriptorSetsPhong[frameIndex], 0,
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &materialDynUboInfo);
 
-			auto diffuseTextDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetPhong, 1,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &baseColorImageInfo);
+		auto diffuseTextDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetsPhong[frameIndex], 1,
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &baseColorImageInfo);
 
-			auto specularDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetPhong, 2,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &specularImageInfo);
+		auto specularDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetsPhong[frameIndex], 2,
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &specularImageInfo);
 
-			std::array descriptorWrites =
-			{
-				materialDynUboWrite, diffuseTextDescriptorWrite, specularDescriptorWrite
-			};
+		std::array descriptorWrites =
+		{
+			materialDynUboWrite, diffuseTextDescriptorWrite, specularDescriptorWrite
+		};
+
+		vkUpdateDescriptorSets(_device.getVkDevice(), descriptorWrites.size(),
+							   descriptorWrites.data(), 0, nullptr);
+
+		//---------- PBR DESCRIPTOR SET ---------------//
+		VkDescriptorBufferInfo materialPbrDynUboInfo = frameResources->materialPbrDynUboBuffer->getVkDescriptorBufferInfo();
+		materialPbrDynUboInfo.range = _materialPbrUboAlignment;
 
-			vkUpdateDescriptorSets(_device.getVkDevice(), descriptorWrites.size(),
-								   descriptorWrites.data(), 0, nullptr);
+		auto materialPbrDynUboWrite = initVkWriteDescriptorSet(material.descriptorSetsPbr[frameIndex], 0,
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &materialPbrDynUboInfo);
 
-			//---------- PBR DESCRIPTOR SET ---------------//
-			VkDescriptorBufferInfo materialPbrDynUboInfo = frameResources->materialPbrDynUboBuffer->getVkDescriptorBufferInfo();
-			materialPbrDynUboInfo.range = _materialPbrUboAlignment;
+		auto baseColorDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetsPbr[frameIndex], 1,
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &baseColorImageInfo);
 
-			auto materialPbrDynUboWrite = initVkWriteDescriptorSet(material.descriptorSetPbr, 0,
-				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &materialPbrDynUboInfo);
+		auto normalDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetsPbr[frameIndex], 2,
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &normalImageInfo);
 
-			auto baseColorDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetPbr, 1,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &baseColorImageInfo);
+		auto metallicRoughnessDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetsPbr[frameIndex], 3,
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &metallicRoughnessImageInfo);
 
-			auto normalDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetPbr, 2,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &normalImageInfo);
+		auto aoDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetsPbr[frameIndex], 4,
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &occlusionImageInfo);
 
-			auto metallicRoughnessDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetPbr, 3,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &metallicRoughnessImageInfo);
+		auto emissiveDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetsPbr[frameIndex], 5,
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &emissiveImageInfo);
 
-			auto aoDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetPbr, 4,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &occlusionImageInfo);
+		std::array descriptorPbrWrites =
+		{
+			materialPbrDynUboWrite, baseColorDescriptorWrite, normalDescriptorWrite, metallicRoughnessDescriptorWrite,
+			aoDescriptorWrite, emissiveDescriptorWrite
+		};
+
+		vkUpdateDescriptorSets(_device.getVkDevice(), descriptorPbrWrites.size(),
+			descriptorPbrWrites.data(), 0, nullptr);
+	}
 
-			auto emissiveDescriptorWrite = initVkWriteDescriptorSet(material.descriptorSetPbr, 5,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &emissiveImageInfo);
+	void Engine::deduplicateMeshes()
+	{
+		/*
+			Meshes are deduplicated by content (vertices, indices and material name), e.g. the ones created by
+			Mesh::createCube with the same parameters: the hash selects the candidates, then the content is compared.
+			A mesh already shared by several objects is hashed only once
+		*/
+		std::unordered_map<uint64_t, std::vector<std::shared_ptr<Mesh>>> meshesByHash;
+		std::unordered_map<const Mesh*, std::shared_ptr<Mesh>> sharedMeshes; // visited mesh => mesh replacing it
+		uint32_t replacedCount = 0;
 
-			std::array descriptorPbrWrites =
+		for (auto& obj : _sceneObjects)
+		{
+			auto shared = sharedMeshes.find(obj->Mesh.get());
+			if (shared == sharedMeshes.end())
 			{
-				materialPbrDynUboWrite, baseColorDescriptorWrite, normalDescriptorWrite, metallicRoughnessDescriptorWrite,
-				aoDescriptorWrite, emissiveDescriptorWrite
-			};
+				const Mesh& mesh = *obj->Mesh;
+				const auto& materialName = mesh.getMaterialName();
+				uint64_t hash = hashBytes(mesh.Vertices.data(), mesh.Vertices.size() * sizeof(Vertex));
+				hash = hashBytes(mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t), hash);
+				hash = hashBytes(materialName.data(), materialName.size(), hash);
+
+				auto& candidates = meshesByHash[hash];
+				auto it = std::ranges::find_if(candidates, [&mesh](const auto& candidate)
+				{
+					return candidate->Vertices == mesh.Vertices && candidate->Indices == mesh.Indices &&
+						candidate->getMaterialName() == mesh.getMaterialName();
+				});
+				if (it == candidates.end())
+					it = candidates.insert(candidates.end(), obj->Mesh);
+
+				shared = sharedMeshes.emplace(obj->Mesh.get(), *it).first;
+			}
 
-			vkUpdateDescriptorSets(_device.getVkDevice(), descriptorPbrWrites.size(),
-				descriptorPbrWrites.data(), 0, nullptr);
+			if (shared->second != obj->Mesh)
+			{
+				obj->setMesh(shared->second);
+				replacedCount++;
+			}
 		}
+
+		if (replacedCount > 0)
+			Log::Get().Info(std::format("Mesh deduplication: {} objects share the mesh of another object", replacedCount));
 	}
 
 	void Engine::compileSceneObjects() const
 	{
 		for (auto &obj: _sceneObjects)
 		{
-			obj->Mesh->compile(_device);
+			obj->Mesh->compile(*_geometryPool);
+
+			// resolve the material name once, the draw loop only uses the material id
+			const auto& materialName = obj->Mesh->getMaterialName();
+			auto it = _materialIds.find(materialName);
+			if (!materialName.empty() && it == _materialIds.end())
+				Log::Get().Warning("Material " + materialName + " not found, using the default material");
+			obj->Mesh->setMaterialId(it != _materialIds.end() ? it->second : 0);
 		}
 	}
 
@@ -1656,7 +2471,7 @@ namespace m1
 				(one dynUboBuffer for each frame in flight)
 			- allocate and update a descriptorSet for each Material
 				(they use the same dynamic ubo buffer but textures are different for each material)
-				(descriptorSet are shared between frame in flight because only read operations)
+				(one for each frame in flight: the streamed textures replace their image while the previous frames are rendering)
 		*/
 
 		size_t materialCount = _materials.size() + 1; // +1 is default material
@@ -1667,7 +2482,7 @@ namespace m1
 		materialUbos.emplace_back(*_defaultMaterial);
 		materialPbrUbos.emplace_back(*_defaultMaterial);
 
-		for (const auto& material: _materials | std::views::values)
+		for (const auto& material: _materials)
 		{
 			materialUbos.emplace_back(*material);
 			materialPbrUbos.emplace_back(*material);
@@ -1676,15 +2491,16 @@ namespace m1
 		// Create the material dynamic ubo buffers, one for each frame in flight
 		size_t materialUboSize = materialCount * _materialPhongUboAlignment;
 		size_t materialPbrUboSize = materialCount * _materialPbrUboAlignment;
-		for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+		for (size_t i = 0; i < _framesInFlight; i++)
 		{
 			// === Bling-Phong ===
 
 			// create material dyn buffer
-			auto materialDynUboBuffer = std::make_unique<Buffer>(_device, materialUboSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+			auto materialDynUboBuffer = std::make_unique<Buffer>(_device, materialUboSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				0, QueueSharing::Upload);
 
 			// copy material ubos array to the dynamic buffer
-			uploadToDeviceBuffer(_device, *materialDynUboBuffer, materialUboSize, materialUbos.data());
+			_uploadBatcher->uploadBuffer(*materialDynUboBuffer, materialUbos.data(), materialUboSize);
 
 			// assign the buffer to the frame resource
 			_framesData[i]->materialPhongDynUboBuffer = std::move(materialDynUboBuffer);
@@ -1692,21 +2508,28 @@ namespace m1
 			// === PBR ===
 
 			// create material dyn buffer
-			auto materialPbrDynUboBuffer = std::make_unique<Buffer>(_device, materialPbrUboSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+			auto materialPbrDynUboBuffer = std::make_unique<Buffer>(_device, materialPbrUboSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				0, QueueSharing::Upload);
 
 			// copy material ubos array to the dynamic buffer
-			uploadToDeviceBuffer(_device, *materialPbrDynUboBuffer, materialPbrUboSize, materialPbrUbos.data());
+			_uploadBatcher->uploadBuffer(*materialPbrDynUboBuffer, materialPbrUbos.data(), materialPbrUboSize);
 
 			// assign the buffer to the frame resource
 			_framesData[i]->materialPbrDynUboBuffer = std::move(materialPbrDynUboBuffer);
 		}
 
-		// allocate one descriptor set for each material
+		// allocate one descriptor set for each material and frame in flight
 		auto phongDescriptorSets = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::MaterialPhong,
-			materialCount);
+			materialCount * _framesInFlight);
 
 		auto pbrDescriptorSets = _descriptorSetManager->allocateDescriptorSets(DescriptorSetLayoutType::MaterialPbr,
-			materialCount);
+			materialCount * _framesInFlight);
+		auto assignDescriptorSets = [&](Material& material, uint32_t materialIndex)
+		{
+			auto first = materialIndex * _framesInFlight;
+			material.descriptorSetsPhong.assign(phongDescriptorSets.begin() + first, phongDescriptorSets.begin() + first + _framesInFlight);
+			material.descriptorSetsPbr.assign(pbrDescriptorSets.begin() + first, pbrDescriptorSets.begin() + first + _framesInFlight);
+		};
 
 		// set materials properties and update descriptorSet
 		_defaultMaterial->uboIndex = 0;
@@ -1718,14 +2541,13 @@ namespace m1
 		_defaultMaterial->emissiveMap = _blackMapSRGB;
 		_defaultMaterial->occlusionMap = _whiteMapSRGB;
 
-		_defaultMaterial->descriptorSetPhong = phongDescriptorSets[0];
-		_defaultMaterial->descriptorSetPbr = pbrDescriptorSets[0];
+		assignDescriptorSets(*_defaultMaterial, 0);
 		updateMaterialDescriptorSets(*_defaultMaterial);
 
 		uint32_t index = 1; // index 0 is for the default material
-		for (auto& material: _materials | std::views::values)
+		for (auto& material: _materials)
 		{
-			// set ubo index
+			// set ubo index (same as the material id)
 			material->uboIndex = index;
 
 			// load texture
@@ -1759,70 +2581,17 @@ namespace m1
 				material->emissiveMap = _blackMapSRGB;
 
 			// update the material descriptor set
-			material->descriptorSetPhong = phongDescriptorSets[index];
-			material->descriptorSetPbr = pbrDescriptorSets[index];
+			assignDescriptorSets(*material, index);
 			index++;
 			updateMaterialDescriptorSets(*material);
 		}
 	}
 
-	void Engine::copyDataToImage(const void* data, uint32_t width, uint32_t height, VkDeviceSize imageSize, const Image* image) const
-	{
-		// Create a staging buffer to upload the texture data to GPU
-		Buffer stagingBuffer{_device, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT};
-
-		// Copy texture data to the staging buffer
-		stagingBuffer.copyDataToBuffer(data);
-
-		// Transition image layout to be optimal for receiving data
-		transitionImageLayoutOtc(*image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-
-		// Copy the texture data from the staging buffer to the image
-		copyBufferToImage(stagingBuffer, *image, width, height);
-
-		if (image->getMipLevels() == 1)
-			// Transition image layout to be optimal for shader access
-			transitionImageLayoutOtc(*image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_IMAGE_ASPECT_COLOR_BIT);
-		else
-			// Generate mipmaps (also transitions the image to be optimal for shader access)
-			generateMipmaps(*image);
-	}
-
-	void Engine::copyBufferToImage(const Buffer &srcBuffer, const Image& image, uint32_t width, uint32_t height) const
+	void Engine::copyDataToImage(const void* data, VkDeviceSize imageSize, const Image& image) const
 	{
-		// Begin one-time command
-		VkCommandBuffer commandBuffer = _device.getGraphicsQueue().beginOneTimeCommand();
-
-		auto layerCount = image.getArrayLayers();
-		auto layersSize = srcBuffer.getSize() / layerCount;
-		std::vector<VkBufferImageCopy> bufferImageCopies {layerCount};
-		// init regions to copy
-		for (uint32_t i = 0; i < layerCount; i++)
-		{
-			VkBufferImageCopy region{};
-			region.bufferOffset = i * layersSize;
-			region.bufferRowLength = 0; // 0 means tightly packed, no padding bytes
-			region.bufferImageHeight = 0; // 0 means tightly packed, no padding bytes
-
-			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			region.imageSubresource.mipLevel = 0;
-			region.imageSubresource.baseArrayLayer = i;
-			region.imageSubresource.layerCount = 1; // TODO can't I just set the layer count here without the for loop?
-
-			// which part of the image to copy to
-			region.imageOffset = {0, 0, 0};
-			region.imageExtent = {width, height, 1};
-
-			bufferImageCopies[i] = region;
-		}
-
-		vkCmdCopyBufferToImage(commandBuffer, srcBuffer.getVkBuffer(), image.getVkImage(),
-								   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, // which layout the image is currently using
-								   bufferImageCopies.size(), bufferImageCopies.data());
-
-		// Execute the copy command
-		_device.getGraphicsQueue().endOneTimeCommand(commandBuffer);
+		// recorded into the upload batch: the copy, the mipmaps generation and the transition to SHADER_READ_ONLY_OPTIMAL
+		// are executed by the next flush of the upload batcher
+		_uploadBatcher->uploadImage(image, data, imageSize);
 	}
 
 	void Engine::createDefaultTextures()
@@ -1846,8 +2615,32 @@ namespace m1
 		_defaultMetallicRoughnessMap = createTexture(params, &defaultMetallicRoughnessPixel);
 	}
 
-	std::unique_ptr<Texture> Engine::loadTexture(const std::string& filePath, VkFormat format) const
+	std::shared_ptr<Texture> Engine::loadTexture(const std::string& filePath, VkFormat format) const
 	{
+		// texture baked offline, if the device can sample it
+		if (_device.getFeatures().textureCompressionBC)
+		{
+			auto ktxPath = getKtx2Path(filePath);
+			if (_textureStreamer)
+			{
+				// only the mip tail, the larger levels are streamed
+				auto ktxImage = readKtx2(ktxPath, TextureStreamer::MIP_TAIL_EXTENT);
+				if (ktxImage && ktxImage->faces == 1 && isCompressedFormatCompatible(ktxImage->format, format))
+				{
+					auto texture = std::make_shared<Texture>(_device, _textureStreamer->addImage(ktxPath, *ktxImage),
+						std::make_shared<Sampler>(_device));
+					_textureStreamer->addTexture(texture);
+					return texture;
+				}
+			}
+			else
+			{
+				auto ktxImage = readKtx2(ktxPath);
+				if (ktxImage && ktxImage->faces == 1 && isCompressedFormatCompatible(ktxImage->format, format))
+					return createTexture(*ktxImage);
+			}
+		}
+
 		// load texture data. Return a pointer to the array of RGBA values
 		int texWidth, texHeight, texChannels;
 		stbi_uc *pixels = stbi_load(filePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -1880,7 +2673,7 @@ namespace m1
 
 		// copy data to the texture's image
 		Image& textImage = texture->getImage();
-		copyDataToImage(data, width, height, imageSize, &textImage);
+		copyDataToImage(data, imageSize, textImage);
 
 		return texture;
 	}
@@ -1891,158 +2684,113 @@ namespace m1
 		auto height = params.extent.height;
 		VkDeviceSize imageSize = width * height * 4; // 4 bytes per pixel (RGBA)
 
-		// create the image object
-		auto image = std::make_unique<Image>(_device, params);
+		// create the image object, written by the upload batcher
+		ImageParams uploadedParams = params;
+		uploadedParams.sharing = QueueSharing::Upload;
+		auto image = std::make_unique<Image>(_device, uploadedParams);
 
 		// copy data to the image
-		copyDataToImage(data, width, height, imageSize, image.get());
+		copyDataToImage(data, imageSize, *image);
 
 		return image;
 	}
 
+	std::shared_ptr<Image> Engine::createImage(const Ktx2Image& ktxImage) const
+	{
+		return uploadKtx2Image(_device, *_uploadBatcher, ktxImage);
+	}
+
+	std::unique_ptr<Texture> Engine::createTexture(const Ktx2Image& ktxImage, const VkSamplerCreateInfo* samplerCreateInfo) const
+	{
+		return std::make_unique<Texture>(_device, createImage(ktxImage), std::make_shared<Sampler>(_device, samplerCreateInfo));
+	}
+
 	void Engine::processInput(float delta)
 	{
 		if (_config.uiEnabled && UiModule::wantCaptureKeyboard())
 			return;
 
-		int key = _window.getPressedKey();
+		int key = _window->getPressedKey();
 
 		if (key == GLFW_KEY_U) setUiEnabled(!_config.uiEnabled);
 
-		if (key == GLFW_KEY_W) _camera.moveUp(delta);
-		if (key == GLFW_KEY_S) _camera.moveUp(-delta);
-		if (key == GLFW_KEY_D) _camera.moveRight(delta);
-		if (key == GLFW_KEY_A) _camera.moveRight(-delta);
+		// in pipelined mode the camera is moved by the update thread
+		if (!_config.pipelinedUpdateEnabled)
+			moveCamera(_camera, key, delta);
+	}
+
+	void Engine::moveCamera(Camera& camera, int key, float delta)
+	{
+		if (key == GLFW_KEY_W) camera.moveUp(delta);
+		if (key == GLFW_KEY_S) camera.moveUp(-delta);
+		if (key == GLFW_KEY_D) camera.moveRight(delta);
+		if (key == GLFW_KEY_A) camera.moveRight(-delta);
 
-		if (key == GLFW_KEY_UP) _camera.orbitVertical(delta);
-		if (key == GLFW_KEY_DOWN) _camera.orbitVertical(-delta);
-		if (key == GLFW_KEY_RIGHT) _camera.orbitHorizontal(delta);
-		if (key == GLFW_KEY_LEFT) _camera.orbitHorizontal(-delta);
+		if (key == GLFW_KEY_UP) camera.orbitVertical(delta);
+		if (key == GLFW_KEY_DOWN) camera.orbitVertical(-delta);
+		if (key == GLFW_KEY_RIGHT) camera.orbitHorizontal(delta);
+		if (key == GLFW_KEY_LEFT) camera.orbitHorizontal(-delta);
 
-		if (key == GLFW_KEY_PAGE_DOWN || key == GLFW_KEY_E) _camera.zoom(delta);
-		if (key == GLFW_KEY_PAGE_UP || key == GLFW_KEY_Q) _camera.zoom(-delta);
+		if (key == GLFW_KEY_PAGE_DOWN || key == GLFW_KEY_E) camera.zoom(delta);
+		if (key == GLFW_KEY_PAGE_UP || key == GLFW_KEY_Q) camera.zoom(-delta);
 
 		if (key == GLFW_KEY_P)
 		{
-			if (_camera.getProjectionType() == Camera::ProjectionType::Perspective)
-				_camera.setProjectionType(Camera::ProjectionType::Orthographic);
+			if (camera.getProjectionType() == Camera::ProjectionType::Perspective)
+				camera.setProjectionType(Camera::ProjectionType::Orthographic);
 			else
-				_camera.setProjectionType(Camera::ProjectionType::Perspective);
+				camera.setProjectionType(Camera::ProjectionType::Perspective);
 		}
 	}
 
-	void Engine::transitionImageLayoutOtc(const Image& image, VkImageLayout oldLayout, VkImageLayout newLayout,
-		VkImageAspectFlags aspectMask) const
+	void Engine::startUpdateThread()
 	{
-		VkCommandBuffer commandBuffer = _device.getGraphicsQueue().beginOneTimeCommand();
+		Log::Get().Info("Starting the update thread");
+		_updateThreadStop = false;
+		_snapshotRequests = 0;
+		_updateThread = std::thread(&Engine::updateLoop, this, _camera);
+	}
 
-		transitionImageLayout(commandBuffer, image.getVkImage(), image.getMipLevels(), oldLayout, newLayout, aspectMask,
-			image.getArrayLayers());
+	void Engine::stopUpdateThread()
+	{
+		if (!_updateThread.joinable())
+			return;
 
-		_device.getGraphicsQueue().endOneTimeCommand(commandBuffer);
+		_updateThreadStop = true;
+		_snapshotRequests.fetch_add(1, std::memory_order_release);
+		_snapshotRequests.notify_one();
+		_updateThread.join();
 	}
 
-	void Engine::generateMipmaps(const Image &image) const
+	void Engine::updateLoop(Camera camera)
 	{
-		// Use vkCmdBlitImage command. This command performs copying, scaling, and filtering operations.
-		// We will call this multiple times to blit data to each mip level of the image.
-		// Source and destination of the command will be the same image, but different mip levels.
+		/*
+			Frame N+1 is simulated while frame N is recorded: the render thread requests a snapshot as soon as it has
+			taken the previous one. The update thread owns its copy of the simulated state, nothing is shared but the
+			triple buffer and the atomics
+		*/
+		auto prevTime = std::chrono::high_resolution_clock::now();
+		uint64_t handledRequests = 0;
+		uint64_t updateIndex = 0;
 
-		// Check if the image format supports linear blitting
-		if (!_device.isLinearFilteringSupported(image.getFormat(), VK_IMAGE_TILING_OPTIMAL))
+		while (true)
 		{
-			Log::Get().Warning("Failed to create mip levels. Texture image format does not support linear blitting!");
+			_snapshotRequests.wait(handledRequests, std::memory_order_acquire);
+			handledRequests = _snapshotRequests.load(std::memory_order_acquire);
+			if (_updateThreadStop)
+				break;
 
-			transitionImageLayoutOtc(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_IMAGE_ASPECT_COLOR_BIT);
-
-			return;
-		}
+			auto currentTime = std::chrono::high_resolution_clock::now();
+			float delta = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - prevTime).count();
+			prevTime = currentTime;
 
-		VkCommandBuffer commandBuffer = _device.getGraphicsQueue().beginOneTimeCommand();
+			moveCamera(camera, _updateInputKey.load(std::memory_order_relaxed), delta);
 
-		auto vkImage = image.getVkImage();
-
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.image = vkImage;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.subresourceRange.levelCount = 1;
-
-		int32_t mipWidth = image.getWidth();
-		int32_t mipHeight = image.getHeight();
-		auto mipLevels = image.getMipLevels();
-		for (uint32_t i = 1; i < mipLevels; i++)
-		{
-			barrier.subresourceRange.baseMipLevel = i - 1;
-			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-			vkCmdPipelineBarrier(commandBuffer,
-			                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-			                     0, nullptr,
-			                     0, nullptr,
-			                     1, &barrier);
-
-			// blit info
-			VkImageBlit blit{};
-			blit.srcOffsets[0] = {0, 0, 0};
-			blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.srcSubresource.mipLevel = i - 1;
-			blit.srcSubresource.baseArrayLayer = 0;
-			blit.srcSubresource.layerCount = 1;
-			blit.dstOffsets[0] = {0, 0, 0};
-			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 }; // each mip level is half the size of the previous level
-			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.dstSubresource.mipLevel = i;
-			blit.dstSubresource.baseArrayLayer = 0;
-			blit.dstSubresource.layerCount = 1;
-
-			// blit command
-			vkCmdBlitImage(commandBuffer,
-			               vkImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			               vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			               1, &blit,
-			               VK_FILTER_LINEAR);
-
-			// transition mip level i-1 to shader read only optimal
-			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			vkCmdPipelineBarrier(commandBuffer,
-			                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-			                     0, nullptr,
-			                     0, nullptr,
-			                     1, &barrier);
-
-			// next mip level is half the size
-			if (mipWidth > 1) mipWidth /= 2;
-			if (mipHeight > 1) mipHeight /= 2;
+			SceneSnapshot& snapshot = _snapshots.getWriteBuffer();
+			snapshot.updateIndex = ++updateIndex;
+			snapshot.camera = camera;
+			_snapshots.publish();
 		}
-
-		// transition the last mip level to shader read only optimal
-		barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer,
-		                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-		                     0, nullptr,
-		                     0, nullptr,
-		                     1, &barrier);
-
-		_device.getGraphicsQueue().endOneTimeCommand(commandBuffer);
 	}
 
 	void copyImageToImage(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D srcSize, VkExtent2D dstSize)
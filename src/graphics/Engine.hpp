@@ -4,6 +4,8 @@
 #include "Instance.hpp"
 #include "Device.hpp"
 #include "SwapChain.hpp"
+#include "RenderGraph.hpp"
+#include "ParallelCommandRecorder.hpp"
 #include "DescriptorSetManager.hpp"
 #include "Pipeline.hpp"
 #include "Buffer.hpp"
@@ -12,17 +14,32 @@
 #include "Camera.hpp"
 #include "FrameData.hpp"
 #include "BBox.hpp"
+#include "CameraPath.hpp"
+#include "GpuProfiler.hpp"
+#include "DrawList.hpp"
+#include "FrustumCuller.hpp"
+#include "SceneGraph.hpp"
+#include "GeometryPool.hpp"
+#include "UploadBatcher.hpp"
+#include "PipelineCache.hpp"
+#include "TextureStreamer.hpp"
+#include "TripleBuffer.hpp"
 
 // std
 #include <memory>
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <optional>
+#include <atomic>
+#include <array>
+#include <thread>
 
 namespace m1
 {
     class SceneObject;
     class UiModule;
+	struct Ktx2Image;
 
 	enum class LightingType
 	{
@@ -55,12 +72,102 @@ namespace m1
 		EnvironmentMapPreset environmentMapPreset = EnvironmentMapPreset::Hdr111ParkingLot2Ref;
 		int selectedModelIndex = 0;
 		SkyBoxMap skyBoxMap = SkyBoxMap::Environment;
+		// GPU-driven rendering: culling on the GPU and one indirect-count draw per batch (requires drawIndirectCount)
+		bool gpuDrivenEnabled = false;
+		// vertex format of the meshes: Packed quantizes the attributes (less vertex bandwidth, fixed at construction)
+		VertexFormat vertexFormat = VertexFormat::Standard;
+
+		// headless mode: no window, surface or presentation. Frames are rendered into an offscreen color image
+		// that can be read back (e.g. for CI, software ICDs like lavapipe or thumbnails)
+		bool headless = false;
+		VkExtent2D headlessExtent = { 1280, 720 };
+		uint32_t headlessFrameCount = 1; // frames rendered by run() in headless mode
+
+		// if set, the camera movements of the interactive session are recorded and saved into this file (see CameraPath)
+		std::string cameraRecordPath;
+
+		// pipeline cache file, loaded at startup and saved on exit (empty: not persisted)
+		std::string pipelineCachePath = "pipeline_cache.bin";
+		// directory of the baked IBL textures (empty: baked at every startup)
+		std::string iblCacheDirectory = "ibl_cache";
+
+		// baked textures: only the mip tail is loaded at startup, the larger levels are streamed by the on-screen size
+		// (fixed at construction)
+		bool textureStreamingEnabled = true;
+		uint32_t textureStreamingBudgetMb = 0; // 0: VRAM budget reported by the device
+
+		// the draws of the CPU path (shadow and main passes) are recorded by worker threads into secondary command buffers
+		bool parallelRecordingEnabled = true;
+		uint32_t recordingThreadCount = 0; // 0: one thread for each hardware thread (fixed at construction)
+
+		// frames recorded while the GPU renders the previous ones, clamped to [2, 4] (fixed at construction).
+		// More frames hide CPU spikes at the cost of latency and per-frame resources
+		uint32_t framesInFlight = 2;
+		// windowed mode: an update thread simulates the scene of the next frame (camera driven by the input) while the
+		// current one is recorded, the snapshots are handed to the render thread through a triple buffer
+		bool pipelinedUpdateEnabled = false;
+
+		// level of detail of the meshes selected by their size on the screen (the LODs are generated at load time)
+		bool lodEnabled = true;
+		float lodErrorPixels = 1.0f; // largest simplification error allowed on the screen
+		uint32_t shadowLodBias = 1;  // LODs coarser than the main pass for the shadow casters
+		// GPU-driven path: the meshlets of the visible objects drawn at full detail are culled one by one (frustum and
+		// back facing normal cone) by a second compute pass
+		bool meshletCullingEnabled = true;
+
+		// cascaded shadow maps: the view frustum up to shadowDistance is split into cascades, each one fitted by an
+		// orthographic projection and rendered into a layer of the shadow map. The splits blend the logarithmic
+		// (lambda = 1, uniform resolution on the screen) and the uniform (lambda = 0) distributions
+		uint32_t shadowCascadeCount = 4; // [1, MAX_SHADOW_CASCADES]
+		float shadowCascadeSplitLambda = 0.75f;
+		float shadowDistance = 0.0f; // 0 or beyond: far plane of the camera
+		// a cascade is rendered again only when its projection, the transforms or the LODs of the shadow casters change
+		bool shadowCascadeCachingEnabled = true;
+	};
+
+	// scene state simulated by the update thread (pipelined mode), applied by the render thread before recording a frame
+	struct SceneSnapshot
+	{
+		uint64_t updateIndex = 0;
+		Camera camera;
+	};
+
+	// light view projection of a shadow cascade, covering the view depths up to splitDepth
+	struct ShadowCascade
+	{
+		glm::mat4 viewProj{ 1.0f };
+		float splitDepth = 0.0f;
+		glm::mat4 cachedViewProj{ 1.0f }; // projection of the content of the layer
+		bool cached = false;              // the layer holds the casters rendered with cachedViewProj
+	};
+
+	struct FrameTimings
+	{
+		uint64_t frameIndex = 0;
+		float cpuRecordMs = 0.0f; // recording of the draw command buffer
+		float submitMs = 0.0f;    // queue submit (and present)
+		// GPU execution time of the draw command buffer. GPU results are only available when the frame slot is reused,
+		// so they refer to an older frame (gpuFrameIndex = -1 if not available)
+		int64_t gpuFrameIndex = -1;
+		float gpuMs = 0.0f;
+	};
+
+	// GPU-driven rendering: objects sharing pipeline, material and geometry pool block, drawn by one indirect-count draw.
+	// The batch owns maxDrawCount consecutive indirect commands starting at firstCommand
+	struct DrawBatch
+	{
+		PipelineType pipelineType;
+		uint32_t materialId;
+		uint32_t geometryBlock;
+		uint32_t firstCommand;
+		uint32_t maxDrawCount;
 	};
 
     class Engine
     {
     public:
-        static constexpr int FRAMES_IN_FLIGHT = 2;
+        static constexpr uint32_t MIN_FRAMES_IN_FLIGHT = 2;
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
     	// startup Window size
     	static constexpr uint32_t WINDOW_WIDTH = 1280;
     	static constexpr uint32_t WINDOW_HEIGHT = 720;
@@ -68,6 +175,10 @@ namespace m1
         static constexpr int PARTICLES_COUNT = 8192;
         static constexpr auto DEFAULT_MATERIAL_NAME = "Default";
     	static constexpr VkExtent2D SHADOW_MAP_RESOLUTION = { 2048, 2048 };
+    	static constexpr uint32_t TEXTURE_STREAMING_INTERVAL = 8; // frames between the texture resolution requests
+    	// a coarser LOD is selected only when its projected error is below this fraction of lodErrorPixels (no popping
+    	// back and forth around the threshold)
+    	static constexpr float LOD_HYSTERESIS = 0.75f;
 
     	// As the irradiance map averages all surrounding radiance uniformly, it doesn't have a lot of high frequency details,
     	// so we can store the map at a low resolution (32x32) and let GPU linear filtering do most of the work
@@ -83,13 +194,30 @@ namespace m1
         ~Engine();
 
         void run();
+        void renderFrame();
+    	// read back the last rendered frame as tightly packed RGBA8 pixels (waits for the GPU)
+    	std::vector<uint8_t> readbackFrame();
+    	void saveFrameToPng(const std::string& filePath);
+    	[[nodiscard]] const FrameTimings& getLastFrameTimings() const { return _frameTimings; }
+    	// per-pass GPU timings
+    	[[nodiscard]] const GpuProfiler& getGpuProfiler() const { return *_gpuProfiler; }
+    	[[nodiscard]] const BBox& getSceneBBox() const { return _bbox; }
         void addSceneObject(std::unique_ptr<SceneObject> obj);
+    	// transform hierarchy of the scene objects
+    	[[nodiscard]] SceneGraph& getSceneGraph() { return _sceneGraph; }
     	void addMaterial(std::unique_ptr<Material> material);
     	void compile();
     	[[nodiscard]] const EngineConfig& getConfig() const { return _config; }
+    	[[nodiscard]] uint32_t getFramesInFlight() const { return _framesInFlight; }
     	std::unique_ptr<Texture> createTexture(const TextureParams &params, const void *data) const;
         std::shared_ptr<Image> createImage(const ImageParams& params, const void* data) const;
+    	// baked texture: all the mip levels are uploaded as they are
+    	std::shared_ptr<Image> createImage(const Ktx2Image& ktxImage) const;
+    	std::unique_ptr<Texture> createTexture(const Ktx2Image& ktxImage, const VkSamplerCreateInfo* samplerCreateInfo = nullptr) const;
         Device& getDevice() { return _device; }
+        const Device& getDevice() const { return _device; }
+    	// null if texture streaming is disabled
+    	[[nodiscard]] TextureStreamer* getTextureStreamer() const { return _textureStreamer.get(); }
     	Camera& getCamera() { return _camera; }
 
         // properties
@@ -103,8 +231,23 @@ namespace m1
         bool getShadowsEnabled() const;
         void setLightingType(LightingType lightingType);
         LightingType getLightingType() const;
+		void setGpuDrivenEnabled(bool enabled);
+		bool getGpuDrivenEnabled() const;
+		[[nodiscard]] bool isGpuDrivenSupported() const;
 		void setSkyboxEnabled(bool enabled);
 		bool getSkyboxEnabled() const;
+		void setParallelRecordingEnabled(bool enabled);
+		bool getParallelRecordingEnabled() const;
+		void setLodEnabled(bool enabled);
+		bool getLodEnabled() const;
+		void setMeshletCullingEnabled(bool enabled);
+		bool getMeshletCullingEnabled() const;
+		void setShadowCascadeCount(uint32_t count);
+		uint32_t getShadowCascadeCount() const;
+		void setShadowCascadeSplitLambda(float lambda);
+		float getShadowCascadeSplitLambda() const;
+		void setShadowCascadeCachingEnabled(bool enabled);
+		bool getShadowCascadeCachingEnabled() const;
         void setSkyBoxMap(SkyBoxMap map);
         SkyBoxMap getSkyBoxMap() const;
 		void setIblIntensity(float intensity);
@@ -122,53 +265,113 @@ namespace m1
 
     private:
         void mainLoop();
+        void headlessLoop();
         void drawFrame();
+        void drawOffscreenFrame(FrameData& frameData);
+        // waits (once, on the CPU) for the previous use of the frame slot, and for the computation of the particles the
+        // frame is about to overwrite
+        void waitForFrameSlot(uint32_t frameSlot) const;
+        // submits the draw commands of the frame, signaling the graphics timeline (and the binary semaphore if any)
+        void submitDrawCommands(FrameData& frameData, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore);
+        // submits the particles computation of the frame slot on the compute queue, overlapping the current frame
+        void submitParticlesCompute(uint32_t frameSlot);
+        // blit of the color image to the swap chain image, then the ui
+        void addPresentPasses(RenderGraphResource color, uint32_t swapChainImageIndex);
         void updateFrameUbo() const;
-        void updateObjectUbo(const SceneObject &sceneObject) const;
         void createSyncObjects();
-        void drawObjectsLoop(VkCommandBuffer commandBuffer);
+        void cullSceneObjects();
+        // splits and stable projections of the shadow cascades, and the cascades to render this frame
+        void updateShadowCascades(bool sceneChanged);
+        // orthographic projection of the light fitted to the corners of a slice of the view frustum
+        [[nodiscard]] glm::mat4 computeCascadeViewProjMatrix(const std::array<glm::vec3, 8>& sliceCorners) const;
+        // LOD of each object by the projected size of its bounds, with hysteresis (also written into the object data)
+        void selectLods();
+        [[nodiscard]] uint32_t getShadowLod(uint32_t objectIndex) const;
+        void buildDrawList();
+        // draws the items [firstItem, firstItem + itemCount) of the draw list (thread safe)
+        void drawObjectsLoop(VkCommandBuffer commandBuffer, uint32_t firstItem, uint32_t itemCount) const;
+        // draws the items [first, first + count) of the draw list of the cascade (thread safe)
+        void drawShadowCasters(VkCommandBuffer commandBuffer, uint32_t cascade, uint32_t first, uint32_t count) const;
+        // the instances (and the indirect commands) of the shadow cascades are stored after the ones of the main pass
+        [[nodiscard]] uint32_t getShadowInstancesOffset(uint32_t cascade) const { return (1 + cascade) * _drawCommandsPerPass; }
+        // starts recording the shadow and main passes of the CPU path on the worker threads
+        void recordSecondaryCommands();
+        void bindMaterialDescriptorSet(VkCommandBuffer commandBuffer, const Pipeline& pipeline, PipelineType pipelineType, uint32_t materialId) const;
+        // GPU-driven rendering (Engine.GpuDriven.cpp)
+        void createGpuDrivenResources();
+        void buildDrawBatches();
+        // per object data read by the vertex shaders of both paths, and by the GPU culling
+        void updateObjectsSsbo();
+        void recordCullingPass(VkCommandBuffer commandBuffer) const;
+        // pass 0: main pass, 1 + cascade: shadow cascade
+        void drawObjectsIndirect(VkCommandBuffer commandBuffer, uint32_t pass) const;
         void drawSkyBox(VkCommandBuffer commandBuffer) const;
         void drawParticles(VkCommandBuffer commandBuffer) const;
+        void drawParticlesAndSkyBox(VkCommandBuffer commandBuffer) const;
         void recordDrawSceneCommands(VkCommandBuffer commandBuffer, uint32_t swapChainImageIndex);
-        void recordComputeCommands(VkCommandBuffer commandBuffer) const;
+        // msaaImage: rendering target resolved into the color image, nullptr if msaa is disabled
+        void recordMainPass(VkCommandBuffer commandBuffer, const Image& colorImage, const Image& depthImage, const Image* msaaImage);
+        void recordComputeCommands(VkCommandBuffer commandBuffer, uint32_t frameSlot) const;
         void recreateSwapChain();
     	void createPipelines();
+    	// load the IBL textures from the IBL cache, baking (and storing) the missing ones
     	void loadIblTextures() const;
+    	void bakeEnvironmentMaps(const std::string& hdrPath) const;
+    	void bakeBrdfLut() const;
 		void createFramesResources();
 		void createShadowMapTexture();
-		void recordShadowMappingPass(VkCommandBuffer commandBuffer) const;
+		void recordShadowMappingPass(VkCommandBuffer commandBuffer);
     	[[nodiscard]] BBox computeSceneBBox() const;
-        [[nodiscard]] glm::mat4 computeLightViewProjMatrix() const;
         void createEnvironmentTextures();
         void initParticles();
         void initLights();
         void updateDescriptorSets() const;
         void updateMaterialDescriptorSets(const Material &material) const;
+        void updateMaterialDescriptorSet(const Material &material, uint32_t frameIndex) const;
+    	// requests the mip levels of the visible materials, then updates the descriptor sets of the swapped textures
+    	void updateTextureStreaming();
+    	// the objects whose meshes have the same content share one of them (uploaded once, drawn as instances)
+    	void deduplicateMeshes();
     	void compileSceneObjects() const;
+    	// material id 0 is the default material, the others are the materials added by addMaterial
+    	[[nodiscard]] const Material& getMaterial(uint32_t materialId) const { return materialId == 0 ? *_defaultMaterial : *_materials[materialId - 1]; }
     	void compileMaterials();
         
-        void copyBufferToImage(const Buffer& srcBuffer, const Image& image, uint32_t width, uint32_t height) const;
-        void copyDataToImage(const void* data, uint32_t width, uint32_t height, VkDeviceSize imageSize, const Image* image) const;
+        void copyDataToImage(const void* data, VkDeviceSize imageSize, const Image& image) const;
 
         void createDefaultTextures();
-        std::unique_ptr<Texture> loadTexture(const std::string &filePath, VkFormat format) const;
+        std::shared_ptr<Texture> loadTexture(const std::string &filePath, VkFormat format) const;
 
         void processInput(float delta);
-        void transitionImageLayoutOtc(const Image &image, VkImageLayout oldLayout, VkImageLayout newLayout, VkImageAspectFlags aspectMask) const;
-        void generateMipmaps(const Image& image) const;
+        static void moveCamera(Camera& camera, int key, float delta);
+        // pipelined mode: simulates a snapshot each time the render thread requests one
+        void updateLoop(Camera camera);
+        void startUpdateThread();
+        void stopUpdateThread();
 
 
 
 
     	EngineConfig _config{};
+    	const uint32_t _framesInFlight;
     	std::unique_ptr<UiModule> _gui;
         Camera _camera{};
 
-        Window _window{ WINDOW_WIDTH, WINDOW_HEIGHT, "Vulkan App" };
-        Device _device{ _window };
+        std::unique_ptr<Window> _window; // null in headless mode
+        Device _device;
         std::unique_ptr<SwapChain> _swapChain;
+        std::unique_ptr<RenderGraph> _renderGraph;
+    	std::unique_ptr<PipelineCache> _pipelineCache; // compiled pipelines and shader modules, outlives the pipelines
+    	std::unique_ptr<UploadBatcher> _uploadBatcher; // buffers and textures data, flushed by compile
+    	std::unique_ptr<TextureStreamer> _textureStreamer;
+    	std::unique_ptr<ParallelCommandRecorder> _commandRecorder;
+    	std::array<SecondaryCommands, MAX_SHADOW_CASCADES> _shadowPassCommands; // recorded by the command recorder, executed by the passes of the frame
+    	SecondaryCommands _mainPassCommands;
+    	std::unique_ptr<GeometryPool> _geometryPool; // vertices and indices of all the meshes (must outlive the scene objects)
     	std::unordered_map<PipelineType, std::unique_ptr<Pipeline>> _graphicsPipelines;
         std::unique_ptr<Pipeline> _computePipeline;
+    	std::unique_ptr<Pipeline> _cullingPipeline;
+    	std::unique_ptr<Pipeline> _meshletCullingPipeline;
 
     	std::vector<std::unique_ptr<FrameData>> _framesData;
 
@@ -180,27 +383,59 @@ namespace m1
     	VkDeviceSize _materialPhongUboAlignment = -1;
     	VkDeviceSize _materialPbrUboAlignment = -1;
 
+    	SceneGraph _sceneGraph; // referenced by the scene objects
         std::vector<std::unique_ptr<SceneObject>> _sceneObjects{};
     	BBox _bbox;
-    	std::unordered_map<std::string, std::unique_ptr<Material>> _materials{};
+    	std::vector<std::unique_ptr<Material>> _materials{}; // materialId - 1
+    	std::unordered_map<std::string, uint32_t> _materialIds{}; // name => material id
     	std::unique_ptr<Material> _defaultMaterial = std::make_unique<Material>(DEFAULT_MATERIAL_NAME);
     	std::shared_ptr<Texture> _whiteMapSRGB;
     	std::shared_ptr<Texture> _whiteMapUnorm;
     	std::shared_ptr<Texture> _defaultNormalMap;
     	std::shared_ptr<Texture> _defaultMetallicRoughnessMap;
     	std::shared_ptr<Texture> _blackMapSRGB;
-    	std::string _currentMaterialName;
+    	DrawList _drawList;
+    	std::array<DrawList, MAX_SHADOW_CASCADES> _shadowDrawLists; // casters of each cascade
+    	FrustumCuller _frustumCuller;
+    	std::vector<uint32_t> _visibleObjects; // indices of the objects inside the camera frustum
+    	std::array<std::vector<uint32_t>, MAX_SHADOW_CASCADES> _visibleShadowCasters; // objects inside the light frustum of each cascade
+    	std::vector<uint32_t> _streamingVisibleObjects; // visible objects whose textures resolution is requested
+    	std::vector<ObjectData> _objectsData; // content of the objects SSBO
+    	std::vector<uint64_t> _objectsDataVersions; // world transform version of each object data, UINT64_MAX: not written yet
+    	std::vector<uint8_t> _objectLods; // LOD of the main pass of each object, UINT8_MAX: not selected yet
+    	std::vector<DrawBatch> _drawBatches;
+    	uint32_t _drawCommandsPerPass = 0; // one per object, or one per meshlet for the objects with meshlets
+    	uint32_t _maxMeshletTasks = 0;     // groups of meshlets culled by a work group of the meshlet culling
+    	std::unique_ptr<Buffer> _meshletsBuffer; // meshlets of all the meshes of the scene (see firstMeshlet of the object data)
+    	std::optional<LightingType> _drawBatchesLightingType; // lighting type the batches were built for (default pipeline)
         uint32_t _currentFrame = 0;
+        uint64_t _totalFrames = 0;
+
+    	// pipelined mode: the update thread produces one snapshot for each request of the render thread
+    	std::thread _updateThread;
+    	TripleBuffer<SceneSnapshot> _snapshots;
+    	std::atomic<uint64_t> _snapshotRequests = 0;
+    	std::atomic<int> _updateInputKey = -1; // key pressed, polled by the render (main) thread
+    	std::atomic<bool> _updateThreadStop = false;
+    	FrameTimings _frameTimings{};
+    	std::unique_ptr<GpuProfiler> _gpuProfiler;
 
-    	std::unique_ptr<Texture> _shadowMap;
+    	std::unique_ptr<Texture> _shadowMap; // one layer for each cascade
+    	std::array<ShadowCascade, MAX_SHADOW_CASCADES> _shadowCascades{};
+    	uint32_t _shadowCascadeMask = 0; // cascades rendered this frame, the other layers are cached (or unused)
     	std::unique_ptr<Texture> _environmentCubemap;
     	std::unique_ptr<Texture> _irradianceCubemap;
     	std::unique_ptr<Texture> _prefilteredEnvCubemap;
     	std::unique_ptr<Texture> _brdfLUT;
 
-		// Synchronization objects (semaphores for GPU-GPU sync, fences for CPU-GPU sync)
+		// Synchronization objects: a timeline semaphore per queue for the frames (GPU-GPU and CPU-GPU sync),
+		// binary semaphores for the swap chain (acquire and present don't support timeline semaphores)
+		VkSemaphore _graphicsTimeline = VK_NULL_HANDLE;
+		VkSemaphore _computeTimeline = VK_NULL_HANDLE;
+		uint64_t _graphicsTimelineValue = 0; // last value signaled by a submission
+		uint64_t _computeTimelineValue = 0;
         std::vector<VkSemaphore> _imageAvailableSems;
         std::vector<VkSemaphore> _drawCmdExecutedSems;
-        VkSemaphore _acquireSemaphore; // only used during acquiring of an image, then swapped into _imageAvailableSems
+        VkSemaphore _acquireSemaphore = VK_NULL_HANDLE; // only used during acquiring of an image, then swapped into _imageAvailableSems
     };
 }
@@ -6,20 +6,19 @@
 #include <vulkan/vulkan.h>
 
 // std
+#include <cstdint>
 #include <memory>
 
 
 namespace m1
 {
     struct FrameUbo;
-    struct ObjectUbo;
 
     struct FrameData
     {
-    	FrameData(std::unique_ptr<Buffer> frameUboBuffer, std::unique_ptr<Buffer> objectUboBuffer, VkDescriptorSet frameDescriptorSet,
-    		VkFence drawFence, VkCommandBuffer drawSceneCmdBuffer) :
-				frameUboBuffer(std::move(frameUboBuffer)), objectUboBuffer(std::move(objectUboBuffer)), frameDescriptorSet(frameDescriptorSet),
-    			drawCmdExecutedFence(drawFence), drawSceneCmdBuffer(drawSceneCmdBuffer)
+    	FrameData(std::unique_ptr<Buffer> frameUboBuffer, VkDescriptorSet frameDescriptorSet, VkCommandBuffer drawSceneCmdBuffer) :
+				frameUboBuffer(std::move(frameUboBuffer)), frameDescriptorSet(frameDescriptorSet),
+    			drawSceneCmdBuffer(drawSceneCmdBuffer)
     	{
     	}
 
@@ -29,20 +28,29 @@ namespace m1
 
     	// buffers
         std::unique_ptr<Buffer> frameUboBuffer;
-        std::unique_ptr<Buffer> objectUboBuffer;
     	std::unique_ptr<Buffer> particleSSboBuffer;
 
         std::unique_ptr<Buffer> materialPhongDynUboBuffer; // contains data of all materials
         std::unique_ptr<Buffer> materialPbrDynUboBuffer;
 
+    	std::unique_ptr<Buffer> objectsSsboBuffer; // per object data, read by the vertex shaders
+    	std::unique_ptr<Buffer> instancesBuffer; // object index of each instance (main pass, then shadow cascades)
+
+    	// GPU-driven rendering
+    	std::unique_ptr<Buffer> drawCommandsBuffer; // indirect commands written by the culling (main pass, then shadow cascades)
+    	std::unique_ptr<Buffer> drawCountsBuffer;   // visible instances of each batch (main pass, then shadow cascades)
+    	std::unique_ptr<Buffer> meshletTasksBuffer; // (object, first meshlet) culled by each work group of the meshlet culling
+    	std::unique_ptr<Buffer> meshletDispatchBuffer; // indirect dispatch of the meshlet culling (x = work groups), then the number of tasks
+
     	// descriptor set
     	VkDescriptorSet frameDescriptorSet = VK_NULL_HANDLE;
     	VkDescriptorSet skyBoxDescriptorSet = VK_NULL_HANDLE;
     	VkDescriptorSet computeParticleDescriptorSet = VK_NULL_HANDLE;
+    	VkDescriptorSet cullingDescriptorSet = VK_NULL_HANDLE;
 
-    	// synchronization objects
-    	VkFence drawCmdExecutedFence, computeCmdExecutedFence = VK_NULL_HANDLE;
-    	VkSemaphore computeCmdExecutedSem = VK_NULL_HANDLE;
+    	// synchronization: values of the queue timeline semaphores signaled by the last submissions using the slot
+    	uint64_t graphicsTimelineValue = 0; // draw commands of the frame (last reader of the particles SSBO)
+    	uint64_t computeTimelineValue = 0;  // particles computation writing the particles SSBO (and using computeCmdBuffer)
 
     	// command buffers
     	VkCommandBuffer drawSceneCmdBuffer, computeCmdBuffer = VK_NULL_HANDLE;
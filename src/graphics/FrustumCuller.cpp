@@ -0,0 +1,151 @@
+#include "FrustumCuller.hpp"
+#include "SceneObject.hpp"
+
+// libs
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define M1_FRUSTUM_CULLER_SSE
+#include <emmintrin.h>
+#endif
+
+// std
+#include <cmath>
+
+namespace m1
+{
+	// extent of the invalid bounds (objects without a mesh): negative so the box is always outside
+	static constexpr float INVALID_EXTENT = -1e30f;
+
+	std::array<glm::vec4, 6> FrustumCuller::extractPlanes(const glm::mat4& viewProj)
+	{
+		// Gribb/Hartmann: planes from the rows of the matrix (glm is column major)
+		auto row = [&viewProj](int i) { return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]); };
+
+		std::array<glm::vec4, 6> planes
+		{
+			row(3) + row(0), // left
+			row(3) - row(0), // right
+			row(3) + row(1), // bottom
+			row(3) - row(1), // top
+			row(2),          // near (depth in [0, 1])
+			row(3) - row(2), // far
+		};
+
+		for (auto& plane : planes)
+			plane /= glm::length(glm::vec3(plane));
+
+		return planes;
+	}
+
+	void FrustumCuller::update(const std::vector<std::unique_ptr<SceneObject>>& objects)
+	{
+		_count = objects.size();
+		size_t paddedCount = (_count + 3) & ~size_t(3);
+
+		_centerX.resize(paddedCount);
+		_centerY.resize(paddedCount);
+		_centerZ.resize(paddedCount);
+		_extentX.resize(paddedCount);
+		_extentY.resize(paddedCount);
+		_extentZ.resize(paddedCount);
+
+		for (size_t i = 0; i < paddedCount; i++)
+		{
+			if (i < _count && objects[i]->getWorldBBox().isValid())
+			{
+				const BBox& bbox = objects[i]->getWorldBBox();
+				glm::vec3 center = bbox.getCenter();
+				glm::vec3 extent = bbox.getExtent() * 0.5f;
+
+				_centerX[i] = center.x;
+				_centerY[i] = center.y;
+				_centerZ[i] = center.z;
+				_extentX[i] = extent.x;
+				_extentY[i] = extent.y;
+				_extentZ[i] = extent.z;
+			}
+			else
+			{
+				_centerX[i] = _centerY[i] = _centerZ[i] = 0.0f;
+				_extentX[i] = _extentY[i] = _extentZ[i] = INVALID_EXTENT;
+			}
+		}
+	}
+
+	void FrustumCuller::cull(const glm::mat4& viewProj, std::vector<uint32_t>& visibleIndices) const
+	{
+		visibleIndices.clear();
+		auto planes = extractPlanes(viewProj);
+
+#ifdef M1_FRUSTUM_CULLER_SSE
+		/*
+			A box is outside if it is entirely behind one plane:
+				dot(n, center) + dot(|n|, extent) + w < 0
+			4 boxes are tested at a time against each plane
+		*/
+		std::array<__m128, 6> nx, ny, nz, absNx, absNy, absNz, w;
+		for (size_t p = 0; p < planes.size(); p++)
+		{
+			nx[p] = _mm_set1_ps(planes[p].x);
+			ny[p] = _mm_set1_ps(planes[p].y);
+			nz[p] = _mm_set1_ps(planes[p].z);
+			absNx[p] = _mm_set1_ps(std::abs(planes[p].x));
+			absNy[p] = _mm_set1_ps(std::abs(planes[p].y));
+			absNz[p] = _mm_set1_ps(std::abs(planes[p].z));
+			w[p] = _mm_set1_ps(planes[p].w);
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		size_t simdCount = _count & ~size_t(3);
+
+		for (size_t i = 0; i < simdCount; i += 4)
+		{
+			__m128 cx = _mm_loadu_ps(&_centerX[i]);
+			__m128 cy = _mm_loadu_ps(&_centerY[i]);
+			__m128 cz = _mm_loadu_ps(&_centerZ[i]);
+			__m128 ex = _mm_loadu_ps(&_extentX[i]);
+			__m128 ey = _mm_loadu_ps(&_extentY[i]);
+			__m128 ez = _mm_loadu_ps(&_extentZ[i]);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (size_t p = 0; p < planes.size(); p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), w[p]));
+				__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNx[p], ex), _mm_mul_ps(absNy[p], ey)), _mm_mul_ps(absNz[p], ez));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (mask & (1 << lane))
+					visibleIndices.push_back(static_cast<uint32_t>(i + lane));
+			}
+		}
+
+		cullScalar(planes, simdCount, visibleIndices);
+#else
+		cullScalar(planes, 0, visibleIndices);
+#endif
+	}
+
+	void FrustumCuller::cullScalar(const std::array<glm::vec4, 6>& planes, size_t first, std::vector<uint32_t>& visibleIndices) const
+	{
+		for (size_t i = first; i < _count; i++)
+		{
+			bool inside = true;
+			for (const auto& plane : planes)
+			{
+				float distance = plane.x * _centerX[i] + plane.y * _centerY[i] + plane.z * _centerZ[i] + plane.w;
+				float radius = std::abs(plane.x) * _extentX[i] + std::abs(plane.y) * _extentY[i] + std::abs(plane.z) * _extentZ[i];
+				if (distance + radius < 0.0f)
+				{
+					inside = false;
+					break;
+				}
+			}
+
+			if (inside)
+				visibleIndices.push_back(static_cast<uint32_t>(i));
+		}
+	}
+}
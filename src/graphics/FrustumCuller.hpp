@@ -0,0 +1,42 @@
+#pragma once
+
+#include "BBox.hpp"
+
+// libs
+#include "glm_config.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace m1
+{
+	class SceneObject;
+
+	// Culls the scene objects world bounds against a view-projection frustum.
+	// Bounds are stored as SoA (center/half extent) so the plane tests run on 4 boxes at a time with SSE.
+	class FrustumCuller
+	{
+	public:
+		// planes (xyz = normal pointing inside, w = distance) of a Vulkan clip space frustum (depth in [0, 1])
+		static std::array<glm::vec4, 6> extractPlanes(const glm::mat4& viewProj);
+
+		// copy the cached world bounds of the objects (once per frame, before culling)
+		void update(const std::vector<std::unique_ptr<SceneObject>>& objects);
+		// indices of the objects intersecting the frustum
+		void cull(const glm::mat4& viewProj, std::vector<uint32_t>& visibleIndices) const;
+
+		[[nodiscard]] size_t size() const { return _count; }
+
+	private:
+		size_t _count = 0;
+
+		// SoA bounds, padded to a multiple of 4
+		std::vector<float> _centerX, _centerY, _centerZ;
+		std::vector<float> _extentX, _extentY, _extentZ;
+
+		void cullScalar(const std::array<glm::vec4, 6>& planes, size_t first, std::vector<uint32_t>& visibleIndices) const;
+	};
+}
@@ -0,0 +1,194 @@
+#include "GeometryPool.hpp"
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "UploadBatcher.hpp"
+#include "Log.hpp"
+
+// std
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace m1
+{
+	std::optional<uint32_t> GeometryPool::RangeAllocator::allocate(uint32_t count)
+	{
+		for (auto it = _freeRanges.begin(); it != _freeRanges.end(); ++it)
+		{
+			auto [offset, freeCount] = *it;
+			if (freeCount < count)
+				continue;
+
+			_freeRanges.erase(it);
+			if (freeCount > count)
+				_freeRanges.emplace(offset + count, freeCount - count);
+
+			return offset;
+		}
+
+		return std::nullopt;
+	}
+
+	void GeometryPool::RangeAllocator::free(uint32_t offset, uint32_t count)
+	{
+		auto next = _freeRanges.lower_bound(offset);
+
+		// merge with the following free range
+		if (next != _freeRanges.end() && offset + count == next->first)
+		{
+			count += next->second;
+			next = _freeRanges.erase(next);
+		}
+
+		// merge with the previous free range
+		if (next != _freeRanges.begin())
+		{
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset)
+			{
+				prev->second += count;
+				return;
+			}
+		}
+
+		_freeRanges.emplace(offset, count);
+	}
+
+	GeometryPool::GeometryPool(const Device& device, UploadBatcher& uploadBatcher, VertexFormat vertexFormat)
+		: _device(device), _uploadBatcher(uploadBatcher), _vertexFormat(vertexFormat)
+	{
+	}
+
+	GeometryPool::~GeometryPool()
+	{
+		Log::Get().Info("Geometry pool destroyed");
+	}
+
+	GeometryAllocation GeometryPool::allocate(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		if (vertices.empty() || indices.empty())
+		{
+			Log::Get().Error("Can't allocate an empty mesh in the geometry pool");
+			throw std::runtime_error("Can't allocate an empty mesh in the geometry pool");
+		}
+
+		auto vertexCount = static_cast<uint32_t>(vertices.size());
+		auto indexCount = static_cast<uint32_t>(indices.size());
+
+		// first block with room for both vertices and indices
+		for (uint32_t i = 0; i <= _blocks.size(); i++)
+		{
+			// no room: create a new block (a dedicated one for the meshes bigger than the default size)
+			if (i == _blocks.size())
+				createBlock(std::max(vertexCount, BLOCK_VERTICES), std::max(indexCount, BLOCK_INDICES));
+
+			auto& block = _blocks[i];
+			auto vertexOffset = block.vertexRanges.allocate(vertexCount);
+			if (!vertexOffset)
+				continue;
+
+			auto firstIndex = block.indexRanges.allocate(indexCount);
+			if (!firstIndex)
+			{
+				block.vertexRanges.free(*vertexOffset, vertexCount);
+				continue;
+			}
+
+			GeometryAllocation allocation
+			{
+				.block = i,
+				.vertexOffset = static_cast<int32_t>(*vertexOffset),
+				.vertexCount = vertexCount,
+				.firstIndex = *firstIndex,
+				.indexCount = indexCount,
+			};
+
+			upload(block, allocation, vertices, indices);
+			return allocation;
+		}
+
+		// unreachable: the new block always has enough room
+		throw std::runtime_error("Geometry pool allocation failed");
+	}
+
+	void GeometryPool::free(const GeometryAllocation& allocation)
+	{
+		auto& block = _blocks.at(allocation.block);
+		block.vertexRanges.free(static_cast<uint32_t>(allocation.vertexOffset), allocation.vertexCount);
+		block.indexRanges.free(allocation.firstIndex, allocation.indexCount);
+	}
+
+	void GeometryPool::bind(VkCommandBuffer commandBuffer, uint32_t block) const
+	{
+		VkBuffer vertexBuffers[] = { _blocks[block].vertexBuffer->getVkBuffer(), VK_NULL_HANDLE };
+		VkDeviceSize offsets[] = { 0, 0 };
+		uint32_t bindingCount = 1;
+		if (_blocks[block].colorBuffer)
+			vertexBuffers[bindingCount++] = _blocks[block].colorBuffer->getVkBuffer();
+		vkCmdBindVertexBuffers(commandBuffer, 0, bindingCount, vertexBuffers, offsets);
+
+		vkCmdBindIndexBuffer(commandBuffer, _blocks[block].indexBuffer->getVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void GeometryPool::createBlock(uint32_t vertexCapacity, uint32_t indexCapacity)
+	{
+		Log::Get().Info("Creating geometry pool block " + std::to_string(_blocks.size()));
+
+		bool packed = _vertexFormat == VertexFormat::Packed;
+		VkDeviceSize vertexSize = packed ? sizeof(PackedVertex) : sizeof(Vertex);
+
+		_blocks.push_back({
+			.vertexBuffer = std::make_unique<Buffer>(_device, VkDeviceSize{vertexCapacity} * vertexSize,
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 0, QueueSharing::Upload),
+			.colorBuffer = packed ? std::make_unique<Buffer>(_device, VkDeviceSize{vertexCapacity} * sizeof(uint32_t),
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 0, QueueSharing::Upload) : nullptr,
+			.indexBuffer = std::make_unique<Buffer>(_device, VkDeviceSize{indexCapacity} * sizeof(uint32_t),
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 0, QueueSharing::Upload),
+			.vertexRanges = RangeAllocator(vertexCapacity),
+			.indexRanges = RangeAllocator(indexCapacity),
+		});
+	}
+
+	void GeometryPool::upload(const Block& block, GeometryAllocation& allocation, const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices) const
+	{
+		auto vertexOffset = static_cast<VkDeviceSize>(allocation.vertexOffset);
+
+		if (_vertexFormat == VertexFormat::Standard)
+		{
+			_uploadBatcher.uploadBuffer(*block.vertexBuffer, vertices.data(), vertices.size() * sizeof(Vertex), vertexOffset * sizeof(Vertex));
+		}
+		else
+		{
+			// quantize the positions in the bounds of the mesh (flat axes get a non-zero extent to avoid dividing by 0)
+			glm::vec3 min = vertices[0].pos;
+			glm::vec3 max = vertices[0].pos;
+			for (const auto& vertex : vertices)
+			{
+				min = glm::min(min, vertex.pos);
+				max = glm::max(max, vertex.pos);
+			}
+			glm::vec3 center = (min + max) * 0.5f;
+			glm::vec3 halfExtent = glm::max((max - min) * 0.5f, glm::vec3(1e-6f));
+			allocation.positionTransform = glm::scale(glm::translate(glm::mat4(1.0f), center), halfExtent);
+
+			std::vector<PackedVertex> packedVertices;
+			std::vector<uint32_t> colors;
+			packedVertices.reserve(vertices.size());
+			colors.reserve(vertices.size());
+			for (const auto& vertex : vertices)
+			{
+				packedVertices.push_back(PackedVertex::pack(vertex, center, halfExtent));
+				colors.push_back(PackedVertex::packColor(vertex.color));
+			}
+
+			// the upload batcher copies the data immediately
+			_uploadBatcher.uploadBuffer(*block.vertexBuffer, packedVertices.data(), packedVertices.size() * sizeof(PackedVertex),
+				vertexOffset * sizeof(PackedVertex));
+			_uploadBatcher.uploadBuffer(*block.colorBuffer, colors.data(), colors.size() * sizeof(uint32_t), vertexOffset * sizeof(uint32_t));
+		}
+
+		_uploadBatcher.uploadBuffer(*block.indexBuffer, indices.data(), indices.size() * sizeof(uint32_t),
+			VkDeviceSize{allocation.firstIndex} * sizeof(uint32_t));
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace m1
+{
+	class Device;
+	class Buffer;
+	class UploadBatcher;
+
+	// Range of a mesh inside the pool: vertexOffset and firstIndex are the values of vkCmdDrawIndexed
+	struct GeometryAllocation
+	{
+		uint32_t block = 0;
+		int32_t vertexOffset = 0;
+		uint32_t vertexCount = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		// packed format: dequantization of the positions (bounds of the mesh), to apply before the model matrix
+		glm::mat4 positionTransform = glm::mat4(1.0f);
+	};
+
+	// Packs the vertices and indices of all the meshes into a few large device local buffers (blocks).
+	// Each block has a vertex and an index buffer sub-allocated with first-fit free lists (ranges are merged when freed),
+	// so meshes in the same block are drawn without rebinding the buffers.
+	// Meshes that don't fit in a default block get a dedicated one.
+	// With the packed vertex format each block has also a color stream, indexed as the vertex buffer.
+	class GeometryPool
+	{
+	public:
+		static constexpr uint32_t BLOCK_VERTICES = 1u << 20; // ~60 MB of vertices
+		static constexpr uint32_t BLOCK_INDICES = 1u << 22;  // 16 MB of indices
+
+		GeometryPool(const Device& device, UploadBatcher& uploadBatcher, VertexFormat vertexFormat);
+		~GeometryPool();
+
+		// Non-copyable, non-movable
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+		GeometryPool(GeometryPool&&) = delete;
+		GeometryPool& operator=(GeometryPool&&) = delete;
+
+		// sub-allocate the mesh and record its upload into the upload batcher (ready after its next flush)
+		GeometryAllocation allocate(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		// give the ranges back to the pool: the GPU must not use them anymore
+		void free(const GeometryAllocation& allocation);
+
+		void bind(VkCommandBuffer commandBuffer, uint32_t block) const;
+		[[nodiscard]] size_t getBlockCount() const { return _blocks.size(); }
+		[[nodiscard]] VertexFormat getVertexFormat() const { return _vertexFormat; }
+
+	private:
+		// first-fit allocator of element ranges: offset => count of the free ranges
+		class RangeAllocator
+		{
+		public:
+			explicit RangeAllocator(uint32_t capacity) { _freeRanges.emplace(0, capacity); }
+			std::optional<uint32_t> allocate(uint32_t count);
+			void free(uint32_t offset, uint32_t count);
+
+		private:
+			std::map<uint32_t, uint32_t> _freeRanges;
+		};
+
+		struct Block
+		{
+			std::unique_ptr<Buffer> vertexBuffer;
+			std::unique_ptr<Buffer> colorBuffer; // packed format only
+			std::unique_ptr<Buffer> indexBuffer;
+			RangeAllocator vertexRanges;
+			RangeAllocator indexRanges;
+		};
+
+		const Device& _device;
+		UploadBatcher& _uploadBatcher;
+		const VertexFormat _vertexFormat;
+		std::vector<Block> _blocks;
+
+		void createBlock(uint32_t vertexCapacity, uint32_t indexCapacity);
+		void upload(const Block& block, GeometryAllocation& allocation, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) const;
+	};
+}
@@ -0,0 +1,148 @@
+#include "GpuProfiler.hpp"
+#include "Device.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+
+// std
+#include <algorithm>
+
+namespace m1
+{
+	GpuProfiler::GpuProfiler(const Device& device, uint32_t framesInFlight) : _device(device)
+	{
+		const auto& properties = device.getProperties();
+
+		// queries are reset from the host, so hostQueryReset is required as well
+		if (properties.timestampValidBits == 0 || properties.timestampPeriod <= 0.0f || !device.getFeatures().hostQueryReset)
+		{
+			Log::Get().Warning("GPU timestamps not supported, GPU profiler disabled");
+			return;
+		}
+
+		_timestampMask = properties.timestampValidBits >= 64 ? ~0ull : (1ull << properties.timestampValidBits) - 1;
+		_timestampPeriod = properties.timestampPeriod;
+
+		// two timestamps (begin/end) for each scope
+		VkQueryPoolCreateInfo queryPoolInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = SCOPES_COUNT * 2,
+		};
+
+		_queryPools.resize(framesInFlight);
+		_slotFrameNumbers.assign(framesInFlight, -1);
+		for (auto& queryPool : _queryPools)
+		{
+			VK_CHECK(vkCreateQueryPool(device.getVkDevice(), &queryPoolInfo, nullptr, &queryPool));
+			// queries must be reset before the first use
+			vkResetQueryPool(device.getVkDevice(), queryPool, 0, SCOPES_COUNT * 2);
+		}
+	}
+
+	GpuProfiler::~GpuProfiler()
+	{
+		for (auto queryPool : _queryPools)
+			vkDestroyQueryPool(_device.getVkDevice(), queryPool, nullptr);
+	}
+
+	void GpuProfiler::beginFrame(uint32_t frameSlot, uint64_t frameNumber)
+	{
+		if (!isSupported())
+			return;
+
+		_currentSlot = frameSlot;
+
+		if (_slotFrameNumbers[frameSlot] >= 0)
+			collectResults(frameSlot);
+
+		vkResetQueryPool(_device.getVkDevice(), _queryPools[frameSlot], 0, SCOPES_COUNT * 2);
+		_slotFrameNumbers[frameSlot] = static_cast<int64_t>(frameNumber);
+	}
+
+	void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, GpuScope scope) const
+	{
+		if (isSupported())
+			vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, _queryPools[_currentSlot], index(scope) * 2);
+	}
+
+	void GpuProfiler::endScope(VkCommandBuffer commandBuffer, GpuScope scope) const
+	{
+		if (isSupported())
+			vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _queryPools[_currentSlot], index(scope) * 2 + 1);
+	}
+
+	float GpuProfiler::getAverageMs(GpuScope scope) const
+	{
+		float sum = 0.0f;
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < _historyCount; i++)
+		{
+			if (_historyRecorded[index(scope)][i])
+			{
+				sum += _history[index(scope)][i];
+				count++;
+			}
+		}
+
+		return count > 0 ? sum / static_cast<float>(count) : 0.0f;
+	}
+
+	uint32_t GpuProfiler::getRecordedCount(GpuScope scope) const
+	{
+		const auto& recorded = _historyRecorded[index(scope)];
+		return static_cast<uint32_t>(std::count(recorded.begin(), recorded.begin() + _historyCount, true));
+	}
+
+	const char* GpuProfiler::getScopeName(GpuScope scope)
+	{
+		switch (scope)
+		{
+			case GpuScope::Frame: return "Frame";
+			case GpuScope::Culling: return "GPU culling";
+			case GpuScope::Shadow: return "Shadow map";
+			case GpuScope::MainLit: return "Main lit";
+			case GpuScope::Skybox: return "Skybox";
+			case GpuScope::ParticlesCompute: return "Particles compute";
+			case GpuScope::Ui: return "UI";
+			case GpuScope::Blit: return "Blit";
+			default: return "Unknown";
+		}
+	}
+
+	void GpuProfiler::collectResults(uint32_t frameSlot)
+	{
+		// each query returns {timestamp, availability}: scopes not recorded in the frame are not available
+		std::array<uint64_t, SCOPES_COUNT * 2 * 2> results{};
+		auto result = vkGetQueryPoolResults(_device.getVkDevice(), _queryPools[frameSlot], 0, SCOPES_COUNT * 2,
+			sizeof(results), results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		if (result != VK_SUCCESS && result != VK_NOT_READY)
+		{
+			Log::Get().Warning("Failed to read GPU timestamps");
+			return;
+		}
+
+		for (uint32_t scope = 0; scope < SCOPES_COUNT; scope++)
+		{
+			const uint64_t* begin = &results[scope * 4];
+			const uint64_t* end = &results[scope * 4 + 2];
+
+			float ms = 0.0f;
+			bool recorded = begin[1] != 0 && end[1] != 0;
+			if (recorded)
+			{
+				uint64_t ticks = (end[0] - begin[0]) & _timestampMask;
+				ms = static_cast<float>(static_cast<double>(ticks) * _timestampPeriod / 1e6);
+			}
+
+			_lastMs[scope] = ms;
+			_history[scope][_historyNext] = ms;
+			_historyRecorded[scope][_historyNext] = recorded;
+		}
+
+		_historyNext = (_historyNext + 1) % HISTORY_SIZE;
+		_historyCount = std::min(_historyCount + 1, HISTORY_SIZE);
+		_lastFrameNumber = _slotFrameNumbers[frameSlot];
+	}
+}
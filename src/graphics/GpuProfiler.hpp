@@ -0,0 +1,84 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace m1
+{
+	class Device;
+
+	// GPU passes measured by the profiler
+	enum class GpuScope : uint32_t
+	{
+		Frame, // whole draw command buffer
+		Culling, // GPU-driven frustum culling
+		Shadow,
+		MainLit,
+		Skybox,
+		ParticlesCompute,
+		Ui,
+		Blit,
+		Count
+	};
+
+	// Measures the GPU time of each pass with timestamp queries.
+	// One query pool per frame in flight: results are read (without waiting) when the frame slot is reused,
+	// i.e. after its timeline values have been waited, so they refer to the frame rendered framesInFlight frames before.
+	class GpuProfiler
+	{
+	public:
+		static constexpr uint32_t SCOPES_COUNT = static_cast<uint32_t>(GpuScope::Count);
+		static constexpr uint32_t HISTORY_SIZE = 64; // frames averaged
+
+		GpuProfiler(const Device& device, uint32_t framesInFlight);
+		~GpuProfiler();
+
+		// Non-copyable, non-movable
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+		GpuProfiler(GpuProfiler&&) = delete;
+		GpuProfiler& operator=(GpuProfiler&&) = delete;
+
+		// must be called after the previous use of the frame slot has been waited and before recording any scope:
+		// collects the results of the previous use of the slot and resets its queries
+		void beginFrame(uint32_t frameSlot, uint64_t frameNumber);
+		void beginScope(VkCommandBuffer commandBuffer, GpuScope scope) const;
+		void endScope(VkCommandBuffer commandBuffer, GpuScope scope) const;
+
+		[[nodiscard]] bool isSupported() const { return !_queryPools.empty(); }
+		// GPU milliseconds of the last collected frame (0 if the pass was not recorded)
+		[[nodiscard]] float getLastMs(GpuScope scope) const { return _lastMs[index(scope)]; }
+		// average over the frames recording the scope among the last HISTORY_SIZE collected frames
+		// (e.g. no particles compute while the particles are disabled), 0 if none
+		[[nodiscard]] float getAverageMs(GpuScope scope) const;
+		// number of frames recording the scope among the last HISTORY_SIZE collected frames
+		[[nodiscard]] uint32_t getRecordedCount(GpuScope scope) const;
+		[[nodiscard]] uint32_t getHistoryCount() const { return _historyCount; }
+		// frame number the last results refer to, -1 if nothing has been collected yet
+		[[nodiscard]] int64_t getLastFrameNumber() const { return _lastFrameNumber; }
+		static const char* getScopeName(GpuScope scope);
+
+	private:
+		const Device& _device;
+		std::vector<VkQueryPool> _queryPools; // empty if timestamps are not supported
+		std::vector<int64_t> _slotFrameNumbers; // frame recorded in each pool, -1 => nothing to read
+		uint32_t _currentSlot = 0;
+		uint64_t _timestampMask = ~0ull;
+		double _timestampPeriod = 0.0; // nanoseconds per tick
+
+		std::array<float, SCOPES_COUNT> _lastMs{};
+		std::array<std::array<float, HISTORY_SIZE>, SCOPES_COUNT> _history{};
+		std::array<std::array<bool, HISTORY_SIZE>, SCOPES_COUNT> _historyRecorded{};
+		uint32_t _historyCount = 0;
+		uint32_t _historyNext = 0;
+		int64_t _lastFrameNumber = -1;
+
+		static uint32_t index(GpuScope scope) { return static_cast<uint32_t>(scope); }
+		void collectResults(uint32_t frameSlot);
+	};
+}
@@ -0,0 +1,174 @@
+#include "IblCache.hpp"
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "Image.hpp"
+#include "Queue.hpp"
+#include "UploadBatcher.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+
+// std
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+namespace m1
+{
+	IblCache::IblCache(const Device& device, UploadBatcher& uploadBatcher, std::string directory) : _device(device),
+		_uploadBatcher(uploadBatcher), _directory(std::move(directory))
+	{
+	}
+
+	uint64_t IblCache::hashFile(const std::string& filePath)
+	{
+		auto content = readFile(filePath);
+		return hashBytes(content.data(), content.size());
+	}
+
+	bool IblCache::load(const std::string& name, uint64_t key, const Image& image) const
+	{
+		if (_directory.empty())
+			return false;
+
+		auto filePath = getFilePath(name, key);
+		std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return false;
+
+		auto fileSize = static_cast<size_t>(file.tellg());
+		file.seekg(0);
+
+		FileHeader header{};
+		FileHeader expected = createFileHeader(key, image);
+		if (fileSize < sizeof(FileHeader) || !file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader)) ||
+			header.magic != expected.magic || header.version != expected.version || header.key != expected.key ||
+			header.format != expected.format || header.width != expected.width || header.height != expected.height ||
+			header.mipLevels != expected.mipLevels || header.arrayLayers != expected.arrayLayers ||
+			header.dataSize != expected.dataSize || fileSize - sizeof(FileHeader) != header.dataSize)
+		{
+			Log::Get().Warning("IBL cache file not matching the texture, ignored: " + filePath);
+			return false;
+		}
+
+		std::vector<char> data(header.dataSize);
+		if (!file.read(data.data(), static_cast<std::streamsize>(data.size())))
+		{
+			Log::Get().Warning("Failed to read the IBL cache file: " + filePath);
+			return false;
+		}
+
+		_uploadBatcher.uploadImage(image, data.data(), data.size(), true);
+		Log::Get().Info("IBL texture loaded from the cache: " + filePath);
+		return true;
+	}
+
+	void IblCache::store(const std::string& name, uint64_t key, const Image& image) const
+	{
+		if (_directory.empty())
+			return;
+
+		FileHeader header = createFileHeader(key, image);
+
+		// host visible buffer the image is copied into (all the levels, each with all the layers)
+		Buffer readbackBuffer{ _device, header.dataSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT };
+
+		std::vector<VkBufferImageCopy> regions;
+		VkDeviceSize bufferOffset = 0;
+		for (uint32_t level = 0; level < image.getMipLevels(); level++)
+		{
+			uint32_t width = std::max(image.getWidth() >> level, 1u);
+			uint32_t height = std::max(image.getHeight() >> level, 1u);
+			for (uint32_t layer = 0; layer < image.getArrayLayers(); layer++)
+			{
+				regions.push_back({
+					.bufferOffset = bufferOffset,
+					.bufferRowLength = 0, // tightly packed
+					.bufferImageHeight = 0,
+					.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1},
+					.imageOffset = {0, 0, 0},
+					.imageExtent = {width, height, 1},
+				});
+				bufferOffset += computeImageSize(image.getFormat(), width, height);
+			}
+		}
+
+		VkCommandBuffer commandBuffer = _device.getGraphicsQueue().beginOneTimeCommand();
+
+		transitionImageLayout(commandBuffer, image.getVkImage(), image.getMipLevels(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT, image.getArrayLayers());
+
+		vkCmdCopyImageToBuffer(commandBuffer, image.getVkImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer.getVkBuffer(),
+			static_cast<uint32_t>(regions.size()), regions.data());
+
+		transitionImageLayout(commandBuffer, image.getVkImage(), image.getMipLevels(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT, image.getArrayLayers());
+
+		// make the transfer write visible to the host
+		memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT,
+			VK_ACCESS_2_HOST_READ_BIT);
+
+		_device.getGraphicsQueue().endOneTimeCommand(commandBuffer);
+
+		std::vector<char> data(header.dataSize);
+		readbackBuffer.copyDataFromBuffer(data.data());
+
+		// write a temporary file and rename it: a crash while writing doesn't leave a truncated file.
+		// A failed store is only a cache miss at the next run, not an error
+		std::error_code error;
+		std::filesystem::create_directories(_directory, error);
+		if (error)
+		{
+			Log::Get().Warning("Failed to create the IBL cache directory " + _directory + ": " + error.message());
+			return;
+		}
+		auto filePath = getFilePath(name, key);
+		auto tempPath = filePath + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+			file.write(data.data(), static_cast<std::streamsize>(data.size()));
+			if (!file)
+			{
+				Log::Get().Warning("Failed to write the IBL cache file: " + tempPath);
+				return;
+			}
+		}
+		std::filesystem::rename(tempPath, filePath, error);
+		if (error)
+		{
+			Log::Get().Warning("Failed to rename the IBL cache file " + tempPath + ": " + error.message());
+			std::filesystem::remove(tempPath, error);
+			return;
+		}
+
+		Log::Get().Info("IBL texture stored in the cache: " + filePath);
+	}
+
+	std::string IblCache::getFilePath(const std::string& name, uint64_t key) const
+	{
+		return (std::filesystem::path(_directory) / std::format("{}_{:016x}.m1ibl", name, key)).string();
+	}
+
+	IblCache::FileHeader IblCache::createFileHeader(uint64_t key, const Image& image)
+	{
+		FileHeader header
+		{
+			.key         = key,
+			.format      = static_cast<uint32_t>(image.getFormat()),
+			.width       = image.getWidth(),
+			.height      = image.getHeight(),
+			.mipLevels   = image.getMipLevels(),
+			.arrayLayers = image.getArrayLayers(),
+		};
+
+		for (uint32_t level = 0; level < image.getMipLevels(); level++)
+		{
+			header.dataSize += computeImageSize(image.getFormat(), std::max(image.getWidth() >> level, 1u),
+				std::max(image.getHeight() >> level, 1u)) * image.getArrayLayers();
+		}
+
+		return header;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace m1
+{
+	class Device;
+	class Image;
+	class UploadBatcher;
+
+	/*
+		On-disk cache of the baked IBL textures (environment, irradiance and prefiltered cubemaps, BRDF LUT).
+		Each texture is a file <name>_<key>.m1ibl: a header (key, format, extent, mip levels and layers) followed by
+		all the levels (each with all the layers) tightly packed.
+		A file is used only if it matches the image it's loaded into, so changing a resolution or a format bakes again.
+	*/
+	class IblCache
+	{
+	public:
+		// empty directory => nothing is loaded or stored
+		IblCache(const Device& device, UploadBatcher& uploadBatcher, std::string directory);
+
+		// key of the textures baked from a file (hash of its content)
+		static uint64_t hashFile(const std::string& filePath);
+
+		// record the upload of the cached texture into the image (left in SHADER_READ_ONLY_OPTIMAL layout, ready after the
+		// next flush of the upload batcher). Returns false if the file is missing or doesn't match the image
+		bool load(const std::string& name, uint64_t key, const Image& image) const;
+		// read back the image (in SHADER_READ_ONLY_OPTIMAL layout, waits for the GPU) and write it to the cache
+		void store(const std::string& name, uint64_t key, const Image& image) const;
+
+	private:
+		static constexpr uint32_t FILE_MAGIC = 0x4942314D; // "M1BI"
+		static constexpr uint32_t FILE_VERSION = 1; // increase when the baking shaders change
+
+		struct FileHeader
+		{
+			uint32_t magic = FILE_MAGIC;
+			uint32_t version = FILE_VERSION;
+			uint64_t key = 0;
+			uint32_t format = 0;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t mipLevels = 0;
+			uint32_t arrayLayers = 0;
+			uint64_t dataSize = 0;
+		};
+
+		const Device& _device;
+		UploadBatcher& _uploadBatcher;
+		const std::string _directory;
+
+		[[nodiscard]] std::string getFilePath(const std::string& name, uint64_t key) const;
+		[[nodiscard]] static FileHeader createFileHeader(uint64_t key, const Image& image);
+	};
+}
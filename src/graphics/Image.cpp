@@ -8,27 +8,46 @@
 
 namespace m1
 {
+	namespace
+	{
+		// queueFamilies must outlive the returned create info
+		VkImageCreateInfo getImageCreateInfo(const ImageParams& params, const std::vector<uint32_t>& queueFamilies)
+		{
+			VkImageCreateInfo imageInfo
+			{
+				.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+				.flags		   = params.flags,
+				.imageType     = VK_IMAGE_TYPE_2D,
+				.format        = params.format,
+				.extent        = VkExtent3D{params.extent.width, params.extent.height, 1},
+				.mipLevels     = params.mipLevels,
+				.arrayLayers   = params.arrayLayers,
+				.samples       = params.samples,
+				.tiling        = params.tiling,
+				.usage         = params.usage,
+				.sharingMode   = VK_SHARING_MODE_EXCLUSIVE, // not shared between multiple queue families
+				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED, // only two possible options: UNDEFINED or PREINITIALIZE
+			};
+
+			// e.g. uploaded by the dedicated transfer queue: concurrent sharing avoids the ownership transfers
+			if (queueFamilies.size() > 1)
+			{
+				imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+				imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+				imageInfo.pQueueFamilyIndices = queueFamilies.data();
+			}
+
+			return imageInfo;
+		}
+	}
+
     Image::Image(const Device& device, const ImageParams& params)
 		: _device(device), _format(params.format), _extent(params.extent), _mipLevels(params.mipLevels), _arrayLayers(params.arrayLayers)
     {
         Log::Get().Info("Creating image from scratch");
 
-        // Image info
-        VkImageCreateInfo imageInfo
-        {
-	        .sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-        	.flags		   = params.flags,
-	        .imageType     = VK_IMAGE_TYPE_2D,
-	        .format        = params.format,
-	        .extent        = VkExtent3D{_extent.width, _extent.height, 1},
-	        .mipLevels     = params.mipLevels,
-	        .arrayLayers   = params.arrayLayers,
-	        .samples       = params.samples,
-	        .tiling        = params.tiling,
-	        .usage         = params.usage,
-	        .sharingMode   = VK_SHARING_MODE_EXCLUSIVE, // not shared between multiple queue families
-	        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED, // only two possible options: UNDEFINED or PREINITIALIZE
-        };
+    	auto queueFamilies = _device.getResourceQueueFamilies(params.sharing);
+    	VkImageCreateInfo imageInfo = getImageCreateInfo(params, queueFamilies);
 
     	// memory allocation info
     	VmaAllocationCreateInfo allocInfo = {};
@@ -38,11 +57,47 @@ namespace m1
     	// Create the Image
     	VK_CHECK(vmaCreateImage(_device.getMemoryAllocator(), &imageInfo, &allocInfo, &_vkImage, &_allocation, nullptr));
 
+    	createImageViews(params);
+    }
+
+    Image::Image(const Device& device, const ImageParams& params, VmaAllocation aliasedAllocation)
+		: _device(device), _format(params.format), _extent(params.extent), _mipLevels(params.mipLevels), _arrayLayers(params.arrayLayers)
+    {
+        Log::Get().Info("Creating image aliasing an allocation");
+
+    	auto queueFamilies = _device.getResourceQueueFamilies(params.sharing);
+    	VkImageCreateInfo imageInfo = getImageCreateInfo(params, queueFamilies);
+
+    	// the image is bound to the start of the allocation, which must satisfy its memory requirements
+    	VK_CHECK(vmaCreateAliasingImage(_device.getMemoryAllocator(), aliasedAllocation, &imageInfo, &_vkImage));
+
+    	createImageViews(params);
+    }
+
+    VkMemoryRequirements Image::getMemoryRequirements(const Device& device, const ImageParams& params)
+    {
+    	auto queueFamilies = device.getResourceQueueFamilies(params.sharing);
+    	VkImageCreateInfo imageInfo = getImageCreateInfo(params, queueFamilies);
+
+    	VkDeviceImageMemoryRequirements requirementsInfo
+    	{
+    		.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+    		.pCreateInfo = &imageInfo,
+    	};
+    	VkMemoryRequirements2 requirements { .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+    	vkGetDeviceImageMemoryRequirements(device.getVkDevice(), &requirementsInfo, &requirements);
+
+    	return requirements.memoryRequirements;
+    }
+
+    void Image::createImageViews(const ImageParams& params)
+    {
 		// ImageView info
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.image = _vkImage;
-        viewInfo.viewType = params.flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D;
+        bool cube = params.flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+        viewInfo.viewType = cube ? VK_IMAGE_VIEW_TYPE_CUBE : _arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
         viewInfo.format = _format;
         viewInfo.subresourceRange.aspectMask = params.aspectMask;
         viewInfo.subresourceRange.baseMipLevel = 0;
@@ -53,8 +108,8 @@ namespace m1
 		// Create the Image View
         VK_CHECK(vkCreateImageView(_device.getVkDevice(), &viewInfo, nullptr, &_imageView));
 
-    	// create an 2D imageView for each layer and mip level
-    	if (params.flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT)
+    	// create an 2D imageView for each layer and mip level (cube and array images, e.g. rendered one layer at a time)
+    	if (cube || _arrayLayers > 1)
     	{
     		_subViews.resize(_arrayLayers * _mipLevels, VK_NULL_HANDLE);
 
@@ -91,6 +146,9 @@ namespace m1
     		if (imageView != VK_NULL_HANDLE)
     			vkDestroyImageView(_device.getVkDevice(), imageView, nullptr);
     	}
-    	vmaDestroyImage(_device.getMemoryAllocator(), _vkImage, _allocation);
+    	if (_allocation != VK_NULL_HANDLE)
+    		vmaDestroyImage(_device.getMemoryAllocator(), _vkImage, _allocation);
+    	else
+    		vkDestroyImage(_device.getVkDevice(), _vkImage, nullptr);
     }
 } // namespace m1
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "QueueSharing.hpp"
+
 // libs
 #include <vector>
 
@@ -21,12 +23,15 @@ namespace m1
     	uint32_t arrayLayers = 1;
 		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
     	VmaAllocationCreateFlags memoryProps = 0;
+    	QueueSharing sharing = QueueSharing::Exclusive; // Upload for the images written by the upload batcher
     };
 
     class Image
     {
     public:
         Image(const Device& device, const ImageParams& params);
+        // image bound to the memory of an existing allocation (not owned), e.g. transient images sharing memory
+        Image(const Device& device, const ImageParams& params, VmaAllocation aliasedAllocation);
         ~Image();
 
         // Non-copyable, non-movable
@@ -45,10 +50,15 @@ namespace m1
 		[[nodiscard]] uint32_t getMipLevels() const { return _mipLevels; }
 		[[nodiscard]] uint32_t getArrayLayers() const { return _arrayLayers; }
 
+		// requirements of the memory of an image created with these parameters (without creating it)
+		static VkMemoryRequirements getMemoryRequirements(const Device& device, const ImageParams& params);
+
     private:
+        void createImageViews(const ImageParams& params);
+
         const Device& _device;
         VkImage _vkImage = VK_NULL_HANDLE;
-    	VmaAllocation _allocation = VK_NULL_HANDLE;
+    	VmaAllocation _allocation = VK_NULL_HANDLE; // null if the memory is not owned
         VkImageView _imageView = VK_NULL_HANDLE;
     	std::vector<VkImageView> _subViews {};
 		VkFormat _format;
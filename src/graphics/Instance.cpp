@@ -10,7 +10,7 @@
 
 namespace m1
 {
-    Instance::Instance()
+    Instance::Instance(bool headless) : _headless(headless)
     {
         Log::Get().Info("Creating instance");
         createInstance();
@@ -48,6 +48,10 @@ namespace m1
 
     std::vector<const char*> Instance::getRequiredExtensions()
     {
+        // offscreen rendering doesn't present anything, so it doesn't need the surface extensions (and GLFW isn't initialized)
+        if (_headless)
+            return {};
+
         // GLFW has a handy built-in function that returns the extension(s) needed to interface with the Window system
         uint32_t glfwExtensionCount = 0;
         const char** glfwExtensions;
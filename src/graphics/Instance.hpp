@@ -10,7 +10,8 @@ namespace m1
     public:
     	static constexpr int VK_API_VERSION = VK_API_VERSION_1_3;
 
-        Instance();
+        // in headless mode no window system (surface) extensions are requested
+        explicit Instance(bool headless = false);
         ~Instance();
 
         // Non-copyable, non-movable
@@ -26,5 +27,6 @@ namespace m1
         std::vector<const char*> getRequiredExtensions();
 
         VkInstance _vkInstance = VK_NULL_HANDLE;
+        bool _headless = false;
     };
 }
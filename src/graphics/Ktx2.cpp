@@ -0,0 +1,306 @@
+#include "Ktx2.hpp"
+#include "Image.hpp"
+#include "UploadBatcher.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace m1
+{
+	namespace
+	{
+		constexpr std::array<uint8_t, 12> IDENTIFIER = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+		// identifier included, so that the 64-bit fields are aligned
+		struct Header
+		{
+			std::array<uint8_t, 12> identifier;
+			uint32_t vkFormat;
+			uint32_t typeSize;
+			uint32_t pixelWidth;
+			uint32_t pixelHeight;
+			uint32_t pixelDepth;
+			uint32_t layerCount;
+			uint32_t faceCount;
+			uint32_t levelCount;
+			uint32_t supercompressionScheme;
+			// index
+			uint32_t dfdByteOffset;
+			uint32_t dfdByteLength;
+			uint32_t kvdByteOffset;
+			uint32_t kvdByteLength;
+			uint64_t sgdByteOffset;
+			uint64_t sgdByteLength;
+		};
+		static_assert(sizeof(Header) == 80);
+
+		struct LevelIndex
+		{
+			uint64_t byteOffset;
+			uint64_t byteLength;
+			uint64_t uncompressedByteLength;
+		};
+
+		// Khronos Data Format basic descriptor block (https://registry.khronos.org/DataFormat/specs/1.3/dataformat.1.3.html)
+		struct DfdSample
+		{
+			uint16_t bitOffset;
+			uint8_t bitLength; // minus 1
+			uint8_t channelType; // channel id | qualifiers
+			uint8_t samplePosition[4];
+			uint32_t sampleLower;
+			uint32_t sampleUpper;
+		};
+		static_assert(sizeof(DfdSample) == 16);
+
+		struct DfdBlock
+		{
+			uint32_t vendorAndType = 0; // Khronos, basic format
+			uint16_t versionNumber = 2;
+			uint16_t descriptorBlockSize;
+			uint8_t colorModel;
+			uint8_t colorPrimaries = 1; // BT.709
+			uint8_t transferFunction;
+			uint8_t flags = 0; // straight alpha
+			uint8_t texelBlockDimension[4] = { 3, 3, 0, 0 }; // 4x4 (minus 1)
+			uint8_t bytesPlane[8] = { 16, 0, 0, 0, 0, 0, 0, 0 };
+		};
+		static_assert(sizeof(DfdBlock) == 24);
+
+		constexpr uint8_t KHR_DF_MODEL_BC5 = 132;
+		constexpr uint8_t KHR_DF_MODEL_BC6H = 133;
+		constexpr uint8_t KHR_DF_MODEL_BC7 = 134;
+		constexpr uint8_t KHR_DF_TRANSFER_LINEAR = 1;
+		constexpr uint8_t KHR_DF_TRANSFER_SRGB = 2;
+		constexpr uint8_t KHR_DF_SAMPLE_DATATYPE_FLOAT = 0x80;
+		constexpr uint32_t FLOAT_ONE = 0x3F800000;
+
+		// all the faces of a level
+		VkDeviceSize getLevelSize(const Ktx2Image& image, uint32_t level)
+		{
+			return computeImageSize(image.format, std::max(image.width >> level, 1u), std::max(image.height >> level, 1u)) * image.faces;
+		}
+
+		std::vector<uint8_t> createDataFormatDescriptor(VkFormat format)
+		{
+			DfdBlock block{};
+			std::vector<DfdSample> samples;
+			switch (format)
+			{
+				case VK_FORMAT_BC5_UNORM_BLOCK:
+					block.colorModel = KHR_DF_MODEL_BC5;
+					block.transferFunction = KHR_DF_TRANSFER_LINEAR;
+					samples.push_back({ .bitOffset = 0, .bitLength = 63, .channelType = 0, .sampleUpper = UINT32_MAX }); // red
+					samples.push_back({ .bitOffset = 64, .bitLength = 63, .channelType = 1, .sampleUpper = UINT32_MAX }); // green
+					break;
+				case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+					block.colorModel = KHR_DF_MODEL_BC6H;
+					block.transferFunction = KHR_DF_TRANSFER_LINEAR;
+					samples.push_back({ .bitOffset = 0, .bitLength = 127, .channelType = KHR_DF_SAMPLE_DATATYPE_FLOAT, .sampleUpper = FLOAT_ONE });
+					break;
+				case VK_FORMAT_BC7_UNORM_BLOCK:
+				case VK_FORMAT_BC7_SRGB_BLOCK:
+					block.colorModel = KHR_DF_MODEL_BC7;
+					block.transferFunction = format == VK_FORMAT_BC7_SRGB_BLOCK ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+					samples.push_back({ .bitOffset = 0, .bitLength = 127, .channelType = 0, .sampleUpper = UINT32_MAX });
+					break;
+				default:
+					Log::Get().Error("KTX2: format not supported");
+					throw std::runtime_error("KTX2: format not supported");
+			}
+			block.descriptorBlockSize = static_cast<uint16_t>(sizeof(DfdBlock) + samples.size() * sizeof(DfdSample));
+
+			// total size, then the block
+			uint32_t totalSize = sizeof(uint32_t) + block.descriptorBlockSize;
+			std::vector<uint8_t> dfd(totalSize);
+			std::memcpy(dfd.data(), &totalSize, sizeof(uint32_t));
+			std::memcpy(dfd.data() + sizeof(uint32_t), &block, sizeof(DfdBlock));
+			std::memcpy(dfd.data() + sizeof(uint32_t) + sizeof(DfdBlock), samples.data(), samples.size() * sizeof(DfdSample));
+			return dfd;
+		}
+	}
+
+	std::optional<Ktx2Image> readKtx2(const std::string& filePath, uint32_t maxExtent)
+	{
+		std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return std::nullopt;
+
+		auto fileSize = static_cast<uint64_t>(file.tellg());
+		file.seekg(0);
+
+		Header header{};
+		if (fileSize < sizeof(Header) || !file.read(reinterpret_cast<char*>(&header), sizeof(Header)) || header.identifier != IDENTIFIER)
+		{
+			Log::Get().Warning("Invalid KTX2 file: " + filePath);
+			return std::nullopt;
+		}
+
+		Ktx2Image image
+		{
+			.format = static_cast<VkFormat>(header.vkFormat),
+			.width = header.pixelWidth,
+			.height = header.pixelHeight,
+			.mipLevels = header.levelCount,
+			.faces = header.faceCount,
+		};
+
+		// levelCount 0 asks the loader to generate the mips, not supported for the block compressed formats
+		if (!isBlockCompressed(image.format) || header.supercompressionScheme != 0 || header.pixelDepth != 0 ||
+			header.layerCount > 1 || (image.faces != 1 && image.faces != 6) || image.width == 0 || image.height == 0 ||
+			image.mipLevels == 0 || image.mipLevels > computeMipLevels(image.width, image.height))
+		{
+			Log::Get().Warning("KTX2 file not supported: " + filePath);
+			return std::nullopt;
+		}
+
+		std::vector<LevelIndex> levels(image.mipLevels);
+		if (!file.read(reinterpret_cast<char*>(levels.data()), static_cast<std::streamsize>(levels.size() * sizeof(LevelIndex))))
+		{
+			Log::Get().Warning("Invalid KTX2 file: " + filePath);
+			return std::nullopt;
+		}
+
+		while (image.firstLevel + 1 < image.mipLevels && std::max(image.width, image.height) >> image.firstLevel > maxExtent)
+			image.firstLevel++;
+
+		VkDeviceSize dataSize = 0;
+		for (uint32_t level = image.firstLevel; level < image.mipLevels; level++)
+			dataSize += getLevelSize(image, level);
+		image.data.resize(dataSize);
+
+		VkDeviceSize offset = 0;
+		for (uint32_t level = image.firstLevel; level < image.mipLevels; level++)
+		{
+			auto levelSize = getLevelSize(image, level);
+			const auto& levelIndex = levels[level];
+			if (levelIndex.byteLength != levelSize || levelIndex.byteOffset > fileSize || fileSize - levelIndex.byteOffset < levelSize ||
+				!file.seekg(static_cast<std::streamoff>(levelIndex.byteOffset)) ||
+				!file.read(image.data.data() + offset, static_cast<std::streamsize>(levelSize)))
+			{
+				Log::Get().Warning("Invalid KTX2 file: " + filePath);
+				return std::nullopt;
+			}
+			offset += levelSize;
+		}
+
+		return image;
+	}
+
+	void writeKtx2(const std::string& filePath, const Ktx2Image& image)
+	{
+		if (image.firstLevel != 0)
+		{
+			Log::Get().Error("KTX2: the image to write misses its largest levels");
+			throw std::runtime_error("KTX2: the image to write misses its largest levels");
+		}
+
+		auto dfd = createDataFormatDescriptor(image.format);
+
+		// the levels are stored from the smallest, each aligned to the block size (16 bytes)
+		constexpr uint64_t LEVEL_ALIGNMENT = 16;
+		uint64_t dfdOffset = sizeof(Header) + image.mipLevels * sizeof(LevelIndex);
+		uint64_t offset = dfdOffset + dfd.size();
+
+		std::vector<LevelIndex> levels(image.mipLevels);
+		for (uint32_t level = image.mipLevels; level-- > 0;)
+		{
+			offset = (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+			auto levelSize = getLevelSize(image, level);
+			levels[level] = { offset, levelSize, levelSize };
+			offset += levelSize;
+		}
+
+		Header header
+		{
+			.identifier = IDENTIFIER,
+			.vkFormat = static_cast<uint32_t>(image.format),
+			.typeSize = 1, // block compressed formats
+			.pixelWidth = image.width,
+			.pixelHeight = image.height,
+			.pixelDepth = 0,
+			.layerCount = 0,
+			.faceCount = image.faces,
+			.levelCount = image.mipLevels,
+			.supercompressionScheme = 0,
+			.dfdByteOffset = static_cast<uint32_t>(dfdOffset),
+			.dfdByteLength = static_cast<uint32_t>(dfd.size()),
+		};
+
+		std::vector<char> content(offset, 0);
+		std::memcpy(content.data(), &header, sizeof(Header));
+		std::memcpy(content.data() + sizeof(Header), levels.data(), levels.size() * sizeof(LevelIndex));
+		std::memcpy(content.data() + dfdOffset, dfd.data(), dfd.size());
+
+		VkDeviceSize dataOffset = 0;
+		for (uint32_t level = 0; level < image.mipLevels; level++)
+		{
+			auto levelSize = getLevelSize(image, level);
+			if (dataOffset + levelSize > image.data.size())
+			{
+				Log::Get().Error("KTX2: image data smaller than its mip chain");
+				throw std::runtime_error("KTX2: image data smaller than its mip chain");
+			}
+
+			std::memcpy(content.data() + levels[level].byteOffset, image.data.data() + dataOffset, levelSize);
+			dataOffset += levelSize;
+		}
+
+		std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open() || !file.write(content.data(), static_cast<std::streamsize>(content.size())))
+		{
+			Log::Get().Error("Failed to write the KTX2 file: " + filePath);
+			throw std::runtime_error("Failed to write the KTX2 file: " + filePath);
+		}
+	}
+
+	std::shared_ptr<Image> uploadKtx2Image(const Device& device, UploadBatcher& uploadBatcher, const Ktx2Image& ktxImage,
+		std::shared_future<void>* uploaded)
+	{
+		ImageParams params
+		{
+			.extent = {std::max(ktxImage.width >> ktxImage.firstLevel, 1u), std::max(ktxImage.height >> ktxImage.firstLevel, 1u)},
+			.format = ktxImage.format,
+			.flags = ktxImage.faces == 6 ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0u,
+			.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // no mipmaps generation
+			.mipLevels = ktxImage.mipLevels - ktxImage.firstLevel,
+			.arrayLayers = ktxImage.faces,
+			.sharing = QueueSharing::Upload,
+		};
+		auto image = std::make_shared<Image>(device, params);
+
+		auto future = uploadBatcher.uploadImage(*image, ktxImage.data.data(), ktxImage.data.size(), true);
+		if (uploaded)
+			*uploaded = std::move(future);
+
+		return image;
+	}
+
+	std::string getKtx2Path(const std::string& sourcePath)
+	{
+		return std::filesystem::path(sourcePath).replace_extension(".ktx2").string();
+	}
+
+	bool isCompressedFormatCompatible(VkFormat compressedFormat, VkFormat format)
+	{
+		switch (format)
+		{
+			case VK_FORMAT_R8G8B8A8_SRGB:
+				return compressedFormat == VK_FORMAT_BC7_SRGB_BLOCK;
+			case VK_FORMAT_R8G8B8A8_UNORM:
+				return compressedFormat == VK_FORMAT_BC7_UNORM_BLOCK || compressedFormat == VK_FORMAT_BC5_UNORM_BLOCK;
+			case VK_FORMAT_R16G16B16A16_SFLOAT:
+			case VK_FORMAT_R32G32B32A32_SFLOAT:
+				return compressedFormat == VK_FORMAT_BC6H_UFLOAT_BLOCK;
+			default:
+				return false;
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace m1
+{
+	class Device;
+	class Image;
+	class UploadBatcher;
+
+	// 2D texture (or cubemap with 6 faces) with its full mip chain, as stored in a KTX2 file
+	struct Ktx2Image
+	{
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 1;
+		uint32_t faces = 1;
+		uint32_t firstLevel = 0; // the levels before it are not loaded (width and height are the extent of the level 0)
+		std::vector<char> data; // the loaded levels (largest first), each with all the faces, tightly packed
+	};
+
+	/*
+		Minimal KTX2 (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html) reader and writer of the textures
+		baked by the texture baker: block compressed formats only (BC5, BC6H, BC7), no supercompression, no arrays.
+		Returns nullopt if the file is missing or (with a warning) not supported, so the caller can fall back to the source image
+	*/
+	// only the levels not larger than maxExtent are loaded (at least the smallest one), e.g. the mip tail of a streamed texture
+	std::optional<Ktx2Image> readKtx2(const std::string& filePath, uint32_t maxExtent = UINT32_MAX);
+	// all the levels must be loaded, throws if the file can't be written
+	void writeKtx2(const std::string& filePath, const Ktx2Image& image);
+
+	// image of the loaded levels (SHADER_READ_ONLY_OPTIMAL layout, ready after the next flush of the upload batcher).
+	// uploaded (optional) receives the future of the upload
+	std::shared_ptr<Image> uploadKtx2Image(const Device& device, UploadBatcher& uploadBatcher, const Ktx2Image& ktxImage,
+		std::shared_future<void>* uploaded = nullptr);
+
+	// the baked texture is stored next to its source image, with the .ktx2 extension
+	std::string getKtx2Path(const std::string& sourcePath);
+	// whether a baked texture can replace a source image loaded with the given format:
+	// SRGB => BC7 SRGB, UNORM => BC7 UNORM or BC5 (normal maps), float => BC6H
+	bool isCompressedFormatCompatible(VkFormat compressedFormat, VkFormat format);
+}
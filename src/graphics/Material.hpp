@@ -3,6 +3,7 @@
 #include "Texture.hpp"
 
 #include <string>
+#include <vector>
 #include "glm_config.hpp"
 #include "Pipeline.hpp"
 
@@ -71,9 +72,9 @@ namespace m1
 	    	shininess = glm::mix(1.0f, 256.0f, normalizedShininess);
 	    }
 
-		VkDescriptorSet getDescriptorSet(PipelineType pipeLineType) const
+		VkDescriptorSet getDescriptorSet(PipelineType pipeLineType, uint32_t frameIndex) const
 		{
-			return pipeLineType == PipelineType::PbrLighting ? descriptorSetPbr : descriptorSetPhong;
+			return pipeLineType == PipelineType::PbrLighting ? descriptorSetsPbr[frameIndex] : descriptorSetsPhong[frameIndex];
 		}
 
 		// Properties
@@ -100,7 +101,9 @@ namespace m1
 	    std::shared_ptr<Texture> metallicRoughnessMap;
 	    std::shared_ptr<Texture> occlusionMap;
 	    std::shared_ptr<Texture> emissiveMap;
-	    VkDescriptorSet descriptorSetPhong = VK_NULL_HANDLE;
-	    VkDescriptorSet descriptorSetPbr = VK_NULL_HANDLE;
+	    // one for each frame in flight, so that the textures can be replaced while the previous frames are rendering
+	    std::vector<VkDescriptorSet> descriptorSetsPhong;
+	    std::vector<VkDescriptorSet> descriptorSetsPbr;
+	    uint32_t staleDescriptorSets = 0; // bit mask of the frames whose descriptor sets reference replaced textures
     };
 }
@@ -0,0 +1,142 @@
+#include "ParallelCommandRecorder.hpp"
+#include "Device.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+
+// std
+#include <algorithm>
+#include <format>
+
+namespace m1
+{
+	ParallelCommandRecorder::ParallelCommandRecorder(const Device& device, uint32_t framesInFlight, uint32_t threadCount) :
+		_device(device), _frames(framesInFlight), _threadPool(threadCount)
+	{
+		Log::Get().Info(std::format("Creating parallel command recorder, {} threads", _threadPool.getThreadCount()));
+	}
+
+	ParallelCommandRecorder::~ParallelCommandRecorder()
+	{
+		Log::Get().Info("Parallel command recorder destroyed");
+	}
+
+	void ParallelCommandRecorder::beginFrame(uint32_t frameSlot)
+	{
+		_currentSlot = frameSlot;
+
+		// the command buffers of the slot are not in use anymore: they are all reset with their pools
+		auto& frame = _frames[_currentSlot];
+		frame.freeContexts.clear();
+		for (auto& context : frame.contexts)
+		{
+			VK_CHECK(vkResetCommandPool(_device.getVkDevice(), context->commandPool->getVkCommandPool(), 0));
+			context->usedCount = 0;
+			frame.freeContexts.push_back(context.get());
+		}
+	}
+
+	void ParallelCommandRecorder::record(const RenderingFormats& formats, uint32_t itemCount,
+		std::function<void(VkCommandBuffer, uint32_t, uint32_t)> record, SecondaryCommands& commands)
+	{
+		// as many chunks as threads, unless they would be too small (at least one chunk, e.g. for the passes without items)
+		uint32_t chunkCount = std::clamp((itemCount + MIN_ITEMS_PER_CHUNK - 1) / MIN_ITEMS_PER_CHUNK, 1u, _threadPool.getThreadCount());
+		uint32_t chunkSize = (itemCount + chunkCount - 1) / chunkCount;
+
+		// shared by the jobs of the chunks
+		auto sharedFormats = std::make_shared<RenderingFormats>(formats);
+		auto sharedRecord = std::make_shared<std::function<void(VkCommandBuffer, uint32_t, uint32_t)>>(std::move(record));
+
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			uint32_t first = std::min(chunk * chunkSize, itemCount);
+			uint32_t count = std::min(chunkSize, itemCount - first);
+			commands.push_back(_threadPool.submit([this, sharedFormats, sharedRecord, first, count]
+			{
+				return recordChunk(*sharedFormats, first, count, *sharedRecord);
+			}));
+		}
+	}
+
+	void ParallelCommandRecorder::execute(VkCommandBuffer commandBuffer, SecondaryCommands& commands)
+	{
+		std::vector<VkCommandBuffer> commandBuffers;
+		commandBuffers.reserve(commands.size());
+		for (auto& command : commands)
+			commandBuffers.push_back(command.get()); // rethrows the recording errors
+
+		if (!commandBuffers.empty())
+			vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		commands.clear();
+	}
+
+	ParallelCommandRecorder::RecordingContext* ParallelCommandRecorder::acquireContext()
+	{
+		std::lock_guard lock(_mutex);
+
+		auto& frame = _frames[_currentSlot];
+		if (frame.freeContexts.empty())
+		{
+			auto context = std::make_unique<RecordingContext>();
+			context->commandPool = std::make_unique<CommandPool>(_device, _device.getQueueFamilyIndices().graphicsFamily.value(),
+				VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+			frame.freeContexts.push_back(context.get());
+			frame.contexts.push_back(std::move(context));
+		}
+
+		auto* context = frame.freeContexts.back();
+		frame.freeContexts.pop_back();
+		return context;
+	}
+
+	void ParallelCommandRecorder::releaseContext(RecordingContext* context)
+	{
+		std::lock_guard lock(_mutex);
+		_frames[_currentSlot].freeContexts.push_back(context);
+	}
+
+	VkCommandBuffer ParallelCommandRecorder::recordChunk(const RenderingFormats& formats, uint32_t first, uint32_t count,
+		const std::function<void(VkCommandBuffer, uint32_t, uint32_t)>& record)
+	{
+		auto* context = acquireContext();
+
+		// the command buffers are kept (and reset with the pool) from one use of the frame slot to the next
+		if (context->usedCount == context->commandBuffers.size())
+			context->commandBuffers.push_back(context->commandPool->allocateCommandBuffers(1, VK_COMMAND_BUFFER_LEVEL_SECONDARY)[0]);
+		VkCommandBuffer commandBuffer = context->commandBuffers[context->usedCount++];
+
+		VkCommandBufferInheritanceRenderingInfo renderingInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+			.colorAttachmentCount = static_cast<uint32_t>(formats.colorFormats.size()),
+			.pColorAttachmentFormats = formats.colorFormats.data(),
+			.depthAttachmentFormat = formats.depthFormat,
+			.rasterizationSamples = formats.samples,
+		};
+		VkCommandBufferInheritanceInfo inheritanceInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+			.pNext = &renderingInfo,
+		};
+		VkCommandBufferBeginInfo beginInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+			.pInheritanceInfo = &inheritanceInfo,
+		};
+
+		try
+		{
+			VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+			record(commandBuffer, first, count);
+			VK_CHECK(vkEndCommandBuffer(commandBuffer));
+		}
+		catch (...)
+		{
+			releaseContext(context);
+			throw;
+		}
+
+		releaseContext(context);
+		return commandBuffer;
+	}
+}
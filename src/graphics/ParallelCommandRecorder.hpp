@@ -0,0 +1,97 @@
+#pragma once
+
+#include "CommandPool.hpp"
+#include "ThreadPool.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace m1
+{
+	class Device;
+
+	// attachments of the dynamic rendering continued by the secondary command buffers
+	struct RenderingFormats
+	{
+		std::vector<VkFormat> colorFormats;
+		VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	};
+
+	// secondary command buffers being recorded, executed in order
+	using SecondaryCommands = std::vector<std::future<VkCommandBuffer>>;
+
+	/*
+		Records the draws of a rendering pass on worker threads, into secondary command buffers executed by the primary
+		command buffer inside its dynamic rendering (begun with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT).
+		A command pool can only be used by one thread at a time: each job takes a recording context (command pool and
+		its secondary command buffers) for the duration of the recording, so there are at most as many contexts as worker
+		threads for each frame in flight. The pools of a frame slot are reset as a whole by beginFrame.
+	*/
+	class ParallelCommandRecorder
+	{
+	public:
+		// draws recorded by a secondary command buffer, below that the recording overhead is not worth it
+		static constexpr uint32_t MIN_ITEMS_PER_CHUNK = 256;
+
+		// threadCount: 0 => one thread for each hardware thread
+		ParallelCommandRecorder(const Device& device, uint32_t framesInFlight, uint32_t threadCount = 0);
+		~ParallelCommandRecorder();
+
+		// Non-copyable, non-movable
+		ParallelCommandRecorder(const ParallelCommandRecorder&) = delete;
+		ParallelCommandRecorder& operator=(const ParallelCommandRecorder&) = delete;
+		ParallelCommandRecorder(ParallelCommandRecorder&&) = delete;
+		ParallelCommandRecorder& operator=(ParallelCommandRecorder&&) = delete;
+
+		// must be called when the previous submission of the frame slot is completed, before any record
+		void beginFrame(uint32_t frameSlot);
+
+		// splits [0, itemCount) into chunks recorded in parallel: record(commandBuffer, first, count) is called once per
+		// chunk, from the worker threads (it must only read the shared state). The dynamic states are not inherited: the
+		// callback sets them. The secondary command buffers are appended to commands, in the order of the items
+		void record(const RenderingFormats& formats, uint32_t itemCount,
+			std::function<void(VkCommandBuffer, uint32_t, uint32_t)> record, SecondaryCommands& commands);
+
+		// waits for the recordings and executes the command buffers (inside the rendering of the primary command buffer)
+		static void execute(VkCommandBuffer commandBuffer, SecondaryCommands& commands);
+
+		[[nodiscard]] uint32_t getThreadCount() const { return _threadPool.getThreadCount(); }
+		// the worker threads are idle outside of the recordings, other per-frame jobs can use them
+		[[nodiscard]] ThreadPool& getThreadPool() { return _threadPool; }
+
+	private:
+		// used by one thread at a time
+		struct RecordingContext
+		{
+			std::unique_ptr<CommandPool> commandPool;
+			std::vector<VkCommandBuffer> commandBuffers;
+			uint32_t usedCount = 0;
+		};
+
+		struct FrameContexts
+		{
+			std::vector<std::unique_ptr<RecordingContext>> contexts;
+			std::vector<RecordingContext*> freeContexts;
+		};
+
+		const Device& _device;
+		std::vector<FrameContexts> _frames;
+		uint32_t _currentSlot = 0;
+		std::mutex _mutex; // free contexts
+		ThreadPool _threadPool;
+
+		RecordingContext* acquireContext();
+		void releaseContext(RecordingContext* context);
+		VkCommandBuffer recordChunk(const RenderingFormats& formats, uint32_t first, uint32_t count,
+			const std::function<void(VkCommandBuffer, uint32_t, uint32_t)>& record);
+	};
+}
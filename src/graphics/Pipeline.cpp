@@ -1,5 +1,6 @@
 #include "Pipeline.hpp"
 #include "Device.hpp"
+#include "PipelineCache.hpp"
 #include "Utils.hpp"
 #include "Vertex.hpp"
 #include "Log.hpp"
@@ -36,6 +37,41 @@ namespace m1
 
 		_shaderStages.push_back(shaderStageInfo);
 		_shaderPaths.push_back(shaderPath);
+		_specializationConstants.emplace_back();
+
+		return *this;
+	}
+
+	GraphicsPipelineBuilder& GraphicsPipelineBuilder::setSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constantId, uint32_t value)
+	{
+		for (size_t i = 0; i < _shaderStages.size(); i++)
+		{
+			if (_shaderStages[i].stage != stage)
+				continue;
+
+			auto& constants = _specializationConstants[i];
+
+			// overwrite the value if the constant is already set
+			bool found = false;
+			for (const auto& entry : constants.entries)
+			{
+				if (entry.constantID == constantId)
+				{
+					constants.data[entry.offset / sizeof(uint32_t)] = value;
+					found = true;
+				}
+			}
+
+			if (!found)
+			{
+				constants.entries.push_back({
+					.constantID = constantId,
+					.offset     = static_cast<uint32_t>(constants.data.size() * sizeof(uint32_t)),
+					.size       = sizeof(uint32_t),
+				});
+				constants.data.push_back(value);
+			}
+		}
 
 		return *this;
 	}
@@ -49,10 +85,13 @@ namespace m1
 
 	GraphicsPipelineBuilder& GraphicsPipelineBuilder::clearVertexInput()
 	{
-		_vertexInput.vertexBindingDescriptionCount = 0;
-		_vertexInput.pVertexBindingDescriptions = nullptr;
-		_vertexInput.vertexAttributeDescriptionCount = 0;
-		_vertexInput.pVertexAttributeDescriptions = nullptr;
+		_vertexLayout = {};
+		return *this;
+	}
+
+	GraphicsPipelineBuilder& GraphicsPipelineBuilder::setVertexFormat(VertexFormat format, bool positionOnly)
+	{
+		_vertexLayout = VertexLayout::get(format, positionOnly);
 		return *this;
 	}
 
@@ -222,13 +261,25 @@ namespace m1
 	/**
 	 * Create the graphics pipeline.
 	 */
-	std::unique_ptr<Pipeline> GraphicsPipelineBuilder::build(const Device& device)
+	std::unique_ptr<Pipeline> GraphicsPipelineBuilder::build(const Device& device, PipelineCache* pipelineCache)
 	{
 		for (size_t i = 0; i < _shaderPaths.size(); i++)
 		{
-			VkShaderModule shaderModule = createShaderModule(device, _shaderPaths[i]);
+			VkShaderModule shaderModule = pipelineCache ? pipelineCache->getShaderModule(_shaderPaths[i]) : createShaderModule(device, _shaderPaths[i]);
 
 			_shaderStages[i].module = shaderModule;
+
+			auto& constants = _specializationConstants[i];
+			if (!constants.entries.empty())
+			{
+				constants.info = {
+					.mapEntryCount = static_cast<uint32_t>(constants.entries.size()),
+					.pMapEntries   = constants.entries.data(),
+					.dataSize      = constants.data.size() * sizeof(uint32_t),
+					.pData         = constants.data.data(),
+				};
+				_shaderStages[i].pSpecializationInfo = &constants.info;
+			}
 		}
 
 		VkPipelineDynamicStateCreateInfo dynamicState
@@ -263,6 +314,11 @@ namespace m1
 			.blendConstants  = {0.0f, 0.0f, 0.0f, 0.0f} // Optional,
 		};
 
+		_vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(_vertexLayout.bindings.size());
+		_vertexInput.pVertexBindingDescriptions = _vertexLayout.bindings.data();
+		_vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(_vertexLayout.attributes.size());
+		_vertexInput.pVertexAttributeDescriptions = _vertexLayout.attributes.data();
+
 		if (_colorAttachmentFormats.size() > 0)
 		{
 			_rendering.colorAttachmentCount = static_cast<uint32_t>(_colorAttachmentFormats.size());
@@ -302,11 +358,15 @@ namespace m1
 
 		// create the graphics pipeline
 		VkPipeline graphicsPipeline;
-		VK_CHECK(vkCreateGraphicsPipelines(device.getVkDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline));
+		VkPipelineCache vkPipelineCache = pipelineCache ? pipelineCache->getVkPipelineCache() : VK_NULL_HANDLE;
+		VK_CHECK(vkCreateGraphicsPipelines(device.getVkDevice(), vkPipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline));
 
-		// destroy shader modules
-		for (auto& _shaderStage: _shaderStages)
-			vkDestroyShaderModule(device.getVkDevice(), _shaderStage.module, nullptr);
+		// destroy shader modules (the cached ones are owned by the cache)
+		if (!pipelineCache)
+		{
+			for (auto& _shaderStage: _shaderStages)
+				vkDestroyShaderModule(device.getVkDevice(), _shaderStage.module, nullptr);
+		}
 
 		return std::make_unique<Pipeline>(device, graphicsPipeline, pipelineLayout);
 	}
@@ -337,9 +397,9 @@ namespace m1
 		return *this;
 	}
 
-	std::unique_ptr<Pipeline> ComputePipelineBuilder::build(const Device& device)
+	std::unique_ptr<Pipeline> ComputePipelineBuilder::build(const Device& device, PipelineCache* pipelineCache)
 	{
-		VkShaderModule shaderModule = createShaderModule(device, _shaderPath);
+		VkShaderModule shaderModule = pipelineCache ? pipelineCache->getShaderModule(_shaderPath) : createShaderModule(device, _shaderPath);
 		_shaderStage.module = shaderModule;
 
 		// layout info: specify layout of dynamic values (descriptors and push constant) for shaders
@@ -363,9 +423,11 @@ namespace m1
 		};
 
 		VkPipeline computePipeline;
-		VK_CHECK(vkCreateComputePipelines(device.getVkDevice(), VK_NULL_HANDLE, 1, &computePipelineInfo, nullptr, &computePipeline));
+		VkPipelineCache vkPipelineCache = pipelineCache ? pipelineCache->getVkPipelineCache() : VK_NULL_HANDLE;
+		VK_CHECK(vkCreateComputePipelines(device.getVkDevice(), vkPipelineCache, 1, &computePipelineInfo, nullptr, &computePipeline));
 
-		vkDestroyShaderModule(device.getVkDevice(), _shaderStage.module, nullptr);
+		if (!pipelineCache)
+			vkDestroyShaderModule(device.getVkDevice(), _shaderStage.module, nullptr);
 
 		return std::make_unique<Pipeline>(device, computePipeline, pipelineLayout);
 
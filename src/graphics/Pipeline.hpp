@@ -15,6 +15,7 @@ namespace m1
 {
 	class Device; // Forward declaration
 	class SwapChain; // Forward declaration
+	class PipelineCache; // Forward declaration
 
 	enum class PipelineType
 	{
@@ -30,10 +31,19 @@ namespace m1
 		BrdfLUT,
 	};
 
-	struct PushConstantData
+	struct CullingPushConstantData
 	{
-		glm::mat4 model;
-		alignas(16) glm::mat3 normalMatrix; // https://vulkan-tutorial.com/Uniform_buffers/Descriptor_pool_and_sets#page_Alignment-requirements
+		uint32_t objectCount;
+		uint32_t batchCount;
+		uint32_t cascadeMask;     // shadow cascades whose casters are culled (the ones rendered this frame)
+		uint32_t commandsPerPass; // commands (and instances) of each pass: main pass, then one per shadow cascade
+		glm::vec4 cameraPosition; // w = 0 => orthographic projection, no cone culling of the meshlets
+		uint32_t maxMeshletGroups; // device limit of the meshlet culling dispatch, the work groups loop over the other tasks
+	};
+
+	struct ShadowPushConstantData
+	{
+		uint32_t cascadeIndex; // layer of the shadow map
 	};
 
 	struct IblPushConstantData
@@ -42,6 +52,8 @@ namespace m1
 		float roughness;
 	};
 
+	VkShaderModule createShaderModule(const Device& device, const std::string& shaderPath);
+
 	class Pipeline
 	{
 	public:
@@ -70,6 +82,15 @@ namespace m1
 		std::vector<VkPipelineShaderStageCreateInfo> _shaderStages;
 		std::vector<std::string> _shaderPaths;
 
+		// specialization constants of each shader stage (32-bit values only)
+		struct SpecializationConstants
+		{
+			std::vector<VkSpecializationMapEntry> entries;
+			std::vector<uint32_t> data;
+			VkSpecializationInfo info{};
+		};
+		std::vector<SpecializationConstants> _specializationConstants;
+
 		VkPipelineViewportStateCreateInfo _viewportState
 		{
 			.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
@@ -77,17 +98,13 @@ namespace m1
 			.scissorCount  = 1  // specifies only the count since is dynamic state
 		};
 
-		VkVertexInputBindingDescription _vertexBindingDescription = Vertex::getBindingDescription();
-		std::vector<VkVertexInputAttributeDescription> _vertexAttributeDescriptions = Vertex::getAttributeDescriptions();
+		VertexLayout _vertexLayout = VertexLayout::get(VertexFormat::Standard);
 
 		// vertex info: describes the format of the vertex data that will be passed to the vertex shader
+		// (the descriptions are pointed by build(), the builder can be copied)
 		VkPipelineVertexInputStateCreateInfo _vertexInput
 		{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-			.vertexBindingDescriptionCount = 1,
-			.pVertexBindingDescriptions = &_vertexBindingDescription,
-			.vertexAttributeDescriptionCount = static_cast<uint32_t>(_vertexAttributeDescriptions.size()),
-			.pVertexAttributeDescriptions = _vertexAttributeDescriptions.data(),
 		};
 
 		// assembly info: primitive topology
@@ -172,15 +189,7 @@ namespace m1
 
 		std::vector<VkDescriptorSetLayout> _setLayouts{};
 
-		std::vector<VkPushConstantRange> _pushConstantRanges
-		{
-			VkPushConstantRange
-			{
-				.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, // shaders that can access the push constants
-				.offset     = 0, // mainly for if using separate ranges for vertex and fragments shaders
-				.size       = sizeof(PushConstantData),
-			}
-		};
+		std::vector<VkPushConstantRange> _pushConstantRanges{}; // the per object data is read from the objects SSBO
 
 		// rendering info: color and depth attachments
 		std::vector<VkFormat> _colorAttachmentFormats{};
@@ -195,10 +204,16 @@ namespace m1
 	public:
 		GraphicsPipelineBuilder& addShaderStage(const std::string& shaderPath, VkShaderStageFlagBits stage, const char* entryPoint = "main");
 
+		// set the value of a specialization constant (layout(constant_id = constantId)) of an already added stage
+		GraphicsPipelineBuilder& setSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constantId, uint32_t value);
+
 		GraphicsPipelineBuilder& setViewportState(uint32_t viewportCount, uint32_t scissorCount);
 
 		GraphicsPipelineBuilder& clearVertexInput();
 
+		// vertex input state matching the vertex format of the geometry (Standard by default)
+		GraphicsPipelineBuilder& setVertexFormat(VertexFormat format, bool positionOnly = false);
+
 		GraphicsPipelineBuilder& setPrimitiveTopology(VkPrimitiveTopology topology);
 
 		GraphicsPipelineBuilder& setRasterizationState(VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL,
@@ -244,8 +259,9 @@ namespace m1
 
 		/**
 		 * Create the graphics pipeline.
+		 * With a pipeline cache the shader modules are shared and the compiled pipeline is looked up/stored in the cache.
 		 */
-		[[nodiscard]] std::unique_ptr<Pipeline> build(const Device& device);
+		[[nodiscard]] std::unique_ptr<Pipeline> build(const Device& device, PipelineCache* pipelineCache = nullptr);
 	};
 
 	class ComputePipelineBuilder
@@ -268,6 +284,6 @@ namespace m1
 		ComputePipelineBuilder& addSetLayout(VkDescriptorSetLayout descriptorSetLayout);
 		ComputePipelineBuilder& addPushConstantRange(VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size);
 
-		std::unique_ptr<Pipeline> build(const Device& device);
+		std::unique_ptr<Pipeline> build(const Device& device, PipelineCache* pipelineCache = nullptr);
 	};
 }
\ No newline at end of file
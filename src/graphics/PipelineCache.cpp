@@ -0,0 +1,161 @@
+#include "PipelineCache.hpp"
+#include "Device.hpp"
+#include "Pipeline.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace m1
+{
+	PipelineCache::PipelineCache(const Device& device, std::string filePath) : _device(device), _filePath(std::move(filePath))
+	{
+		std::vector<char> data = _filePath.empty() ? std::vector<char>{} : loadFile();
+
+		VkPipelineCacheCreateInfo createInfo
+		{
+			.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+			.initialDataSize = data.size(),
+			.pInitialData    = data.empty() ? nullptr : data.data(),
+		};
+		VK_CHECK(vkCreatePipelineCache(_device.getVkDevice(), &createInfo, nullptr, &_pipelineCache));
+
+		Log::Get().Info("Pipeline cache created (" + std::to_string(data.size()) + " bytes loaded)");
+	}
+
+	PipelineCache::~PipelineCache()
+	{
+		try
+		{
+			save();
+		}
+		catch (const std::exception& e)
+		{
+			Log::Get().Warning(std::string("Failed to save the pipeline cache: ") + e.what());
+		}
+
+		for (auto& [path, shaderModule] : _shaderModules)
+			vkDestroyShaderModule(_device.getVkDevice(), shaderModule, nullptr);
+
+		vkDestroyPipelineCache(_device.getVkDevice(), _pipelineCache, nullptr);
+		Log::Get().Info("Pipeline cache destroyed");
+	}
+
+	VkShaderModule PipelineCache::getShaderModule(const std::string& shaderPath)
+	{
+		auto it = _shaderModules.find(shaderPath);
+		if (it != _shaderModules.end())
+			return it->second;
+
+		VkShaderModule shaderModule = createShaderModule(_device, shaderPath);
+		_shaderModules.emplace(shaderPath, shaderModule);
+		return shaderModule;
+	}
+
+	void PipelineCache::save() const
+	{
+		if (_filePath.empty())
+			return;
+
+		size_t dataSize = 0;
+		VK_CHECK(vkGetPipelineCacheData(_device.getVkDevice(), _pipelineCache, &dataSize, nullptr));
+		std::vector<char> data(dataSize);
+		VK_CHECK(vkGetPipelineCacheData(_device.getVkDevice(), _pipelineCache, &dataSize, data.data()));
+		data.resize(dataSize);
+
+		FileHeader header = createFileHeader();
+		header.dataSize = data.size();
+		header.dataHash = hashBytes(data.data(), data.size());
+
+		// write a temporary file and rename it: a crash while writing doesn't leave a truncated cache
+		std::string tempPath = _filePath + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				throw std::runtime_error("failed to open file: " + tempPath);
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+			file.write(data.data(), static_cast<std::streamsize>(data.size()));
+			if (!file)
+				throw std::runtime_error("failed to write file: " + tempPath);
+		}
+		std::filesystem::rename(tempPath, _filePath);
+
+		Log::Get().Info("Pipeline cache saved (" + std::to_string(data.size()) + " bytes)");
+	}
+
+	PipelineCache::FileHeader PipelineCache::createFileHeader() const
+	{
+		const auto& properties = _device.getProperties();
+
+		FileHeader header
+		{
+			.vendorId      = properties.vendorId,
+			.deviceId      = properties.deviceId,
+			.driverVersion = properties.driverVersion,
+		};
+		std::ranges::copy(properties.pipelineCacheUuid, header.pipelineCacheUuid);
+
+		return header;
+	}
+
+	std::vector<char> PipelineCache::loadFile() const
+	{
+		std::ifstream file(_filePath, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return {};
+
+		auto fileSize = static_cast<size_t>(file.tellg());
+		file.seekg(0);
+
+		FileHeader header{};
+		if (fileSize < sizeof(FileHeader) || !file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader)))
+		{
+			Log::Get().Warning("Pipeline cache file too small, ignored: " + _filePath);
+			return {};
+		}
+
+		// written by another device, driver or version of the engine
+		FileHeader expected = createFileHeader();
+		if (header.magic != expected.magic || header.version != expected.version || header.vendorId != expected.vendorId ||
+			header.deviceId != expected.deviceId || header.driverVersion != expected.driverVersion ||
+			std::memcmp(header.pipelineCacheUuid, expected.pipelineCacheUuid, VK_UUID_SIZE) != 0)
+		{
+			Log::Get().Info("Pipeline cache file created by another device or driver, ignored: " + _filePath);
+			return {};
+		}
+
+		// checked before allocating: the size read from a corrupted file can be anything
+		if (header.dataSize != fileSize - sizeof(FileHeader))
+		{
+			Log::Get().Warning("Pipeline cache file corrupted, ignored: " + _filePath);
+			return {};
+		}
+
+		std::vector<char> data(header.dataSize);
+		if (!file.read(data.data(), static_cast<std::streamsize>(data.size())) || hashBytes(data.data(), data.size()) != header.dataHash)
+		{
+			Log::Get().Warning("Pipeline cache file corrupted, ignored: " + _filePath);
+			return {};
+		}
+
+		// the driver validates its own header too, but a mismatch is not reported: check it here
+		VkPipelineCacheHeaderVersionOne cacheHeader{};
+		if (data.size() < sizeof(cacheHeader))
+			return {};
+		std::memcpy(&cacheHeader, data.data(), sizeof(cacheHeader));
+		if (cacheHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || cacheHeader.vendorID != expected.vendorId ||
+			cacheHeader.deviceID != expected.deviceId || std::memcmp(cacheHeader.pipelineCacheUUID, expected.pipelineCacheUuid, VK_UUID_SIZE) != 0)
+		{
+			Log::Get().Warning("Pipeline cache data not valid for the device, ignored: " + _filePath);
+			return {};
+		}
+
+		return data;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace m1
+{
+	class Device;
+
+	/*
+		VkPipelineCache persisted on disk and shader modules shared by the pipelines:
+		- the cache file starts with a header identifying the device and the driver (vendor, device, driver version and
+			pipeline cache UUID) and a hash of the data. A file written by another device or driver, truncated or corrupted
+			is ignored and the cache starts empty
+		- the cache is saved by the destructor (written to a temporary file, then renamed)
+		- a shader module is created once for each SPIR-V file and destroyed with the cache
+	*/
+	class PipelineCache
+	{
+	public:
+		// empty filePath => the cache is not persisted
+		PipelineCache(const Device& device, std::string filePath);
+		~PipelineCache();
+
+		// Non-copyable, non-movable
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator=(const PipelineCache&) = delete;
+		PipelineCache(PipelineCache&&) = delete;
+		PipelineCache& operator=(PipelineCache&&) = delete;
+
+		[[nodiscard]] VkPipelineCache getVkPipelineCache() const { return _pipelineCache; }
+		// the returned module is owned by the cache
+		VkShaderModule getShaderModule(const std::string& shaderPath);
+		void save() const;
+
+	private:
+		static constexpr uint32_t FILE_MAGIC = 0x4331504D; // "MP1C"
+		static constexpr uint32_t FILE_VERSION = 1;
+
+		struct FileHeader
+		{
+			uint32_t magic = FILE_MAGIC;
+			uint32_t version = FILE_VERSION;
+			uint32_t vendorId = 0;
+			uint32_t deviceId = 0;
+			uint32_t driverVersion = 0;
+			uint8_t pipelineCacheUuid[VK_UUID_SIZE]{};
+			uint64_t dataSize = 0;
+			uint64_t dataHash = 0;
+		};
+
+		const Device& _device;
+		const std::string _filePath;
+		VkPipelineCache _pipelineCache = VK_NULL_HANDLE;
+		std::unordered_map<std::string, VkShaderModule> _shaderModules; // SPIR-V path => module
+
+		[[nodiscard]] FileHeader createFileHeader() const;
+		// cache data of the file, empty if missing or not valid for this device
+		[[nodiscard]] std::vector<char> loadFile() const;
+	};
+}
@@ -55,8 +55,7 @@ namespace m1
         submitInfo.pCommandBuffers = &commandBuffer;
         vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE);
 
-        // TODO: now one operation executed synchronously.
-        // Combine these operations in a single command buffer and execute them asynchronously
+        // executed synchronously: the asset uploads are batched by the UploadBatcher instead
 
 		// Wait for the operations to finish
         vkQueueWaitIdle(_queue);
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace m1
+{
+	// queue families accessing a buffer or an image besides the graphics family. The resources used by more than one family
+	// are created with the concurrent sharing mode (no ownership transfers), slower to access on some GPUs: opt-in only
+	enum class QueueSharing
+	{
+		Exclusive, // graphics queue only (attachments, transient and per-frame resources)
+		Upload,    // also written by the upload batcher on the dedicated transfer queue
+		UploadAndCompute, // also accessed by the dedicated compute queue (async compute)
+	};
+}
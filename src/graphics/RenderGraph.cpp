@@ -0,0 +1,561 @@
+#include "RenderGraph.hpp"
+#include "Device.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+
+// std
+#include <algorithm>
+#include <format>
+#include <ranges>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace m1
+{
+	namespace
+	{
+		struct UsageInfo
+		{
+			VkPipelineStageFlags2 stages;
+			VkAccessFlags2 readAccess;
+			VkAccessFlags2 writeAccess;
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			bool readsOnWrite = false; // e.g. depth test, blending and atomics also read what is written
+		};
+
+		UsageInfo getUsageInfo(ImageUsage usage)
+		{
+			switch (usage)
+			{
+				case ImageUsage::ColorAttachment:
+					return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT,
+						VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+				case ImageUsage::DepthAttachment:
+					return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+						VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+						VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true };
+				case ImageUsage::ResolveAttachment:
+					return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE,
+						VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+				case ImageUsage::Sampled:
+					return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_ACCESS_2_NONE,
+						VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+				case ImageUsage::TransferSrc:
+					return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_ACCESS_2_NONE,
+						VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+				case ImageUsage::TransferDst:
+					return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_NONE, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+						VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+			}
+			throw std::runtime_error("Unknown image usage");
+		}
+
+		UsageInfo getUsageInfo(BufferUsage usage)
+		{
+			switch (usage)
+			{
+				case BufferUsage::IndirectRead:
+					return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_ACCESS_2_NONE };
+				case BufferUsage::VertexShaderRead:
+					return { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_ACCESS_2_NONE };
+				case BufferUsage::ComputeWrite:
+					return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+						VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true };
+			}
+			throw std::runtime_error("Unknown buffer usage");
+		}
+
+		// consumers of the images left in their final layout (after the frame, or by the following submissions)
+		void getFinalStageAndAccess(VkImageLayout layout, VkPipelineStageFlags2& stages, VkAccessFlags2& access)
+		{
+			switch (layout)
+			{
+				case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+					// the presentation waits for the semaphore signaled by the submission
+					stages = VK_PIPELINE_STAGE_2_NONE;
+					access = VK_ACCESS_2_NONE;
+					break;
+				case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+					stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+					access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+					break;
+				case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+					stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+					access = VK_ACCESS_2_TRANSFER_READ_BIT;
+					break;
+				default:
+					stages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+					access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+					break;
+			}
+		}
+
+		bool overlaps(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB)
+		{
+			return firstA <= lastB && firstB <= lastA;
+		}
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(RenderGraphResource resource, ImageUsage usage)
+	{
+		return addAccess(resource, static_cast<uint32_t>(usage), false, true, false);
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(RenderGraphResource resource, BufferUsage usage)
+	{
+		return addAccess(resource, static_cast<uint32_t>(usage), true, true, false);
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(RenderGraphResource resource, ImageUsage usage)
+	{
+		return addAccess(resource, static_cast<uint32_t>(usage), false, false, true);
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(RenderGraphResource resource, BufferUsage usage)
+	{
+		return addAccess(resource, static_cast<uint32_t>(usage), true, false, true);
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::readWrite(RenderGraphResource resource, ImageUsage usage)
+	{
+		return addAccess(resource, static_cast<uint32_t>(usage), false, true, true);
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::addAccess(RenderGraphResource resource, uint32_t usage, bool isBuffer, bool read, bool write)
+	{
+		if (_graph._resources.at(resource).isBuffer != isBuffer)
+			throw std::runtime_error("Render graph resource " + _graph._resources[resource].name + " used with the wrong usage type");
+
+		_graph._passes[_passIndex].accesses.push_back({ resource, usage, isBuffer, read, write });
+		return *this;
+	}
+
+	RenderGraph::RenderGraph(const Device& device) : _device(device)
+	{
+		Log::Get().Info("Creating render graph");
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		destroyPhysicalImages();
+		Log::Get().Info("Render graph destroyed");
+	}
+
+	void RenderGraph::reset()
+	{
+		_passes.clear();
+		_resources.clear();
+		_finalImageBarriers.clear();
+	}
+
+	RenderGraphResource RenderGraph::importImage(const std::string& name, VkImage image, VkImageAspectFlags aspectMask,
+		std::optional<VkImageLayout> finalLayout, VkPipelineStageFlags2 acquireStages)
+	{
+		_resources.push_back({ .name = name, .image = image, .aspectMask = aspectMask, .finalLayout = finalLayout, .acquireStages = acquireStages });
+		return static_cast<RenderGraphResource>(_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::importBuffer(const std::string& name, VkBuffer buffer)
+	{
+		_resources.push_back({ .name = name, .isBuffer = true, .buffer = buffer });
+		return static_cast<RenderGraphResource>(_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::createImage(const std::string& name, const TransientImageDesc& desc)
+	{
+		_resources.push_back({ .name = name, .transient = true, .aspectMask = desc.aspectMask, .desc = desc });
+		return static_cast<RenderGraphResource>(_resources.size() - 1);
+	}
+
+	void RenderGraph::markOutput(RenderGraphResource resource)
+	{
+		_resources.at(resource).output = true;
+	}
+
+	RenderGraph::PassBuilder RenderGraph::addPass(const std::string& name, std::function<void(VkCommandBuffer)> execute)
+	{
+		_passes.push_back({ .name = name, .execute = std::move(execute) });
+		return { *this, static_cast<uint32_t>(_passes.size() - 1) };
+	}
+
+	void RenderGraph::compile()
+	{
+		cullPasses();
+		computeLifetimes();
+		createPhysicalImages();
+		computeBarriers();
+	}
+
+	void RenderGraph::execute(VkCommandBuffer commandBuffer)
+	{
+		for (const auto& pass : _passes)
+		{
+			if (pass.culled)
+				continue;
+
+			if (!pass.imageBarriers.empty() || !pass.bufferBarriers.empty())
+			{
+				VkDependencyInfo dependencyInfo
+				{
+					.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+					.bufferMemoryBarrierCount = static_cast<uint32_t>(pass.bufferBarriers.size()),
+					.pBufferMemoryBarriers = pass.bufferBarriers.data(),
+					.imageMemoryBarrierCount = static_cast<uint32_t>(pass.imageBarriers.size()),
+					.pImageMemoryBarriers = pass.imageBarriers.data(),
+				};
+				vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+			}
+
+			pass.execute(commandBuffer);
+		}
+
+		if (!_finalImageBarriers.empty())
+		{
+			VkDependencyInfo dependencyInfo
+			{
+				.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.imageMemoryBarrierCount = static_cast<uint32_t>(_finalImageBarriers.size()),
+				.pImageMemoryBarriers = _finalImageBarriers.data(),
+			};
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		}
+	}
+
+	Image& RenderGraph::getImage(RenderGraphResource resource) const
+	{
+		const auto& graphResource = _resources.at(resource);
+		if (!graphResource.transient || graphResource.physicalImage == UINT32_MAX)
+			throw std::runtime_error("Render graph resource " + graphResource.name + " has no physical image");
+
+		return *_physicalImages[graphResource.physicalImage].image;
+	}
+
+	void RenderGraph::clearImportedStates()
+	{
+		_importedImageStates.clear();
+		_importedBufferStates.clear();
+	}
+
+	void RenderGraph::cullPasses()
+	{
+		// backwards from the outputs: a pass is needed if it writes a resource read by a following needed pass
+		std::unordered_set<RenderGraphResource> neededResources;
+		for (RenderGraphResource i = 0; i < _resources.size(); i++)
+		{
+			if (_resources[i].output)
+				neededResources.insert(i);
+		}
+
+		_culledPassCount = 0;
+		for (auto& pass : std::views::reverse(_passes))
+		{
+			pass.culled = std::ranges::none_of(pass.accesses, [&](const Access& access)
+			{
+				return access.write && neededResources.contains(access.resource);
+			});
+
+			if (pass.culled)
+			{
+				_culledPassCount++;
+				continue;
+			}
+
+			// the previous contents of the overwritten resources are not needed anymore
+			for (const auto& access : pass.accesses)
+			{
+				if (access.write && !access.read)
+					neededResources.erase(access.resource);
+			}
+			for (const auto& access : pass.accesses)
+			{
+				if (access.read)
+					neededResources.insert(access.resource);
+			}
+		}
+	}
+
+	void RenderGraph::computeLifetimes()
+	{
+		for (uint32_t passIndex = 0; passIndex < _passes.size(); passIndex++)
+		{
+			const auto& pass = _passes[passIndex];
+			if (pass.culled)
+				continue;
+
+			for (const auto& access : pass.accesses)
+			{
+				auto& resource = _resources[access.resource];
+				if (resource.transient && resource.firstPass == UINT32_MAX && access.read)
+					throw std::runtime_error(std::format("Transient image {} read by the pass {} before being written", resource.name, pass.name));
+
+				resource.firstPass = std::min(resource.firstPass, passIndex);
+				resource.lastPass = std::max(resource.lastPass, passIndex);
+			}
+		}
+	}
+
+	void RenderGraph::createPhysicalImages()
+	{
+		std::vector<RenderGraphResource> transients;
+		for (RenderGraphResource i = 0; i < _resources.size(); i++)
+		{
+			if (_resources[i].transient && _resources[i].firstPass != UINT32_MAX)
+				transients.push_back(i);
+		}
+
+		// same images as the previous frames: nothing to create
+		bool unchanged = transients.size() == _physicalImages.size() && std::ranges::equal(transients, _physicalImages,
+			[&](RenderGraphResource i, const PhysicalImage& physicalImage)
+			{
+				const auto& resource = _resources[i];
+				return resource.desc == physicalImage.desc && resource.firstPass == physicalImage.firstPass && resource.lastPass == physicalImage.lastPass;
+			});
+
+		if (!unchanged)
+		{
+			// rare (swap chain recreated, passes enabled or disabled): the previous images can still be used by the frames in flight
+			if (!_physicalImages.empty())
+				vkDeviceWaitIdle(_device.getVkDevice());
+			destroyPhysicalImages();
+
+			// the images are placed in order of first use, into the first memory block not used during their lifetime
+			auto order = transients;
+			std::ranges::sort(order, {}, [&](RenderGraphResource i) { return _resources[i].firstPass; });
+
+			_physicalImages.resize(transients.size());
+			std::vector<ImageParams> imageParams(transients.size());
+			VkDeviceSize unaliasedSize = 0;
+			for (RenderGraphResource i : order)
+			{
+				const auto& resource = _resources[i];
+				auto physicalIndex = static_cast<uint32_t>(std::ranges::find(transients, i) - transients.begin());
+				imageParams[physicalIndex] = ImageParams
+				{
+					.extent = resource.desc.extent,
+					.format = resource.desc.format,
+					.usage = resource.desc.usage,
+					.aspectMask = resource.desc.aspectMask,
+					.samples = resource.desc.samples,
+				};
+				auto requirements = Image::getMemoryRequirements(_device, imageParams[physicalIndex]);
+				unaliasedSize += requirements.size;
+
+				auto block = std::ranges::find_if(_memoryBlocks, [&](const MemoryBlock& memoryBlock)
+				{
+					return (memoryBlock.requirements.memoryTypeBits & requirements.memoryTypeBits) != 0 &&
+						std::ranges::none_of(memoryBlock.physicalImages, [&](uint32_t other)
+						{
+							return overlaps(resource.firstPass, resource.lastPass, _physicalImages[other].firstPass, _physicalImages[other].lastPass);
+						});
+				});
+
+				if (block == _memoryBlocks.end())
+				{
+					_memoryBlocks.push_back({ .requirements = requirements });
+					block = _memoryBlocks.end() - 1;
+				}
+				else
+				{
+					block->requirements.size = std::max(block->requirements.size, requirements.size);
+					block->requirements.alignment = std::max(block->requirements.alignment, requirements.alignment);
+					block->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+				}
+
+				block->physicalImages.push_back(physicalIndex);
+				_physicalImages[physicalIndex] = { resource.desc, resource.firstPass, resource.lastPass, static_cast<uint32_t>(block - _memoryBlocks.begin()) };
+			}
+
+			// dedicated allocation for special, big resources, like fullscreen images used as attachments
+			VmaAllocationCreateInfo allocationInfo
+			{
+				.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+				.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			};
+			VkDeviceSize aliasedSize = 0;
+			for (auto& block : _memoryBlocks)
+			{
+				VK_CHECK(vmaAllocateMemory(_device.getMemoryAllocator(), &block.requirements, &allocationInfo, &block.allocation, nullptr));
+				aliasedSize += block.requirements.size;
+			}
+
+			for (uint32_t i = 0; i < _physicalImages.size(); i++)
+			{
+				auto& physicalImage = _physicalImages[i];
+				physicalImage.image = std::make_unique<Image>(_device, imageParams[i], _memoryBlocks[physicalImage.memoryBlock].allocation);
+			}
+
+			Log::Get().Info(std::format("Render graph: {} transient images in {} memory blocks, {:.1f} MB ({:.1f} MB without aliasing)",
+				_physicalImages.size(), _memoryBlocks.size(), static_cast<double>(aliasedSize) / (1 << 20), static_cast<double>(unaliasedSize) / (1 << 20)));
+		}
+
+		for (uint32_t i = 0; i < transients.size(); i++)
+			_resources[transients[i]].physicalImage = i;
+	}
+
+	void RenderGraph::destroyPhysicalImages()
+	{
+		_physicalImages.clear();
+		for (const auto& block : _memoryBlocks)
+			vmaFreeMemory(_device.getMemoryAllocator(), block.allocation);
+		_memoryBlocks.clear();
+	}
+
+	void RenderGraph::computeBarriers()
+	{
+		_barrierCount = 0;
+		for (uint32_t passIndex = 0; passIndex < _passes.size(); passIndex++)
+		{
+			auto& pass = _passes[passIndex];
+			pass.imageBarriers.clear();
+			pass.bufferBarriers.clear();
+			if (pass.culled)
+				continue;
+
+			for (const auto& access : pass.accesses)
+				addBarrier(passIndex, access);
+
+			_barrierCount += static_cast<uint32_t>(pass.imageBarriers.size() + pass.bufferBarriers.size());
+		}
+
+		// imported images left in their final layout
+		for (const auto& resource : _resources)
+		{
+			if (!resource.finalLayout.has_value())
+				continue;
+
+			auto& state = getState(resource);
+			if (state.layout == resource.finalLayout.value())
+				continue;
+
+			VkPipelineStageFlags2 dstStages;
+			VkAccessFlags2 dstAccess;
+			getFinalStageAndAccess(resource.finalLayout.value(), dstStages, dstAccess);
+
+			_finalImageBarriers.push_back(
+			{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+				.srcStageMask = state.writeStages | state.readStages | resource.acquireStages,
+				.srcAccessMask = state.writeAccess,
+				.dstStageMask = dstStages,
+				.dstAccessMask = dstAccess,
+				.oldLayout = state.layout,
+				.newLayout = resource.finalLayout.value(),
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = resource.image,
+				.subresourceRange = { resource.aspectMask, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS },
+			});
+			state = { .layout = resource.finalLayout.value(), .writeStages = dstStages, .visibleStages = dstStages };
+		}
+		_barrierCount += static_cast<uint32_t>(_finalImageBarriers.size());
+	}
+
+	RenderGraph::ResourceState& RenderGraph::getState(const Resource& resource)
+	{
+		if (resource.transient)
+			return _physicalImages[resource.physicalImage].state;
+		if (resource.isBuffer)
+			return _importedBufferStates[resource.buffer];
+		return _importedImageStates[resource.image];
+	}
+
+	void RenderGraph::addBarrier(uint32_t passIndex, const Access& access)
+	{
+		auto& pass = _passes[passIndex];
+		const auto& resource = _resources[access.resource];
+		auto& state = getState(resource);
+
+		UsageInfo usage = access.isBuffer ? getUsageInfo(static_cast<BufferUsage>(access.usage)) : getUsageInfo(static_cast<ImageUsage>(access.usage));
+		VkAccessFlags2 dstAccess = (access.read || usage.readsOnWrite ? usage.readAccess : VK_ACCESS_2_NONE) | (access.write ? usage.writeAccess : VK_ACCESS_2_NONE);
+
+		// accesses to wait for (all the pipeline barriers of the queue also apply to the previous frames)
+		VkPipelineStageFlags2 srcStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+		bool layoutChange = !access.isBuffer && state.layout != usage.layout;
+		bool firstUse = resource.firstPass == passIndex;
+
+		if (access.write || layoutChange)
+		{
+			// write after write/read, or layout transition (which is a write)
+			srcStages = state.writeStages | state.readStages;
+			srcAccess = state.writeAccess;
+
+			// the memory of a transient image was used by the other images of its block
+			if (resource.transient && firstUse)
+			{
+				for (uint32_t other : _memoryBlocks[_physicalImages[resource.physicalImage].memoryBlock].physicalImages)
+				{
+					const auto& otherState = _physicalImages[other].state;
+					srcStages |= otherState.writeStages | otherState.readStages;
+					srcAccess |= otherState.writeAccess;
+				}
+			}
+		}
+		else if (state.writeStages != VK_PIPELINE_STAGE_2_NONE && (usage.stages & ~state.visibleStages) != 0)
+		{
+			// read after write, not yet visible to these stages
+			srcStages = state.writeStages;
+			srcAccess = state.writeAccess;
+		}
+
+		// e.g. the swap chain image: the first barrier chains with the semaphore wait of the acquired image
+		if (firstUse)
+			srcStages |= resource.acquireStages;
+
+		bool barrierNeeded = layoutChange || srcStages != VK_PIPELINE_STAGE_2_NONE;
+		if (barrierNeeded)
+		{
+			if (access.isBuffer)
+			{
+				pass.bufferBarriers.push_back(
+				{
+					.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+					.srcStageMask = srcStages,
+					.srcAccessMask = srcAccess,
+					.dstStageMask = usage.stages,
+					.dstAccessMask = dstAccess,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.buffer = resource.buffer,
+					.offset = 0,
+					.size = VK_WHOLE_SIZE,
+				});
+			}
+			else
+			{
+				VkImage image = resource.transient ? _physicalImages[resource.physicalImage].image->getVkImage() : resource.image;
+				pass.imageBarriers.push_back(
+				{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.srcStageMask = srcStages,
+					.srcAccessMask = srcAccess,
+					.dstStageMask = usage.stages,
+					.dstAccessMask = dstAccess,
+					// the previous contents of an overwritten image are discarded
+					.oldLayout = access.write && !access.read ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout,
+					.newLayout = usage.layout,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.image = image,
+					.subresourceRange = { resource.aspectMask, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS },
+				});
+			}
+		}
+
+		// new state
+		if (access.write || layoutChange)
+		{
+			state.layout = usage.layout;
+			state.writeStages = usage.stages;
+			state.writeAccess = access.write ? usage.writeAccess : VK_ACCESS_2_NONE;
+			state.readStages = access.read ? usage.stages : VK_PIPELINE_STAGE_2_NONE;
+			state.visibleStages = usage.stages;
+		}
+		else
+		{
+			state.readStages |= usage.stages;
+			if (barrierNeeded)
+				state.visibleStages |= usage.stages;
+		}
+	}
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "Image.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace m1
+{
+	class Device;
+
+	using RenderGraphResource = uint32_t;
+
+	// how a pass uses an image: pipeline stages, access and layout of the barriers
+	enum class ImageUsage
+	{
+		ColorAttachment,
+		DepthAttachment,
+		ResolveAttachment, // msaa resolve target of a color attachment
+		Sampled, // sampled by the fragment shaders
+		TransferSrc,
+		TransferDst,
+	};
+
+	// how a pass uses a buffer
+	enum class BufferUsage
+	{
+		IndirectRead, // indirect draw commands and counts
+		VertexShaderRead, // storage reads of the vertex shaders
+		ComputeWrite, // storage writes of the compute shaders, including the fills recorded before the dispatches
+	};
+
+	struct TransientImageDesc
+	{
+		VkExtent2D extent;
+		VkFormat format;
+		VkImageUsageFlags usage;
+		VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+		// not defaulted: VkExtent2D has no operator==
+		bool operator==(const TransientImageDesc& other) const
+		{
+			return extent.width == other.extent.width && extent.height == other.extent.height && format == other.format &&
+			       usage == other.usage && aspectMask == other.aspectMask && samples == other.samples;
+		}
+	};
+
+	/*
+		Frame graph: the passes of a frame declare the images and buffers they read and write, then the graph
+		- culls the passes not contributing to the outputs (e.g. the shadow pass when the shadow map is not read)
+		- records before each pass one batch of barriers, only for the hazards and layout changes of its resources
+			(the states of the resources are tracked across the frames, there is no transition from UNDEFINED unless
+			the contents are discarded)
+		- creates the transient images and lets the ones with disjoint lifetimes share the same memory
+
+		The passes and resources are declared again at each frame (reset, declarations, compile, execute), the physical
+		transient images are kept as long as their descriptions and lifetimes don't change.
+		Passes are executed in declaration order, on a single command buffer of the graphics queue.
+	*/
+	class RenderGraph
+	{
+	public:
+		class PassBuilder
+		{
+		public:
+			// the resource contents are used (and preserved by the previous passes)
+			PassBuilder& read(RenderGraphResource resource, ImageUsage usage);
+			PassBuilder& read(RenderGraphResource resource, BufferUsage usage);
+			// the resource is entirely overwritten: its previous contents are discarded
+			PassBuilder& write(RenderGraphResource resource, ImageUsage usage);
+			PassBuilder& write(RenderGraphResource resource, BufferUsage usage);
+			// the previous contents are loaded and modified (e.g. drawing on top of an image)
+			PassBuilder& readWrite(RenderGraphResource resource, ImageUsage usage);
+
+		private:
+			friend class RenderGraph;
+			PassBuilder(RenderGraph& graph, uint32_t passIndex) : _graph(graph), _passIndex(passIndex) {}
+			PassBuilder& addAccess(RenderGraphResource resource, uint32_t usage, bool isBuffer, bool read, bool write);
+
+			RenderGraph& _graph;
+			uint32_t _passIndex;
+		};
+
+		explicit RenderGraph(const Device& device);
+		~RenderGraph();
+
+		// Non-copyable, non-movable
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+		RenderGraph(RenderGraph&&) = delete;
+		RenderGraph& operator=(RenderGraph&&) = delete;
+
+		// clears the passes and resources of the previous frame
+		void reset();
+
+		// image owned outside the graph (whole image). If finalLayout is set, the image is transitioned to it at the end
+		// of the frame, even if no pass uses it. acquireStages: stages of the semaphore wait making the image available
+		// (swap chain image), the first barrier of the frame chains with it
+		RenderGraphResource importImage(const std::string& name, VkImage image, VkImageAspectFlags aspectMask,
+			std::optional<VkImageLayout> finalLayout = std::nullopt, VkPipelineStageFlags2 acquireStages = VK_PIPELINE_STAGE_2_NONE);
+		RenderGraphResource importBuffer(const std::string& name, VkBuffer buffer);
+		// image created by the graph, only valid during the frame (the first pass using it must write it)
+		RenderGraphResource createImage(const std::string& name, const TransientImageDesc& desc);
+		// the passes contributing to the outputs are executed, the others are culled
+		void markOutput(RenderGraphResource resource);
+
+		PassBuilder addPass(const std::string& name, std::function<void(VkCommandBuffer)> execute);
+
+		// culls the passes, creates the transient images and computes the barriers
+		void compile();
+		void execute(VkCommandBuffer commandBuffer);
+
+		// physical image of a transient resource (valid after compile)
+		[[nodiscard]] Image& getImage(RenderGraphResource resource) const;
+		// the tracked states of the imported resources are forgotten, e.g. when the swap chain is recreated
+		void clearImportedStates();
+
+		[[nodiscard]] uint32_t getCulledPassCount() const { return _culledPassCount; }
+		[[nodiscard]] uint32_t getBarrierCount() const { return _barrierCount; }
+
+	private:
+		// synchronization state of a resource, after its last access
+		struct ResourceState
+		{
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE; // last write
+			VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+			VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE; // reads after the last write
+			VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE; // stages the last write is visible to
+		};
+
+		struct Access
+		{
+			RenderGraphResource resource;
+			uint32_t usage; // ImageUsage or BufferUsage
+			bool isBuffer;
+			bool read;
+			bool write;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			std::function<void(VkCommandBuffer)> execute;
+			std::vector<Access> accesses;
+			bool culled = false;
+			std::vector<VkImageMemoryBarrier2> imageBarriers;
+			std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+		};
+
+		struct Resource
+		{
+			std::string name;
+			bool isBuffer = false;
+			bool transient = false;
+			bool output = false;
+			VkImage image = VK_NULL_HANDLE;
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkImageAspectFlags aspectMask = 0;
+			std::optional<VkImageLayout> finalLayout;
+			VkPipelineStageFlags2 acquireStages = VK_PIPELINE_STAGE_2_NONE;
+			TransientImageDesc desc{};
+			uint32_t firstPass = UINT32_MAX; // lifetime, in executed passes
+			uint32_t lastPass = 0;
+			uint32_t physicalImage = UINT32_MAX; // transient only
+		};
+
+		// transient image, possibly sharing the memory block with others
+		struct PhysicalImage
+		{
+			TransientImageDesc desc;
+			uint32_t firstPass;
+			uint32_t lastPass;
+			uint32_t memoryBlock;
+			std::unique_ptr<Image> image;
+			ResourceState state;
+		};
+
+		struct MemoryBlock
+		{
+			VkMemoryRequirements requirements;
+			std::vector<uint32_t> physicalImages;
+			VmaAllocation allocation = VK_NULL_HANDLE;
+		};
+
+		const Device& _device;
+		std::vector<Pass> _passes;
+		std::vector<Resource> _resources;
+		std::vector<VkImageMemoryBarrier2> _finalImageBarriers;
+
+		std::vector<PhysicalImage> _physicalImages;
+		std::vector<MemoryBlock> _memoryBlocks;
+		std::unordered_map<VkImage, ResourceState> _importedImageStates;
+		std::unordered_map<VkBuffer, ResourceState> _importedBufferStates;
+
+		uint32_t _culledPassCount = 0;
+		uint32_t _barrierCount = 0;
+
+		void cullPasses();
+		void computeLifetimes();
+		void createPhysicalImages();
+		void destroyPhysicalImages();
+		void computeBarriers();
+		ResourceState& getState(const Resource& resource);
+		// hazards and layout changes between the state and the access, the state is updated
+		void addBarrier(uint32_t passIndex, const Access& access);
+	};
+}
@@ -3,12 +3,13 @@
 namespace m1
 {
 	void beginRendering(VkCommandBuffer cmdBuffer, VkRect2D renderArea, uint32_t colorAttachmentCount, VkRenderingAttachmentInfo* pColorAttachments,
-		VkRenderingAttachmentInfo* pDepthAttachment)
+		VkRenderingAttachmentInfo* pDepthAttachment, VkRenderingFlags flags)
 	{
 		// begin rendering
 		VkRenderingInfo renderingInfo
 		{
 			.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+			.flags = flags,
 			.renderArea = renderArea,
 			.layerCount = 1,
 			.colorAttachmentCount = colorAttachmentCount,
@@ -5,7 +5,7 @@
 namespace m1
 {
 	void beginRendering(VkCommandBuffer cmdBuffer, VkRect2D renderArea, uint32_t colorAttachmentCount,
-		VkRenderingAttachmentInfo* pColorAttachments, VkRenderingAttachmentInfo* pDepthAttachment);
+		VkRenderingAttachmentInfo* pColorAttachments, VkRenderingAttachmentInfo* pDepthAttachment, VkRenderingFlags flags = 0);
 	void endRendering(VkCommandBuffer cmdBuffer);
 	void setDynamicStates(VkCommandBuffer cmdBuffer, VkExtent2D extent);
 	VkRenderingAttachmentInfo createColorAttachment(VkImageView imageView);
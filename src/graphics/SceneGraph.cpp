@@ -0,0 +1,126 @@
+#include "SceneGraph.hpp"
+#include "ThreadPool.hpp"
+#include "Log.hpp"
+
+// libs
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define M1_SCENE_GRAPH_SSE
+#include <xmmintrin.h>
+#endif
+
+// std
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <string>
+
+namespace m1
+{
+	// result = parent * local, one column at a time: the columns of the parent weighted by the components of the local column
+	static void multiplyTransforms(const glm::mat4& parent, const glm::mat4& local, glm::mat4& result)
+	{
+#ifdef M1_SCENE_GRAPH_SSE
+		__m128 parentColumns[4];
+		for (int column = 0; column < 4; column++)
+			parentColumns[column] = _mm_loadu_ps(&parent[column][0]);
+
+		for (int column = 0; column < 4; column++)
+		{
+			__m128 sum = _mm_mul_ps(parentColumns[0], _mm_set1_ps(local[column][0]));
+			sum = _mm_add_ps(sum, _mm_mul_ps(parentColumns[1], _mm_set1_ps(local[column][1])));
+			sum = _mm_add_ps(sum, _mm_mul_ps(parentColumns[2], _mm_set1_ps(local[column][2])));
+			sum = _mm_add_ps(sum, _mm_mul_ps(parentColumns[3], _mm_set1_ps(local[column][3])));
+			_mm_storeu_ps(&result[column][0], sum);
+		}
+#else
+		result = parent * local;
+#endif
+	}
+
+	SceneNode SceneGraph::createNode(SceneNode parent, const glm::mat4& localTransform)
+	{
+		if (parent != INVALID_SCENE_NODE && parent >= _parents.size())
+		{
+			Log::Get().Error("Invalid scene graph parent node " + std::to_string(parent));
+			throw std::runtime_error("Invalid scene graph parent node " + std::to_string(parent));
+		}
+
+		auto node = static_cast<SceneNode>(_parents.size());
+		if (parent == INVALID_SCENE_NODE)
+			_roots.push_back(node);
+		else if (parent < _roots.back())
+			_subtreesContiguous = false; // child of a previous root subtree, appended after the following ones
+
+		_parents.push_back(parent);
+		_localTransforms.push_back(localTransform);
+		_worldTransforms.emplace_back(1.0f);
+		_worldVersions.push_back(0);
+		_dirty.push_back(1);
+		_anyDirty = true;
+
+		return node;
+	}
+
+	void SceneGraph::setLocalTransform(SceneNode node, const glm::mat4& localTransform)
+	{
+		_localTransforms[node] = localTransform;
+		_dirty[node] = 1;
+		_anyDirty = true;
+	}
+
+	bool SceneGraph::update(ThreadPool* threadPool)
+	{
+		if (!_anyDirty)
+			return false;
+
+		_updateCount++;
+		auto nodeCount = static_cast<SceneNode>(_parents.size());
+		uint32_t threadCount = threadPool ? threadPool->getThreadCount() : 1;
+
+		if (!_subtreesContiguous || threadCount == 1 || nodeCount < 2 * MIN_NODES_PER_JOB)
+			updateRange(0, nodeCount);
+		else
+		{
+			// whole root subtrees, about one job per thread
+			SceneNode jobSize = std::max(MIN_NODES_PER_JOB, (nodeCount + threadCount - 1) / threadCount);
+			std::vector<std::future<void>> jobs;
+			SceneNode first = 0;
+			for (size_t i = 1; i <= _roots.size(); i++)
+			{
+				SceneNode end = i < _roots.size() ? _roots[i] : nodeCount;
+				if (end - first >= jobSize || end == nodeCount)
+				{
+					jobs.push_back(threadPool->submit([this, first, end] { updateRange(first, end); }));
+					first = end;
+				}
+			}
+
+			for (auto& job : jobs)
+				job.get();
+		}
+
+		std::ranges::fill(_dirty, 0);
+		_anyDirty = false;
+		return true;
+	}
+
+	void SceneGraph::updateRange(SceneNode first, SceneNode end)
+	{
+		for (SceneNode node = first; node < end; node++)
+		{
+			// the parent precedes the node: its dirty flag already includes its own ancestors
+			SceneNode parent = _parents[node];
+			if (parent != INVALID_SCENE_NODE && _dirty[parent])
+				_dirty[node] = 1;
+
+			if (!_dirty[node])
+				continue;
+
+			if (parent == INVALID_SCENE_NODE)
+				_worldTransforms[node] = _localTransforms[node];
+			else
+				multiplyTransforms(_worldTransforms[parent], _localTransforms[node], _worldTransforms[node]);
+			_worldVersions[node] = _updateCount;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// libs
+#include "glm_config.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace m1
+{
+	class ThreadPool;
+
+	using SceneNode = uint32_t;
+	static constexpr SceneNode INVALID_SCENE_NODE = UINT32_MAX;
+
+	/*
+		Transform hierarchy of the scene. The nodes are stored as SoA (parents, local and world matrices, dirty flags),
+		in topological order: a node is always created after its parent, so one linear pass over the arrays computes the
+		world matrices (the parent world matrix is always up to date when its children are reached).
+		Only the nodes whose local transform changed, and their descendants, are recomputed.
+
+		When the nodes are created depth first (each subtree is contiguous), the subtrees of the roots are independent
+		ranges and are updated in parallel.
+	*/
+	class SceneGraph
+	{
+	public:
+		// root subtrees gathered into a job, below that the job overhead is not worth it
+		static constexpr uint32_t MIN_NODES_PER_JOB = 1024;
+
+		// parent: an existing node, or INVALID_SCENE_NODE for a root
+		SceneNode createNode(SceneNode parent = INVALID_SCENE_NODE, const glm::mat4& localTransform = glm::mat4(1.0f));
+
+		// transform relative to the parent, the world transforms are recomputed by the next update
+		void setLocalTransform(SceneNode node, const glm::mat4& localTransform);
+		[[nodiscard]] const glm::mat4& getLocalTransform(SceneNode node) const { return _localTransforms[node]; }
+		// valid after update (the reference is invalidated by the creation of nodes)
+		[[nodiscard]] const glm::mat4& getWorldTransform(SceneNode node) const { return _worldTransforms[node]; }
+		// update count of the last change of the world transform (0 until the first update)
+		[[nodiscard]] uint64_t getWorldVersion(SceneNode node) const { return _worldVersions[node]; }
+		[[nodiscard]] SceneNode getParent(SceneNode node) const { return _parents[node]; }
+		[[nodiscard]] size_t size() const { return _parents.size(); }
+
+		// propagates the dirty local transforms to the world transforms, in parallel if threadPool is not null.
+		// Returns false if nothing changed
+		bool update(ThreadPool* threadPool = nullptr);
+
+	private:
+		// SoA, indexed by node
+		std::vector<SceneNode> _parents;
+		std::vector<glm::mat4> _localTransforms;
+		std::vector<glm::mat4> _worldTransforms;
+		std::vector<uint64_t> _worldVersions;
+		std::vector<uint8_t> _dirty; // set by setLocalTransform, then propagated to the descendants by update
+
+		std::vector<SceneNode> _roots; // in creation order, the start of their subtrees if contiguous
+		bool _subtreesContiguous = true;
+		bool _anyDirty = false;
+		uint64_t _updateCount = 0;
+
+		void updateRange(SceneNode first, SceneNode end);
+	};
+}
@@ -0,0 +1,18 @@
+#include "SceneObject.hpp"
+#include "Mesh.hpp"
+
+namespace m1
+{
+	const BBox& SceneObject::getWorldBBox()
+	{
+		uint64_t worldVersion = _sceneGraph.getWorldVersion(_node);
+		if (_worldBBoxDirty || _worldBBoxVersion != worldVersion)
+		{
+			_worldBBox = Mesh ? Mesh->getLocalBBox().transform(getTransform()) : BBox{};
+			_worldBBoxDirty = false;
+			_worldBBoxVersion = worldVersion;
+		}
+
+		return _worldBBox;
+	}
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Pipeline.hpp"
+#include "BBox.hpp"
+#include "SceneGraph.hpp"
 
 // libs
 #include "glm_config.hpp"
@@ -16,18 +18,29 @@ namespace m1
 	class SceneObject
 	{
 	public:
-		static std::unique_ptr<SceneObject> createSceneObject()
+		// attached to an existing node (e.g. the primitives of a glTF mesh share the node of the mesh)
+		static std::unique_ptr<SceneObject> createSceneObject(SceneGraph& sceneGraph, SceneNode node)
 		{
 			static uint64_t currentId = 0;
 			// ReSharper disable once CppDFAMemoryLeak (it's not a leak)
-			return std::unique_ptr<SceneObject>(new SceneObject(currentId++));
+			return std::unique_ptr<SceneObject>(new SceneObject(currentId++, sceneGraph, node));
+		}
+		// attached to a new root node
+		static std::unique_ptr<SceneObject> createSceneObject(SceneGraph& sceneGraph)
+		{
+			return createSceneObject(sceneGraph, sceneGraph.createNode());
 		}
 
-		void setMesh(std::shared_ptr<Mesh> mesh) { Mesh = std::move(mesh); }
-		void setTransform(const glm::mat4& transform) { Transform = transform; }
+		void setMesh(std::shared_ptr<Mesh> mesh) { Mesh = std::move(mesh); _worldBBoxDirty = true; }
+		// local transform of the node (relative to its parent)
+		void setTransform(const glm::mat4& transform) { _sceneGraph.setLocalTransform(_node, transform); }
+		// world transform: view into the scene graph storage, valid after SceneGraph::update
+		[[nodiscard]] const glm::mat4& getTransform() const { return _sceneGraph.getWorldTransform(_node); }
+		[[nodiscard]] SceneNode getNode() const { return _node; }
+		// world space bounds, recomputed only after the world transform or the mesh changed (the mesh must be compiled)
+		const BBox& getWorldBBox();
 
 		uint64_t Id;
-		glm::mat4 Transform{ 1.0f };
 		std::shared_ptr<Mesh> Mesh = nullptr;
 		// Optional: which pipeline to use when drawing this object
 		std::optional<PipelineType> PipelineKey = std::nullopt;
@@ -35,6 +48,12 @@ namespace m1
 		bool IsAuxiliary = false;
 
 	private:
-		explicit SceneObject(const uint64_t id) : Id{ id } { }
+		SceneObject(const uint64_t id, SceneGraph& sceneGraph, SceneNode node) : Id{ id }, _sceneGraph{ sceneGraph }, _node{ node } { }
+
+		SceneGraph& _sceneGraph;
+		SceneNode _node;
+		BBox _worldBBox;
+		bool _worldBBoxDirty = true; // mesh changed
+		uint64_t _worldBBoxVersion = 0; // world transform version the bounds were computed for
 	};
 }
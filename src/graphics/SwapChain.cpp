@@ -12,16 +12,30 @@
 
 namespace m1
 {
-	SwapChain::SwapChain(const Device& device, const Window& window, const SwapChainConfig& config) : _samples(config.samples), _device(device)
+	SwapChain::SwapChain(const Device& device, const Window* window, const SwapChainConfig& config) : _samples(config.samples), _device(device)
     {
-        Log::Get().Info("Creating swap chain");
-        createSwapChain(window, config.oldSwapChain);
-        createImages();
+		if (window != nullptr)
+		{
+			Log::Get().Info("Creating swap chain");
+			createSwapChain(*window, config.oldSwapChain);
+			createImages();
+		}
+		else
+		{
+			// headless: rendering ends in the color image, which is read back instead of presented
+			Log::Get().Info("Creating headless swap chain");
+			_swapChainImageFormat = HEADLESS_COLOR_FORMAT;
+			_extent = config.headlessExtent;
+		}
 
 		createColorImage();
-		createDepthImage();
-		if (_samples > VK_SAMPLE_COUNT_1_BIT)
-			createMsaaImage();
+
+        // the depth and msaa images are transient images of the render graph
+        _depthFormat = _device.findSupportedFormat(
+            { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+        );
     }
 
     SwapChain::~SwapChain()
@@ -30,7 +44,8 @@ namespace m1
             vkDestroyImageView(_device.getVkDevice(), imageView, nullptr);
 
         // _images are automatically cleaned up once the swap chain has been destroyed
-        vkDestroySwapchainKHR(_device.getVkDevice(), _vkSwapChain, nullptr);
+        if (_vkSwapChain != VK_NULL_HANDLE)
+            vkDestroySwapchainKHR(_device.getVkDevice(), _vkSwapChain, nullptr);
         Log::Get().Info("SwapChain destroyed");
     }
 
@@ -199,44 +214,6 @@ namespace m1
 		_colorImage = std::make_unique<Image>(_device, params);
     }
 
-	void SwapChain::createMsaaImage()
-	{
-		ImageParams params
-		{
-			.extent = _extent,
-			.format = _swapChainImageFormat,
-			.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |  //
-				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, // rendering target
-			.samples = _samples,
-			.memoryProps = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, // dedicated allocation for special, big resources, like fullscreen images used as attachments
-		};
-
-		_msaaColorImage = std::make_unique<Image>(_device, params);
-	}
-
-    void SwapChain::createDepthImage()
-    {
-        // find a format that supports specified tiling and flags
-        VkFormat depthFormat = _device.findSupportedFormat(
-            { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
-        );
-
-        ImageParams params
-        {
-            .extent = _extent,
-            .format = depthFormat,
-            .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-            .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
-			.samples = _samples,
-        	.memoryProps = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, // dedicated allocation for special, big resources, like fullscreen images used as attachments
-        };
-
-        // create the depth image
-        _depthImage = std::make_unique<Image>(_device, params);
-    }
-
     bool SwapChain::hasStencilComponent(VkFormat format)
     {
         // S8 -> 8 bit component for stencil
@@ -17,12 +17,17 @@ namespace m1
 	{
 		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
 		VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE;
+		VkExtent2D headlessExtent = { 1280, 720 }; // only used in headless mode, where there is no window to size the images
 	};
 
     class SwapChain
     {
     public:
-        SwapChain(const Device& device, const Window& window, const SwapChainConfig& config);
+    	// color format of the offscreen target in headless mode (RGBA so that read back pixels can be written as they are)
+    	static constexpr VkFormat HEADLESS_COLOR_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+    	// a null window creates a headless swap chain: only the offscreen color image, no presentable images
+        SwapChain(const Device& device, const Window* window, const SwapChainConfig& config);
         ~SwapChain();
 
         // Non-copyable, non-movable
@@ -34,21 +39,20 @@ namespace m1
         VkSwapchainKHR getVkSwapChain() const { return _vkSwapChain; }
         VkFormat getSwapChainImageFormat() const { return _swapChainImageFormat; }
     	Image& getColorImage() const { return *_colorImage; }
-    	Image& getMsaaColorImage() const { return *_msaaColorImage; }
-    	Image& getDepthImage() const { return *_depthImage; }
+    	// format and samples of the depth and msaa attachments (transient images of the render graph)
+    	VkFormat getDepthFormat() const { return _depthFormat; }
         VkExtent2D getExtent() const { return _extent; }
         float getAspectRatio() const { return _extent.width / static_cast<float>(_extent.height); }
         VkImage getSwapChainImage(uint32_t index) const { return _swapChainImages[index]; }
         VkImageView getSwapChainImageView(uint32_t index) const { return _swapChainImageViews[index]; }
         size_t getImageCount() const { return _swapChainImages.size(); }
 		VkSampleCountFlagBits getSamples() const { return _samples; }
+		bool isHeadless() const { return _vkSwapChain == VK_NULL_HANDLE; }
 
     private:
         void createSwapChain(const Window& window, VkSwapchainKHR oldSwapChain);
         void createImages();
         void createColorImage();
-        void createMsaaImage();
-        void createDepthImage();
         bool hasStencilComponent(VkFormat format);
 
         VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
@@ -57,13 +61,14 @@ namespace m1
         
         VkSwapchainKHR _vkSwapChain = VK_NULL_HANDLE;
         VkFormat _swapChainImageFormat;
+        VkFormat _depthFormat;
         VkExtent2D _extent;
         VkSampleCountFlagBits _samples;
 
         std::vector<VkImage> _swapChainImages;
         std::vector<VkImageView> _swapChainImageViews;
         
-        std::unique_ptr<Image> _colorImage, _msaaColorImage, _depthImage;
+        std::unique_ptr<Image> _colorImage;
 
         const Device& _device;
     };
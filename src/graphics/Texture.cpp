@@ -36,6 +36,7 @@ namespace m1
             .format = textureParams.format,
             .usage = getTextureImageUsageFlags(),
             .mipLevels = mipLevels,
+            .sharing = QueueSharing::Upload, // the pixels are uploaded after the creation
         };
 
         _image = std::make_unique<Image>(_device, imageParams);
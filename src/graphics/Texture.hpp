@@ -33,6 +33,8 @@ namespace m1
     	Texture& operator=(Texture&&) = delete;
 
         [[nodiscard]] Image& getImage() const { return *_image; }
+    	// the previous image must not be used by the pending frames (see TextureStreamer)
+    	void setImage(std::shared_ptr<Image> image) { _image = std::move(image); }
         [[nodiscard]] Sampler& getSampler() const { return *_sampler; }
     	[[nodiscard]] VkExtent2D getExtent() const { return _image->getExtent();}
         [[nodiscard]] uint32_t getWidth() const { return _image->getWidth(); }
@@ -0,0 +1,263 @@
+#include "TextureStreamer.hpp"
+#include "Device.hpp"
+#include "Image.hpp"
+#include "Texture.hpp"
+#include "UploadBatcher.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+
+// libs
+#include "vk_mem_alloc.h"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+
+namespace m1
+{
+	namespace
+	{
+		// headroom left to the other allocations when the budget is the one reported by VMA
+		constexpr double VMA_BUDGET_RATIO = 0.9;
+
+		bool isReady(const std::shared_future<void>& future)
+		{
+			return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}
+
+		template <typename T>
+		bool isReady(const std::future<T>& future)
+		{
+			return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}
+	}
+
+	TextureStreamer::TextureStreamer(const Device& device, UploadBatcher& uploadBatcher, uint32_t framesInFlight, VkDeviceSize budget) :
+		_device(device), _uploadBatcher(uploadBatcher), _framesInFlight(framesInFlight), _budget(budget)
+	{
+		Log::Get().Info(budget > 0 ? std::format("Creating texture streamer, budget {} MB", budget >> 20) :
+			"Creating texture streamer, VMA heap budget");
+	}
+
+	std::shared_ptr<Image> TextureStreamer::addImage(const std::string& ktxPath, const Ktx2Image& mipTail)
+	{
+		auto image = uploadKtx2Image(_device, _uploadBatcher, mipTail);
+		if (mipTail.firstLevel == 0 || mipTail.faces != 1)
+			return image;
+
+		_imageIndices[image.get()] = _images.size();
+		_images.push_back(
+		{
+			.path = ktxPath,
+			.format = mipTail.format,
+			.width = mipTail.width,
+			.height = mipTail.height,
+			.mipLevels = mipTail.mipLevels,
+			.tailLevel = mipTail.firstLevel,
+			.image = image,
+			.residentLevel = mipTail.firstLevel,
+			.requestedLevel = mipTail.firstLevel,
+		});
+
+		return image;
+	}
+
+	void TextureStreamer::addTexture(const std::shared_ptr<Texture>& texture)
+	{
+		auto it = _imageIndices.find(&texture->getImage());
+		if (it != _imageIndices.end())
+			_images[it->second].textures.push_back(texture);
+	}
+
+	void TextureStreamer::beginRequests()
+	{
+		for (auto& streamedImage : _images)
+			streamedImage.requestedLevel = streamedImage.tailLevel;
+	}
+
+	void TextureStreamer::requestResolution(const Texture& texture, float pixels)
+	{
+		auto it = _imageIndices.find(&texture.getImage());
+		if (it == _imageIndices.end() || pixels <= 0.0f)
+			return;
+
+		auto& streamedImage = _images[it->second];
+		// level whose extent is the closest above the covered pixels
+		auto maxExtent = static_cast<float>(std::max(streamedImage.width, streamedImage.height));
+		auto level = static_cast<uint32_t>(std::clamp(std::floor(std::log2(maxExtent / pixels)), 0.0f, static_cast<float>(streamedImage.tailLevel)));
+
+		streamedImage.requestedLevel = std::min(streamedImage.requestedLevel, level);
+		streamedImage.lastRequestFrame = _frameNumber;
+	}
+
+	std::vector<const Texture*> TextureStreamer::update(uint64_t frameNumber)
+	{
+		_frameNumber = frameNumber;
+
+		// the frames that could use the retired images are completed
+		std::erase_if(_retiredImages, [&](const RetiredImage& retired) { return frameNumber >= retired.frameNumber + _framesInFlight; });
+
+		std::vector<const Texture*> changedTextures;
+		swapUploadedImages(changedTextures);
+		bool uploaded = uploadLoadedLevels();
+
+		auto isIdle = [](const StreamedImage& streamedImage)
+		{
+			return !streamedImage.failed && !streamedImage.load.valid() && !streamedImage.pendingImage;
+		};
+
+		if (isOverBudget())
+		{
+			// drop the largest level of the least recently requested image, one image per frame. The levels loaded
+			// recently are kept: evicted then requested again at each frame otherwise
+			StreamedImage* victim = nullptr;
+			for (auto& streamedImage : _images)
+			{
+				if (isIdle(streamedImage) && streamedImage.residentLevel < streamedImage.tailLevel &&
+					frameNumber >= streamedImage.residentFrame + MIN_RESIDENT_FRAMES &&
+					(!victim || streamedImage.lastRequestFrame < victim->lastRequestFrame))
+					victim = &streamedImage;
+			}
+			if (victim)
+				scheduleLoad(*victim, victim->residentLevel + 1);
+		}
+		else
+		{
+			// the largest missing resolutions first
+			std::vector<StreamedImage*> candidates;
+			for (auto& streamedImage : _images)
+			{
+				if (isIdle(streamedImage) && streamedImage.requestedLevel < streamedImage.residentLevel)
+					candidates.push_back(&streamedImage);
+			}
+			std::ranges::sort(candidates, std::greater{}, [](const StreamedImage* streamedImage) { return streamedImage->residentLevel - streamedImage->requestedLevel; });
+
+			VkDeviceSize scheduledBytes = 0;
+			for (auto* streamedImage : candidates)
+			{
+				if (getPendingLoadCount() >= MAX_PENDING_LOADS)
+					break;
+
+				// the resident image stays alive until the swap
+				auto size = getChainSize(*streamedImage, streamedImage->requestedLevel);
+				if (!fitsBudget(scheduledBytes + size, LOAD_BUDGET_RATIO))
+					continue;
+
+				scheduledBytes += size;
+				scheduleLoad(*streamedImage, streamedImage->requestedLevel);
+			}
+		}
+
+		if (uploaded)
+			_uploadBatcher.flush();
+
+		return changedTextures;
+	}
+
+	VkDeviceSize TextureStreamer::getResidentBytes() const
+	{
+		VkDeviceSize size = 0;
+		for (const auto& streamedImage : _images)
+			size += getChainSize(streamedImage, streamedImage.residentLevel);
+		return size;
+	}
+
+	void TextureStreamer::swapUploadedImages(std::vector<const Texture*>& changedTextures)
+	{
+		for (size_t i = 0; i < _images.size(); i++)
+		{
+			auto& streamedImage = _images[i];
+			if (!streamedImage.pendingImage || !isReady(streamedImage.pendingUpload))
+				continue;
+
+			_imageIndices.erase(streamedImage.image.get());
+			_retiredImages.push_back({ std::move(streamedImage.image), _frameNumber });
+
+			streamedImage.image = std::move(streamedImage.pendingImage);
+			streamedImage.residentLevel = streamedImage.pendingLevel;
+			streamedImage.residentFrame = _frameNumber;
+			streamedImage.pendingUpload = {};
+			_imageIndices[streamedImage.image.get()] = i;
+
+			std::erase_if(streamedImage.textures, [](const std::weak_ptr<Texture>& texture) { return texture.expired(); });
+			for (const auto& weakTexture : streamedImage.textures)
+			{
+				auto texture = weakTexture.lock();
+				texture->setImage(streamedImage.image);
+				changedTextures.push_back(texture.get());
+			}
+		}
+	}
+
+	bool TextureStreamer::uploadLoadedLevels()
+	{
+		bool uploaded = false;
+		for (auto& streamedImage : _images)
+		{
+			if (!streamedImage.load.valid() || !isReady(streamedImage.load))
+				continue;
+
+			auto ktxImage = streamedImage.load.get();
+			if (!ktxImage || ktxImage->format != streamedImage.format || ktxImage->mipLevels != streamedImage.mipLevels ||
+				ktxImage->faces != 1)
+			{
+				Log::Get().Warning("Failed to stream the texture " + streamedImage.path);
+				streamedImage.failed = true;
+				continue;
+			}
+
+			streamedImage.pendingImage = uploadKtx2Image(_device, _uploadBatcher, *ktxImage, &streamedImage.pendingUpload);
+			streamedImage.pendingLevel = ktxImage->firstLevel;
+			uploaded = true;
+		}
+		return uploaded;
+	}
+
+	void TextureStreamer::scheduleLoad(StreamedImage& streamedImage, uint32_t level)
+	{
+		// the new image contains the whole chain from the level
+		uint32_t maxExtent = std::max(streamedImage.width, streamedImage.height) >> level;
+		streamedImage.load = _loader.submit([path = streamedImage.path, maxExtent] { return readKtx2(path, maxExtent); });
+	}
+
+	bool TextureStreamer::isOverBudget() const
+	{
+		return !fitsBudget(0, 1.0);
+	}
+
+	bool TextureStreamer::fitsBudget(VkDeviceSize additionalBytes, double ratio) const
+	{
+		if (_budget > 0)
+			return static_cast<double>(getResidentBytes() + additionalBytes) <= static_cast<double>(_budget) * ratio;
+
+		// usage of the whole process, reported by VK_EXT_memory_budget if supported (estimated by VMA otherwise)
+		VmaAllocator allocator = _device.getMemoryAllocator();
+		const VkPhysicalDeviceMemoryProperties* memoryProperties;
+		vmaGetMemoryProperties(allocator, &memoryProperties);
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+		vmaGetHeapBudgets(allocator, budgets);
+
+		for (uint32_t heap = 0; heap < memoryProperties->memoryHeapCount; heap++)
+		{
+			if ((memoryProperties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+				static_cast<double>(budgets[heap].usage + additionalBytes) > static_cast<double>(budgets[heap].budget) * VMA_BUDGET_RATIO * ratio)
+				return false;
+		}
+		return true;
+	}
+
+	VkDeviceSize TextureStreamer::getChainSize(const StreamedImage& streamedImage, uint32_t firstLevel) const
+	{
+		VkDeviceSize size = 0;
+		for (uint32_t level = firstLevel; level < streamedImage.mipLevels; level++)
+			size += computeImageSize(streamedImage.format, std::max(streamedImage.width >> level, 1u), std::max(streamedImage.height >> level, 1u));
+		return size;
+	}
+
+	size_t TextureStreamer::getPendingLoadCount() const
+	{
+		return std::ranges::count_if(_images, [](const StreamedImage& streamedImage) { return streamedImage.load.valid() || streamedImage.pendingImage; });
+	}
+}
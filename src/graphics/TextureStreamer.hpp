@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Ktx2.hpp"
+#include "ThreadPool.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace m1
+{
+	class Device;
+	class Image;
+	class Texture;
+	class UploadBatcher;
+
+	/*
+		Streams the mip levels of the baked (KTX2) textures.
+		A texture starts with its mip tail resident (levels not larger than MIP_TAIL_EXTENT), so the materials render
+		right away. The larger levels requested by the screen space size of the objects are read from the file on a
+		background thread, uploaded into a new image with the whole resident chain, then swapped into the textures.
+		When the VRAM budget is exceeded, the least recently requested textures drop their largest level: the smaller
+		chain is read from the file by the loader thread too (no copy of the levels is kept in system memory).
+		The loads stop below the budget (LOAD_BUDGET_RATIO) and a loaded level stays at least MIN_RESIDENT_FRAMES
+		frames, so an evicted level is not loaded again right away.
+		The replaced images are released once the frames in flight can't use them anymore.
+	*/
+	class TextureStreamer
+	{
+	public:
+		static constexpr uint32_t MIP_TAIL_EXTENT = 128;
+		static constexpr uint32_t MAX_PENDING_LOADS = 4;
+		static constexpr double LOAD_BUDGET_RATIO = 0.85;
+		static constexpr uint64_t MIN_RESIDENT_FRAMES = 120;
+
+		// budget: bytes of the streamed textures, 0 => only the VMA budget of the device local heaps
+		TextureStreamer(const Device& device, UploadBatcher& uploadBatcher, uint32_t framesInFlight, VkDeviceSize budget);
+
+		// Non-copyable, non-movable
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+		TextureStreamer(TextureStreamer&&) = delete;
+		TextureStreamer& operator=(TextureStreamer&&) = delete;
+
+		// image of the loaded mip tail (see readKtx2 maxExtent); the textures using it are registered by addTexture.
+		// A texture fully loaded (not larger than the tail) is not streamed
+		std::shared_ptr<Image> addImage(const std::string& ktxPath, const Ktx2Image& mipTail);
+		// does nothing if the image of the texture is not streamed
+		void addTexture(const std::shared_ptr<Texture>& texture);
+
+		// the requests replace the previous ones
+		void beginRequests();
+		// the texture covers about `pixels` pixels on screen (largest side)
+		void requestResolution(const Texture& texture, float pixels);
+
+		// once per frame, when the previous use of the frame slot is completed: swaps the uploaded images, evicts and
+		// schedules the loads. Returns the textures whose image changed (their descriptor sets must be updated)
+		std::vector<const Texture*> update(uint64_t frameNumber);
+
+		[[nodiscard]] VkDeviceSize getResidentBytes() const;
+
+	private:
+		struct StreamedImage
+		{
+			std::string path;
+			VkFormat format;
+			uint32_t width;
+			uint32_t height;
+			uint32_t mipLevels;
+			uint32_t tailLevel; // first level of the mip tail, always resident
+
+			std::shared_ptr<Image> image;
+			uint32_t residentLevel; // first level of the image
+			uint32_t requestedLevel;
+			uint64_t lastRequestFrame = 0;
+			uint64_t residentFrame = 0; // swap of the image
+			bool failed = false; // the file couldn't be read again, keeps its resident levels
+			std::vector<std::weak_ptr<Texture>> textures;
+
+			// levels read by the loader thread, then uploaded into the pending image
+			std::future<std::optional<Ktx2Image>> load;
+			std::shared_ptr<Image> pendingImage;
+			uint32_t pendingLevel = 0;
+			std::shared_future<void> pendingUpload;
+		};
+
+		struct RetiredImage
+		{
+			std::shared_ptr<Image> image;
+			uint64_t frameNumber;
+		};
+
+		const Device& _device;
+		UploadBatcher& _uploadBatcher;
+		const uint32_t _framesInFlight;
+		const VkDeviceSize _budget;
+		uint64_t _frameNumber = 0;
+
+		std::vector<StreamedImage> _images;
+		std::unordered_map<const Image*, size_t> _imageIndices; // current image => index in _images
+		std::vector<RetiredImage> _retiredImages;
+		ThreadPool _loader{ 1 };
+
+		void swapUploadedImages(std::vector<const Texture*>& changedTextures);
+		bool uploadLoadedLevels();
+		void scheduleLoad(StreamedImage& streamedImage, uint32_t level);
+		[[nodiscard]] bool isOverBudget() const;
+		// ratio: of the budget, below 1 for the loads
+		[[nodiscard]] bool fitsBudget(VkDeviceSize additionalBytes, double ratio) const;
+		[[nodiscard]] VkDeviceSize getChainSize(const StreamedImage& streamedImage, uint32_t firstLevel) const;
+		[[nodiscard]] size_t getPendingLoadCount() const;
+	};
+}
@@ -59,6 +59,23 @@ namespace m1
 		ImGui::Begin("Engine controls", nullptr, windowFlags);
 		ImGui::PushItemWidth(-1.0f);
 
+		const GpuProfiler& profiler = _engine.getGpuProfiler();
+		if (profiler.isSupported())
+		{
+			ImGui::TextUnformatted("GPU timings (average ms, frames recorded)");
+			ImGui::Separator();
+
+			for (uint32_t i = 0; i < GpuProfiler::SCOPES_COUNT; i++)
+			{
+				auto scope = static_cast<GpuScope>(i);
+				ImGui::Text("%-18s %7.3f %3u/%u", GpuProfiler::getScopeName(scope), profiler.getAverageMs(scope),
+					profiler.getRecordedCount(scope), profiler.getHistoryCount());
+			}
+
+			ImGui::Spacing();
+			ImGui::Spacing();
+		}
+
 		ImGui::TextUnformatted("Rendering");
 		ImGui::Separator();
 
@@ -74,6 +91,40 @@ namespace m1
 		if (ImGui::Checkbox("Shadows", &shadowsEnabled))
 			_engine.setShadowsEnabled(shadowsEnabled);
 
+		if (shadowsEnabled)
+		{
+			int cascadeCount = static_cast<int>(_engine.getShadowCascadeCount());
+			if (ImGui::SliderInt("Shadow cascades", &cascadeCount, 1, MAX_SHADOW_CASCADES))
+				_engine.setShadowCascadeCount(static_cast<uint32_t>(cascadeCount));
+
+			float splitLambda = _engine.getShadowCascadeSplitLambda();
+			if (ImGui::SliderFloat("Cascade split lambda", &splitLambda, 0.0f, 1.0f, "%.2f"))
+				_engine.setShadowCascadeSplitLambda(splitLambda);
+
+			bool cascadeCachingEnabled = _engine.getShadowCascadeCachingEnabled();
+			if (ImGui::Checkbox("Cascade caching", &cascadeCachingEnabled))
+				_engine.setShadowCascadeCachingEnabled(cascadeCachingEnabled);
+		}
+
+		if (_engine.isGpuDrivenSupported())
+		{
+			bool gpuDrivenEnabled = _engine.getGpuDrivenEnabled();
+			if (ImGui::Checkbox("GPU-driven", &gpuDrivenEnabled))
+				_engine.setGpuDrivenEnabled(gpuDrivenEnabled);
+		}
+
+		bool parallelRecordingEnabled = _engine.getParallelRecordingEnabled();
+		if (ImGui::Checkbox("Parallel recording", &parallelRecordingEnabled))
+			_engine.setParallelRecordingEnabled(parallelRecordingEnabled);
+
+		bool lodEnabled = _engine.getLodEnabled();
+		if (ImGui::Checkbox("LOD", &lodEnabled))
+			_engine.setLodEnabled(lodEnabled);
+
+		bool meshletCullingEnabled = _engine.getMeshletCullingEnabled();
+		if (ImGui::Checkbox("Meshlet culling", &meshletCullingEnabled))
+			_engine.setMeshletCullingEnabled(meshletCullingEnabled);
+
 		bool skyboxEnabled = _engine.getSkyboxEnabled();
 		if (ImGui::Checkbox("Skybox", &skyboxEnabled))
 			_engine.setSkyboxEnabled(skyboxEnabled);
@@ -0,0 +1,347 @@
+#include "UploadBatcher.hpp"
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "Image.hpp"
+#include "Queue.hpp"
+#include "Utils.hpp"
+#include "Log.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace m1
+{
+	static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	UploadBatcher::UploadBatcher(const Device& device) : _device(device), _dedicatedTransferQueue(device.hasDedicatedTransferQueue())
+	{
+		Log::Get().Info("Creating upload batcher");
+
+		auto queueFamilies = _device.getQueueFamilyIndices();
+		_transferCommandPool = std::make_unique<CommandPool>(_device,
+			queueFamilies.transferFamily.value_or(queueFamilies.graphicsFamily.value()), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+		if (_dedicatedTransferQueue)
+			_graphicsCommandPool = std::make_unique<CommandPool>(_device, queueFamilies.graphicsFamily.value(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+		_stagingBuffer = std::make_unique<Buffer>(_device, STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT); // persistent mapping
+
+		_waiterThread = std::thread(&UploadBatcher::waiterLoop, this);
+	}
+
+	UploadBatcher::~UploadBatcher()
+	{
+		waitIdle();
+
+		{
+			std::lock_guard lock(_waitMutex);
+			_stopWaiter = true;
+		}
+		_waitCondition.notify_all();
+		_waiterThread.join();
+
+		Log::Get().Info("Upload batcher destroyed");
+	}
+
+	std::shared_future<void> UploadBatcher::uploadBuffer(const Buffer& dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset)
+	{
+		std::lock_guard lock(_mutex);
+
+		auto staging = allocateStaging(size);
+		std::memcpy(staging.data, data, size);
+
+		Batch& batch = getOpenBatch();
+		VkBufferCopy region
+		{
+			.srcOffset = staging.offset,
+			.dstOffset = dstOffset,
+			.size = size,
+		};
+		vkCmdCopyBuffer(batch.transferCommandBuffer, staging.buffer, dstBuffer.getVkBuffer(), 1, &region);
+		batch.empty = false;
+
+		return batch.future;
+	}
+
+	std::shared_future<void> UploadBatcher::uploadImage(const Image& image, const void* data, VkDeviceSize size, bool includesMipChain)
+	{
+		auto layerCount = image.getArrayLayers();
+		auto levelCount = includesMipChain ? image.getMipLevels() : 1;
+
+		// size of each level of each layer (without the mip chain the data is split evenly between the layers)
+		std::vector<VkDeviceSize> regionSizes;
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			for (uint32_t layer = 0; layer < layerCount; layer++)
+			{
+				regionSizes.push_back(includesMipChain ? computeImageSize(image.getFormat(), std::max(image.getWidth() >> level, 1u),
+					std::max(image.getHeight() >> level, 1u)) : size / layerCount);
+			}
+		}
+
+		if (includesMipChain && std::accumulate(regionSizes.begin(), regionSizes.end(), VkDeviceSize{0}) != size)
+		{
+			Log::Get().Error("Image upload size doesn't match the image");
+			throw std::runtime_error("Image upload size doesn't match the image");
+		}
+
+		std::lock_guard lock(_mutex);
+
+		auto staging = allocateStaging(size);
+		std::memcpy(staging.data, data, size);
+
+		Batch& batch = getOpenBatch();
+
+		transitionImageLayout(batch.transferCommandBuffer, image.getVkImage(), image.getMipLevels(), VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT, layerCount);
+
+		std::vector<VkBufferImageCopy> regions;
+		regions.reserve(regionSizes.size());
+		VkDeviceSize bufferOffset = staging.offset;
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			for (uint32_t layer = 0; layer < layerCount; layer++)
+			{
+				regions.push_back({
+					.bufferOffset = bufferOffset,
+					.bufferRowLength = 0, // tightly packed
+					.bufferImageHeight = 0,
+					.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1},
+					.imageOffset = {0, 0, 0},
+					.imageExtent = {std::max(image.getWidth() >> level, 1u), std::max(image.getHeight() >> level, 1u), 1},
+				});
+				bufferOffset += regionSizes[regions.size() - 1];
+			}
+		}
+		vkCmdCopyBufferToImage(batch.transferCommandBuffer, staging.buffer, image.getVkImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			regions.size(), regions.data());
+		batch.empty = false;
+
+		// blits and shader read layout need a graphics queue: recorded in the graphics command buffer
+		// (submitted after the transfer one) when the copies run on the dedicated transfer queue
+		VkCommandBuffer graphicsCommandBuffer = batch.transferCommandBuffer;
+		if (_dedicatedTransferQueue)
+		{
+			if (batch.graphicsCommandBuffer == VK_NULL_HANDLE)
+			{
+				batch.graphicsCommandBuffer = _graphicsCommandPool->allocateCommandBuffers(1)[0];
+				VkCommandBufferBeginInfo beginInfo{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+				VK_CHECK(vkBeginCommandBuffer(batch.graphicsCommandBuffer, &beginInfo));
+			}
+			graphicsCommandBuffer = batch.graphicsCommandBuffer;
+		}
+
+		bool linearBlitSupported = _device.isLinearFilteringSupported(image.getFormat(), VK_IMAGE_TILING_OPTIMAL);
+		if (image.getMipLevels() > 1 && !includesMipChain && linearBlitSupported)
+		{
+			// also transitions the image to be optimal for shader access
+			generateMipmaps(graphicsCommandBuffer, image);
+		}
+		else
+		{
+			if (image.getMipLevels() > 1 && !includesMipChain)
+				Log::Get().Warning("Failed to create mip levels. Texture image format does not support linear blitting!");
+
+			transitionImageLayout(graphicsCommandBuffer, image.getVkImage(), image.getMipLevels(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT, layerCount);
+		}
+
+		return batch.future;
+	}
+
+	std::shared_future<void> UploadBatcher::flush()
+	{
+		std::lock_guard lock(_mutex);
+		reclaimCompletedBatches();
+		return submitOpenBatch();
+	}
+
+	void UploadBatcher::waitIdle()
+	{
+		std::lock_guard lock(_mutex);
+		submitOpenBatch();
+
+		// the batches complete in submission order
+		if (!_submittedBatches.empty())
+		{
+			std::unique_lock waitLock(_waitMutex);
+			_waitCondition.wait(waitLock, [this] { return _submittedBatches.back()->completed.load(); });
+		}
+
+		reclaimCompletedBatches();
+	}
+
+	UploadBatcher::Batch& UploadBatcher::getOpenBatch()
+	{
+		if (!_openBatch)
+		{
+			_openBatch = std::make_unique<Batch>();
+			_openBatch->transferCommandBuffer = _transferCommandPool->allocateCommandBuffers(1)[0];
+
+			VkCommandBufferBeginInfo beginInfo{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+			VK_CHECK(vkBeginCommandBuffer(_openBatch->transferCommandBuffer, &beginInfo));
+		}
+
+		return *_openBatch;
+	}
+
+	UploadBatcher::StagingAllocation UploadBatcher::allocateStaging(VkDeviceSize size)
+	{
+		// too big for the ring: dedicated staging buffer, destroyed with the batch
+		if (size > STAGING_SIZE)
+		{
+			auto stagingBuffer = std::make_unique<Buffer>(_device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+			StagingAllocation allocation{ stagingBuffer->getVkBuffer(), 0, stagingBuffer->getMappedData() };
+			getOpenBatch().dedicatedStagingBuffers.push_back(std::move(stagingBuffer));
+			return allocation;
+		}
+
+		while (true)
+		{
+			reclaimCompletedBatches();
+
+			// the allocation can't wrap around the end of the buffer
+			VkDeviceSize begin = alignUp(_stagingHead, STAGING_ALIGNMENT);
+			if (begin % STAGING_SIZE + size > STAGING_SIZE)
+				begin = alignUp(begin, STAGING_SIZE);
+
+			// nothing in use: the allocation can start anywhere
+			if (_stagingHead == _stagingTail)
+				_stagingTail = begin;
+
+			if (begin + size - _stagingTail <= STAGING_SIZE)
+			{
+				_stagingHead = begin + size;
+				auto offset = begin % STAGING_SIZE;
+				return { _stagingBuffer->getVkBuffer(), offset, static_cast<uint8_t*>(_stagingBuffer->getMappedData()) + offset };
+			}
+
+			// ring full: the open batch holds the memory, submit it and wait for the oldest batch
+			if (_submittedBatches.empty())
+				submitOpenBatch();
+
+			std::unique_lock waitLock(_waitMutex);
+			_waitCondition.wait(waitLock, [this] { return _submittedBatches.front()->completed.load(); });
+		}
+	}
+
+	std::shared_future<void> UploadBatcher::submitOpenBatch()
+	{
+		if (!_openBatch || _openBatch->empty)
+		{
+			if (!_submittedBatches.empty())
+				return _submittedBatches.back()->future;
+
+			std::promise<void> ready;
+			ready.set_value();
+			return ready.get_future().share();
+		}
+
+		auto batch = std::move(_openBatch);
+		batch->stagingEnd = _stagingHead;
+
+		VkFenceCreateInfo fenceInfo{ .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+		VK_CHECK(vkCreateFence(_device.getVkDevice(), &fenceInfo, nullptr, &batch->fence));
+
+		VK_CHECK(vkEndCommandBuffer(batch->transferCommandBuffer));
+		VkSubmitInfo transferSubmitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &batch->transferCommandBuffer,
+		};
+
+		if (batch->graphicsCommandBuffer != VK_NULL_HANDLE)
+		{
+			// the graphics submission waits for the copies
+			VkSemaphoreCreateInfo semaphoreInfo{ .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+			VK_CHECK(vkCreateSemaphore(_device.getVkDevice(), &semaphoreInfo, nullptr, &batch->transferSemaphore));
+
+			transferSubmitInfo.signalSemaphoreCount = 1;
+			transferSubmitInfo.pSignalSemaphores = &batch->transferSemaphore;
+			VK_CHECK(vkQueueSubmit(_device.getTransferQueue().getVkQueue(), 1, &transferSubmitInfo, VK_NULL_HANDLE));
+
+			VK_CHECK(vkEndCommandBuffer(batch->graphicsCommandBuffer));
+			VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			VkSubmitInfo graphicsSubmitInfo
+			{
+				.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+				.waitSemaphoreCount = 1,
+				.pWaitSemaphores = &batch->transferSemaphore,
+				.pWaitDstStageMask = &waitStage,
+				.commandBufferCount = 1,
+				.pCommandBuffers = &batch->graphicsCommandBuffer,
+			};
+			VK_CHECK(vkQueueSubmit(_device.getGraphicsQueue().getVkQueue(), 1, &graphicsSubmitInfo, batch->fence));
+		}
+		else
+		{
+			VK_CHECK(vkQueueSubmit(_device.getTransferQueue().getVkQueue(), 1, &transferSubmitInfo, batch->fence));
+		}
+
+		auto future = batch->future;
+		{
+			std::lock_guard lock(_waitMutex);
+			_batchesToWait.push_back(batch.get());
+			_submittedBatches.push_back(std::move(batch));
+		}
+		_waitCondition.notify_all();
+
+		return future;
+	}
+
+	void UploadBatcher::reclaimCompletedBatches()
+	{
+		while (!_submittedBatches.empty() && _submittedBatches.front()->completed)
+		{
+			auto& batch = *_submittedBatches.front();
+
+			vkFreeCommandBuffers(_device.getVkDevice(), _transferCommandPool->getVkCommandPool(), 1, &batch.transferCommandBuffer);
+			if (batch.graphicsCommandBuffer != VK_NULL_HANDLE)
+				vkFreeCommandBuffers(_device.getVkDevice(), _graphicsCommandPool->getVkCommandPool(), 1, &batch.graphicsCommandBuffer);
+			if (batch.transferSemaphore != VK_NULL_HANDLE)
+				vkDestroySemaphore(_device.getVkDevice(), batch.transferSemaphore, nullptr);
+			vkDestroyFence(_device.getVkDevice(), batch.fence, nullptr);
+
+			// the staging memory of the batch can be reused
+			_stagingTail = std::max(_stagingTail, batch.stagingEnd);
+
+			std::lock_guard lock(_waitMutex);
+			_submittedBatches.pop_front();
+		}
+	}
+
+	void UploadBatcher::waiterLoop()
+	{
+		while (true)
+		{
+			Batch* batch;
+			{
+				std::unique_lock lock(_waitMutex);
+				_waitCondition.wait(lock, [this] { return _stopWaiter || !_batchesToWait.empty(); });
+				if (_batchesToWait.empty())
+					return;
+
+				batch = _batchesToWait.front();
+				_batchesToWait.pop_front();
+			}
+
+			VK_CHECK(vkWaitForFences(_device.getVkDevice(), 1, &batch->fence, VK_TRUE, UINT64_MAX));
+			batch->promise.set_value();
+
+			// the batch can be destroyed as soon as it's marked as completed
+			{
+				std::lock_guard lock(_waitMutex);
+				batch->completed = true;
+			}
+			_waitCondition.notify_all();
+		}
+	}
+}
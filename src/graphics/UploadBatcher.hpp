@@ -0,0 +1,111 @@
+#pragma once
+
+#include "CommandPool.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace m1
+{
+	class Device;
+	class Buffer;
+	class Image;
+
+	/*
+		Batches the uploads of buffers and images:
+		- the data is copied into a persistently mapped staging ring buffer
+		- the copies are recorded into the command buffer of the open batch, submitted all together by flush()
+			(on the dedicated transfer queue if available. The mip generation of the images runs on the graphics queue,
+			after the copies)
+		- the staging memory of a batch is reused once its fence is signaled
+		- the returned futures resolve when the data is resident (a waiter thread waits for the fences)
+		Uploads bigger than the ring get a dedicated staging buffer.
+	*/
+	class UploadBatcher
+	{
+	public:
+		static constexpr VkDeviceSize STAGING_SIZE = 64ull << 20; // 64 MB
+		static constexpr VkDeviceSize STAGING_ALIGNMENT = 16; // multiple of the texel (or 4x4 block) size of the uploaded formats
+
+		explicit UploadBatcher(const Device& device);
+		~UploadBatcher();
+
+		// Non-copyable, non-movable
+		UploadBatcher(const UploadBatcher&) = delete;
+		UploadBatcher& operator=(const UploadBatcher&) = delete;
+		UploadBatcher(UploadBatcher&&) = delete;
+		UploadBatcher& operator=(UploadBatcher&&) = delete;
+
+		// the data is copied immediately, the destination must be alive until the returned future is ready
+		std::shared_future<void> uploadBuffer(const Buffer& dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+		// data contains the level 0 of all the layers, one after the other.
+		// The mip chain is generated (unless includesMipChain: data contains all the levels, each with all the layers)
+		// and the image is left in SHADER_READ_ONLY_OPTIMAL layout
+		std::shared_future<void> uploadImage(const Image& image, const void* data, VkDeviceSize size, bool includesMipChain = false);
+
+		// submit the open batch, returns its future (already ready if there was nothing to submit)
+		std::shared_future<void> flush();
+		// submit the open batch and wait for all the uploads
+		void waitIdle();
+
+	private:
+		struct StagingAllocation
+		{
+			VkBuffer buffer;
+			VkDeviceSize offset;
+			void* data;
+		};
+
+		struct Batch
+		{
+			VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+			VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE; // mip generation, only with a dedicated transfer queue
+			VkSemaphore transferSemaphore = VK_NULL_HANDLE; // transfer => graphics submission
+			VkFence fence = VK_NULL_HANDLE;
+			VkDeviceSize stagingEnd = 0; // ring position after the last staging allocation of the batch
+			std::vector<std::unique_ptr<Buffer>> dedicatedStagingBuffers;
+			bool empty = true;
+
+			std::promise<void> promise;
+			std::shared_future<void> future = promise.get_future().share();
+			std::atomic<bool> completed = false; // set by the waiter thread
+		};
+
+		const Device& _device;
+		const bool _dedicatedTransferQueue;
+		std::unique_ptr<CommandPool> _transferCommandPool;
+		std::unique_ptr<CommandPool> _graphicsCommandPool;
+
+		// ring positions increase monotonically, the offset in the buffer is position % STAGING_SIZE
+		std::unique_ptr<Buffer> _stagingBuffer;
+		VkDeviceSize _stagingHead = 0;
+		VkDeviceSize _stagingTail = 0; // start of the memory still used by the submitted batches
+
+		std::mutex _mutex; // uploads can be recorded from multiple threads
+		std::unique_ptr<Batch> _openBatch;
+		std::deque<std::unique_ptr<Batch>> _submittedBatches;
+
+		// waiter thread
+		std::mutex _waitMutex;
+		std::condition_variable _waitCondition;
+		std::deque<Batch*> _batchesToWait;
+		bool _stopWaiter = false;
+		std::thread _waiterThread;
+
+		Batch& getOpenBatch();
+		StagingAllocation allocateStaging(VkDeviceSize size);
+		std::shared_future<void> submitOpenBatch();
+		void reclaimCompletedBatches();
+		void waiterLoop();
+	};
+}
@@ -3,8 +3,10 @@
 #include "Device.hpp"
 #include "Buffer.hpp"
 #include "Texture.hpp"
+#include "Image.hpp"
 #include "Queue.hpp"
 #include "Sampler.hpp"
+#include "Ktx2.hpp"
 
 
 #include <stb_image.h>
@@ -13,45 +15,24 @@
 
 namespace m1
 {
-    void copyBuffer(const Device& device, const Buffer& srcBuffer, const Buffer& dstBuffer, VkDeviceSize size)
-    {
-        // Memory transfer operations are executed using command buffers.
-        
-        // Begin one-time command
-        VkCommandBuffer commandBuffer = device.getGraphicsQueue().beginOneTimeCommand();
-
-        // Copy buffer
-        VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = 0; // Optional
-        copyRegion.dstOffset = 0; // Optional
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer.getVkBuffer(), dstBuffer.getVkBuffer(), 1, &copyRegion);
-
-        // Execute the command
-        device.getGraphicsQueue().endOneTimeCommand(commandBuffer);
-    }
-
-    void uploadToDeviceBuffer(const Device& device, const Buffer& dstBuffer, VkDeviceSize size, const void* data)
+	std::unique_ptr<Texture> loadEquirectangularHDRMap(const Engine& engine, const std::string& filePath)
     {
-        // Create a staging buffer accessible to CPU to upload the data
-        Buffer stagingBuffer{ device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT};
+    	auto samplerCreateInfo = Sampler::getDefaultCreateInfo();
+    	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
 
-        // Copy data to the staging buffer
-        stagingBuffer.copyDataToBuffer(data);
-
-        // Copy staging buffer to destination buffer
-        copyBuffer(device, stagingBuffer, dstBuffer, size);
-    }
+    	// BC6H map baked offline, if the device can sample it
+    	if (engine.getDevice().getFeatures().textureCompressionBC)
+    	{
+    		auto ktxImage = readKtx2(getKtx2Path(filePath));
+    		if (ktxImage && ktxImage->faces == 1 && isCompressedFormatCompatible(ktxImage->format, VK_FORMAT_R32G32B32A32_SFLOAT))
+    			return engine.createTexture(*ktxImage, &samplerCreateInfo);
+    	}
 
-	std::unique_ptr<Texture> loadEquirectangularHDRMap(const Engine& engine, const std::string& filePath)
-    {
     	int width, height, nrComponents;
     	auto* data = stbi_loadf(filePath.c_str(), &width, &height, &nrComponents, 4);
     	if (data)
     	{
-    		auto samplerCreateInfo = Sampler::getDefaultCreateInfo();
-    		samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    		samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
     		TextureParams params
     		{
     			.extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)},
@@ -102,6 +83,28 @@ namespace m1
     	}
     }
 
+	bool isBlockCompressed(VkFormat format)
+	{
+		switch (format)
+		{
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+			case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	VkDeviceSize computeImageSize(VkFormat format, uint32_t width, uint32_t height)
+	{
+		if (isBlockCompressed(format))
+			return VkDeviceSize{(width + 3) / 4} * ((height + 3) / 4) * 16;
+
+		return VkDeviceSize{width} * height * getBytesPerPixel(format);
+	}
+
 	std::vector<char> readFile(const std::string& filename)
     {
     	// ate: Start reading at the end of the file
@@ -124,6 +127,17 @@ namespace m1
     	return buffer;
     }
 
+	uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+	{
+		auto* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
 	glm::mat4 perspectiveProjection(float fov, float aspectRatio, float near, float far)
     {
     	auto perspective = glm::perspective(fov, aspectRatio, near, far);
@@ -209,6 +223,118 @@ namespace m1
 		vkCmdPipelineBarrier2(commandBuffer, &depInfo);
 	}
 
+	void generateMipmaps(VkCommandBuffer commandBuffer, const Image& image)
+	{
+		// Use vkCmdBlitImage command. This command performs copying, scaling, and filtering operations.
+		// We will call this multiple times to blit data to each mip level of the image.
+		// Source and destination of the command will be the same image, but different mip levels.
+		// The format must support linear blitting (see Device::isLinearFilteringSupported)
+
+		auto vkImage = image.getVkImage();
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.image = vkImage;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.subresourceRange.levelCount = 1;
+
+		int32_t mipWidth = image.getWidth();
+		int32_t mipHeight = image.getHeight();
+		auto mipLevels = image.getMipLevels();
+		for (uint32_t i = 1; i < mipLevels; i++)
+		{
+			barrier.subresourceRange.baseMipLevel = i - 1;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer,
+			                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			                     0, nullptr,
+			                     0, nullptr,
+			                     1, &barrier);
+
+			// blit info
+			VkImageBlit blit{};
+			blit.srcOffsets[0] = {0, 0, 0};
+			blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = i - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+			blit.dstOffsets[0] = {0, 0, 0};
+			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 }; // each mip level is half the size of the previous level
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = i;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
+
+			// blit command
+			vkCmdBlitImage(commandBuffer,
+			               vkImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			               vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			               1, &blit,
+			               VK_FILTER_LINEAR);
+
+			// transition mip level i-1 to shader read only optimal
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer,
+			                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			                     0, nullptr,
+			                     0, nullptr,
+			                     1, &barrier);
+
+			// next mip level is half the size
+			if (mipWidth > 1) mipWidth /= 2;
+			if (mipHeight > 1) mipHeight /= 2;
+		}
+
+		// transition the last mip level to shader read only optimal
+		barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		                     0, nullptr,
+		                     0, nullptr,
+		                     1, &barrier);
+
+	}
+
+	void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask,
+		VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask)
+	{
+		VkMemoryBarrier2 barrier
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = srcStageMask,
+			.srcAccessMask = srcAccessMask,
+			.dstStageMask = dstStageMask,
+			.dstAccessMask = dstAccessMask,
+		};
+
+		VkDependencyInfo depInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &barrier,
+		};
+
+		vkCmdPipelineBarrier2(commandBuffer, &depInfo);
+	}
+
 	void getStageAndAccessMaskForLayout(VkImageLayout layout, VkPipelineStageFlags& stageMask, VkAccessFlags& accessMask)
 	{
 		switch (layout)
@@ -29,17 +29,27 @@ namespace m1
 	class Device;
 	class Buffer;
 	class Texture;
+	class Image;
 
-	void copyBuffer(const Device& device, const Buffer& srcBuffer, const Buffer& dstBuffer, VkDeviceSize size);
-	void uploadToDeviceBuffer(const Device& device, const Buffer& dstBuffer, VkDeviceSize size, const void* data);
 	void copyImageToImage(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D srcSize, VkExtent2D dstSize);
 	std::unique_ptr<Texture> loadEquirectangularHDRMap(const Engine& engine, const std::string& filePath);
 	int getBytesPerPixel(VkFormat format);
+	// BC5, BC6H and BC7: 16 bytes for each 4x4 block
+	bool isBlockCompressed(VkFormat format);
+	// bytes of a tightly packed level, the partial blocks at the edges are rounded up
+	VkDeviceSize computeImageSize(VkFormat format, uint32_t width, uint32_t height);
 	std::vector<char> readFile(const std::string& filename);
+	// FNV-1a, can be chained by passing the previous hash
+	uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
 
 	void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, uint32_t mipLevels, VkImageLayout currentLayout,
 			VkImageLayout newLayout, VkImageAspectFlags aspectMask, uint32_t layerCount = 1);
+	// generate the mip chain from the level 0 (all levels in TRANSFER_DST_OPTIMAL), then transition to SHADER_READ_ONLY_OPTIMAL
+	void generateMipmaps(VkCommandBuffer commandBuffer, const Image& image);
 	void getStageAndAccessMaskForLayout(VkImageLayout layout, VkPipelineStageFlags &stageMask, VkAccessFlags &accessMask);
+	// global memory barrier, e.g. to make the buffers written by a compute shader visible to the following draws
+	void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask,
+			VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask);
 
 	glm::mat4 perspectiveProjection(float fov, float aspectRatio, float near, float far);
 	glm::mat4 orthoProjection(float left, float right, float bottom, float top, float near, float far);
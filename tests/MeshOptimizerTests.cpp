@@ -0,0 +1,147 @@
+#include "MeshOptimizer.hpp"
+#include "TestMeshes.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <format>
+#include <random>
+#include <string>
+#include <vector>
+
+// CPU checks of MeshOptimizer: the reorderings keep the triangles, lower or keep the cache miss ratio of a shuffled
+// mesh, and handle empty and degenerate index lists.
+
+using namespace m1;
+using namespace m1::test;
+
+namespace
+{
+	std::vector<std::array<uint32_t, 3>> getSortedTriangles(const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i < indices.size() / 3; i++)
+			triangles.push_back(getTriangle(indices, i));
+		std::ranges::sort(triangles);
+		return triangles;
+	}
+
+	// triangles as positions, to compare the meshes before and after the vertices are renumbered
+	std::vector<std::array<std::array<float, 3>, 3>> getSortedPositionTriangles(const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<std::array<float, 3>, 3>> triangles;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			std::array<std::array<float, 3>, 3> triangle;
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				const glm::vec3& pos = vertices[indices[i + k]].pos;
+				triangle[k] = { pos.x, pos.y, pos.z };
+			}
+			triangles.push_back(triangle);
+		}
+		std::ranges::sort(triangles);
+		return triangles;
+	}
+
+	// triangles in a random (fixed) order, the worst case of the vertex cache
+	TestMesh shuffleTriangles(TestMesh mesh)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i < mesh.indices.size() / 3; i++)
+			triangles.push_back(getTriangle(mesh.indices, i));
+		std::ranges::shuffle(triangles, std::mt19937(42));
+
+		mesh.name = "shuffled " + mesh.name;
+		mesh.indices.clear();
+		for (const auto& triangle : triangles)
+			mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+		return mesh;
+	}
+
+	// same steps as Mesh::optimize
+	void checkOptimization(const TestMesh& mesh)
+	{
+		const std::string& name = mesh.name;
+		auto source = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+		std::vector<uint32_t> indices = mesh.indices;
+		optimizeVertexCache(indices, mesh.vertices.size());
+		check(getSortedTriangles(indices) == getSortedTriangles(mesh.indices), name + ": optimizeVertexCache changed the triangles");
+		auto cacheOptimized = analyzeVertexCache(indices, mesh.vertices.size());
+		check(cacheOptimized.acmr <= source.acmr, std::format("{}: ACMR {} -> {} after optimizeVertexCache", name, source.acmr, cacheOptimized.acmr));
+
+		optimizeOverdraw(indices, mesh.vertices);
+		check(getSortedTriangles(indices) == getSortedTriangles(mesh.indices), name + ": optimizeOverdraw changed the triangles");
+		auto overdrawOptimized = analyzeVertexCache(indices, mesh.vertices.size());
+		check(overdrawOptimized.acmr <= source.acmr, std::format("{}: ACMR {} -> {} after optimizeOverdraw", name, source.acmr, overdrawOptimized.acmr));
+
+		std::vector<Vertex> vertices = mesh.vertices;
+		optimizeVertexFetch(vertices, indices);
+		check(getSortedPositionTriangles(vertices, indices) == getSortedPositionTriangles(mesh.vertices, mesh.indices),
+			name + ": optimizeVertexFetch changed the triangles");
+
+		// the vertices are numbered in the order of their first use
+		uint32_t nextVertex = 0;
+		for (uint32_t index : indices)
+		{
+			check(index <= nextVertex, name + ": vertices not in the order of their first use");
+			if (index == nextVertex)
+				nextVertex++;
+		}
+		check(nextVertex == vertices.size(), name + ": unreferenced vertices kept");
+		check(analyzeVertexCache(indices, vertices.size()).acmr == overdrawOptimized.acmr, name + ": ACMR changed by optimizeVertexFetch");
+	}
+
+	// a cache holding all the vertices transforms each one once
+	void checkLargeCache(const TestMesh& mesh)
+	{
+		auto statistics = analyzeVertexCache(mesh.indices, mesh.vertices.size(), static_cast<uint32_t>(mesh.vertices.size()));
+		check(statistics.atvr == 1.0f, std::format("{}: ATVR {} with a cache of all the vertices", mesh.name, statistics.atvr));
+	}
+
+	void checkEmpty()
+	{
+		std::vector<uint32_t> indices;
+		std::vector<Vertex> vertices(4);
+
+		auto statistics = analyzeVertexCache(indices, vertices.size());
+		check(statistics.acmr == 0.0f && statistics.atvr == 0.0f, "empty: statistics not zero");
+		optimizeVertexCache(indices, vertices.size());
+		optimizeOverdraw(indices, vertices);
+		optimizeVertexFetch(vertices, indices);
+		check(indices.empty() && vertices.empty(), "empty: vertices or indices left");
+	}
+
+	// degenerate triangles (repeated index, or zero area with distinct indices) mixed with a grid
+	void checkDegenerateTriangles()
+	{
+		TestMesh mesh = makeGrid(8);
+		mesh.name = "grid with degenerate triangles";
+		Vertex vertex;
+		vertex.pos = glm::vec3(0.5f, 0.0f, 0.0f); // on the edge between vertices 0 and 1
+		mesh.vertices.push_back(vertex);
+		auto extra = static_cast<uint32_t>(mesh.vertices.size() - 1);
+		mesh.indices.insert(mesh.indices.end(), { 0, 0, 1, 5, 5, 5, 0, extra, 1, 10, 11, 10 });
+		checkOptimization(mesh);
+
+		TestMesh degenerate{ .name = "degenerate triangles only", .vertices = std::vector<Vertex>(3), .indices = { 0, 0, 1, 2, 2, 2 } };
+		degenerate.vertices[1].pos = glm::vec3(1.0f, 0.0f, 0.0f);
+		degenerate.vertices[2].pos = glm::vec3(0.0f, 1.0f, 0.0f);
+		checkOptimization(degenerate);
+	}
+}
+
+int main()
+{
+	checkOptimization(makeGrid(32));
+	checkOptimization(shuffleTriangles(makeGrid(32)));
+	checkOptimization(shuffleTriangles(makeSphere(24, 32)));
+	checkLargeCache(makeGrid(32));
+	checkLargeCache(shuffleTriangles(makeSphere(24, 32)));
+	checkEmpty();
+	checkDegenerateTriangles();
+
+	return getResult("optimizer");
+}
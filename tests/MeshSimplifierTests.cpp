@@ -0,0 +1,79 @@
+#include "MeshSimplifier.hpp"
+#include "TestMeshes.hpp"
+
+// std
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <string>
+#include <vector>
+
+// CPU checks of the LOD chains of simplifyLodChain (used by Mesh::generateLods): fewer indices at each level, no error
+// on a flat surface, and on a sphere a reported error bounding the distance of the original vertices.
+
+using namespace m1;
+using namespace m1::test;
+
+namespace
+{
+	// largest distance of the original vertices to the simplified surface
+	float getMaxVertexDistance(const TestMesh& mesh, const std::vector<uint32_t>& indices)
+	{
+		float maxDistance = 0.0f;
+		for (const auto& vertex : mesh.vertices)
+		{
+			float distance = std::numeric_limits<float>::max();
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				glm::vec3 closest = getClosestPoint(vertex.pos, mesh.vertices[indices[i]].pos,
+					mesh.vertices[indices[i + 1]].pos, mesh.vertices[indices[i + 2]].pos);
+				distance = std::min(distance, glm::distance(vertex.pos, closest));
+			}
+			maxDistance = std::max(maxDistance, distance);
+		}
+		return maxDistance;
+	}
+
+	// unit sphere: the curvature gives each level an error, which stays a small fraction of the radius
+	void checkSphere()
+	{
+		TestMesh sphere = makeSphere(32, 48);
+		auto lods = simplifyLodChain(sphere.vertices, sphere.indices);
+		check(!lods.empty() && lods.size() < MAX_LODS, std::format("{}: {} simplified levels", sphere.name, lods.size()));
+
+		size_t previousCount = sphere.indices.size();
+		for (size_t i = 0; i < lods.size(); i++)
+		{
+			std::string lodName = std::format("{}: LOD {}", sphere.name, i + 1);
+			const SimplifiedLod& lod = lods[i];
+			check(lod.indices.size() % 3 == 0 && !lod.indices.empty(), lodName + " not a triangle list");
+			check(lod.indices.size() < previousCount, lodName + " index count not decreasing");
+			check(lod.indices.size() / 3 >= MIN_LOD_TRIANGLES, lodName + " below the minimum triangle count");
+			previousCount = lod.indices.size();
+
+			float distance = getMaxVertexDistance(sphere, lod.indices);
+			check(distance > 0.0f && lod.error > 0.0f, std::format("{} error {} on a curved surface", lodName, lod.error));
+			check(distance <= lod.error * 1.0001f + 1e-5f,
+				std::format("{} error {} not bounding the vertex distance {}", lodName, lod.error, distance));
+			check(lod.error < 0.1f, std::format("{} error {} larger than a tenth of the radius", lodName, lod.error));
+		}
+	}
+
+	// the collapses in a plane keep the surface: no error whatever the level
+	void checkFlatGrid()
+	{
+		TestMesh grid = makeGrid(48);
+		auto lods = simplifyLodChain(grid.vertices, grid.indices);
+		check(lods.size() > 1, grid.name + ": not simplified");
+		for (const auto& lod : lods)
+			check(lod.error < 1e-4f, std::format("{}: error {} on a flat surface", grid.name, lod.error));
+	}
+}
+
+int main()
+{
+	checkSphere();
+	checkFlatGrid();
+
+	return getResult("simplifier");
+}
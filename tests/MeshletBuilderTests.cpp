@@ -0,0 +1,122 @@
+#include "MeshletBuilder.hpp"
+#include "TestMeshes.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <format>
+#include <string>
+#include <vector>
+
+// CPU checks of buildMeshlets: limits, triangles coverage, bounding spheres and normal cones.
+
+using namespace m1;
+using namespace m1::test;
+
+namespace
+{
+	void checkMeshlets(const TestMesh& mesh)
+	{
+		std::vector<uint32_t> meshletIndices;
+		auto meshlets = buildMeshlets(mesh.indices, mesh.vertices, meshletIndices);
+		const std::string& name = mesh.name;
+
+		// the meshlets are consecutive ranges of meshletIndices
+		uint32_t nextIndex = 0;
+		for (const auto& meshlet : meshlets)
+		{
+			check(meshlet.firstIndex == nextIndex, name + ": meshlet ranges not consecutive");
+			nextIndex = meshlet.firstIndex + meshlet.triangleCount * 3;
+		}
+		check(nextIndex == meshletIndices.size(), name + ": meshlet ranges not covering the indices");
+
+		// every input triangle emitted exactly once, with its winding
+		std::vector<std::array<uint32_t, 3>> inputTriangles, outputTriangles;
+		for (size_t i = 0; i < mesh.indices.size() / 3; i++)
+			inputTriangles.push_back(getTriangle(mesh.indices, i));
+		for (size_t i = 0; i < meshletIndices.size() / 3; i++)
+			outputTriangles.push_back(getTriangle(meshletIndices, i));
+		std::ranges::sort(inputTriangles);
+		std::ranges::sort(outputTriangles);
+		check(inputTriangles == outputTriangles, name + ": triangles not emitted exactly once");
+
+		for (size_t m = 0; m < meshlets.size(); m++)
+		{
+			const Meshlet& meshlet = meshlets[m];
+			std::string meshletName = std::format("{}: meshlet {}", name, m);
+
+			std::vector<uint32_t> vertices(meshletIndices.begin() + meshlet.firstIndex,
+				meshletIndices.begin() + meshlet.firstIndex + meshlet.triangleCount * 3);
+			std::ranges::sort(vertices);
+			vertices.erase(std::ranges::unique(vertices).begin(), vertices.end());
+
+			// limits
+			check(meshlet.triangleCount > 0, meshletName + " is empty");
+			check(meshlet.triangleCount <= MAX_MESHLET_TRIANGLES, meshletName + " has too many triangles");
+			check(meshlet.vertexCount <= MAX_MESHLET_VERTICES, meshletName + " has too many vertices");
+			check(meshlet.vertexCount == vertices.size(), meshletName + " vertex count not matching its triangles");
+
+			// bounding sphere
+			for (uint32_t vertex : vertices)
+			{
+				float distance = glm::distance(meshlet.center, mesh.vertices[vertex].pos);
+				check(distance <= meshlet.radius * 1.0001f + 1e-6f, meshletName + " vertex outside the bounding sphere");
+			}
+
+			// normal cone: the normals are within the half angle (cutoff = sine) around the axis
+			if (meshlet.coneCutoff >= 1.0f)
+				continue;
+			float minDot = std::sqrt(std::max(1.0f - meshlet.coneCutoff * meshlet.coneCutoff, 0.0f));
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				auto triangle = getTriangle(meshletIndices, meshlet.firstIndex / 3 + t);
+				const glm::vec3& p0 = mesh.vertices[triangle[0]].pos;
+				glm::vec3 normal = glm::cross(mesh.vertices[triangle[1]].pos - p0, mesh.vertices[triangle[2]].pos - p0);
+				float length = glm::length(normal);
+				if (length == 0.0f)
+					continue; // degenerate
+				check(glm::dot(normal / length, meshlet.coneAxis) >= minDot - 1e-4f, meshletName + " normal outside its cone");
+			}
+		}
+	}
+
+	// degenerate triangles (a, a, b) with distinct vertices: 32 triangles of 2 vertices fill exactly one meshlet
+	void checkDegenerateTriangles()
+	{
+		TestMesh mesh{ .name = "degenerate triangles" };
+		for (uint32_t i = 0; i < MAX_MESHLET_VERTICES; i++)
+		{
+			Vertex vertex;
+			vertex.pos = glm::vec3(static_cast<float>(i), static_cast<float>(i % 2), 0.0f);
+			mesh.vertices.push_back(vertex);
+		}
+		for (uint32_t i = 0; i < MAX_MESHLET_VERTICES; i += 2)
+			mesh.indices.insert(mesh.indices.end(), { i, i, i + 1 });
+
+		checkMeshlets(mesh);
+
+		std::vector<uint32_t> meshletIndices;
+		auto meshlets = buildMeshlets(mesh.indices, mesh.vertices, meshletIndices);
+		check(meshlets.size() == 1, mesh.name + ": the repeated index counted as two vertices");
+	}
+}
+
+int main()
+{
+	checkMeshlets(makeSphere(100, 100));
+	checkMeshlets(makeSphere(4, 6));
+	checkMeshlets(makeGrid(64));
+	checkDegenerateTriangles();
+
+	// a single flat grid fits in front-facing cones
+	{
+		TestMesh grid = makeGrid(4);
+		std::vector<uint32_t> meshletIndices;
+		auto meshlets = buildMeshlets(grid.indices, grid.vertices, meshletIndices);
+		check(meshlets.size() == 1 && meshlets[0].coneCutoff < 1e-3f && meshlets[0].coneAxis.z > 0.999f,
+			"grid 4x4: flat meshlet without a tight normal cone");
+	}
+
+	return getResult("meshlet");
+}
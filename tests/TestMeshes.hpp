@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+// std
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Helpers shared by the CPU tests: failed checks counter and generated meshes. Each test executable returns the
+// number of failed checks (getResult), so ctest reports it as failed if any.
+
+namespace m1::test
+{
+	inline int failures = 0;
+
+	inline void check(bool condition, const std::string& message)
+	{
+		if (!condition)
+		{
+			std::cerr << "FAILED: " << message << '\n';
+			failures++;
+		}
+	}
+
+	inline int getResult(const std::string& suite)
+	{
+		if (failures == 0)
+			std::cout << "All " << suite << " checks passed\n";
+		return failures;
+	}
+
+	struct TestMesh
+	{
+		std::string name;
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// UV sphere of (rings + 1) x (segments + 1) vertices, counterclockwise from the outside. The first and last
+	// columns are a seam (same positions) and the rings stop half a step before the poles (open borders)
+	inline TestMesh makeSphere(uint32_t rings, uint32_t segments)
+	{
+		TestMesh mesh{ .name = std::format("sphere {}x{}", rings, segments) };
+		for (uint32_t i = 0; i <= rings; i++)
+		{
+			for (uint32_t j = 0; j <= segments; j++)
+			{
+				float theta = 3.14159265f * (static_cast<float>(i) + 0.5f) / static_cast<float>(rings + 1);
+				float phi = 6.28318531f * static_cast<float>(j) / static_cast<float>(segments);
+				Vertex vertex;
+				vertex.pos = glm::vec3(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+				vertex.normal = vertex.pos;
+				mesh.vertices.push_back(vertex);
+			}
+		}
+		for (uint32_t i = 0; i < rings; i++)
+		{
+			for (uint32_t j = 0; j < segments; j++)
+			{
+				uint32_t a = i * (segments + 1) + j, b = a + 1, c = a + segments + 1, d = c + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+			}
+		}
+		return mesh;
+	}
+
+	// flat grid in the z = 0 plane, facing +z
+	inline TestMesh makeGrid(uint32_t size)
+	{
+		TestMesh mesh{ .name = std::format("grid {}x{}", size, size) };
+		for (uint32_t y = 0; y <= size; y++)
+		{
+			for (uint32_t x = 0; x <= size; x++)
+			{
+				Vertex vertex;
+				vertex.pos = glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f);
+				vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+				mesh.vertices.push_back(vertex);
+			}
+		}
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				uint32_t a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+			}
+		}
+		return mesh;
+	}
+
+	inline std::array<uint32_t, 3> getTriangle(const std::vector<uint32_t>& indices, size_t triangle)
+	{
+		return { indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2] };
+	}
+}
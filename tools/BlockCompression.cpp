@@ -0,0 +1,379 @@
+#include "BlockCompression.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace m1
+{
+	namespace
+	{
+		constexpr uint32_t BLOCK_SIZE = 16; // bytes of a 4x4 block
+		constexpr std::array<int, 16> WEIGHTS_4BIT = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// little-endian bit writer of a 128-bit block
+		class BlockWriter
+		{
+		public:
+			explicit BlockWriter(uint8_t* block) : _block(block) { std::fill_n(_block, BLOCK_SIZE, 0); }
+
+			void write(uint32_t value, uint32_t bitCount)
+			{
+				for (uint32_t i = 0; i < bitCount; i++, _position++)
+				{
+					if (value >> i & 1u)
+						_block[_position / 8] |= static_cast<uint8_t>(1u << (_position % 8));
+				}
+			}
+
+		private:
+			uint8_t* _block;
+			uint32_t _position = 0;
+		};
+
+		// calls encodeBlock(texels, block) for each 4x4 block, texels are the clamped coordinates of the block (row by row)
+		template <typename Texel, typename EncodeBlock>
+		std::vector<uint8_t> encodeBlocks(const Texel* texels, uint32_t width, uint32_t height, EncodeBlock encodeBlock)
+		{
+			uint32_t blocksX = (width + 3) / 4;
+			uint32_t blocksY = (height + 3) / 4;
+			std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * BLOCK_SIZE);
+
+			std::array<Texel, 16> blockTexels;
+			for (uint32_t by = 0; by < blocksY; by++)
+			{
+				for (uint32_t bx = 0; bx < blocksX; bx++)
+				{
+					for (uint32_t i = 0; i < 16; i++)
+					{
+						uint32_t x = std::min(bx * 4 + i % 4, width - 1);
+						uint32_t y = std::min(by * 4 + i / 4, height - 1);
+						blockTexels[i] = texels[static_cast<size_t>(y) * width + x];
+					}
+					encodeBlock(blockTexels, &blocks[(static_cast<size_t>(by) * blocksX + bx) * BLOCK_SIZE]);
+				}
+			}
+
+			return blocks;
+		}
+
+		// line through the texels (mean + principal axis), texels projected on the axis are in [tMin, tMax]
+		template <size_t N>
+		void fitLine(const std::array<std::array<float, N>, 16>& texels, std::array<float, N>& start, std::array<float, N>& end)
+		{
+			std::array<float, N> mean{};
+			for (const auto& texel : texels)
+				for (size_t c = 0; c < N; c++)
+					mean[c] += texel[c] / 16.0f;
+
+			std::array<std::array<float, N>, N> covariance{};
+			for (const auto& texel : texels)
+				for (size_t i = 0; i < N; i++)
+					for (size_t j = 0; j < N; j++)
+						covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+
+			// power iteration, starting from the diagonal of the bounding box
+			std::array<float, N> axis{};
+			for (size_t c = 0; c < N; c++)
+			{
+				float min = texels[0][c], max = texels[0][c];
+				for (const auto& texel : texels)
+				{
+					min = std::min(min, texel[c]);
+					max = std::max(max, texel[c]);
+				}
+				axis[c] = max - min;
+			}
+
+			for (int iteration = 0; iteration < 8; iteration++)
+			{
+				std::array<float, N> next{};
+				for (size_t i = 0; i < N; i++)
+					for (size_t j = 0; j < N; j++)
+						next[i] += covariance[i][j] * axis[j];
+
+				float length = 0.0f;
+				for (float v : next)
+					length += v * v;
+				if (length <= std::numeric_limits<float>::min())
+					break;
+
+				length = std::sqrt(length);
+				for (size_t c = 0; c < N; c++)
+					axis[c] = next[c] / length;
+			}
+
+			float axisLength = 0.0f;
+			for (float v : axis)
+				axisLength += v * v;
+
+			float tMin = 0.0f, tMax = 0.0f;
+			if (axisLength > 0.0f)
+			{
+				tMin = std::numeric_limits<float>::max();
+				tMax = std::numeric_limits<float>::lowest();
+				for (const auto& texel : texels)
+				{
+					float t = 0.0f;
+					for (size_t c = 0; c < N; c++)
+						t += (texel[c] - mean[c]) * axis[c] / axisLength;
+					tMin = std::min(tMin, t);
+					tMax = std::max(tMax, t);
+				}
+			}
+
+			for (size_t c = 0; c < N; c++)
+			{
+				start[c] = mean[c] + axis[c] * tMin;
+				end[c] = mean[c] + axis[c] * tMax;
+			}
+		}
+
+		//--------- BC7 ----------//
+
+		// 7-bit endpoint + p-bit closest to the color
+		void quantizeBc7Endpoint(const std::array<float, 4>& color, std::array<uint32_t, 4>& quantized, uint32_t& pBit)
+		{
+			float bestError = std::numeric_limits<float>::max();
+			for (uint32_t p = 0; p < 2; p++)
+			{
+				std::array<uint32_t, 4> candidate{};
+				float error = 0.0f;
+				for (size_t c = 0; c < 4; c++)
+				{
+					float value = std::clamp(color[c], 0.0f, 255.0f);
+					candidate[c] = static_cast<uint32_t>(std::clamp(std::lround((value - static_cast<float>(p)) / 2.0f), 0l, 127l));
+					float delta = static_cast<float>(candidate[c] << 1 | p) - value;
+					error += delta * delta;
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					quantized = candidate;
+					pBit = p;
+				}
+			}
+		}
+
+		void encodeBc7Block(const std::array<std::array<uint8_t, 4>, 16>& texels, uint8_t* block)
+		{
+			std::array<std::array<float, 4>, 16> colors;
+			for (size_t i = 0; i < 16; i++)
+				for (size_t c = 0; c < 4; c++)
+					colors[i][c] = texels[i][c];
+
+			std::array<float, 4> start, end;
+			fitLine(colors, start, end);
+
+			std::array<std::array<uint32_t, 4>, 2> endpoints;
+			std::array<uint32_t, 2> pBits;
+			quantizeBc7Endpoint(start, endpoints[0], pBits[0]);
+			quantizeBc7Endpoint(end, endpoints[1], pBits[1]);
+
+			// palette of the 16 interpolated colors
+			std::array<std::array<int, 4>, 16> palette;
+			for (size_t i = 0; i < 16; i++)
+			{
+				for (size_t c = 0; c < 4; c++)
+				{
+					int e0 = static_cast<int>(endpoints[0][c] << 1 | pBits[0]);
+					int e1 = static_cast<int>(endpoints[1][c] << 1 | pBits[1]);
+					palette[i][c] = (e0 * (64 - WEIGHTS_4BIT[i]) + e1 * WEIGHTS_4BIT[i] + 32) >> 6;
+				}
+			}
+
+			std::array<uint32_t, 16> indices;
+			for (size_t t = 0; t < 16; t++)
+			{
+				int bestError = std::numeric_limits<int>::max();
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					int error = 0;
+					for (size_t c = 0; c < 4; c++)
+					{
+						int delta = palette[i][c] - texels[t][c];
+						error += delta * delta;
+					}
+					if (error < bestError)
+					{
+						bestError = error;
+						indices[t] = i;
+					}
+				}
+			}
+
+			// the most significant bit of the anchor index (texel 0) is implicit 0
+			if (indices[0] >= 8)
+			{
+				std::swap(endpoints[0], endpoints[1]);
+				std::swap(pBits[0], pBits[1]);
+				for (auto& index : indices)
+					index = 15 - index;
+			}
+
+			BlockWriter writer(block);
+			writer.write(1u << 6, 7); // mode 6
+			for (size_t c = 0; c < 4; c++)
+			{
+				writer.write(endpoints[0][c], 7);
+				writer.write(endpoints[1][c], 7);
+			}
+			writer.write(pBits[0], 1);
+			writer.write(pBits[1], 1);
+			for (size_t t = 0; t < 16; t++)
+				writer.write(indices[t], t == 0 ? 3 : 4);
+		}
+
+		//--------- BC4/BC5 ----------//
+
+		void encodeBc4Block(const std::array<std::array<uint8_t, 4>, 16>& texels, size_t channel, uint8_t* block)
+		{
+			uint8_t max = 0, min = 255;
+			for (const auto& texel : texels)
+			{
+				max = std::max(max, texel[channel]);
+				min = std::min(min, texel[channel]);
+			}
+
+			// red0 > red1: 8 values mode (with red0 == red1 all the indices are 0)
+			std::array<int, 8> palette{ max, min };
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * max + (i - 1) * min) / 7;
+
+			block[0] = max;
+			block[1] = min;
+			uint64_t indices = 0;
+			for (size_t t = 0; t < 16; t++)
+			{
+				uint64_t bestIndex = 0;
+				int bestError = std::numeric_limits<int>::max();
+				for (uint64_t i = 0; i < 8; i++)
+				{
+					int error = std::abs(palette[i] - texels[t][channel]);
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = i;
+					}
+				}
+				indices |= bestIndex << (3 * t);
+			}
+
+			for (size_t i = 0; i < 6; i++)
+				block[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+		}
+
+		//--------- BC6H ----------//
+
+		// BC6H unsigned endpoints are interpolated in a space where the half float bits are scaled by 64/31
+		constexpr float HALF_TO_BC6H = 64.0f / 31.0f;
+		constexpr uint16_t MAX_HALF = 0x7BFF; // 65504
+
+		int unquantizeBc6h(uint32_t value)
+		{
+			if (value == 0)
+				return 0;
+			if (value == 1023)
+				return 0xFFFF;
+			return static_cast<int>(((value << 16) + 0x8000) >> 10);
+		}
+
+		void encodeBc6hBlock(const std::array<std::array<uint16_t, 4>, 16>& texels, uint8_t* block)
+		{
+			std::array<std::array<int, 3>, 16> halves;
+			std::array<std::array<float, 3>, 16> colors;
+			for (size_t i = 0; i < 16; i++)
+			{
+				for (size_t c = 0; c < 3; c++)
+				{
+					uint16_t half = texels[i][c];
+					halves[i][c] = half & 0x8000 ? 0 : std::min(half, MAX_HALF); // negative => 0, inf/nan => max
+					colors[i][c] = static_cast<float>(halves[i][c]) * HALF_TO_BC6H;
+				}
+			}
+
+			std::array<float, 3> start, end;
+			fitLine(colors, start, end);
+
+			std::array<std::array<uint32_t, 3>, 2> endpoints;
+			for (size_t c = 0; c < 3; c++)
+			{
+				endpoints[0][c] = static_cast<uint32_t>(std::clamp(std::lround(start[c] / 64.0f - 0.5f), 0l, 1023l));
+				endpoints[1][c] = static_cast<uint32_t>(std::clamp(std::lround(end[c] / 64.0f - 0.5f), 0l, 1023l));
+			}
+
+			std::array<std::array<int, 3>, 16> palette;
+			for (size_t i = 0; i < 16; i++)
+			{
+				for (size_t c = 0; c < 3; c++)
+				{
+					int e0 = unquantizeBc6h(endpoints[0][c]);
+					int e1 = unquantizeBc6h(endpoints[1][c]);
+					palette[i][c] = ((e0 * (64 - WEIGHTS_4BIT[i]) + e1 * WEIGHTS_4BIT[i] + 32) >> 6) * 31 >> 6;
+				}
+			}
+
+			std::array<uint32_t, 16> indices;
+			for (size_t t = 0; t < 16; t++)
+			{
+				int64_t bestError = std::numeric_limits<int64_t>::max();
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					int64_t error = 0;
+					for (size_t c = 0; c < 3; c++)
+					{
+						int64_t delta = palette[i][c] - halves[t][c];
+						error += delta * delta;
+					}
+					if (error < bestError)
+					{
+						bestError = error;
+						indices[t] = i;
+					}
+				}
+			}
+
+			// the most significant bit of the anchor index (texel 0) is implicit 0
+			if (indices[0] >= 8)
+			{
+				std::swap(endpoints[0], endpoints[1]);
+				for (auto& index : indices)
+					index = 15 - index;
+			}
+
+			BlockWriter writer(block);
+			writer.write(0x03, 5); // mode 11
+			for (size_t c = 0; c < 3; c++)
+				writer.write(endpoints[0][c], 10);
+			for (size_t c = 0; c < 3; c++)
+				writer.write(endpoints[1][c], 10);
+			for (size_t t = 0; t < 16; t++)
+				writer.write(indices[t], t == 0 ? 3 : 4);
+		}
+	}
+
+	std::vector<uint8_t> encodeBc7(const uint8_t* rgba, uint32_t width, uint32_t height)
+	{
+		auto* texels = reinterpret_cast<const std::array<uint8_t, 4>*>(rgba);
+		return encodeBlocks(texels, width, height, encodeBc7Block);
+	}
+
+	std::vector<uint8_t> encodeBc5(const uint8_t* rgba, uint32_t width, uint32_t height)
+	{
+		auto* texels = reinterpret_cast<const std::array<uint8_t, 4>*>(rgba);
+		return encodeBlocks(texels, width, height, [](const std::array<std::array<uint8_t, 4>, 16>& blockTexels, uint8_t* block)
+		{
+			encodeBc4Block(blockTexels, 0, block);
+			encodeBc4Block(blockTexels, 1, block + 8);
+		});
+	}
+
+	std::vector<uint8_t> encodeBc6h(const uint16_t* rgba, uint32_t width, uint32_t height)
+	{
+		auto* texels = reinterpret_cast<const std::array<uint16_t, 4>*>(rgba);
+		return encodeBlocks(texels, width, height, encodeBc6hBlock);
+	}
+}
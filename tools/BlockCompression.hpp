@@ -0,0 +1,21 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace m1
+{
+	/*
+		CPU block compression encoders (4x4 texel blocks of 16 bytes), used offline by the texture baker.
+		The blocks are returned row by row; the partial blocks at the right/bottom edges clamp the coordinates.
+		Each encoder uses a single mode, favouring speed and simplicity over the best possible quality:
+		- BC7 mode 6: one RGBA line (principal axis of the block), 7-bit endpoints + p-bit, 16 weights
+		- BC5: two BC4 channels (R, G), min/max endpoints with 8 weights
+		- BC6H mode 11: one RGB line, 10-bit endpoints, 16 weights (unsigned half floats)
+	*/
+	std::vector<uint8_t> encodeBc7(const uint8_t* rgba, uint32_t width, uint32_t height);
+	std::vector<uint8_t> encodeBc5(const uint8_t* rgba, uint32_t width, uint32_t height);
+	// rgba: half float bits, negative values are clamped to 0 and alpha is ignored
+	std::vector<uint8_t> encodeBc6h(const uint16_t* rgba, uint32_t width, uint32_t height);
+}
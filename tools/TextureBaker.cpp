@@ -0,0 +1,297 @@
+#include "BlockCompression.hpp"
+#include "Log.hpp"
+#include "graphics/Ktx2.hpp"
+
+// libs
+#include <fastgltf/core.hpp>
+#include <fastgltf/types.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <stb_image.h>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Offline texture baker: compresses the source images into KTX2 files with their full mip chain, loaded at runtime
+// instead of the source images when the device supports the BC formats (see readKtx2).
+//
+// usage: m1TextureBaker <image> <output.ktx2> --format bc7|bc7-srgb|bc5|bc6h [--no-mips]
+//        m1TextureBaker --gltf <scene.gltf> [--no-mips]
+//
+// The glTF mode bakes every external image next to its source: BC7 sRGB for the base color and emissive maps,
+// BC5 for the normal maps, BC7 for the metallic-roughness and occlusion maps.
+
+namespace
+{
+	enum class BakeFormat { Bc7, Bc7Srgb, Bc5, Bc6h };
+
+	struct BakeOptions
+	{
+		std::string input;
+		std::string output;
+		std::string gltf;
+		BakeFormat format = BakeFormat::Bc7;
+		bool mips = true;
+	};
+
+	VkFormat getVkFormat(BakeFormat format)
+	{
+		switch (format)
+		{
+			case BakeFormat::Bc7: return VK_FORMAT_BC7_UNORM_BLOCK;
+			case BakeFormat::Bc7Srgb: return VK_FORMAT_BC7_SRGB_BLOCK;
+			case BakeFormat::Bc5: return VK_FORMAT_BC5_UNORM_BLOCK;
+			case BakeFormat::Bc6h: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+		}
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	BakeFormat parseFormat(const std::string& name)
+	{
+		if (name == "bc7") return BakeFormat::Bc7;
+		if (name == "bc7-srgb") return BakeFormat::Bc7Srgb;
+		if (name == "bc5") return BakeFormat::Bc5;
+		if (name == "bc6h") return BakeFormat::Bc6h;
+		throw std::runtime_error("Unknown texture format " + name);
+	}
+
+	BakeOptions parseOptions(int argc, char* argv[])
+	{
+		BakeOptions options;
+		std::vector<std::string> positional;
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--format" && hasValue)
+				options.format = parseFormat(argv[++i]);
+			else if (arg == "--gltf" && hasValue)
+				options.gltf = argv[++i];
+			else if (arg == "--no-mips")
+				options.mips = false;
+			else if (arg.starts_with("--"))
+				m1::Log::Get().Warning("Unknown texture baker argument: " + arg);
+			else
+				positional.push_back(arg);
+		}
+
+		if (options.gltf.empty())
+		{
+			if (positional.size() != 2)
+				throw std::runtime_error("usage: m1TextureBaker <image> <output.ktx2> --format bc7|bc7-srgb|bc5|bc6h [--no-mips]");
+			options.input = positional[0];
+			options.output = positional[1];
+		}
+
+		return options;
+	}
+
+	float srgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// linear values of a mip level
+	struct Level
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<glm::vec4> texels;
+	};
+
+	// 2x2 box filter, the last row/column is repeated for the odd sizes
+	Level downsample(const Level& level)
+	{
+		Level next{ std::max(level.width / 2, 1u), std::max(level.height / 2, 1u) };
+		next.texels.resize(static_cast<size_t>(next.width) * next.height);
+		for (uint32_t y = 0; y < next.height; y++)
+		{
+			for (uint32_t x = 0; x < next.width; x++)
+			{
+				uint32_t x0 = std::min(2 * x, level.width - 1), x1 = std::min(2 * x + 1, level.width - 1);
+				uint32_t y0 = std::min(2 * y, level.height - 1), y1 = std::min(2 * y + 1, level.height - 1);
+				next.texels[static_cast<size_t>(y) * next.width + x] = 0.25f * (
+					level.texels[static_cast<size_t>(y0) * level.width + x0] + level.texels[static_cast<size_t>(y0) * level.width + x1] +
+					level.texels[static_cast<size_t>(y1) * level.width + x0] + level.texels[static_cast<size_t>(y1) * level.width + x1]);
+			}
+		}
+		return next;
+	}
+
+	std::vector<uint8_t> encodeLevel(const Level& level, BakeFormat format)
+	{
+		if (format == BakeFormat::Bc6h)
+		{
+			std::vector<uint16_t> halves(level.texels.size() * 4);
+			for (size_t i = 0; i < level.texels.size(); i++)
+				for (int c = 0; c < 4; c++)
+					halves[i * 4 + c] = glm::packHalf1x16(level.texels[i][c]);
+			return m1::encodeBc6h(halves.data(), level.width, level.height);
+		}
+
+		std::vector<uint8_t> rgba(level.texels.size() * 4);
+		for (size_t i = 0; i < level.texels.size(); i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float value = level.texels[i][c];
+				if (format == BakeFormat::Bc7Srgb && c < 3)
+					value = linearToSrgb(value);
+				rgba[i * 4 + c] = static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+			}
+		}
+
+		if (format == BakeFormat::Bc5)
+			return m1::encodeBc5(rgba.data(), level.width, level.height);
+		return m1::encodeBc7(rgba.data(), level.width, level.height);
+	}
+
+	Level loadImage(const std::string& filePath, BakeFormat format)
+	{
+		int width, height, channels;
+		Level level;
+		if (format == BakeFormat::Bc6h)
+		{
+			float* pixels = stbi_loadf(filePath.c_str(), &width, &height, &channels, 4);
+			if (!pixels)
+				throw std::runtime_error("Failed to load the image " + filePath);
+
+			level = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+			level.texels.resize(static_cast<size_t>(width) * height);
+			for (size_t i = 0; i < level.texels.size(); i++)
+				level.texels[i] = glm::vec4(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2], pixels[i * 4 + 3]);
+			stbi_image_free(pixels);
+			return level;
+		}
+
+		stbi_uc* pixels = stbi_load(filePath.c_str(), &width, &height, &channels, 4);
+		if (!pixels)
+			throw std::runtime_error("Failed to load the image " + filePath);
+
+		// the mips of the sRGB images are filtered in linear space
+		level = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+		level.texels.resize(static_cast<size_t>(width) * height);
+		for (size_t i = 0; i < level.texels.size(); i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float value = pixels[i * 4 + c] / 255.0f;
+				level.texels[i][c] = format == BakeFormat::Bc7Srgb && c < 3 ? srgbToLinear(value) : value;
+			}
+		}
+		stbi_image_free(pixels);
+		return level;
+	}
+
+	void bakeTexture(const std::string& input, const std::string& output, BakeFormat format, bool mips)
+	{
+		Level level = loadImage(input, format);
+
+		m1::Ktx2Image image
+		{
+			.format = getVkFormat(format),
+			.width = level.width,
+			.height = level.height,
+			.mipLevels = mips ? static_cast<uint32_t>(std::floor(std::log2(std::max(level.width, level.height)))) + 1 : 1,
+		};
+
+		for (uint32_t mip = 0; mip < image.mipLevels; mip++)
+		{
+			if (mip > 0)
+				level = downsample(level);
+
+			auto blocks = encodeLevel(level, format);
+			image.data.insert(image.data.end(), blocks.begin(), blocks.end());
+		}
+
+		m1::writeKtx2(output, image);
+
+		auto sourceSize = VkDeviceSize{image.width} * image.height * (format == BakeFormat::Bc6h ? 16 : 4);
+		m1::Log::Get().Info(std::format("Baked {} ({}x{}, {} levels): {} KB, level 0 {:.1f}x smaller than the uncompressed image",
+			output, image.width, image.height, image.mipLevels, image.data.size() / 1024,
+			static_cast<double>(sourceSize) / static_cast<double>((image.width + 3) / 4 * ((image.height + 3) / 4) * 16)));
+	}
+
+	// bakes each external image of the material textures with the format of its first use
+	void bakeGltf(const std::filesystem::path& path, bool mips)
+	{
+		fastgltf::Parser parser;
+		auto gltfFile = fastgltf::MappedGltfFile::FromPath(path);
+		if (!static_cast<bool>(gltfFile))
+			throw std::runtime_error("Failed to open glTF file: " + std::string(fastgltf::getErrorMessage(gltfFile.error())));
+
+		auto asset = parser.loadGltf(gltfFile.get(), path.parent_path(), fastgltf::Options::DontRequireValidAssetMember);
+		if (asset.error() != fastgltf::Error::None)
+			throw std::runtime_error("Failed to load glTF: " + std::string(fastgltf::getErrorMessage(asset.error())));
+
+		std::map<size_t, BakeFormat> imageFormats;
+		auto addTexture = [&](const auto& textureInfo, BakeFormat format)
+		{
+			if (!textureInfo.has_value())
+				return;
+
+			auto imageIndex = asset->textures[textureInfo->textureIndex].imageIndex;
+			if (!imageIndex.has_value())
+				return;
+
+			auto [it, inserted] = imageFormats.emplace(imageIndex.value(), format);
+			if (!inserted && it->second != format)
+				m1::Log::Get().Warning(std::format("glTF image {} used with different formats, baked for its first use", imageIndex.value()));
+		};
+
+		for (const auto& material : asset->materials)
+		{
+			addTexture(material.pbrData.baseColorTexture, BakeFormat::Bc7Srgb);
+			addTexture(material.pbrData.metallicRoughnessTexture, BakeFormat::Bc7);
+			addTexture(material.normalTexture, BakeFormat::Bc5);
+			addTexture(material.occlusionTexture, BakeFormat::Bc7);
+			addTexture(material.emissiveTexture, BakeFormat::Bc7Srgb);
+		}
+
+		for (auto [imageIndex, format] : imageFormats)
+		{
+			const auto* uri = std::get_if<fastgltf::sources::URI>(&asset->images[imageIndex].data);
+			if (!uri || !uri->uri.isLocalPath())
+			{
+				m1::Log::Get().Warning(std::format("glTF image {} is not an external file, skipped", imageIndex));
+				continue;
+			}
+
+			auto imagePath = (path.parent_path() / uri->uri.fspath()).string();
+			bakeTexture(imagePath, m1::getKtx2Path(imagePath), format, mips);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		auto options = parseOptions(argc, argv);
+		if (!options.gltf.empty())
+			bakeGltf(options.gltf, options.mips);
+		else
+			bakeTexture(options.input, options.output, options.format, options.mips);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}